@@ -0,0 +1,247 @@
+﻿#include "settings_manager.h"
+#include "core/system/user_paths.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <system_error>
+
+namespace knoux::core::config {
+
+namespace {
+
+// Helper: Top-level keys added, removed or modified between two settings objects
+std::vector<std::string> ChangedKeys(const nlohmann::json& before, const nlohmann::json& after) {
+    std::vector<std::string> changed;
+    for (auto it = before.begin(); it != before.end(); ++it) {
+        const auto match = after.find(it.key());
+        if (match == after.end() || *match != it.value()) {
+            changed.push_back(it.key());
+        }
+    }
+    for (auto it = after.begin(); it != after.end(); ++it) {
+        if (!before.contains(it.key())) {
+            changed.push_back(it.key());
+        }
+    }
+    return changed;
+}
+
+} // namespace
+
+// Static instance pointer
+static std::shared_ptr<SettingsManager> g_settingsInstance = nullptr;
+static std::once_flag g_settingsOnce;
+
+std::shared_ptr<SettingsManager> SettingsManager::GetInstance() {
+    std::call_once(g_settingsOnce, [] { g_settingsInstance = std::shared_ptr<SettingsManager>(new SettingsManager()); });
+    return g_settingsInstance;
+}
+
+SettingsManager::SettingsManager()
+    : m_configPath(system::UserDataDirectory() / "settings.json"),
+      m_snapshot(std::make_shared<const nlohmann::json>(nlohmann::json::object())) {
+}
+
+bool SettingsManager::Load() {
+    if (!EnsureConfigDir()) {
+        return false;
+    }
+    std::error_code error;
+    if (!std::filesystem::exists(m_configPath, error)) {
+        // First run: persist the current (default) settings
+        return Save();
+    }
+
+    std::ifstream in(m_configPath);
+    if (!in.is_open()) {
+        return false;
+    }
+    nlohmann::json loaded = nlohmann::json::parse(in, nullptr, false);
+    if (loaded.is_discarded() || !loaded.is_object()) {
+        return false;
+    }
+    return Modify([&loaded](nlohmann::json& settings) {
+        settings = std::move(loaded);
+        return true;
+    });
+}
+
+bool SettingsManager::Save() const {
+    if (!EnsureConfigDir()) {
+        return false;
+    }
+    // Held so concurrent saves do not share the temporary file
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const std::filesystem::path temporary = m_configPath.string() + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::out | std::ios::trunc);
+        if (!out.is_open()) {
+            return false;
+        }
+        out << m_snapshot->dump(4);
+        if (!out.good()) {
+            return false;
+        }
+    }
+
+    std::error_code error;
+    if (std::filesystem::exists(m_configPath, error)) {
+        std::filesystem::copy_file(m_configPath, m_configPath.string() + ".bak",
+                                   std::filesystem::copy_options::overwrite_existing, error);
+    }
+    std::filesystem::rename(temporary, m_configPath, error);
+    return !error;
+}
+
+bool SettingsManager::Update(const std::function<void(nlohmann::json& settings)>& edit) {
+    return Modify([&edit](nlohmann::json& settings) {
+        edit(settings);
+        return true;
+    });
+}
+
+uint64_t SettingsManager::Subscribe(ChangeCallback callback) {
+    std::lock_guard<std::mutex> lock(m_notifyMutex);
+    const uint64_t id = m_nextSubscriberId++;
+    m_subscribers.emplace(id, std::move(callback));
+    return id;
+}
+
+void SettingsManager::Unsubscribe(uint64_t id) {
+    std::lock_guard<std::mutex> lock(m_notifyMutex);
+    m_subscribers.erase(id);
+}
+
+bool SettingsManager::Has(const std::string& key) const {
+    return Snapshot()->contains(key);
+}
+
+bool SettingsManager::Remove(const std::string& key) {
+    return Modify([&key](nlohmann::json& settings) {
+        return settings.erase(key) > 0;
+    });
+}
+
+bool SettingsManager::Clear() {
+    return Modify([](nlohmann::json& settings) {
+        settings = nlohmann::json::object();
+        return true;
+    });
+}
+
+std::string SettingsManager::GetConfigPath() const {
+    return m_configPath.string();
+}
+
+bool SettingsManager::EnsureConfigDir() const {
+    std::error_code error;
+    const std::filesystem::path directory = m_configPath.parent_path();
+    if (std::filesystem::is_directory(directory, error)) {
+        return true;
+    }
+    return std::filesystem::create_directories(directory, error) && !error;
+}
+
+bool SettingsManager::Modify(const std::function<bool(nlohmann::json& settings)>& edit) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const std::shared_ptr<const nlohmann::json> current = m_snapshot;
+        nlohmann::json next = *current;
+        try {
+            if (!edit(next) || !next.is_object()) {
+                return false;
+            }
+        } catch (...) {
+            return false;
+        }
+
+        const std::vector<std::string> changed = ChangedKeys(*current, next);
+        if (changed.empty()) {
+            return true;
+        }
+        const auto published = std::make_shared<const nlohmann::json>(std::move(next));
+        std::atomic_store_explicit(&m_snapshot, published, std::memory_order_release);
+
+        // Refresh handles before returning so a Set() is visible through them at once
+        for (const std::string& key : changed) {
+            const auto entry = m_slots.find(key);
+            if (entry == m_slots.end()) {
+                continue;
+            }
+            std::vector<std::weak_ptr<SettingSlotBase>>& slots = entry->second;
+            for (auto it = slots.begin(); it != slots.end();) {
+                if (const std::shared_ptr<SettingSlotBase> slot = it->lock()) {
+                    slot->Refresh(*published);
+                    ++it;
+                } else {
+                    it = slots.erase(it);
+                }
+            }
+            if (slots.empty()) {
+                m_slots.erase(entry);
+            }
+        }
+
+        std::lock_guard<std::mutex> notifyLock(m_notifyMutex);
+        m_pendingChanges.insert(m_pendingChanges.end(), changed.begin(), changed.end());
+    }
+    DispatchChanges();
+    return true;
+}
+
+void SettingsManager::AttachSlot(const std::shared_ptr<SettingSlotBase>& slot) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    slot->Refresh(*m_snapshot);
+    std::vector<std::weak_ptr<SettingSlotBase>>& slots = m_slots[slot->Key()];
+    // Drop handles released since the key was last bound
+    slots.erase(std::remove_if(slots.begin(), slots.end(),
+                               [](const std::weak_ptr<SettingSlotBase>& weak) { return weak.expired(); }),
+                slots.end());
+    slots.push_back(slot);
+}
+
+void SettingsManager::DispatchChanges() {
+    std::unique_lock<std::mutex> lock(m_notifyMutex);
+    if (m_dispatching) {
+        // The dispatching thread picks these changes up as its next batch
+        return;
+    }
+    m_dispatching = true;
+
+    // Cleared on every exit, or a throw would leave later changes queued for no one
+    struct DispatchReset {
+        std::unique_lock<std::mutex>& lock;
+        bool& dispatching;
+        ~DispatchReset() {
+            if (!lock.owns_lock()) {
+                lock.lock();
+            }
+            dispatching = false;
+        }
+    } reset{ lock, m_dispatching };
+
+    while (!m_pendingChanges.empty()) {
+        std::vector<std::string> batch;
+        batch.swap(m_pendingChanges);
+        std::sort(batch.begin(), batch.end());
+        batch.erase(std::unique(batch.begin(), batch.end()), batch.end());
+
+        std::vector<ChangeCallback> callbacks;
+        callbacks.reserve(m_subscribers.size());
+        for (const auto& [id, callback] : m_subscribers) {
+            callbacks.push_back(callback);
+        }
+
+        lock.unlock();
+        for (const ChangeCallback& callback : callbacks) {
+            try {
+                callback(batch);
+            } catch (...) {
+                // One failing subscriber must not cost the others the batch
+            }
+        }
+        lock.lock();
+    }
+}
+
+} // namespace knoux::core::config
@@ -2,12 +2,148 @@
 
 #include <string>
 #include <unordered_map>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <type_traits>
+#include <vector>
+#include <cstdint>
 #include <filesystem>
 #include <nlohmann/json.hpp>
 
 namespace knoux::core::config {
 
+/**
+ * @class SettingSlotBase
+ * @brief Cached value behind Setting<T> handles of one key.
+ *
+ * Slots are owned by their handles; the manager keeps weak references and
+ * refreshes every live slot of a key whenever a write changes that key.
+ */
+class SettingSlotBase {
+public:
+    explicit SettingSlotBase(std::string key) : m_key(std::move(key)) {}
+
+    virtual ~SettingSlotBase() = default;
+
+    const std::string& Key() const { return m_key; }
+
+    /**
+     * @brief Re-reads the key from a published snapshot (writer side only)
+     */
+    virtual void Refresh(const nlohmann::json& settings) = 0;
+
+private:
+    std::string m_key;
+};
+
+/**
+ * @class SettingSlot
+ * @brief Typed slot: lock-free std::atomic<T> for arithmetic and other small
+ *        trivially copyable types, an atomically swapped shared_ptr otherwise
+ */
+template<typename T>
+class SettingSlot final : public SettingSlotBase {
+public:
+    SettingSlot(std::string key, T defaultValue)
+        : SettingSlotBase(std::move(key)), m_default(std::move(defaultValue)) {
+        Store(m_default);
+    }
+
+    T Load() const {
+        if constexpr (kInline) {
+            return m_value.load(std::memory_order_acquire);
+        } else {
+            return *std::atomic_load_explicit(&m_value, std::memory_order_acquire);
+        }
+    }
+
+    void Refresh(const nlohmann::json& settings) override {
+        const auto it = settings.find(Key());
+        if (it == settings.end()) {
+            Store(m_default);
+            return;
+        }
+        try {
+            Store(it->template get<T>());
+        } catch (...) {
+            Store(m_default);
+        }
+    }
+
+private:
+    template<typename U, typename = void>
+    struct IsInline : std::false_type {};
+
+    template<typename U>
+    struct IsInline<U, std::enable_if_t<std::is_trivially_copyable_v<U>>>
+        : std::bool_constant<std::atomic<U>::is_always_lock_free> {};
+
+    static constexpr bool kInline = IsInline<T>::value;
+
+    void Store(T value) {
+        if constexpr (kInline) {
+            m_value.store(value, std::memory_order_release);
+        } else {
+            std::atomic_store_explicit(&m_value, std::make_shared<const T>(std::move(value)), std::memory_order_release);
+        }
+    }
+
+    T m_default;
+    std::conditional_t<kInline, std::atomic<T>, std::shared_ptr<const T>> m_value;
+};
+
+/**
+ * @class Setting
+ * @brief Pre-resolved, typed handle to one setting.
+ *
+ * Reading never touches the JSON, the key or a mutex: for arithmetic types
+ * it is a single atomic load of the cached value, which the manager
+ * updates when the key is written. Falls back to the bind-time default if
+ * the key is missing or holds another type. Copies share one slot.
+ */
+template<typename T>
+class Setting {
+public:
+    Setting() = default;
+
+    T Get() const { return m_slot ? m_slot->Load() : T{}; }
+
+    operator T() const { return Get(); }
+
+    bool IsBound() const { return m_slot != nullptr; }
+
+private:
+    friend class SettingsManager;
+
+    explicit Setting(std::shared_ptr<const SettingSlot<T>> slot) : m_slot(std::move(slot)) {}
+
+    std::shared_ptr<const SettingSlot<T>> m_slot;
+};
+
+class SettingsManager;
+
+/**
+ * @class SettingBinding
+ * @brief Result of SettingsManager::Bind(key); converts to the Setting<T> it is
+ *        assigned to, with T{} as default
+ */
+class SettingBinding {
+public:
+    template<typename T>
+    operator Setting<T>() const;
+
+private:
+    friend class SettingsManager;
+
+    SettingBinding(SettingsManager& manager, std::string key) : m_manager(manager), m_key(std::move(key)) {}
+
+    SettingsManager& m_manager;
+    std::string m_key;
+};
+
 /**
  * @class SettingsManager
  * @brief Centralized configuration manager for KNOUX Player X™.
@@ -22,9 +158,22 @@ namespace knoux::core::config {
  * - Type-safe access via template getters
  * - Validation on load
  * - Automatic backup on critical changes
+ *
+ * Settings are published as immutable snapshots (read-copy-update): readers
+ * atomically load the current snapshot and never wait for writers, while
+ * writers copy it, apply their change and publish the copy under a writer
+ * mutex. Hot paths (DSP, render loop) should Bind() a Setting<T> once and
+ * read that instead of calling Get() per buffer. Change notifications are
+ * coalesced: one Update() reports all its keys at once, and writes landing
+ * while subscribers are being called are delivered as the next batch.
  */
 class SettingsManager {
 public:
+    /**
+     * @brief Receives the keys changed since the previous notification
+     */
+    using ChangeCallback = std::function<void(const std::vector<std::string>& changedKeys)>;
+
     /**
      * @brief Singleton instance accessor
      */
@@ -52,6 +201,13 @@ public:
     template<typename T>
     bool Set(const std::string& key, const T& value);
 
+    /**
+     * @brief Applies several edits as one published snapshot and one notification
+     * @param edit Called with a private copy of the settings object
+     * @return true if applied, false if edit threw or left a non-object
+     */
+    bool Update(const std::function<void(nlohmann::json& settings)>& edit);
+
     /**
      * @brief Gets a value by key with type safety
      * @tparam T Expected return type
@@ -62,6 +218,41 @@ public:
     template<typename T>
     T Get(const std::string& key, const T& defaultValue) const;
 
+    /**
+     * @brief Binds a typed handle to a key
+     * @param key Setting key
+     * @param defaultValue Value the handle reads while the key is missing or mistyped
+     */
+    template<typename T>
+    Setting<T> Bind(const std::string& key, const T& defaultValue);
+
+    /**
+     * @brief Binds a handle whose type is taken from the Setting<T> it initializes
+     */
+    SettingBinding Bind(const std::string& key) { return SettingBinding(*this, key); }
+
+    /**
+     * @brief Current immutable snapshot, for reading several keys consistently
+     */
+    std::shared_ptr<const nlohmann::json> Snapshot() const {
+        return std::atomic_load_explicit(&m_snapshot, std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Registers a change callback
+     * @return Id for Unsubscribe()
+     *
+     * Callbacks run after the write is published, outside every lock and
+     * never concurrently; a batch may be delivered on another writer's thread.
+     * An exception from a callback is swallowed; the other callbacks still run.
+     */
+    uint64_t Subscribe(ChangeCallback callback);
+
+    /**
+     * @brief Removes a callback; a batch already being delivered may still reach it
+     */
+    void Unsubscribe(uint64_t id);
+
     /**
      * @brief Checks if a setting exists
      * @param key Key to check
@@ -95,39 +286,74 @@ private:
     // Path to the config file
     std::filesystem::path m_configPath;
 
-    // In-memory storage of settings
-    nlohmann::json m_settings;
+    // Published settings object; swapped with atomic_store, never mutated
+    std::shared_ptr<const nlohmann::json> m_snapshot;
 
-    // Mutex for thread safety
+    // Serializes writers and guards m_slots
     mutable std::mutex m_mutex;
 
+    // Live handle slots by key
+    std::unordered_map<std::string, std::vector<std::weak_ptr<SettingSlotBase>>> m_slots;
+
+    // Change notification state
+    std::mutex m_notifyMutex;
+    std::vector<std::string> m_pendingChanges;
+    std::map<uint64_t, ChangeCallback> m_subscribers;
+    uint64_t m_nextSubscriberId = 1;
+    bool m_dispatching = false;
+
     // Helper: Ensures config directory exists
     bool EnsureConfigDir() const;
+
+    // Helper: Copies the snapshot, runs edit on it and publishes the result if it changed
+    bool Modify(const std::function<bool(nlohmann::json& settings)>& edit);
+
+    // Helper: Registers a slot and fills it from the current snapshot
+    void AttachSlot(const std::shared_ptr<SettingSlotBase>& slot);
+
+    // Helper: Delivers pending change batches unless another thread already is
+    void DispatchChanges();
 };
 
 // Template implementations must be defined inline due to linkage issues
 template<typename T>
 bool SettingsManager::Set(const std::string& key, const T& value) {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    nlohmann::json converted;
     try {
-        m_settings[key] = value;
-        return true;
+        converted = value;
     } catch (...) {
         return false;
     }
+    return Modify([&key, &converted](nlohmann::json& settings) {
+        settings[key] = std::move(converted);
+        return true;
+    });
 }
 
 template<typename T>
 T SettingsManager::Get(const std::string& key, const T& defaultValue) const {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    try {
-        if (m_settings.contains(key)) {
-            return m_settings[key].get<T>();
-        }
+    const std::shared_ptr<const nlohmann::json> settings = Snapshot();
+    const auto it = settings->find(key);
+    if (it == settings->end()) {
         return defaultValue;
+    }
+    try {
+        return it->template get<T>();
     } catch (...) {
         return defaultValue;
     }
 }
 
-} // namespace knoux::core::config
\ No newline at end of file
+template<typename T>
+Setting<T> SettingsManager::Bind(const std::string& key, const T& defaultValue) {
+    auto slot = std::make_shared<SettingSlot<T>>(key, defaultValue);
+    AttachSlot(slot);
+    return Setting<T>(std::move(slot));
+}
+
+template<typename T>
+SettingBinding::operator Setting<T>() const {
+    return m_manager.Bind<T>(m_key, T{});
+}
+
+} // namespace knoux::core::config
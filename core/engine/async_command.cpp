@@ -0,0 +1,118 @@
+﻿#include "async_command.h"
+#include <utility>
+
+namespace knoux::core::engine {
+
+CommandFuture MakeReadyCommand(CommandStatus status) {
+    std::promise<CommandStatus> promise;
+    promise.set_value(status);
+    return promise.get_future().share();
+}
+
+CommandChannel::CommandChannel(Submitter submitter)
+    : m_submitter(std::move(submitter))
+    , m_generation(std::make_shared<std::atomic<uint64_t>>(0))
+{
+}
+
+CommandFuture CommandChannel::Post(Work work) {
+    m_posted.fetch_add(1, std::memory_order_relaxed);
+
+    Pending command;
+    command.work = std::move(work);
+    CommandFuture future = command.promise.get_future().share();
+
+    std::optional<Pending> stale;
+    bool startDrain = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // Bumping the generation cancels the running command's token
+        command.generation = m_generation->fetch_add(1, std::memory_order_acq_rel) + 1;
+        stale.swap(m_pending);
+        m_pending.emplace(std::move(command));
+        if (!m_draining) {
+            m_draining = true;
+            startDrain = true;
+        }
+    }
+
+    if (stale) {
+        Resolve(stale->promise, CommandStatus::Superseded);
+    }
+
+    if (startDrain && !m_submitter([this]() { Drain(); })) {
+        std::optional<Pending> orphan;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            orphan.swap(m_pending);
+            m_draining = false;
+        }
+        if (orphan) {
+            Resolve(orphan->promise, CommandStatus::Failed);
+        }
+    }
+    return future;
+}
+
+void CommandChannel::Cancel() {
+    std::optional<Pending> stale;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_generation->fetch_add(1, std::memory_order_acq_rel);
+        stale.swap(m_pending);
+    }
+    if (stale) {
+        Resolve(stale->promise, CommandStatus::Superseded);
+    }
+}
+
+CommandChannel::Stats CommandChannel::GetStats() const {
+    Stats stats;
+    stats.posted = m_posted.load(std::memory_order_relaxed);
+    stats.completed = m_completed.load(std::memory_order_relaxed);
+    stats.superseded = m_superseded.load(std::memory_order_relaxed);
+    stats.failed = m_failed.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void CommandChannel::Drain() {
+    for (;;) {
+        std::optional<Pending> command;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_pending) {
+                m_draining = false;
+                return;
+            }
+            command.swap(m_pending);
+        }
+
+        const CancellationToken token(m_generation, command->generation);
+        CommandStatus status = CommandStatus::Superseded;
+        if (!token.IsCancelled()) {
+            try {
+                status = command->work(token);
+            } catch (...) {
+                status = CommandStatus::Failed;
+            }
+        }
+        Resolve(command->promise, status);
+    }
+}
+
+void CommandChannel::Resolve(std::promise<CommandStatus>& promise, CommandStatus status) {
+    switch (status) {
+        case CommandStatus::Completed:
+            m_completed.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case CommandStatus::Superseded:
+            m_superseded.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case CommandStatus::Failed:
+            m_failed.fetch_add(1, std::memory_order_relaxed);
+            break;
+    }
+    promise.set_value(status);
+}
+
+} // namespace knoux::core::engine
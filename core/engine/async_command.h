@@ -0,0 +1,139 @@
+﻿#pragma once
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <cstdint>
+
+namespace knoux::core::engine {
+
+/**
+ * @enum CommandStatus
+ * @brief Final state of an asynchronous engine command
+ */
+enum class CommandStatus {
+    Completed,   // The command ran to completion
+    Superseded,  // A newer command of the same kind replaced or aborted it
+    Failed       // The command ran and failed, or could not be scheduled
+};
+
+// Completion token returned by asynchronous engine commands
+using CommandFuture = std::shared_future<CommandStatus>;
+
+/**
+ * @brief Returns an already-resolved command future
+ */
+CommandFuture MakeReadyCommand(CommandStatus status);
+
+/**
+ * @class CancellationToken
+ * @brief Cheap, copyable view of whether a command has been superseded.
+ *
+ * Long-running command bodies poll IsCancelled() between stages and return
+ * CommandStatus::Superseded as soon as it turns true.
+ */
+class CancellationToken {
+public:
+    CancellationToken() = default;
+
+    /**
+     * @brief Checks if a newer command was posted to the same channel
+     */
+    bool IsCancelled() const {
+        return m_source && m_source->load(std::memory_order_acquire) != m_generation;
+    }
+
+private:
+    friend class CommandChannel;
+
+    CancellationToken(std::shared_ptr<const std::atomic<uint64_t>> source, uint64_t generation)
+        : m_source(std::move(source)), m_generation(generation) {}
+
+    std::shared_ptr<const std::atomic<uint64_t>> m_source;
+    uint64_t m_generation = 0;
+};
+
+/**
+ * @class CommandChannel
+ * @brief Latest-wins mailbox for one kind of engine command (load, seek, ...).
+ *
+ * At most one command waits in the channel and at most one runs:
+ * - Post() replaces the waiting command, resolving it as Superseded
+ *   without running it, and bumps the generation so the running one sees
+ *   its token cancelled at its next checkpoint
+ * - a single drain task on the scheduler runs whatever is waiting, one
+ *   command at a time, so a burst of N posts costs one execution plus
+ *   at most one aborted one, not N
+ */
+class CommandChannel {
+public:
+    using Work = std::function<CommandStatus(const CancellationToken&)>;
+    using Submitter = std::function<bool(std::function<void()>)>;
+
+    /**
+     * @struct Stats
+     * @brief Counters since construction
+     */
+    struct Stats {
+        uint64_t posted = 0;
+        uint64_t completed = 0;
+        uint64_t superseded = 0;
+        uint64_t failed = 0;
+    };
+
+    /**
+     * @brief Creates an idle channel
+     * @param submitter Queues the drain task on a worker; returns false if it cannot
+     */
+    explicit CommandChannel(Submitter submitter);
+
+    CommandChannel(const CommandChannel&) = delete;
+    CommandChannel& operator=(const CommandChannel&) = delete;
+
+    /**
+     * @brief Queues a command, superseding the waiting and running ones
+     * @param work Command body; receives the token to poll for cancellation
+     * @return Future resolved with the command's final status
+     */
+    CommandFuture Post(Work work);
+
+    /**
+     * @brief Supersedes the waiting and running commands without posting a new one
+     */
+    void Cancel();
+
+    /**
+     * @brief Returns a snapshot of the counters
+     */
+    Stats GetStats() const;
+
+private:
+    struct Pending {
+        Work work;
+        std::promise<CommandStatus> promise;
+        uint64_t generation = 0;
+    };
+
+    // Internal drain loop, runs on a scheduler worker
+    void Drain();
+
+    // Helper: Resolves a promise and counts its status
+    void Resolve(std::promise<CommandStatus>& promise, CommandStatus status);
+
+    Submitter m_submitter;
+    std::shared_ptr<std::atomic<uint64_t>> m_generation;
+
+    std::mutex m_mutex;
+    std::optional<Pending> m_pending;
+    bool m_draining = false;
+
+    std::atomic<uint64_t> m_posted{ 0 };
+    std::atomic<uint64_t> m_completed{ 0 };
+    std::atomic<uint64_t> m_superseded{ 0 };
+    std::atomic<uint64_t> m_failed{ 0 };
+};
+
+} // namespace knoux::core::engine
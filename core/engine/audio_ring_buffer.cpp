@@ -0,0 +1,166 @@
+﻿#include "audio_ring_buffer.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace knoux::core::engine {
+
+namespace {
+
+size_t RoundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+} // namespace
+
+AudioRingBuffer::AudioRingBuffer(size_t capacityFrames, size_t channels)
+    : m_capacity(RoundUpToPowerOfTwo(std::max<size_t>(capacityFrames, 2)))
+    , m_mask(m_capacity - 1)
+    , m_channels(std::max<size_t>(channels, 1))
+    , m_samples(new float[m_capacity * m_channels]())
+{
+}
+
+AudioRingBuffer::~AudioRingBuffer() = default;
+
+size_t AudioRingBuffer::Write(const float* data, size_t frames) {
+    const size_t writePos = m_writePos.load(std::memory_order_relaxed);
+
+    size_t free = m_capacity - (writePos - m_cachedReadPos);
+    if (free < frames) {
+        m_cachedReadPos = m_readPos.load(std::memory_order_acquire);
+        free = m_capacity - (writePos - m_cachedReadPos);
+    }
+
+    const size_t count = std::min(frames, free);
+    if (count < frames) {
+        m_overruns.fetch_add(1, std::memory_order_relaxed);
+        m_droppedFrames.fetch_add(frames - count, std::memory_order_relaxed);
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    CopyIn(writePos, data, count);
+    m_writePos.store(writePos + count, std::memory_order_release);
+    return count;
+}
+
+size_t AudioRingBuffer::Read(float* out, size_t frames) {
+    const size_t count = ReadAvailable(out, frames);
+    if (count < frames) {
+        std::memset(out + count * m_channels, 0, (frames - count) * m_channels * sizeof(float));
+        m_underruns.fetch_add(1, std::memory_order_relaxed);
+        m_silenceFrames.fetch_add(frames - count, std::memory_order_relaxed);
+    }
+    return count;
+}
+
+size_t AudioRingBuffer::ReadAvailable(float* out, size_t frames) {
+    const size_t readPos = m_readPos.load(std::memory_order_relaxed);
+
+    size_t available = m_cachedWritePos - readPos;
+    if (available < frames) {
+        m_cachedWritePos = m_writePos.load(std::memory_order_acquire);
+        available = m_cachedWritePos - readPos;
+    }
+
+    const size_t count = std::min(frames, available);
+    if (count == 0) {
+        return 0;
+    }
+
+    CopyOut(readPos, out, count);
+    m_readPos.store(readPos + count, std::memory_order_release);
+    return count;
+}
+
+size_t AudioRingBuffer::AvailableToRead() const {
+    // Read position first: it can only trail the write position loaded after it
+    const size_t readPos = m_readPos.load(std::memory_order_acquire);
+    return m_writePos.load(std::memory_order_acquire) - readPos;
+}
+
+size_t AudioRingBuffer::AvailableToWrite() const {
+    return m_capacity - AvailableToRead();
+}
+
+void AudioRingBuffer::Reset() {
+    m_writePos.store(0, std::memory_order_relaxed);
+    m_readPos.store(0, std::memory_order_relaxed);
+    m_cachedReadPos = 0;
+    m_cachedWritePos = 0;
+    m_overruns.store(0, std::memory_order_relaxed);
+    m_droppedFrames.store(0, std::memory_order_relaxed);
+    m_underruns.store(0, std::memory_order_relaxed);
+    m_silenceFrames.store(0, std::memory_order_relaxed);
+}
+
+AudioRingBuffer::Stats AudioRingBuffer::GetStats() const {
+    Stats stats;
+    stats.framesWritten = m_writePos.load(std::memory_order_relaxed);
+    stats.framesRead = m_readPos.load(std::memory_order_relaxed);
+    stats.overruns = m_overruns.load(std::memory_order_relaxed);
+    stats.droppedFrames = m_droppedFrames.load(std::memory_order_relaxed);
+    stats.underruns = m_underruns.load(std::memory_order_relaxed);
+    stats.silenceFrames = m_silenceFrames.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void AudioRingBuffer::CopyIn(size_t position, const float* src, size_t frames) {
+    const size_t start = position & m_mask;
+    const size_t first = std::min(frames, m_capacity - start);
+    std::memcpy(m_samples.get() + start * m_channels, src, first * m_channels * sizeof(float));
+    if (first < frames) {
+        std::memcpy(m_samples.get(), src + first * m_channels, (frames - first) * m_channels * sizeof(float));
+    }
+}
+
+void AudioRingBuffer::CopyOut(size_t position, float* dst, size_t frames) const {
+    const size_t start = position & m_mask;
+    const size_t first = std::min(frames, m_capacity - start);
+    std::memcpy(dst, m_samples.get() + start * m_channels, first * m_channels * sizeof(float));
+    if (first < frames) {
+        std::memcpy(dst + first * m_channels, m_samples.get(), (frames - first) * m_channels * sizeof(float));
+    }
+}
+
+bool AudioRingGate::TryEnter() {
+    // Sequentially consistent with lock(): either it sees this caller or the caller sees it held
+    m_callers.fetch_add(1);
+    if (m_held.load()) {
+        m_callers.fetch_sub(1);
+        return false;
+    }
+    return true;
+}
+
+void AudioRingGate::Enter() {
+    while (!TryEnter()) {
+        std::lock_guard<std::mutex> wait(m_holder);
+    }
+}
+
+void AudioRingGate::Leave() {
+    m_callers.fetch_sub(1, std::memory_order_release);
+}
+
+void AudioRingGate::lock() {
+    m_holder.lock();
+    m_held.store(true);
+    // Admitted calls are a few memcpys (or one delivery callback) long
+    while (m_callers.load() != 0) {
+        std::this_thread::yield();
+    }
+}
+
+void AudioRingGate::unlock() {
+    m_held.store(false);
+    m_holder.unlock();
+}
+
+} // namespace knoux::core::engine
@@ -0,0 +1,195 @@
+﻿#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <cstddef>
+#include <cstdint>
+
+namespace knoux::core::engine {
+
+// Assumed L1 line size used to keep producer and consumer state apart
+constexpr size_t kCacheLineSize = 64;
+
+/**
+ * @class AudioRingBuffer
+ * @brief Lock-free single-producer/single-consumer ring of interleaved float frames.
+ *
+ * Designed for the hand-off between the decoder thread (producer) and the
+ * real-time audio output thread (consumer):
+ * - no mutex, no allocation after construction
+ * - Read() is wait-free: it copies what is available, zero-fills the rest
+ *   and counts an underrun instead of waiting
+ * - Write() never blocks: frames that do not fit are dropped and counted
+ *   as an overrun, the caller decides whether to retry
+ * - write and read positions live on separate cache lines, and each side
+ *   keeps a private copy of the other side's position so the shared line is
+ *   only touched when the cached view runs out
+ *
+ * Exactly one thread may call Write() and exactly one thread may call Read().
+ */
+class AudioRingBuffer {
+public:
+    /**
+     * @struct Stats
+     * @brief Counters accumulated since construction or the last Reset()
+     */
+    struct Stats {
+        uint64_t framesWritten = 0;
+        uint64_t framesRead = 0;
+        uint64_t overruns = 0;        // Write() calls that could not store everything
+        uint64_t droppedFrames = 0;   // Frames discarded by those calls
+        uint64_t underruns = 0;       // Read() calls that could not be fully served
+        uint64_t silenceFrames = 0;   // Frames zero-filled by those calls
+    };
+
+    /**
+     * @brief Allocates the ring
+     * @param capacityFrames Minimum capacity in frames (rounded up to a power of two)
+     * @param channels Samples per frame
+     */
+    AudioRingBuffer(size_t capacityFrames, size_t channels);
+    ~AudioRingBuffer();
+
+    AudioRingBuffer(const AudioRingBuffer&) = delete;
+    AudioRingBuffer& operator=(const AudioRingBuffer&) = delete;
+
+    /**
+     * @brief Producer: appends interleaved frames
+     * @param data Interleaved samples (frames * channels floats)
+     * @param frames Number of frames offered
+     * @return Frames actually stored
+     */
+    size_t Write(const float* data, size_t frames);
+
+    /**
+     * @brief Consumer: removes interleaved frames, zero-filling any shortfall
+     * @param out Destination for frames * channels floats
+     * @param frames Number of frames requested
+     * @return Frames copied from the ring (the remainder of out is silence)
+     */
+    size_t Read(float* out, size_t frames);
+
+    /**
+     * @brief Consumer: removes up to frames without padding or underrun accounting
+     * @return Frames copied
+     */
+    size_t ReadAvailable(float* out, size_t frames);
+
+    /**
+     * @brief Frames currently buffered (exact for the consumer, a lower bound otherwise)
+     */
+    size_t AvailableToRead() const;
+
+    /**
+     * @brief Free space in frames (exact for the producer, a lower bound otherwise)
+     */
+    size_t AvailableToWrite() const;
+
+    /**
+     * @brief Discards buffered audio and clears counters; both sides must be idle
+     */
+    void Reset();
+
+    /**
+     * @brief Returns a snapshot of the counters
+     */
+    Stats GetStats() const;
+
+    size_t CapacityFrames() const { return m_capacity; }
+    size_t Channels() const { return m_channels; }
+
+private:
+    // Helper: Copies frames between the ring and a linear buffer across the wrap point
+    void CopyIn(size_t position, const float* src, size_t frames);
+    void CopyOut(size_t position, float* dst, size_t frames) const;
+
+    const size_t m_capacity;
+    const size_t m_mask;
+    const size_t m_channels;
+    std::unique_ptr<float[]> m_samples;
+
+    // Producer-owned line
+    alignas(kCacheLineSize) std::atomic<size_t> m_writePos{ 0 };
+    size_t m_cachedReadPos = 0;
+    std::atomic<uint64_t> m_overruns{ 0 };
+    std::atomic<uint64_t> m_droppedFrames{ 0 };
+
+    // Consumer-owned line
+    alignas(kCacheLineSize) std::atomic<size_t> m_readPos{ 0 };
+    size_t m_cachedWritePos = 0;
+    std::atomic<uint64_t> m_underruns{ 0 };
+    std::atomic<uint64_t> m_silenceFrames{ 0 };
+};
+
+/**
+ * @class AudioRingGate
+ * @brief Lets a control thread quiesce both sides of an AudioRingBuffer.
+ *
+ * Producer and consumer wrap each call on the ring in a Scope; a control
+ * thread that holds the gate (lock()/unlock(), so std::lock_guard works)
+ * waits until every admitted call has left, and keeps new ones out until
+ * it unlocks. In between it may Reset() or replace the ring.
+ *
+ * Admission is two atomic operations and never waits for a holder in
+ * TryEnter(), so a real-time consumer stays wait-free: while the gate is
+ * held it is simply refused. Enter() blocks until the holder is done.
+ */
+class AudioRingGate {
+public:
+    /**
+     * @class Scope
+     * @brief One call past the gate; check it before touching the ring
+     */
+    class Scope {
+    public:
+        // Blocking admission (decoder and delivery threads)
+        explicit Scope(AudioRingGate& gate) : m_gate(gate), m_admitted(true) { m_gate.Enter(); }
+
+        // Non-blocking admission (real-time output); may be refused
+        Scope(AudioRingGate& gate, std::try_to_lock_t) : m_gate(gate), m_admitted(gate.TryEnter()) {}
+
+        ~Scope() {
+            if (m_admitted) {
+                m_gate.Leave();
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        explicit operator bool() const { return m_admitted; }
+
+    private:
+        AudioRingGate& m_gate;
+        const bool m_admitted;
+    };
+
+    /**
+     * @brief Admits a call unless the gate is held; Leave() must follow a true return
+     */
+    bool TryEnter();
+
+    /**
+     * @brief Admits a call, waiting for a holder to unlock first
+     */
+    void Enter();
+
+    void Leave();
+
+    /**
+     * @brief Closes the gate and waits for admitted calls to leave
+     */
+    void lock();
+
+    void unlock();
+
+private:
+    std::atomic<uint32_t> m_callers{ 0 };
+    std::atomic<bool> m_held{ false };
+
+    // Owned by the holder; Enter() waits on it
+    std::mutex m_holder;
+};
+
+} // namespace knoux::core::engine
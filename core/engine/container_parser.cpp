@@ -0,0 +1,2077 @@
+﻿#include "container_parser.h"
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <unordered_map>
+
+namespace knoux::core::engine {
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// Byte helpers
+// ---------------------------------------------------------------------------
+
+inline uint16_t ReadBE16(const uint8_t* p) { return static_cast<uint16_t>((p[0] << 8) | p[1]); }
+inline uint32_t ReadBE24(const uint8_t* p) { return (uint32_t(p[0]) << 16) | (uint32_t(p[1]) << 8) | p[2]; }
+inline uint32_t ReadBE32(const uint8_t* p) { return (uint32_t(p[0]) << 24) | ReadBE24(p + 1); }
+inline uint64_t ReadBE64(const uint8_t* p) { return (uint64_t(ReadBE32(p)) << 32) | ReadBE32(p + 4); }
+inline uint16_t ReadLE16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+inline uint32_t ReadLE32(const uint8_t* p) { return uint32_t(ReadLE16(p)) | (uint32_t(ReadLE16(p + 2)) << 16); }
+inline uint64_t ReadLE64(const uint8_t* p) { return uint64_t(ReadLE32(p)) | (uint64_t(ReadLE32(p + 4)) << 32); }
+
+inline bool Tag(const uint8_t* p, const char* tag) { return std::memcmp(p, tag, 4) == 0; }
+
+inline size_t Remaining(const uint8_t* p, const uint8_t* end) {
+    return p < end ? static_cast<size_t>(end - p) : 0;
+}
+
+// Converts a floating-point value computed from file fields; false unless it is finite and
+// fits, since an out-of-range conversion is undefined
+template <typename Int>
+bool ToInteger(double value, Int& out) {
+    static_assert(std::is_signed<Int>::value, "the bounds below are those of a signed type");
+    const double bound = -static_cast<double>(std::numeric_limits<Int>::min());
+    if (!(value >= -bound && value < bound)) {
+        return false;
+    }
+    out = static_cast<Int>(value);
+    return true;
+}
+
+uint64_t Gcd(uint64_t a, uint64_t b) {
+    while (b != 0) {
+        const uint64_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+void SetTimebase(StreamInfo& stream, uint64_t num, uint64_t den) {
+    if (num == 0 || den == 0) {
+        return;
+    }
+    const uint64_t g = Gcd(num, den);
+    num /= g;
+    den /= g;
+    while (num > UINT32_MAX || den > UINT32_MAX) {
+        num = std::max<uint64_t>(num >> 1, 1);
+        den = std::max<uint64_t>(den >> 1, 1);
+    }
+    stream.timebaseNum = static_cast<uint32_t>(num);
+    stream.timebaseDen = static_cast<uint32_t>(den);
+}
+
+std::string FourCCString(const uint8_t* p) {
+    std::string s(reinterpret_cast<const char*>(p), 4);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\0')) {
+        s.pop_back();
+    }
+    return s;
+}
+
+// Shared by WAV and AVI: maps a WAVEFORMATEX format tag to a codec name
+std::string WaveFormatCodec(uint16_t formatTag, int bitsPerSample) {
+    switch (formatTag) {
+        case 0x0001:
+            if (bitsPerSample == 8) return "pcm_u8";
+            return "pcm_s" + std::to_string(bitsPerSample) + "le";
+        case 0x0002: return "adpcm_ms";
+        case 0x0003: return bitsPerSample == 64 ? "pcm_f64le" : "pcm_f32le";
+        case 0x0006: return "pcm_alaw";
+        case 0x0007: return "pcm_mulaw";
+        case 0x0011: return "adpcm_ima_wav";
+        case 0x0050: return "mp2";
+        case 0x0055: return "mp3";
+        case 0x00FF:
+        case 0x1610: return "aac";
+        case 0x2000: return "ac3";
+        case 0x2001: return "dts";
+        case 0xF1AC: return "flac";
+        default:     return "unknown";
+    }
+}
+
+// Parses a WAVEFORMATEX(-TENSIBLE) structure into an audio stream
+void ParseWaveFormat(const uint8_t* p, size_t size, StreamInfo& stream, uint32_t& byteRate) {
+    if (size < 16) {
+        return;
+    }
+
+    uint16_t formatTag = ReadLE16(p);
+    stream.type = StreamType::Audio;
+    stream.channels = ReadLE16(p + 2);
+    stream.sampleRate = static_cast<int>(ReadLE32(p + 4));
+    byteRate = ReadLE32(p + 8);
+    stream.bitsPerSample = ReadLE16(p + 14);
+
+    if (formatTag == 0xFFFE && size >= 40) {
+        // WAVE_FORMAT_EXTENSIBLE: the first two bytes of the sub-format GUID carry the real tag
+        formatTag = ReadLE16(p + 24);
+    }
+
+    stream.codec = WaveFormatCodec(formatTag, stream.bitsPerSample);
+    stream.bitrate = static_cast<int64_t>(byteRate) * 8;
+    SetTimebase(stream, 1, static_cast<uint64_t>(stream.sampleRate));
+}
+
+// ---------------------------------------------------------------------------
+// Matroska / WebM (EBML)
+// ---------------------------------------------------------------------------
+
+namespace ebml {
+
+constexpr uint32_t kHeader = 0x1A45DFA3;
+constexpr uint32_t kDocType = 0x4282;
+constexpr uint32_t kSegment = 0x18538067;
+constexpr uint32_t kSeekHead = 0x114D9B74;
+constexpr uint32_t kSeek = 0x4DBB;
+constexpr uint32_t kSeekId = 0x53AB;
+constexpr uint32_t kSeekPosition = 0x53AC;
+constexpr uint32_t kInfo = 0x1549A966;
+constexpr uint32_t kTimecodeScale = 0x2AD7B1;
+constexpr uint32_t kDuration = 0x4489;
+constexpr uint32_t kTitle = 0x7BA9;
+constexpr uint32_t kTracks = 0x1654AE6B;
+constexpr uint32_t kTrackEntry = 0xAE;
+constexpr uint32_t kTrackNumber = 0xD7;
+constexpr uint32_t kTrackUid = 0x73C5;
+constexpr uint32_t kTrackType = 0x83;
+constexpr uint32_t kCodecId = 0x86;
+constexpr uint32_t kLanguage = 0x22B59C;
+constexpr uint32_t kDefaultDuration = 0x23E383;
+constexpr uint32_t kCodecDelay = 0x56AA;
+constexpr uint32_t kVideo = 0xE0;
+constexpr uint32_t kPixelWidth = 0xB0;
+constexpr uint32_t kPixelHeight = 0xBA;
+constexpr uint32_t kAudio = 0xE1;
+constexpr uint32_t kSamplingFrequency = 0xB5;
+constexpr uint32_t kChannels = 0x9F;
+constexpr uint32_t kBitDepth = 0x6264;
+constexpr uint32_t kTags = 0x1254C367;
+constexpr uint32_t kTag = 0x7373;
+constexpr uint32_t kTargets = 0x63C0;
+constexpr uint32_t kTagTrackUid = 0x63C5;
+constexpr uint32_t kSimpleTag = 0x67C8;
+constexpr uint32_t kTagName = 0x45A3;
+constexpr uint32_t kTagString = 0x4487;
+constexpr uint32_t kCluster = 0x1F43B675;
+constexpr uint32_t kClusterTimecode = 0xE7;
+constexpr uint32_t kSimpleBlock = 0xA3;
+constexpr uint32_t kBlockGroup = 0xA0;
+constexpr uint32_t kBlock = 0xA1;
+constexpr uint32_t kReferenceBlock = 0xFB;
+constexpr uint32_t kCues = 0x1C53BB6B;
+constexpr uint32_t kCuePoint = 0xBB;
+constexpr uint32_t kCueTime = 0xB3;
+constexpr uint32_t kCueTrackPositions = 0xB7;
+constexpr uint32_t kCueTrack = 0xF7;
+constexpr uint32_t kCueClusterPosition = 0xF1;
+constexpr uint32_t kChapters = 0x1043A770;
+constexpr uint32_t kAttachments = 0x1941A469;
+
+constexpr uint64_t kUnknownSize = UINT64_MAX;
+
+struct Element {
+    uint32_t id = 0;
+    uint64_t size = 0;
+    const uint8_t* data = nullptr;  // Start of the payload
+    const uint8_t* end = nullptr;   // End of the payload, clamped to the buffer
+};
+
+// Reads a variable-length integer; IDs keep their length marker, sizes drop it
+bool ReadVint(const uint8_t*& p, const uint8_t* end, uint64_t& value, bool keepMarker) {
+    if (p >= end || *p == 0) {
+        return false;
+    }
+
+    int length = 1;
+    uint8_t mask = 0x80;
+    while (!(*p & mask)) {
+        mask >>= 1;
+        ++length;
+    }
+    if (Remaining(p, end) < static_cast<size_t>(length)) {
+        return false;
+    }
+
+    uint64_t v = keepMarker ? *p : (*p & (mask - 1));
+    bool allOnes = (v == static_cast<uint64_t>(mask - 1));
+    for (int i = 1; i < length; ++i) {
+        v = (v << 8) | p[i];
+        allOnes = allOnes && p[i] == 0xFF;
+    }
+    p += length;
+
+    value = (!keepMarker && allOnes) ? kUnknownSize : v;
+    return true;
+}
+
+bool ReadElement(const uint8_t*& p, const uint8_t* end, Element& element) {
+    uint64_t id = 0;
+    if (!ReadVint(p, end, id, true) || id > UINT32_MAX || !ReadVint(p, end, element.size, false)) {
+        return false;
+    }
+
+    element.id = static_cast<uint32_t>(id);
+    element.data = p;
+    element.end = (element.size == kUnknownSize || element.size > Remaining(p, end))
+        ? end : p + element.size;
+    p = element.end;
+    return true;
+}
+
+uint64_t ReadUInt(const Element& e) {
+    uint64_t v = 0;
+    for (const uint8_t* p = e.data; p < e.end && p < e.data + 8; ++p) {
+        v = (v << 8) | *p;
+    }
+    return v;
+}
+
+double ReadFloat(const Element& e) {
+    const size_t size = Remaining(e.data, e.end);
+    if (size == 4) {
+        const uint32_t bits = ReadBE32(e.data);
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+    if (size == 8) {
+        const uint64_t bits = ReadBE64(e.data);
+        double d;
+        std::memcpy(&d, &bits, sizeof(d));
+        return d;
+    }
+    return 0.0;
+}
+
+std::string ReadString(const Element& e) {
+    std::string s(reinterpret_cast<const char*>(e.data), Remaining(e.data, e.end));
+    const size_t nul = s.find('\0');
+    if (nul != std::string::npos) {
+        s.resize(nul);
+    }
+    return s;
+}
+
+std::string CodecName(const std::string& codecId) {
+    static const std::unordered_map<std::string, std::string> kCodecs = {
+        { "V_MPEG4/ISO/AVC", "h264" }, { "V_MPEGH/ISO/HEVC", "hevc" }, { "V_AV1", "av1" },
+        { "V_VP8", "vp8" }, { "V_VP9", "vp9" }, { "V_MPEG2", "mpeg2video" },
+        { "V_MPEG4/ISO/ASP", "mpeg4" }, { "V_MS/VFW/FOURCC", "vfw" }, { "V_THEORA", "theora" },
+        { "A_AAC", "aac" }, { "A_OPUS", "opus" }, { "A_VORBIS", "vorbis" }, { "A_FLAC", "flac" },
+        { "A_AC3", "ac3" }, { "A_EAC3", "eac3" }, { "A_DTS", "dts" }, { "A_TRUEHD", "truehd" },
+        { "A_MPEG/L3", "mp3" }, { "A_MPEG/L2", "mp2" }, { "A_PCM/INT/LIT", "pcm_le" },
+        { "A_PCM/INT/BIG", "pcm_be" }, { "A_PCM/FLOAT/IEEE", "pcm_float" },
+        { "S_TEXT/UTF8", "subrip" }, { "S_TEXT/ASS", "ass" }, { "S_TEXT/SSA", "ssa" },
+        { "S_TEXT/WEBVTT", "webvtt" }, { "S_HDMV/PGS", "hdmv_pgs_subtitle" }, { "S_VOBSUB", "dvd_subtitle" }
+    };
+
+    const auto it = kCodecs.find(codecId);
+    if (it != kCodecs.end()) {
+        return it->second;
+    }
+    // AAC used to be signalled with profile suffixes (A_AAC/MPEG4/LC, ...)
+    if (codecId.rfind("A_AAC", 0) == 0) {
+        return "aac";
+    }
+    return codecId;
+}
+
+struct ParseState {
+    uint64_t timecodeScale = 1000000;
+    double durationTicks = 0.0;
+    std::unordered_map<uint64_t, size_t> streamByUid;
+    bool infoDone = false;
+    bool tracksDone = false;
+    bool tagsDone = false;
+};
+
+void ParseInfo(const Element& info, ContainerInfo& out, ParseState& state) {
+    Element e;
+    for (const uint8_t* p = info.data; ReadElement(p, info.end, e);) {
+        switch (e.id) {
+            case kTimecodeScale: state.timecodeScale = std::max<uint64_t>(ReadUInt(e), 1); break;
+            case kDuration:      state.durationTicks = ReadFloat(e); break;
+            case kTitle:         out.title = ReadString(e); break;
+            default: break;
+        }
+    }
+    state.infoDone = true;
+}
+
+void ParseTrackEntry(const Element& entry, ContainerInfo& out, ParseState& state) {
+    StreamInfo stream;
+    uint64_t uid = 0;
+    uint64_t defaultDuration = 0;
+    uint64_t codecDelay = 0;
+    uint64_t trackType = 0;
+    bool valid = true;
+
+    Element e;
+    for (const uint8_t* p = entry.data; ReadElement(p, entry.end, e);) {
+        switch (e.id) {
+            case kTrackNumber:     stream.trackId = static_cast<uint32_t>(ReadUInt(e)); break;
+            case kTrackUid:        uid = ReadUInt(e); break;
+            case kTrackType:       trackType = ReadUInt(e); break;
+            case kCodecId:         stream.codec = CodecName(ReadString(e)); break;
+            case kLanguage:        stream.language = ReadString(e); break;
+            case kDefaultDuration: defaultDuration = ReadUInt(e); break;
+            case kCodecDelay:      codecDelay = ReadUInt(e); break;
+            case kVideo: {
+                Element v;
+                for (const uint8_t* q = e.data; ReadElement(q, e.end, v);) {
+                    if (v.id == kPixelWidth) stream.width = static_cast<int>(ReadUInt(v));
+                    if (v.id == kPixelHeight) stream.height = static_cast<int>(ReadUInt(v));
+                }
+                break;
+            }
+            case kAudio: {
+                Element a;
+                for (const uint8_t* q = e.data; ReadElement(q, e.end, a);) {
+                    if (a.id == kSamplingFrequency) valid = ToInteger(ReadFloat(a), stream.sampleRate) && valid;
+                    if (a.id == kChannels) stream.channels = static_cast<int>(ReadUInt(a));
+                    if (a.id == kBitDepth) stream.bitsPerSample = static_cast<int>(ReadUInt(a));
+                }
+                break;
+            }
+            default: break;
+        }
+    }
+
+    switch (trackType) {
+        case 1:    stream.type = StreamType::Video; break;
+        case 2:    stream.type = StreamType::Audio; break;
+        case 0x11: stream.type = StreamType::Subtitle; break;
+        default:   stream.type = StreamType::Data; break;
+    }
+    if (!valid) {
+        return;
+    }
+    if (stream.type == StreamType::Audio && stream.channels == 0) {
+        stream.channels = 1;
+    }
+    // CodecDelay is in nanoseconds; trailing padding is per block (DiscardPadding), not declared here
+    if (stream.type == StreamType::Audio && codecDelay > 0 && stream.sampleRate > 0) {
+        stream.encoderDelay = static_cast<int64_t>((codecDelay * static_cast<uint64_t>(stream.sampleRate) + 500000000) / 1000000000);
+    }
+    if (stream.type == StreamType::Video && defaultDuration > 0) {
+        stream.frameRate = 1e9 / static_cast<double>(defaultDuration);
+    }
+
+    stream.index = static_cast<int>(out.streams.size());
+    state.streamByUid[uid] = out.streams.size();
+    out.streams.push_back(std::move(stream));
+}
+
+void ParseTracks(const Element& tracks, ContainerInfo& out, ParseState& state) {
+    Element e;
+    for (const uint8_t* p = tracks.data; ReadElement(p, tracks.end, e);) {
+        if (e.id == kTrackEntry) {
+            ParseTrackEntry(e, out, state);
+        }
+    }
+    state.tracksDone = true;
+}
+
+// Reads mkvmerge statistics tags (BPS) and global ARTIST/TITLE tags
+void ParseTags(const Element& tags, ContainerInfo& out, ParseState& state) {
+    Element tag;
+    for (const uint8_t* p = tags.data; ReadElement(p, tags.end, tag);) {
+        if (tag.id != kTag) {
+            continue;
+        }
+
+        uint64_t trackUid = 0;
+        Element e;
+        for (const uint8_t* q = tag.data; ReadElement(q, tag.end, e);) {
+            if (e.id == kTargets) {
+                Element t;
+                for (const uint8_t* r = e.data; ReadElement(r, e.end, t);) {
+                    if (t.id == kTagTrackUid) trackUid = ReadUInt(t);
+                }
+                continue;
+            }
+            if (e.id != kSimpleTag) {
+                continue;
+            }
+
+            std::string name;
+            std::string value;
+            Element s;
+            for (const uint8_t* r = e.data; ReadElement(r, e.end, s);) {
+                if (s.id == kTagName) name = ReadString(s);
+                if (s.id == kTagString) value = ReadString(s);
+            }
+
+            if (trackUid == 0) {
+                if (name == "ARTIST" && out.artist.empty()) out.artist = value;
+                if (name == "TITLE" && out.title.empty()) out.title = value;
+                continue;
+            }
+
+            const auto it = state.streamByUid.find(trackUid);
+            if (it != state.streamByUid.end() && (name == "BPS" || name == "BPS-eng")) {
+                out.streams[it->second].bitrate = std::strtoll(value.c_str(), nullptr, 10);
+            }
+        }
+    }
+    state.tagsDone = true;
+}
+
+void ParseTopLevel(const Element& e, ContainerInfo& out, ParseState& state) {
+    switch (e.id) {
+        case kInfo:   if (!state.infoDone) ParseInfo(e, out, state); break;
+        case kTracks: if (!state.tracksDone) ParseTracks(e, out, state); break;
+        case kTags:   if (!state.tagsDone) ParseTags(e, out, state); break;
+        default: break;
+    }
+}
+
+bool Parse(const uint8_t* data, size_t size, ContainerInfo& out) {
+    const uint8_t* end = data + size;
+    const uint8_t* p = data;
+
+    Element header;
+    if (!ReadElement(p, end, header) || header.id != kHeader) {
+        return false;
+    }
+
+    out.formatName = "matroska";
+    Element e;
+    for (const uint8_t* q = header.data; ReadElement(q, header.end, e);) {
+        if (e.id == kDocType && ReadString(e) == "webm") {
+            out.formatName = "webm";
+        }
+    }
+
+    Element segment;
+    while (ReadElement(p, end, segment) && segment.id != kSegment) {
+    }
+    if (segment.id != kSegment) {
+        return false;
+    }
+
+    // Walk level-1 elements until the first cluster. Anything stored after the
+    // clusters (Tags are commonly appended by muxers) is reached via SeekHead
+    // so the cluster payload is never touched.
+    ParseState state;
+    std::vector<uint64_t> seekTargets;
+    for (const uint8_t* q = segment.data; q < segment.end;) {
+        if (!ReadElement(q, segment.end, e) || e.id == kCluster) {
+            break;
+        }
+
+        if (e.id == kSeekHead) {
+            Element seek;
+            for (const uint8_t* r = e.data; ReadElement(r, e.end, seek);) {
+                if (seek.id != kSeek) {
+                    continue;
+                }
+                uint64_t id = 0;
+                uint64_t position = 0;
+                Element s;
+                for (const uint8_t* t = seek.data; ReadElement(t, seek.end, s);) {
+                    if (s.id == kSeekId) id = ReadUInt(s);
+                    if (s.id == kSeekPosition) position = ReadUInt(s);
+                }
+                if (id == kInfo || id == kTracks || id == kTags) {
+                    seekTargets.push_back(position);
+                }
+            }
+            continue;
+        }
+
+        ParseTopLevel(e, out, state);
+    }
+
+    for (uint64_t position : seekTargets) {
+        if (position >= Remaining(segment.data, segment.end)) {
+            continue;
+        }
+        const uint8_t* q = segment.data + position;
+        if (ReadElement(q, segment.end, e)) {
+            ParseTopLevel(e, out, state);
+        }
+    }
+
+    if (!state.tracksDone) {
+        return false;
+    }
+
+    out.duration = state.durationTicks * static_cast<double>(state.timecodeScale) / 1e9;
+    for (auto& stream : out.streams) {
+        SetTimebase(stream, state.timecodeScale, 1000000000ULL);
+        stream.duration = out.duration;
+    }
+    return true;
+}
+
+// Level-1 IDs terminate an unknown-size cluster
+bool IsTopLevel(uint32_t id) {
+    return id == kCluster || id == kCues || id == kInfo || id == kTracks || id == kTags ||
+           id == kSeekHead || id == kChapters || id == kAttachments;
+}
+
+// Reads the Cues element: one point per CuePoint that references the track
+void ReadCues(const Element& cues, const uint8_t* data, const Element& segment, uint64_t track,
+              double usPerTick, std::vector<SeekPoint>& points) {
+    const uint64_t segmentOffset = static_cast<uint64_t>(segment.data - data);
+    Element point;
+    for (const uint8_t* p = cues.data; ReadElement(p, cues.end, point);) {
+        if (point.id != kCuePoint) {
+            continue;
+        }
+
+        uint64_t time = 0;
+        Element e;
+        for (const uint8_t* q = point.data; ReadElement(q, point.end, e);) {
+            if (e.id == kCueTime) {
+                time = ReadUInt(e);
+                continue;
+            }
+            if (e.id != kCueTrackPositions) {
+                continue;
+            }
+
+            uint64_t cueTrack = 0;
+            uint64_t position = UINT64_MAX;
+            Element t;
+            for (const uint8_t* r = e.data; ReadElement(r, e.end, t);) {
+                if (t.id == kCueTrack) cueTrack = ReadUInt(t);
+                if (t.id == kCueClusterPosition) position = ReadUInt(t);
+            }
+            if (cueTrack == track && position != UINT64_MAX) {
+                int64_t us = 0;
+                if (ToInteger(static_cast<double>(time) * usPerTick, us)) {
+                    points.push_back({ us, segmentOffset + position });
+                }
+            }
+        }
+    }
+}
+
+// Returns true and the absolute block time if a SimpleBlock/Block is a keyframe of the track
+bool ReadKeyBlock(const Element& block, bool simple, bool hasReference, uint64_t track,
+                  uint64_t clusterTime, uint64_t& time) {
+    const uint8_t* p = block.data;
+    uint64_t blockTrack = 0;
+    if (!ReadVint(p, block.end, blockTrack, false) || blockTrack != track || Remaining(p, block.end) < 3) {
+        return false;
+    }
+
+    const bool key = simple ? (p[2] & 0x80) != 0 : !hasReference;
+    const int16_t relative = static_cast<int16_t>(ReadBE16(p));
+    time = static_cast<uint64_t>(std::max<int64_t>(static_cast<int64_t>(clusterTime) + relative, 0));
+    return key;
+}
+
+// Walks every cluster, recording the first keyframe of the track in each
+bool ScanClusters(const uint8_t* data, const Element& segment, uint64_t track, double usPerTick,
+                  std::vector<SeekPoint>& points, const std::function<bool()>& cancelled) {
+    for (const uint8_t* q = segment.data; q < segment.end;) {
+        const uint8_t* start = q;
+        Element e;
+        if (!ReadElement(q, segment.end, e)) {
+            break;
+        }
+        if (e.id != kCluster) {
+            continue;
+        }
+        if (cancelled && cancelled()) {
+            return false;
+        }
+
+        uint64_t clusterTime = 0;
+        bool found = false;
+        const uint8_t* r = e.data;
+        while (r < e.end) {
+            const uint8_t* childStart = r;
+            Element child;
+            if (!ReadElement(r, e.end, child)) {
+                break;
+            }
+            if (e.size == kUnknownSize && IsTopLevel(child.id)) {
+                // Live-muxed cluster without a size ends where the next level-1 element starts
+                r = childStart;
+                break;
+            }
+            if (found) {
+                if (e.size != kUnknownSize) {
+                    break;
+                }
+                continue;
+            }
+
+            uint64_t time = 0;
+            if (child.id == kClusterTimecode) {
+                clusterTime = ReadUInt(child);
+            } else if (child.id == kSimpleBlock) {
+                found = ReadKeyBlock(child, true, false, track, clusterTime, time);
+            } else if (child.id == kBlockGroup) {
+                Element block;
+                bool hasBlock = false;
+                bool hasReference = false;
+                Element g;
+                for (const uint8_t* t = child.data; ReadElement(t, child.end, g);) {
+                    if (g.id == kBlock) {
+                        block = g;
+                        hasBlock = true;
+                    }
+                    hasReference = hasReference || g.id == kReferenceBlock;
+                }
+                found = hasBlock && ReadKeyBlock(block, false, hasReference, track, clusterTime, time);
+            }
+            int64_t us = 0;
+            if (found && ToInteger(static_cast<double>(time) * usPerTick, us)) {
+                points.push_back({ us, static_cast<uint64_t>(start - data) });
+            }
+        }
+        if (e.size == kUnknownSize) {
+            q = r;
+        }
+    }
+    return true;
+}
+
+bool BuildIndex(const StreamInfo& stream, const uint8_t* data, size_t size, std::vector<SeekPoint>& points,
+                SeekIndexOrigin& origin, const std::function<bool()>& cancelled) {
+    const uint8_t* end = data + size;
+    const uint8_t* p = data;
+    Element segment;
+    while (ReadElement(p, end, segment) && segment.id != kSegment) {
+    }
+    if (segment.id != kSegment) {
+        return false;
+    }
+
+    const double usPerTick = 1e6 * stream.timebaseNum / static_cast<double>(std::max<uint32_t>(stream.timebaseDen, 1));
+
+    // Cues are usually written after the clusters; find them through SeekHead or the header walk
+    Element e;
+    const uint8_t* cuesAt = nullptr;
+    for (const uint8_t* q = segment.data; q < segment.end && !cuesAt;) {
+        const uint8_t* start = q;
+        if (!ReadElement(q, segment.end, e) || e.id == kCluster) {
+            break;
+        }
+        if (e.id == kCues) {
+            cuesAt = start;
+        } else if (e.id == kSeekHead) {
+            Element seek;
+            for (const uint8_t* r = e.data; ReadElement(r, e.end, seek);) {
+                if (seek.id != kSeek) {
+                    continue;
+                }
+                uint64_t id = 0;
+                uint64_t position = 0;
+                Element s;
+                for (const uint8_t* t = seek.data; ReadElement(t, seek.end, s);) {
+                    if (s.id == kSeekId) id = ReadUInt(s);
+                    if (s.id == kSeekPosition) position = ReadUInt(s);
+                }
+                if (id == kCues && position < Remaining(segment.data, segment.end)) {
+                    cuesAt = segment.data + position;
+                }
+            }
+        }
+    }
+
+    if (cuesAt && ReadElement(cuesAt, segment.end, e) && e.id == kCues) {
+        ReadCues(e, data, segment, stream.trackId, usPerTick, points);
+        if (!points.empty()) {
+            origin = SeekIndexOrigin::Container;
+            return true;
+        }
+    }
+
+    origin = SeekIndexOrigin::Scan;
+    return ScanClusters(data, segment, stream.trackId, usPerTick, points, cancelled) && !points.empty();
+}
+
+} // namespace ebml
+
+// ---------------------------------------------------------------------------
+// ISO base media file format (MP4 / MOV / M4A)
+// ---------------------------------------------------------------------------
+
+namespace isobmff {
+
+struct Box {
+    char type[4] = {};
+    const uint8_t* data = nullptr;  // Start of the payload
+    const uint8_t* end = nullptr;   // End of the payload, clamped to the buffer
+};
+
+bool ReadBox(const uint8_t*& p, const uint8_t* end, Box& box) {
+    if (Remaining(p, end) < 8) {
+        return false;
+    }
+
+    uint64_t size = ReadBE32(p);
+    std::memcpy(box.type, p + 4, 4);
+    size_t headerSize = 8;
+
+    if (size == 1) {
+        if (Remaining(p, end) < 16) {
+            return false;
+        }
+        size = ReadBE64(p + 8);
+        headerSize = 16;
+    } else if (size == 0) {
+        size = Remaining(p, end);
+    }
+    if (size < headerSize) {
+        return false;
+    }
+
+    box.data = p + headerSize;
+    box.end = (size > Remaining(p, end)) ? end : p + size;
+    p = box.end;
+    return true;
+}
+
+inline bool Is(const Box& box, const char* tag) { return std::memcmp(box.type, tag, 4) == 0; }
+
+struct TrackState {
+    StreamInfo stream;
+    uint32_t timescale = 0;
+    uint64_t mediaDuration = 0;
+    uint64_t sampleCount = 0;
+    uint64_t totalBytes = 0;
+    uint32_t declaredBitrate = 0;
+    char handler[4] = {};
+    // Set when a field cannot be represented; the track is left out
+    bool invalid = false;
+
+    // First non-empty edit: start in media ticks, length in movie ticks
+    int64_t editMediaTime = -1;
+    uint64_t editDuration = 0;
+};
+
+// Encoder delay/padding declared by an iTunSMPB tag
+struct GaplessTag {
+    bool present = false;
+    int64_t delay = 0;
+    int64_t padding = 0;
+};
+
+// Reads an MPEG-4 descriptor length (up to four 7-bit groups)
+bool ReadDescriptorLength(const uint8_t*& p, const uint8_t* end, uint32_t& length) {
+    length = 0;
+    for (int i = 0; i < 4; ++i) {
+        if (p >= end) {
+            return false;
+        }
+        const uint8_t b = *p++;
+        length = (length << 7) | (b & 0x7F);
+        if (!(b & 0x80)) {
+            return true;
+        }
+    }
+    return true;
+}
+
+void ParseEsds(const Box& box, TrackState& track) {
+    const uint8_t* p = box.data + 4;
+    const uint8_t* end = box.end;
+    uint32_t length = 0;
+
+    if (p >= end || *p++ != 0x03 || !ReadDescriptorLength(p, end, length) || Remaining(p, end) < 3) {
+        return;
+    }
+    const uint8_t flags = p[2];
+    p += 3;
+    if (flags & 0x80) p += 2;                        // dependsOn_ES_ID
+    if ((flags & 0x40) && p < end) p += 1 + *p;      // URL
+    if (flags & 0x20) p += 2;                        // OCR_ES_ID
+
+    if (p >= end || *p++ != 0x04 || !ReadDescriptorLength(p, end, length) || Remaining(p, end) < 13) {
+        return;
+    }
+
+    switch (p[0]) {
+        case 0x40: case 0x66: case 0x67: case 0x68: track.stream.codec = "aac"; break;
+        case 0x69: case 0x6B: track.stream.codec = "mp3"; break;
+        case 0x20: track.stream.codec = "mpeg4"; break;
+        case 0xA5: track.stream.codec = "ac3"; break;
+        case 0xA6: track.stream.codec = "eac3"; break;
+        default: break;
+    }
+    track.declaredBitrate = ReadBE32(p + 9);
+}
+
+std::string SampleEntryCodec(const uint8_t* fourcc) {
+    static const std::unordered_map<std::string, std::string> kCodecs = {
+        { "avc1", "h264" }, { "avc3", "h264" }, { "hvc1", "hevc" }, { "hev1", "hevc" },
+        { "av01", "av1" }, { "vp09", "vp9" }, { "vp08", "vp8" }, { "mp4v", "mpeg4" },
+        { "apch", "prores" }, { "apcn", "prores" }, { "apcs", "prores" }, { "apco", "prores" },
+        { "ap4h", "prores" }, { "jpeg", "mjpeg" }, { "mp4a", "aac" }, { "ac-3", "ac3" },
+        { "ec-3", "eac3" }, { "Opus", "opus" }, { "fLaC", "flac" }, { "alac", "alac" },
+        { ".mp3", "mp3" }, { "lpcm", "pcm" }, { "sowt", "pcm_s16le" }, { "twos", "pcm_s16be" },
+        { "tx3g", "mov_text" }, { "wvtt", "webvtt" }, { "stpp", "ttml" }, { "c608", "eia_608" }
+    };
+
+    const std::string key(reinterpret_cast<const char*>(fourcc), 4);
+    const auto it = kCodecs.find(key);
+    return it != kCodecs.end() ? it->second : FourCCString(fourcc);
+}
+
+void ParseStsd(const Box& box, TrackState& track) {
+    if (Remaining(box.data, box.end) < 8 || ReadBE32(box.data + 4) == 0) {
+        return;
+    }
+
+    const uint8_t* p = box.data + 8;
+    Box entry;
+    if (!ReadBox(p, box.end, entry)) {
+        return;
+    }
+
+    track.stream.codec = SampleEntryCodec(reinterpret_cast<const uint8_t*>(entry.type));
+
+    // Sample entries share 8 bytes (reserved + data_reference_index) before the type-specific fields
+    const uint8_t* fields = entry.data + 8;
+    const uint8_t* children = nullptr;
+
+    if (std::memcmp(track.handler, "vide", 4) == 0) {
+        if (Remaining(fields, entry.end) < 70) {
+            return;
+        }
+        track.stream.width = ReadBE16(fields + 16);
+        track.stream.height = ReadBE16(fields + 18);
+        children = fields + 70;
+    } else if (std::memcmp(track.handler, "soun", 4) == 0) {
+        if (Remaining(fields, entry.end) < 20) {
+            return;
+        }
+        const uint16_t version = ReadBE16(fields);
+        track.stream.channels = ReadBE16(fields + 8);
+        track.stream.bitsPerSample = ReadBE16(fields + 10);
+        track.stream.sampleRate = static_cast<int>(ReadBE32(fields + 16) >> 16);
+        children = fields + 20;
+
+        // QuickTime sound description versions carry extra fields
+        if (version == 1) {
+            children += 16;
+        } else if (version == 2 && Remaining(fields, entry.end) >= 56) {
+            uint64_t rateBits = ReadBE64(fields + 24);
+            double rate;
+            std::memcpy(&rate, &rateBits, sizeof(rate));
+            if (!ToInteger(rate, track.stream.sampleRate)) {
+                track.invalid = true;
+            }
+            track.stream.channels = static_cast<int>(ReadBE32(fields + 32));
+            children += 36;
+        }
+    }
+
+    if (!children) {
+        return;
+    }
+
+    Box child;
+    for (const uint8_t* q = children; ReadBox(q, entry.end, child);) {
+        if (Is(child, "esds")) {
+            ParseEsds(child, track);
+        } else if (Is(child, "btrt") && Remaining(child.data, child.end) >= 12) {
+            track.declaredBitrate = ReadBE32(child.data + 8);
+        }
+    }
+}
+
+void ParseStbl(const Box& stbl, TrackState& track) {
+    Box box;
+    for (const uint8_t* p = stbl.data; ReadBox(p, stbl.end, box);) {
+        if (Is(box, "stsd")) {
+            ParseStsd(box, track);
+        } else if (Is(box, "stsz") && Remaining(box.data, box.end) >= 12) {
+            const uint32_t sampleSize = ReadBE32(box.data + 4);
+            const uint32_t count = ReadBE32(box.data + 8);
+            track.sampleCount = count;
+            if (sampleSize != 0) {
+                track.totalBytes = static_cast<uint64_t>(sampleSize) * count;
+            } else {
+                const uint8_t* q = box.data + 12;
+                const size_t available = std::min<size_t>(count, Remaining(q, box.end) / 4);
+                uint64_t total = 0;
+                for (size_t i = 0; i < available; ++i) {
+                    total += ReadBE32(q + i * 4);
+                }
+                track.totalBytes = total;
+            }
+        } else if (Is(box, "stts") && Remaining(box.data, box.end) >= 8 && track.sampleCount == 0) {
+            const uint32_t entries = ReadBE32(box.data + 4);
+            const uint8_t* q = box.data + 8;
+            for (uint32_t i = 0; i < entries && Remaining(q, box.end) >= 8; ++i, q += 8) {
+                track.sampleCount += ReadBE32(q);
+            }
+        }
+    }
+}
+
+void ParseMdia(const Box& mdia, TrackState& track) {
+    Box box;
+    for (const uint8_t* p = mdia.data; ReadBox(p, mdia.end, box);) {
+        const size_t size = Remaining(box.data, box.end);
+        if (Is(box, "mdhd") && size >= 24) {
+            const uint8_t version = box.data[0];
+            const uint8_t* q = box.data + 4;
+            if (version == 1 && size >= 36) {
+                track.timescale = ReadBE32(q + 16);
+                track.mediaDuration = ReadBE64(q + 20);
+                q += 28;
+            } else {
+                track.timescale = ReadBE32(q + 8);
+                track.mediaDuration = ReadBE32(q + 12);
+                q += 16;
+            }
+            const uint16_t lang = ReadBE16(q);
+            if (lang != 0 && lang != 0x7FFF) {
+                track.stream.language = {
+                    static_cast<char>(((lang >> 10) & 0x1F) + 0x60),
+                    static_cast<char>(((lang >> 5) & 0x1F) + 0x60),
+                    static_cast<char>((lang & 0x1F) + 0x60)
+                };
+            }
+        } else if (Is(box, "hdlr") && size >= 12) {
+            std::memcpy(track.handler, box.data + 8, 4);
+        } else if (Is(box, "minf")) {
+            Box stbl;
+            for (const uint8_t* q = box.data; ReadBox(q, box.end, stbl);) {
+                if (Is(stbl, "stbl")) {
+                    ParseStbl(stbl, track);
+                }
+            }
+        }
+    }
+}
+
+// Keeps the first edit that maps media (empty edits, media_time -1, only delay the track)
+void ParseEdts(const Box& edts, TrackState& track) {
+    Box elst;
+    for (const uint8_t* p = edts.data; ReadBox(p, edts.end, elst);) {
+        if (!Is(elst, "elst") || Remaining(elst.data, elst.end) < 8) {
+            continue;
+        }
+        const bool wide = elst.data[0] == 1;
+        const size_t entrySize = wide ? 20 : 12;
+        const uint32_t entries = ReadBE32(elst.data + 4);
+        const uint8_t* q = elst.data + 8;
+        for (uint32_t i = 0; i < entries && Remaining(q, elst.end) >= entrySize; ++i, q += entrySize) {
+            const int64_t mediaTime = wide ? static_cast<int64_t>(ReadBE64(q + 8))
+                                           : static_cast<int32_t>(ReadBE32(q + 4));
+            if (mediaTime >= 0) {
+                track.editDuration = wide ? ReadBE64(q) : ReadBE32(q);
+                track.editMediaTime = mediaTime;
+                return;
+            }
+        }
+    }
+}
+
+void ParseTrak(const Box& trak, ContainerInfo& out, uint32_t movieTimescale) {
+    TrackState track;
+    Box box;
+    for (const uint8_t* p = trak.data; ReadBox(p, trak.end, box);) {
+        if (Is(box, "tkhd") && Remaining(box.data, box.end) >= 24) {
+            track.stream.trackId = ReadBE32(box.data + (box.data[0] == 1 ? 20 : 12));
+        } else if (Is(box, "mdia")) {
+            ParseMdia(box, track);
+        } else if (Is(box, "edts")) {
+            ParseEdts(box, track);
+        }
+    }
+
+    StreamInfo& stream = track.stream;
+    if (std::memcmp(track.handler, "vide", 4) == 0) {
+        stream.type = StreamType::Video;
+    } else if (std::memcmp(track.handler, "soun", 4) == 0) {
+        stream.type = StreamType::Audio;
+    } else if (std::memcmp(track.handler, "subt", 4) == 0 || std::memcmp(track.handler, "text", 4) == 0 ||
+               std::memcmp(track.handler, "sbtl", 4) == 0) {
+        stream.type = StreamType::Subtitle;
+    } else {
+        stream.type = StreamType::Data;
+    }
+
+    if (track.timescale > 0) {
+        SetTimebase(stream, 1, track.timescale);
+        stream.duration = static_cast<double>(track.mediaDuration) / track.timescale;
+    }
+    if (stream.type == StreamType::Video && stream.duration > 0.0 && track.sampleCount > 0) {
+        stream.frameRate = static_cast<double>(track.sampleCount) / stream.duration;
+    }
+    if (track.declaredBitrate > 0) {
+        stream.bitrate = track.declaredBitrate;
+    } else if (stream.duration > 0.0 && track.totalBytes > 0) {
+        ToInteger(static_cast<double>(track.totalBytes) * 8.0 / stream.duration, stream.bitrate);
+    }
+
+    // The edit list trims priming samples at the start and padding beyond the edit's length
+    if (stream.type == StreamType::Audio && track.editMediaTime >= 0 && track.timescale > 0 && stream.sampleRate > 0) {
+        const auto toSamples = [&](uint64_t ticks) {
+            return static_cast<int64_t>(ticks * static_cast<uint64_t>(stream.sampleRate) / track.timescale);
+        };
+        const uint64_t start = static_cast<uint64_t>(track.editMediaTime);
+        stream.encoderDelay = toSamples(start);
+        if (track.editDuration > 0 && movieTimescale > 0) {
+            const uint64_t shown = track.editDuration * track.timescale / movieTimescale;
+            if (track.mediaDuration > start + shown) {
+                stream.encoderPadding = toSamples(track.mediaDuration - start - shown);
+            }
+        }
+    }
+
+    if (track.invalid) {
+        return;
+    }
+    stream.index = static_cast<int>(out.streams.size());
+    out.streams.push_back(std::move(stream));
+}
+
+// Reads the "iTunSMPB" freeform item: " 00000000 <delay> <padding> <length> ..." in hex
+void ParseFreeformItem(const Box& item, GaplessTag& gapless) {
+    std::string name;
+    std::string value;
+    Box child;
+    for (const uint8_t* p = item.data; ReadBox(p, item.end, child);) {
+        if (Is(child, "name") && Remaining(child.data, child.end) >= 4) {
+            name.assign(reinterpret_cast<const char*>(child.data + 4), Remaining(child.data + 4, child.end));
+        } else if (Is(child, "data") && Remaining(child.data, child.end) >= 8) {
+            value.assign(reinterpret_cast<const char*>(child.data + 8), Remaining(child.data + 8, child.end));
+        }
+    }
+    if (name != "iTunSMPB") {
+        return;
+    }
+
+    uint64_t fields[3] = {};
+    const char* cursor = value.c_str();
+    for (uint64_t& field : fields) {
+        char* next = nullptr;
+        field = std::strtoull(cursor, &next, 16);
+        if (next == cursor) {
+            return;
+        }
+        cursor = next;
+    }
+    gapless.present = true;
+    gapless.delay = static_cast<int64_t>(fields[1]);
+    gapless.padding = static_cast<int64_t>(fields[2]);
+}
+
+// Reads iTunes-style ©nam / ©ART atoms and the iTunSMPB gapless tag from moov/udta/meta/ilst
+void ParseUdta(const Box& udta, ContainerInfo& out, GaplessTag& gapless) {
+    Box meta;
+    for (const uint8_t* p = udta.data; ReadBox(p, udta.end, meta);) {
+        if (!Is(meta, "meta")) {
+            continue;
+        }
+
+        // ISO meta is a FullBox, QuickTime meta is not
+        const uint8_t* q = meta.data;
+        if (Remaining(q, meta.end) >= 12 && !Tag(q + 4, "hdlr")) {
+            q += 4;
+        }
+
+        Box ilst;
+        for (; ReadBox(q, meta.end, ilst);) {
+            if (!Is(ilst, "ilst")) {
+                continue;
+            }
+            Box item;
+            for (const uint8_t* r = ilst.data; ReadBox(r, ilst.end, item);) {
+                if (Is(item, "----")) {
+                    ParseFreeformItem(item, gapless);
+                    continue;
+                }
+                const bool isTitle = std::memcmp(item.type, "\xA9nam", 4) == 0;
+                const bool isArtist = std::memcmp(item.type, "\xA9" "ART", 4) == 0;
+                if (!isTitle && !isArtist) {
+                    continue;
+                }
+                Box data;
+                const uint8_t* s = item.data;
+                if (ReadBox(s, item.end, data) && Is(data, "data") && Remaining(data.data, data.end) >= 8) {
+                    std::string value(reinterpret_cast<const char*>(data.data + 8), Remaining(data.data + 8, data.end));
+                    (isTitle ? out.title : out.artist) = std::move(value);
+                }
+            }
+        }
+    }
+}
+
+bool Parse(const uint8_t* data, size_t size, ContainerInfo& out) {
+    const uint8_t* end = data + size;
+    bool hasMoov = false;
+    uint32_t movieTimescale = 0;
+    uint64_t movieDuration = 0;
+    uint64_t fragmentDuration = 0;
+    GaplessTag gapless;
+
+    out.formatName = "mp4";
+
+    Box box;
+    for (const uint8_t* p = data; ReadBox(p, end, box);) {
+        if (Is(box, "ftyp") && Remaining(box.data, box.end) >= 4) {
+            if (Tag(box.data, "qt  ")) {
+                out.formatName = "mov";
+            } else if (Tag(box.data, "M4A ") || Tag(box.data, "M4B ")) {
+                out.formatName = "m4a";
+            }
+            continue;
+        }
+        if (!Is(box, "moov")) {
+            continue;  // mdat, moof, free, ... are skipped by size
+        }
+
+        hasMoov = true;
+        Box child;
+        for (const uint8_t* q = box.data; ReadBox(q, box.end, child);) {
+            const size_t childSize = Remaining(child.data, child.end);
+            if (Is(child, "mvhd") && childSize >= 20) {
+                if (child.data[0] == 1 && childSize >= 32) {
+                    movieTimescale = ReadBE32(child.data + 20);
+                    movieDuration = ReadBE64(child.data + 24);
+                } else {
+                    movieTimescale = ReadBE32(child.data + 12);
+                    movieDuration = ReadBE32(child.data + 16);
+                }
+            } else if (Is(child, "trak")) {
+                ParseTrak(child, out, movieTimescale);
+            } else if (Is(child, "udta")) {
+                ParseUdta(child, out, gapless);
+            } else if (Is(child, "mvex")) {
+                Box mehd;
+                for (const uint8_t* r = child.data; ReadBox(r, child.end, mehd);) {
+                    if (Is(mehd, "mehd") && Remaining(mehd.data, mehd.end) >= 8) {
+                        fragmentDuration = (mehd.data[0] == 1 && Remaining(mehd.data, mehd.end) >= 12)
+                            ? ReadBE64(mehd.data + 4) : ReadBE32(mehd.data + 4);
+                    }
+                }
+            }
+        }
+    }
+
+    if (!hasMoov) {
+        return false;
+    }
+
+    if (movieTimescale > 0) {
+        out.duration = static_cast<double>(std::max(movieDuration, fragmentDuration)) / movieTimescale;
+    }
+
+    // iTunSMPB is what iTunes-encoded AAC relies on; it wins over the edit list
+    if (gapless.present) {
+        const auto audio = std::find_if(out.streams.begin(), out.streams.end(),
+                                        [](const StreamInfo& s) { return s.type == StreamType::Audio; });
+        if (audio != out.streams.end()) {
+            audio->encoderDelay = gapless.delay;
+            audio->encoderPadding = gapless.padding;
+        }
+    }
+    return true;
+}
+
+// Raw sample table boxes of one track; absent boxes keep a null data pointer
+struct SampleTables {
+    Box stts, ctts, stss, stsc, stsz, stco;
+    bool co64 = false;
+};
+
+// Minimum spacing between indexed points of tracks where every sample is a sync sample
+constexpr int64_t kAllSyncSpacingUs = 500000;
+
+// Chunks or samples walked between cancellation checks
+constexpr uint32_t kCancelPollInterval = 4096;
+
+bool FindSampleTables(const Box& moov, uint32_t trackId, SampleTables& tables) {
+    Box trak;
+    for (const uint8_t* p = moov.data; ReadBox(p, moov.end, trak);) {
+        if (!Is(trak, "trak")) {
+            continue;
+        }
+
+        uint32_t id = 0;
+        bool hasStbl = false;
+        Box box, stbl;
+        for (const uint8_t* q = trak.data; ReadBox(q, trak.end, box);) {
+            if (Is(box, "tkhd") && Remaining(box.data, box.end) >= 24) {
+                id = ReadBE32(box.data + (box.data[0] == 1 ? 20 : 12));
+            } else if (Is(box, "mdia")) {
+                Box minf;
+                for (const uint8_t* r = box.data; ReadBox(r, box.end, minf);) {
+                    for (const uint8_t* t = minf.data; Is(minf, "minf") && ReadBox(t, minf.end, stbl);) {
+                        if (Is(stbl, "stbl")) {
+                            hasStbl = true;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        if (id != trackId || !hasStbl) {
+            continue;
+        }
+
+        for (const uint8_t* q = stbl.data; ReadBox(q, stbl.end, box);) {
+            if (Is(box, "stts")) tables.stts = box;
+            else if (Is(box, "ctts")) tables.ctts = box;
+            else if (Is(box, "stss")) tables.stss = box;
+            else if (Is(box, "stsc")) tables.stsc = box;
+            else if (Is(box, "stsz")) tables.stsz = box;
+            else if (Is(box, "stco")) tables.stco = box;
+            else if (Is(box, "co64")) { tables.stco = box; tables.co64 = true; }
+        }
+        return tables.stts.data && tables.stsc.data && tables.stsz.data && tables.stco.data;
+    }
+    return false;
+}
+
+// Clamps a table's declared entry count (at countOffset) to what the box actually holds
+uint32_t TableEntries(const Box& box, size_t headerSize, size_t entrySize, size_t countOffset = 4) {
+    if (!box.data || Remaining(box.data, box.end) < headerSize) {
+        return 0;
+    }
+    const size_t available = Remaining(box.data + headerSize, box.end) / entrySize;
+    return static_cast<uint32_t>(std::min<size_t>(ReadBE32(box.data + countOffset), available));
+}
+
+// Walks the sample tables in decode order and records the sync samples; false if cancelled
+bool ReadSyncSamples(const SampleTables& tables, uint32_t timescale, std::vector<SeekPoint>& points,
+                     const std::function<bool()>& cancelled) {
+    const uint32_t sttsEntries = TableEntries(tables.stts, 8, 8);
+    const uint32_t cttsEntries = TableEntries(tables.ctts, 8, 8);
+    const uint32_t stssEntries = TableEntries(tables.stss, 8, 4);
+    const uint32_t stscEntries = TableEntries(tables.stsc, 8, 12);
+    const uint32_t chunkCount = TableEntries(tables.stco, 8, tables.co64 ? 8 : 4);
+    if (Remaining(tables.stsz.data, tables.stsz.end) < 12 || stscEntries == 0) {
+        return true;
+    }
+
+    // stsz: version/flags, sample_size, sample_count, then per-sample sizes when sample_size is 0
+    const uint32_t fixedSize = ReadBE32(tables.stsz.data + 4);
+    const uint32_t sampleCount = fixedSize != 0
+        ? ReadBE32(tables.stsz.data + 8) : TableEntries(tables.stsz, 12, 4, 8);
+    const bool allSync = !tables.stss.data;
+    const bool cttsSigned = tables.ctts.data && tables.ctts.data[0] == 1;
+
+    const uint8_t* stts = tables.stts.data + 8;
+    const uint8_t* ctts = tables.ctts.data ? tables.ctts.data + 8 : nullptr;
+    const uint8_t* stss = tables.stss.data ? tables.stss.data + 8 : nullptr;
+    const uint8_t* stsc = tables.stsc.data + 8;
+    const uint8_t* stco = tables.stco.data + 8;
+    const uint8_t* sizes = tables.stsz.data + 12;
+
+    uint32_t sttsIndex = 0, sttsLeft = sttsEntries ? ReadBE32(stts) : 0;
+    uint32_t cttsIndex = 0, cttsLeft = cttsEntries ? ReadBE32(ctts) : 0;
+    uint32_t stssIndex = 0;
+    uint32_t stscIndex = 0;
+    uint64_t dts = 0;
+    uint32_t sample = 0;
+    // The first candidate is always kept
+    int64_t lastUs = INT64_MIN;
+
+    for (uint32_t chunk = 0; chunk < chunkCount && sample < sampleCount; ++chunk) {
+        if (cancelled && chunk % kCancelPollInterval == 0 && cancelled()) {
+            return false;
+        }
+
+        // stsc chunk numbers are 1-based
+        while (stscIndex + 1 < stscEntries && ReadBE32(stsc + (stscIndex + 1) * 12) <= chunk + 1) {
+            ++stscIndex;
+        }
+        const uint32_t perChunk = ReadBE32(stsc + stscIndex * 12 + 4);
+        uint64_t offset = tables.co64 ? ReadBE64(stco + chunk * 8) : ReadBE32(stco + chunk * 4);
+
+        // Constant-size sync-only tracks (PCM) can hold millions of samples: one candidate per chunk
+        if (allSync && fixedSize != 0 && !ctts) {
+            int64_t us = 0;
+            if (ToInteger(static_cast<double>(dts) * 1e6 / timescale, us) && us - kAllSyncSpacingUs >= lastUs) {
+                points.push_back({ us, offset });
+                lastUs = us;
+            }
+            uint32_t skip = std::min(perChunk, sampleCount - sample);
+            sample += skip;
+            while (skip > 0 && sttsIndex < sttsEntries) {
+                const uint32_t take = std::min(skip, sttsLeft);
+                dts += static_cast<uint64_t>(take) * ReadBE32(stts + sttsIndex * 8 + 4);
+                skip -= take;
+                sttsLeft -= take;
+                if (sttsLeft == 0 && ++sttsIndex < sttsEntries) {
+                    sttsLeft = ReadBE32(stts + sttsIndex * 8);
+                }
+            }
+            continue;
+        }
+
+        for (uint32_t i = 0; i < perChunk && sample < sampleCount; ++i, ++sample) {
+            if (cancelled && sample % kCancelPollInterval == 0 && cancelled()) {
+                return false;
+            }
+
+            bool sync = allSync;
+            while (!allSync && stssIndex < stssEntries && ReadBE32(stss + stssIndex * 4) < sample + 1) {
+                ++stssIndex;
+            }
+            if (!allSync && stssIndex < stssEntries && ReadBE32(stss + stssIndex * 4) == sample + 1) {
+                sync = true;
+            }
+
+            int64_t composition = 0;
+            if (cttsIndex < cttsEntries) {
+                const uint32_t raw = ReadBE32(ctts + cttsIndex * 8 + 4);
+                composition = cttsSigned ? static_cast<int32_t>(raw) : static_cast<int64_t>(raw);
+            }
+
+            if (sync) {
+                const double pts = std::max(static_cast<double>(dts) + static_cast<double>(composition), 0.0);
+                int64_t us = 0;
+                if (ToInteger(pts * 1e6 / timescale, us) && (!allSync || us - kAllSyncSpacingUs >= lastUs)) {
+                    points.push_back({ us, offset });
+                    lastUs = us;
+                }
+            }
+
+            offset += fixedSize != 0 ? fixedSize : ReadBE32(sizes + static_cast<size_t>(sample) * 4);
+            if (sttsIndex < sttsEntries) {
+                dts += ReadBE32(stts + sttsIndex * 8 + 4);
+                if (--sttsLeft == 0 && ++sttsIndex < sttsEntries) {
+                    sttsLeft = ReadBE32(stts + sttsIndex * 8);
+                }
+            }
+            if (cttsIndex < cttsEntries && --cttsLeft == 0 && ++cttsIndex < cttsEntries) {
+                cttsLeft = ReadBE32(ctts + cttsIndex * 8);
+            }
+        }
+    }
+    return true;
+}
+
+// Records the start of every movie fragment carrying the track (fragments open on a sync sample)
+bool ReadFragments(const uint8_t* data, size_t size, uint32_t trackId, uint32_t timescale,
+                   std::vector<SeekPoint>& points, const std::function<bool()>& cancelled) {
+    const uint8_t* end = data + size;
+    Box box;
+    for (const uint8_t* p = data; p < end;) {
+        const uint8_t* start = p;
+        if (!ReadBox(p, end, box)) {
+            break;
+        }
+        if (!Is(box, "moof")) {
+            continue;
+        }
+        if (cancelled && cancelled()) {
+            return false;
+        }
+
+        Box traf;
+        for (const uint8_t* q = box.data; ReadBox(q, box.end, traf);) {
+            if (!Is(traf, "traf")) {
+                continue;
+            }
+            uint32_t id = 0;
+            bool hasTime = false;
+            uint64_t baseTime = 0;
+            Box child;
+            for (const uint8_t* r = traf.data; ReadBox(r, traf.end, child);) {
+                const size_t childSize = Remaining(child.data, child.end);
+                if (Is(child, "tfhd") && childSize >= 8) {
+                    id = ReadBE32(child.data + 4);
+                } else if (Is(child, "tfdt") && childSize >= 8) {
+                    baseTime = (child.data[0] == 1 && childSize >= 12) ? ReadBE64(child.data + 4) : ReadBE32(child.data + 4);
+                    hasTime = true;
+                }
+            }
+            int64_t us = 0;
+            if (id == trackId && hasTime && ToInteger(static_cast<double>(baseTime) * 1e6 / timescale, us)) {
+                points.push_back({ us, static_cast<uint64_t>(start - data) });
+            }
+        }
+    }
+    return true;
+}
+
+bool BuildIndex(const StreamInfo& stream, const uint8_t* data, size_t size, std::vector<SeekPoint>& points,
+                SeekIndexOrigin& origin, const std::function<bool()>& cancelled) {
+    // Timebases are stored reduced; 1/timescale stays 1/timescale
+    const uint32_t timescale = stream.timebaseNum == 1 ? stream.timebaseDen : 0;
+    if (timescale == 0) {
+        return false;
+    }
+
+    const uint8_t* end = data + size;
+    Box box;
+    for (const uint8_t* p = data; ReadBox(p, end, box);) {
+        SampleTables tables;
+        if (Is(box, "moov") && FindSampleTables(box, stream.trackId, tables)) {
+            if (!ReadSyncSamples(tables, timescale, points, cancelled)) {
+                return false;
+            }
+            break;
+        }
+    }
+
+    // Fragmented files keep (almost) no samples in moov; their only index is the moof chain
+    const size_t fromTables = points.size();
+    if (!ReadFragments(data, size, stream.trackId, timescale, points, cancelled)) {
+        return false;
+    }
+    origin = points.size() > fromTables ? SeekIndexOrigin::Scan : SeekIndexOrigin::Container;
+    return !points.empty();
+}
+
+} // namespace isobmff
+
+// ---------------------------------------------------------------------------
+// RIFF (WAV / RF64 / AVI)
+// ---------------------------------------------------------------------------
+
+namespace riff {
+
+bool ParseWave(const uint8_t* data, size_t size, ContainerInfo& out) {
+    const uint8_t* end = data + size;
+    const bool isRf64 = Tag(data, "RF64");
+    out.formatName = isRf64 ? "rf64" : "wav";
+
+    StreamInfo stream;
+    uint32_t byteRate = 0;
+    uint64_t dataSize = 0;
+    uint64_t ds64DataSize = 0;
+    uint64_t factSamples = 0;
+    bool hasFormat = false;
+    bool hasData = false;
+
+    for (const uint8_t* p = data + 12; Remaining(p, end) >= 8;) {
+        const uint8_t* chunk = p + 8;
+        uint64_t chunkSize = ReadLE32(p + 4);
+
+        if (Tag(p, "ds64") && Remaining(chunk, end) >= 24) {
+            ds64DataSize = ReadLE64(chunk + 8);
+        } else if (Tag(p, "fmt ")) {
+            ParseWaveFormat(chunk, std::min<size_t>(chunkSize, Remaining(chunk, end)), stream, byteRate);
+            hasFormat = true;
+        } else if (Tag(p, "fact") && Remaining(chunk, end) >= 4) {
+            factSamples = ReadLE32(chunk);
+        } else if (Tag(p, "data")) {
+            if (isRf64 && chunkSize == 0xFFFFFFFF) {
+                chunkSize = ds64DataSize;
+            }
+            dataSize = std::min<uint64_t>(chunkSize, Remaining(chunk, end));
+            hasData = true;
+            break;  // Sample payload follows, nothing left worth parsing
+        }
+
+        if (chunkSize > Remaining(chunk, end)) {
+            break;
+        }
+        p = chunk + chunkSize + (chunkSize & 1);
+    }
+
+    if (!hasFormat) {
+        return false;
+    }
+
+    if (factSamples > 0 && stream.sampleRate > 0) {
+        stream.duration = static_cast<double>(factSamples) / stream.sampleRate;
+    } else if (hasData && byteRate > 0) {
+        stream.duration = static_cast<double>(dataSize) / byteRate;
+    }
+
+    out.duration = stream.duration;
+    out.streams.push_back(std::move(stream));
+    return true;
+}
+
+std::string AviVideoCodec(const uint8_t* fourcc) {
+    static const std::unordered_map<std::string, std::string> kCodecs = {
+        { "H264", "h264" }, { "h264", "h264" }, { "X264", "h264" }, { "x264", "h264" }, { "avc1", "h264" },
+        { "HEVC", "hevc" }, { "H265", "hevc" }, { "XVID", "mpeg4" }, { "xvid", "mpeg4" }, { "DIVX", "mpeg4" },
+        { "DX50", "mpeg4" }, { "FMP4", "mpeg4" }, { "MJPG", "mjpeg" }, { "mpg2", "mpeg2video" }
+    };
+
+    const std::string key(reinterpret_cast<const char*>(fourcc), 4);
+    const auto it = kCodecs.find(key);
+    return it != kCodecs.end() ? it->second : FourCCString(fourcc);
+}
+
+void ParseAviStreamList(const uint8_t* p, const uint8_t* end, ContainerInfo& out) {
+    StreamInfo stream;
+    bool isVideo = false;
+    bool valid = true;
+    uint32_t scale = 0;
+    uint32_t rate = 0;
+    uint32_t length = 0;
+
+    while (Remaining(p, end) >= 8) {
+        const uint8_t* chunk = p + 8;
+        const uint32_t chunkSize = ReadLE32(p + 4);
+        const size_t available = std::min<size_t>(chunkSize, Remaining(chunk, end));
+
+        if (Tag(p, "strh") && available >= 36) {
+            isVideo = Tag(chunk, "vids");
+            stream.type = isVideo ? StreamType::Video : (Tag(chunk, "auds") ? StreamType::Audio : StreamType::Data);
+            if (isVideo) {
+                stream.codec = AviVideoCodec(chunk + 4);
+            }
+            scale = ReadLE32(chunk + 20);
+            rate = ReadLE32(chunk + 24);
+            length = ReadLE32(chunk + 32);
+        } else if (Tag(p, "strf")) {
+            if (isVideo && available >= 20) {
+                stream.width = static_cast<int>(ReadLE32(chunk + 4));
+                // Negative heights mark top-down bitmaps; INT32_MIN has no positive counterpart
+                const int64_t height = static_cast<int32_t>(ReadLE32(chunk + 8));
+                if (height == INT32_MIN) {
+                    valid = false;
+                }
+                stream.height = static_cast<int>(std::abs(height));
+                if (stream.codec.empty()) {
+                    stream.codec = AviVideoCodec(chunk + 16);
+                }
+            } else if (stream.type == StreamType::Audio) {
+                uint32_t byteRate = 0;
+                ParseWaveFormat(chunk, available, stream, byteRate);
+            }
+        }
+
+        if (chunkSize > Remaining(chunk, end)) {
+            break;
+        }
+        p = chunk + chunkSize + (chunkSize & 1);
+    }
+
+    if (scale > 0 && rate > 0) {
+        SetTimebase(stream, scale, rate);
+        stream.duration = static_cast<double>(length) * scale / rate;
+        if (isVideo) {
+            stream.frameRate = static_cast<double>(rate) / scale;
+        }
+    }
+
+    if (!valid) {
+        return;
+    }
+    stream.index = static_cast<int>(out.streams.size());
+    out.streams.push_back(std::move(stream));
+}
+
+bool ParseAvi(const uint8_t* data, size_t size, ContainerInfo& out) {
+    const uint8_t* end = data + size;
+    out.formatName = "avi";
+
+    for (const uint8_t* p = data + 12; Remaining(p, end) >= 12;) {
+        const uint8_t* chunk = p + 8;
+        const uint32_t chunkSize = ReadLE32(p + 4);
+        const uint8_t* chunkEnd = chunk + std::min<size_t>(chunkSize, Remaining(chunk, end));
+
+        if (Tag(p, "LIST") && Tag(chunk, "hdrl")) {
+            for (const uint8_t* q = chunk + 4; Remaining(q, chunkEnd) >= 8;) {
+                const uint8_t* sub = q + 8;
+                const uint32_t subSize = ReadLE32(q + 4);
+                const uint8_t* subEnd = sub + std::min<size_t>(subSize, Remaining(sub, chunkEnd));
+
+                if (Tag(q, "avih") && Remaining(sub, subEnd) >= 20) {
+                    const uint32_t usPerFrame = ReadLE32(sub);
+                    const uint32_t totalFrames = ReadLE32(sub + 16);
+                    out.duration = static_cast<double>(usPerFrame) * totalFrames / 1e6;
+                } else if (Tag(q, "LIST") && Remaining(sub, subEnd) >= 4 && Tag(sub, "strl")) {
+                    ParseAviStreamList(sub + 4, subEnd, out);
+                }
+                q = subEnd + (subSize & 1);
+            }
+            return !out.streams.empty();
+        }
+
+        if (chunkSize > Remaining(chunk, end)) {
+            break;
+        }
+        p = chunk + chunkSize + (chunkSize & 1);
+    }
+    return false;
+}
+
+} // namespace riff
+
+// ---------------------------------------------------------------------------
+// FLAC
+// ---------------------------------------------------------------------------
+
+namespace flac {
+
+// Skips a leading ID3v2 tag, returning the offset of the next structure
+size_t SkipId3(const uint8_t* data, size_t size) {
+    if (size < 10 || !(data[0] == 'I' && data[1] == 'D' && data[2] == '3')) {
+        return 0;
+    }
+    const size_t tagSize = (size_t(data[6] & 0x7F) << 21) | (size_t(data[7] & 0x7F) << 14) |
+                           (size_t(data[8] & 0x7F) << 7) | size_t(data[9] & 0x7F);
+    const size_t footer = (data[5] & 0x10) ? 10 : 0;
+    return std::min(size, 10 + tagSize + footer);
+}
+
+void ParseVorbisComment(const uint8_t* p, const uint8_t* end, ContainerInfo& out) {
+    if (Remaining(p, end) < 4) {
+        return;
+    }
+    p += 4 + ReadLE32(p);  // vendor string
+    if (Remaining(p, end) < 4) {
+        return;
+    }
+
+    const uint32_t count = ReadLE32(p);
+    p += 4;
+    for (uint32_t i = 0; i < count && Remaining(p, end) >= 4; ++i) {
+        const uint32_t length = ReadLE32(p);
+        p += 4;
+        if (length > Remaining(p, end)) {
+            return;
+        }
+
+        const std::string comment(reinterpret_cast<const char*>(p), length);
+        p += length;
+
+        const size_t eq = comment.find('=');
+        if (eq == std::string::npos) {
+            continue;
+        }
+        std::string key = comment.substr(0, eq);
+        std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return std::toupper(c); });
+        if (key == "TITLE" && out.title.empty()) out.title = comment.substr(eq + 1);
+        if (key == "ARTIST" && out.artist.empty()) out.artist = comment.substr(eq + 1);
+    }
+}
+
+bool Parse(const uint8_t* data, size_t size, ContainerInfo& out) {
+    const uint8_t* end = data + size;
+    const uint8_t* p = data + SkipId3(data, size);
+    if (Remaining(p, end) < 8 || !Tag(p, "fLaC")) {
+        return false;
+    }
+    p += 4;
+
+    out.formatName = "flac";
+    StreamInfo stream;
+    stream.type = StreamType::Audio;
+    stream.codec = "flac";
+    uint64_t totalSamples = 0;
+    bool hasStreamInfo = false;
+
+    bool last = false;
+    while (!last && Remaining(p, end) >= 4) {
+        last = (p[0] & 0x80) != 0;
+        const uint8_t type = p[0] & 0x7F;
+        const uint32_t length = ReadBE24(p + 1);
+        const uint8_t* block = p + 4;
+        if (length > Remaining(block, end)) {
+            break;
+        }
+
+        if (type == 0 && length >= 18) {
+            const uint64_t bits = ReadBE64(block + 10);
+            stream.sampleRate = static_cast<int>(bits >> 44);
+            stream.channels = static_cast<int>((bits >> 41) & 0x7) + 1;
+            stream.bitsPerSample = static_cast<int>((bits >> 36) & 0x1F) + 1;
+            totalSamples = bits & 0xFFFFFFFFFULL;
+            hasStreamInfo = true;
+        } else if (type == 4) {
+            ParseVorbisComment(block, block + length, out);
+        }
+        p = block + length;
+    }
+
+    if (!hasStreamInfo || stream.sampleRate == 0) {
+        return false;
+    }
+
+    SetTimebase(stream, 1, static_cast<uint64_t>(stream.sampleRate));
+    stream.duration = static_cast<double>(totalSamples) / stream.sampleRate;
+    if (stream.duration > 0.0) {
+        ToInteger(static_cast<double>(Remaining(p, end)) * 8.0 / stream.duration, stream.bitrate);
+    }
+
+    out.duration = stream.duration;
+    out.streams.push_back(std::move(stream));
+    return true;
+}
+
+} // namespace flac
+
+// ---------------------------------------------------------------------------
+// MPEG transport stream (TS / M2TS)
+// ---------------------------------------------------------------------------
+
+namespace mpegts {
+
+constexpr uint8_t kSync = 0x47;
+constexpr size_t kHeadWindow = 4 * 1024 * 1024;
+constexpr size_t kTailWindow = 2 * 1024 * 1024;
+constexpr uint64_t kPtsWrap = 1ULL << 33;
+
+// Returns the packet size (188, 192 or 204) and the offset of the sync byte within a packet
+bool DetectPacketLayout(const uint8_t* data, size_t size, size_t& packetSize, size_t& syncOffset) {
+    static constexpr size_t kSizes[] = { 188, 192, 204 };
+    for (const size_t candidate : kSizes) {
+        const size_t offset = (candidate == 192) ? 4 : 0;
+        if (size < offset + candidate * 2 + 1) {
+            continue;
+        }
+        if (data[offset] == kSync && data[offset + candidate] == kSync && data[offset + candidate * 2] == kSync) {
+            packetSize = candidate;
+            syncOffset = offset;
+            return true;
+        }
+    }
+    return false;
+}
+
+struct PidState {
+    size_t streamIndex = 0;
+    bool hasFirstPts = false;
+    uint64_t firstPts = 0;
+    uint64_t lastPts = 0;
+    uint64_t packets = 0;
+};
+
+bool ReadPts(const uint8_t* payload, const uint8_t* end, uint64_t& pts) {
+    if (Remaining(payload, end) < 14 || payload[0] != 0 || payload[1] != 0 || payload[2] != 1) {
+        return false;
+    }
+    if (!(payload[7] & 0x80)) {
+        return false;
+    }
+    const uint8_t* p = payload + 9;
+    pts = (uint64_t(p[0] >> 1) & 0x07) << 30 | uint64_t(p[1]) << 22 | uint64_t(p[2] >> 1) << 15 |
+          uint64_t(p[3]) << 7 | uint64_t(p[4] >> 1);
+    return true;
+}
+
+// Fills sample rate and channel count from the first ADTS header of an AAC PES
+void ReadAdts(const uint8_t* payload, const uint8_t* end, StreamInfo& stream) {
+    static constexpr int kRates[] = { 96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350 };
+    if (Remaining(payload, end) < 9) {
+        return;
+    }
+    const uint8_t* p = payload + 9 + payload[8];
+    if (Remaining(p, end) < 4 || p[0] != 0xFF || (p[1] & 0xF6) != 0xF0) {
+        return;
+    }
+    const int rateIndex = (p[2] >> 2) & 0x0F;
+    if (rateIndex < 13) {
+        stream.sampleRate = kRates[rateIndex];
+    }
+    stream.channels = ((p[2] & 0x01) << 2) | (p[3] >> 6);
+}
+
+void AssignStreamType(uint8_t streamType, const uint8_t* desc, const uint8_t* descEnd, StreamInfo& stream) {
+    switch (streamType) {
+        case 0x01: stream.type = StreamType::Video; stream.codec = "mpeg1video"; break;
+        case 0x02: stream.type = StreamType::Video; stream.codec = "mpeg2video"; break;
+        case 0x10: stream.type = StreamType::Video; stream.codec = "mpeg4"; break;
+        case 0x1B: stream.type = StreamType::Video; stream.codec = "h264"; break;
+        case 0x24: stream.type = StreamType::Video; stream.codec = "hevc"; break;
+        case 0xEA: stream.type = StreamType::Video; stream.codec = "vc1"; break;
+        case 0x03:
+        case 0x04: stream.type = StreamType::Audio; stream.codec = "mp2"; break;
+        case 0x0F: stream.type = StreamType::Audio; stream.codec = "aac"; break;
+        case 0x11: stream.type = StreamType::Audio; stream.codec = "aac_latm"; break;
+        case 0x80: stream.type = StreamType::Audio; stream.codec = "pcm_bluray"; break;
+        case 0x81: stream.type = StreamType::Audio; stream.codec = "ac3"; break;
+        case 0x82:
+        case 0x85:
+        case 0x86: stream.type = StreamType::Audio; stream.codec = "dts"; break;
+        case 0x83: stream.type = StreamType::Audio; stream.codec = "truehd"; break;
+        case 0x84:
+        case 0x87: stream.type = StreamType::Audio; stream.codec = "eac3"; break;
+        case 0x90: stream.type = StreamType::Subtitle; stream.codec = "hdmv_pgs_subtitle"; break;
+        default:   stream.type = StreamType::Data; stream.codec = "unknown"; break;
+    }
+
+    // ES descriptors: language, and codec identification for private streams (0x06)
+    while (Remaining(desc, descEnd) >= 2) {
+        const uint8_t tag = desc[0];
+        const uint8_t length = desc[1];
+        const uint8_t* body = desc + 2;
+        if (length > Remaining(body, descEnd)) {
+            break;
+        }
+
+        if (tag == 0x0A && length >= 3) {
+            stream.language.assign(reinterpret_cast<const char*>(body), 3);
+        } else if (streamType == 0x06) {
+            switch (tag) {
+                case 0x6A: stream.type = StreamType::Audio; stream.codec = "ac3"; break;
+                case 0x7A: stream.type = StreamType::Audio; stream.codec = "eac3"; break;
+                case 0x7B: stream.type = StreamType::Audio; stream.codec = "dts"; break;
+                case 0x59: stream.type = StreamType::Subtitle; stream.codec = "dvb_subtitle"; break;
+                case 0x56: stream.type = StreamType::Subtitle; stream.codec = "dvb_teletext"; break;
+                case 0x05:
+                    if (length >= 4 && Tag(body, "Opus")) { stream.type = StreamType::Audio; stream.codec = "opus"; }
+                    if (length >= 4 && Tag(body, "AC-3")) { stream.type = StreamType::Audio; stream.codec = "ac3"; }
+                    break;
+                default: break;
+            }
+        }
+        desc = body + length;
+    }
+}
+
+void ParsePmt(const uint8_t* section, const uint8_t* end, ContainerInfo& out, std::unordered_map<uint16_t, PidState>& pids) {
+    if (Remaining(section, end) < 12 || section[0] != 0x02) {
+        return;
+    }
+    const size_t sectionLength = ReadBE16(section + 1) & 0x0FFF;
+    const uint8_t* sectionEnd = section + 3 + std::min(sectionLength, Remaining(section + 3, end));
+    const uint8_t* crc = sectionEnd - 4;
+    const size_t programInfoLength = ReadBE16(section + 10) & 0x0FFF;
+
+    for (const uint8_t* p = section + 12 + programInfoLength; Remaining(p, crc) >= 5;) {
+        const uint8_t streamType = p[0];
+        const uint16_t pid = ReadBE16(p + 1) & 0x1FFF;
+        const size_t infoLength = ReadBE16(p + 3) & 0x0FFF;
+        const uint8_t* desc = p + 5;
+        const uint8_t* descEnd = desc + std::min(infoLength, Remaining(desc, crc));
+
+        if (pids.find(pid) == pids.end()) {
+            StreamInfo stream;
+            stream.trackId = pid;
+            stream.index = static_cast<int>(out.streams.size());
+            SetTimebase(stream, 1, 90000);
+            AssignStreamType(streamType, desc, descEnd, stream);
+
+            PidState state;
+            state.streamIndex = out.streams.size();
+            pids.emplace(pid, state);
+            out.streams.push_back(std::move(stream));
+        }
+        p = descEnd;
+    }
+}
+
+// Walks packets in [begin, end) and invokes fn(pid, pusi, payload, payloadEnd)
+template<typename Fn>
+void ForEachPacket(const uint8_t* begin, const uint8_t* end, size_t packetSize, size_t syncOffset, Fn&& fn) {
+    for (const uint8_t* packet = begin; Remaining(packet, end) >= packetSize; packet += packetSize) {
+        const uint8_t* ts = packet + syncOffset;
+        if (ts[0] != kSync) {
+            continue;
+        }
+        const uint16_t pid = ReadBE16(ts + 1) & 0x1FFF;
+        const bool pusi = (ts[1] & 0x40) != 0;
+        const uint8_t adaptation = (ts[3] >> 4) & 0x03;
+        if (!(adaptation & 0x01)) {
+            continue;
+        }
+        const uint8_t* payload = ts + 4;
+        if (adaptation & 0x02) {
+            payload += 1 + ts[4];
+        }
+        const uint8_t* payloadEnd = ts + 188;
+        if (payload >= payloadEnd) {
+            continue;
+        }
+        if (!fn(pid, pusi, payload, payloadEnd)) {
+            return;
+        }
+    }
+}
+
+bool Parse(const uint8_t* data, size_t size, ContainerInfo& out) {
+    size_t packetSize = 0;
+    size_t syncOffset = 0;
+    if (!DetectPacketLayout(data, size, packetSize, syncOffset)) {
+        return false;
+    }
+
+    out.formatName = (packetSize == 192) ? "m2ts" : "mpegts";
+    const uint8_t* end = data + size;
+    const uint8_t* headEnd = data + std::min(size, kHeadWindow);
+
+    int pmtPid = -1;
+    bool pmtParsed = false;
+    uint64_t totalPackets = 0;
+    std::unordered_map<uint16_t, PidState> pids;
+
+    ForEachPacket(data, headEnd, packetSize, syncOffset,
+        [&](uint16_t pid, bool pusi, const uint8_t* payload, const uint8_t* payloadEnd) {
+            ++totalPackets;
+            if (pid == 0 && pusi && pmtPid < 0) {
+                const uint8_t* section = payload + 1 + payload[0];
+                if (Remaining(section, payloadEnd) >= 12 && section[0] == 0x00) {
+                    const size_t sectionLength = ReadBE16(section + 1) & 0x0FFF;
+                    const uint8_t* entriesEnd = section + 3 + std::min(sectionLength, Remaining(section + 3, payloadEnd)) - 4;
+                    for (const uint8_t* e = section + 8; Remaining(e, entriesEnd) >= 4; e += 4) {
+                        if (ReadBE16(e) != 0) {
+                            pmtPid = ReadBE16(e + 2) & 0x1FFF;
+                            break;
+                        }
+                    }
+                }
+            } else if (pid == pmtPid && pusi && !pmtParsed) {
+                ParsePmt(payload + 1 + payload[0], payloadEnd, out, pids);
+                pmtParsed = true;
+            } else {
+                const auto it = pids.find(pid);
+                if (it != pids.end()) {
+                    PidState& state = it->second;
+                    ++state.packets;
+                    uint64_t pts = 0;
+                    if (pusi && !state.hasFirstPts && ReadPts(payload, payloadEnd, pts)) {
+                        state.firstPts = pts;
+                        state.lastPts = pts;
+                        state.hasFirstPts = true;
+                        StreamInfo& stream = out.streams[state.streamIndex];
+                        if (stream.codec == "aac") {
+                            ReadAdts(payload, payloadEnd, stream);
+                        }
+                    }
+                }
+            }
+            return true;
+        });
+
+    if (!pmtParsed) {
+        return false;
+    }
+
+    // Last PTS per PID from the tail of the file, aligned to the packet grid
+    const size_t tailStart = (size > kTailWindow) ? ((size - kTailWindow) / packetSize) * packetSize : 0;
+    const uint8_t* tail = data + tailStart;
+    while (Remaining(tail, end) >= packetSize * 3 &&
+           !(tail[syncOffset] == kSync && tail[syncOffset + packetSize] == kSync && tail[syncOffset + packetSize * 2] == kSync)) {
+        ++tail;
+    }
+
+    ForEachPacket(tail, end, packetSize, syncOffset,
+        [&](uint16_t pid, bool pusi, const uint8_t* payload, const uint8_t* payloadEnd) {
+            const auto it = pids.find(pid);
+            uint64_t pts = 0;
+            if (pusi && it != pids.end() && it->second.hasFirstPts && ReadPts(payload, payloadEnd, pts)) {
+                it->second.lastPts = pts;
+            }
+            return true;
+        });
+
+    for (auto& [pid, state] : pids) {
+        StreamInfo& stream = out.streams[state.streamIndex];
+        if (state.hasFirstPts) {
+            const uint64_t delta = (state.lastPts + kPtsWrap - state.firstPts) % kPtsWrap;
+            stream.duration = static_cast<double>(delta) / 90000.0;
+            out.duration = std::max(out.duration, stream.duration);
+        }
+    }
+
+    // Per-stream bitrate is estimated from the packet share observed in the head window
+    if (out.duration > 0.0 && totalPackets > 0) {
+        const double totalBitrate = static_cast<double>(size) * 8.0 / out.duration;
+        for (auto& [pid, state] : pids) {
+            ToInteger(totalBitrate * static_cast<double>(state.packets) / static_cast<double>(totalPackets),
+                      out.streams[state.streamIndex].bitrate);
+        }
+    }
+    return true;
+}
+
+} // namespace mpegts
+
+} // namespace
+
+bool ContainerParser::Parse(ContainerFormat format, const uint8_t* data, size_t size, ContainerInfo& info) {
+    info = ContainerInfo();
+    info.format = format;
+    if (!data || size < 12) {
+        return false;
+    }
+
+    bool parsed = false;
+    switch (format) {
+        case ContainerFormat::Matroska: parsed = ebml::Parse(data, size, info); break;
+        case ContainerFormat::IsoBmff:  parsed = isobmff::Parse(data, size, info); break;
+        case ContainerFormat::Wave:     parsed = riff::ParseWave(data, size, info); break;
+        case ContainerFormat::Avi:      parsed = riff::ParseAvi(data, size, info); break;
+        case ContainerFormat::Flac:     parsed = flac::Parse(data, size, info); break;
+        case ContainerFormat::MpegTs:   parsed = mpegts::Parse(data, size, info); break;
+        default: break;
+    }
+    if (!parsed) {
+        return false;
+    }
+
+    for (const auto& stream : info.streams) {
+        info.duration = std::max(info.duration, stream.duration);
+    }
+    if (info.duration > 0.0) {
+        ToInteger(static_cast<double>(size) * 8.0 / info.duration, info.bitrate);
+    }
+    if (info.streams.size() == 1 && info.streams.front().bitrate == 0) {
+        info.streams.front().bitrate = info.bitrate;
+    }
+    return true;
+}
+
+bool ContainerParser::BuildSeekIndex(const ContainerInfo& info, const uint8_t* data, size_t size,
+                                     std::vector<SeekPoint>& points, SeekIndexOrigin& origin,
+                                     const std::function<bool()>& cancelled) {
+    points.clear();
+    origin = SeekIndexOrigin::None;
+    if (!data || size < 12) {
+        return false;
+    }
+
+    // Seek on the first video stream; audio-only files index their first audio stream
+    const StreamInfo* primary = nullptr;
+    for (const auto& stream : info.streams) {
+        if (stream.type == StreamType::Video) {
+            primary = &stream;
+            break;
+        }
+        if (stream.type == StreamType::Audio && !primary) {
+            primary = &stream;
+        }
+    }
+    if (!primary) {
+        return false;
+    }
+
+    bool built = false;
+    switch (info.format) {
+        case ContainerFormat::Matroska: built = ebml::BuildIndex(*primary, data, size, points, origin, cancelled); break;
+        case ContainerFormat::IsoBmff:  built = isobmff::BuildIndex(*primary, data, size, points, origin, cancelled); break;
+        default: break;
+    }
+    if (!built) {
+        points.clear();
+        origin = SeekIndexOrigin::None;
+    }
+    return built;
+}
+
+const char* ContainerParser::FormatName(ContainerFormat format) {
+    switch (format) {
+        case ContainerFormat::Matroska: return "matroska";
+        case ContainerFormat::IsoBmff:  return "mp4";
+        case ContainerFormat::Wave:     return "wav";
+        case ContainerFormat::Avi:      return "avi";
+        case ContainerFormat::Flac:     return "flac";
+        case ContainerFormat::MpegTs:   return "mpegts";
+        default:                        return "unknown";
+    }
+}
+
+const char* ContainerParser::StreamTypeName(StreamType type) {
+    switch (type) {
+        case StreamType::Video:    return "video";
+        case StreamType::Audio:    return "audio";
+        case StreamType::Subtitle: return "subtitle";
+        default:                   return "data";
+    }
+}
+
+} // namespace knoux::core::engine
@@ -0,0 +1,161 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+namespace knoux::core::engine {
+
+/**
+ * @enum ContainerFormat
+ * @brief Container layouts understood by ContainerParser
+ */
+enum class ContainerFormat {
+    Unknown,
+    Matroska,
+    IsoBmff,
+    Wave,
+    Avi,
+    Flac,
+    MpegTs
+};
+
+/**
+ * @enum StreamType
+ * @brief Elementary stream category
+ */
+enum class StreamType {
+    Video,
+    Audio,
+    Subtitle,
+    Data
+};
+
+/**
+ * @struct StreamInfo
+ * @brief Layout of a single elementary stream as declared by the container
+ */
+struct StreamInfo {
+    int index = 0;
+    uint32_t trackId = 0;
+    StreamType type = StreamType::Data;
+    std::string codec;
+    std::string language;
+
+    // Presentation timebase as a rational (seconds = ticks * num / den)
+    uint32_t timebaseNum = 1;
+    uint32_t timebaseDen = 1;
+
+    // Duration in seconds, 0 if unknown
+    double duration = 0.0;
+
+    // Average bitrate in bits per second, 0 if unknown
+    int64_t bitrate = 0;
+
+    // Video only
+    int width = 0;
+    int height = 0;
+    double frameRate = 0.0;
+
+    // Audio only
+    int sampleRate = 0;
+    int channels = 0;
+    int bitsPerSample = 0;
+
+    // Audio only: priming samples the decoder emits before the first real
+    // sample and padding samples after the last one (gapless playback)
+    int64_t encoderDelay = 0;
+    int64_t encoderPadding = 0;
+};
+
+/**
+ * @struct ContainerInfo
+ * @brief Result of parsing a container header
+ */
+struct ContainerInfo {
+    ContainerFormat format = ContainerFormat::Unknown;
+    std::string formatName;
+    std::string title;
+    std::string artist;
+    double duration = 0.0;
+    int64_t bitrate = 0;
+    std::vector<StreamInfo> streams;
+};
+
+/**
+ * @struct SeekPoint
+ * @brief Keyframe position: presentation time and the byte offset to resume demuxing at
+ */
+struct SeekPoint {
+    int64_t timeUs = 0;
+    uint64_t offset = 0;
+};
+
+/**
+ * @enum SeekIndexOrigin
+ * @brief Where a seek index came from
+ */
+enum class SeekIndexOrigin {
+    None,       // No index; seeks are byte-proportional estimates
+    Container,  // Read from an index stored in the file (Cues, stss)
+    Scan,       // Built by scanning the payload (no Cues, fragmented MP4)
+    Cache       // Loaded from the sidecar cache of a previous scan
+};
+
+/**
+ * @class ContainerParser
+ * @brief Zero-copy container header parser.
+ *
+ * Works directly on a memory-mapped view of the file and only dereferences
+ * the structures it needs (EBML header elements, ISO-BMFF box headers, RIFF
+ * chunk headers, FLAC metadata blocks, the head and tail of an MPEG-TS
+ * stream). Payload such as Matroska clusters or the MP4 mdat box is skipped
+ * by size, so the pages holding it are never faulted in.
+ *
+ * Container detection is done up front by FormatProbeRegistry. The parser
+ * is stateless and safe to call concurrently.
+ */
+class ContainerParser {
+public:
+    /**
+     * @brief Parses the stream layout using an already detected container
+     * @param format Container to parse as
+     * @param data Start of the file
+     * @param size File size in bytes
+     * @param info Receives the parsed layout
+     * @return true if parsing succeeded
+     */
+    static bool Parse(ContainerFormat format, const uint8_t* data, size_t size, ContainerInfo& info);
+
+    /**
+     * @brief Collects keyframe positions of the primary stream (first video, else first audio)
+     * @param info Layout returned by Parse() for the same data
+     * @param data Start of the file
+     * @param size File size in bytes
+     * @param points Receives keyframes in file order
+     * @param origin Receives Container if the file carried an index, Scan if the payload was walked
+     * @param cancelled Optional predicate polled during payload scans; returning true aborts
+     * @return true if at least one keyframe was found
+     *
+     * Supports Matroska (Cues, else cluster scan) and ISO-BMFF (sample
+     * tables, else movie fragments). Unlike Parse() a scan touches the
+     * whole payload, so results are meant to be cached.
+     */
+    static bool BuildSeekIndex(const ContainerInfo& info, const uint8_t* data, size_t size,
+                               std::vector<SeekPoint>& points, SeekIndexOrigin& origin,
+                               const std::function<bool()>& cancelled = nullptr);
+
+    /**
+     * @brief Returns the short name of a container format
+     */
+    static const char* FormatName(ContainerFormat format);
+
+    /**
+     * @brief Returns the short name of a stream type
+     */
+    static const char* StreamTypeName(StreamType type);
+};
+
+} // namespace knoux::core::engine
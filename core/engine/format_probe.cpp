@@ -0,0 +1,311 @@
+﻿#include "format_probe.h"
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <mutex>
+#include "core/system/io_backend.h"
+
+namespace knoux::core::engine {
+
+// Static instance pointer
+static std::shared_ptr<FormatProbeRegistry> g_probeRegistry = nullptr;
+static std::once_flag g_probeRegistryOnce;
+
+namespace {
+
+constexpr uint8_t FF = 0xFF;
+
+// Built-in signature table. Structural formats (MP4, MPEG-TS, bare MPEG
+// audio) are detected by the deep probes below instead.
+constexpr MagicSignature kBuiltinSignatures[] = {
+    { "matroska", ContainerFormat::Matroska, 0, 4,  { 0x1A, 0x45, 0xDF, 0xA3 }, { FF, FF, FF, FF }, 90 },
+    { "wav",      ContainerFormat::Wave,     0, 12, { 'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E' },
+                                                    { FF, FF, FF, FF, 0, 0, 0, 0, FF, FF, FF, FF }, 100 },
+    { "rf64",     ContainerFormat::Wave,     0, 12, { 'R', 'F', '6', '4', 0, 0, 0, 0, 'W', 'A', 'V', 'E' },
+                                                    { FF, FF, FF, FF, 0, 0, 0, 0, FF, FF, FF, FF }, 100 },
+    { "avi",      ContainerFormat::Avi,      0, 12, { 'R', 'I', 'F', 'F', 0, 0, 0, 0, 'A', 'V', 'I', ' ' },
+                                                    { FF, FF, FF, FF, 0, 0, 0, 0, FF, FF, FF, FF }, 100 },
+    { "flac",     ContainerFormat::Flac,     0, 4,  { 'f', 'L', 'a', 'C' }, { FF, FF, FF, FF }, 100 },
+    { "ogg",      ContainerFormat::Unknown,  0, 4,  { 'O', 'g', 'g', 'S' }, { FF, FF, FF, FF }, 100 },
+    { "midi",     ContainerFormat::Unknown,  0, 4,  { 'M', 'T', 'h', 'd' }, { FF, FF, FF, FF }, 100 },
+    { "asf",      ContainerFormat::Unknown,  0, 8,  { 0x30, 0x26, 0xB2, 0x75, 0x8E, 0x66, 0xCF, 0x11 },
+                                                    { FF, FF, FF, FF, FF, FF, FF, FF }, 100 },
+    { "flv",      ContainerFormat::Unknown,  0, 4,  { 'F', 'L', 'V', 0x01 }, { FF, FF, FF, FF }, 90 },
+    { "mpeg-ps",  ContainerFormat::Unknown,  0, 4,  { 0x00, 0x00, 0x01, 0xBA }, { FF, FF, FF, FF }, 90 },
+    { "mpeg-es",  ContainerFormat::Unknown,  0, 4,  { 0x00, 0x00, 0x01, 0xB3 }, { FF, FF, FF, FF }, 80 },
+    { "aac",      ContainerFormat::Unknown,  0, 2,  { 0xFF, 0xF0 }, { FF, 0xF6 }, 40 },
+};
+
+inline uint32_t ReadBE32(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+}
+
+bool MatchSignature(const MagicSignature& sig, const uint8_t* data, size_t size) {
+    if (sig.offset + sig.length > size) {
+        return false;
+    }
+    const uint8_t* p = data + sig.offset;
+    for (size_t i = 0; i < sig.length; ++i) {
+        if ((p[i] & sig.mask[i]) != (sig.bytes[i] & sig.mask[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ProbeResult Match(const char* format, ContainerFormat container, int confidence) {
+    ProbeResult result;
+    result.format = format;
+    result.container = container;
+    result.confidence = confidence;
+    result.readable = true;
+    return result;
+}
+
+// ISO-BMFF: an ftyp box at offset 4 is conclusive, other top-level boxes are a strong hint
+ProbeResult ProbeIsoBmff(const uint8_t* data, size_t size) {
+    if (size < 12 || ReadBE32(data) < 8) {
+        return {};
+    }
+
+    const uint8_t* type = data + 4;
+    if (std::memcmp(type, "ftyp", 4) == 0) {
+        const uint8_t* brand = data + 8;
+        if (std::memcmp(brand, "qt  ", 4) == 0) return Match("mov", ContainerFormat::IsoBmff, 100);
+        if (std::memcmp(brand, "M4A ", 4) == 0 || std::memcmp(brand, "M4B ", 4) == 0) return Match("m4a", ContainerFormat::IsoBmff, 100);
+        if (std::memcmp(brand, "3gp", 3) == 0 || std::memcmp(brand, "3g2", 3) == 0) return Match("3gp", ContainerFormat::IsoBmff, 100);
+        return Match("mp4", ContainerFormat::IsoBmff, 100);
+    }
+
+    static constexpr const char* kTopLevel[] = { "moov", "mdat", "free", "wide", "skip", "pnot" };
+    for (const char* box : kTopLevel) {
+        if (std::memcmp(type, box, 4) == 0) {
+            return Match("mov", ContainerFormat::IsoBmff, 60);
+        }
+    }
+    return {};
+}
+
+// MPEG-TS / M2TS: sync byte cadence across every packet in the buffer
+ProbeResult ProbeMpegTs(const uint8_t* data, size_t size) {
+    struct Layout { size_t packetSize; size_t syncOffset; const char* name; };
+    static constexpr Layout kLayouts[] = { { 188, 0, "mpegts" }, { 192, 4, "m2ts" }, { 204, 0, "mpegts" } };
+
+    for (const Layout& layout : kLayouts) {
+        const size_t packets = (size > layout.syncOffset) ? (size - layout.syncOffset) / layout.packetSize : 0;
+        if (packets < 3) {
+            continue;
+        }
+        bool synced = true;
+        for (size_t i = 0; i < packets && synced; ++i) {
+            synced = data[layout.syncOffset + i * layout.packetSize] == 0x47;
+        }
+        if (synced) {
+            return Match(layout.name, ContainerFormat::MpegTs, packets >= 5 ? 100 : 85);
+        }
+    }
+    return {};
+}
+
+// Returns the length of the MPEG audio frame starting at p, or 0 if the header is invalid
+size_t MpegAudioFrameLength(const uint8_t* p, size_t size, int& layer) {
+    if (size < 4 || p[0] != 0xFF || (p[1] & 0xE0) != 0xE0) {
+        return 0;
+    }
+
+    static constexpr int kBitratesV1L3[] = { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 };
+    static constexpr int kBitratesV1L2[] = { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384 };
+    static constexpr int kBitratesV2[] = { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 };
+    static constexpr int kRates[] = { 44100, 48000, 32000 };
+
+    const int version = (p[1] >> 3) & 0x03;   // 3 = MPEG-1, 2 = MPEG-2, 0 = MPEG-2.5
+    const int layerBits = (p[1] >> 1) & 0x03; // 1 = Layer III, 2 = Layer II
+    const int bitrateIndex = (p[2] >> 4) & 0x0F;
+    const int rateIndex = (p[2] >> 2) & 0x03;
+    const int padding = (p[2] >> 1) & 0x01;
+
+    if (version == 1 || (layerBits != 1 && layerBits != 2) || bitrateIndex == 0 || bitrateIndex == 15 || rateIndex == 3) {
+        return 0;
+    }
+
+    layer = (layerBits == 1) ? 3 : 2;
+    const bool mpeg1 = (version == 3);
+    const int kbps = mpeg1 ? (layer == 3 ? kBitratesV1L3 : kBitratesV1L2)[bitrateIndex] : kBitratesV2[bitrateIndex];
+    const int sampleRate = kRates[rateIndex] >> (mpeg1 ? 0 : (version == 2 ? 1 : 2));
+    const int samplesPerFrame = (layer == 3 && !mpeg1) ? 576 : 1152;
+
+    return static_cast<size_t>(samplesPerFrame / 8 * kbps * 1000 / sampleRate + padding);
+}
+
+ProbeResult ProbeMpegAudioAt(const uint8_t* data, size_t size, int matchConfidence) {
+    int layer = 0;
+    const size_t frameLength = MpegAudioFrameLength(data, size, layer);
+    if (frameLength == 0) {
+        return {};
+    }
+
+    // A second valid header right after the first rules out random 0xFFE bit patterns
+    int nextLayer = 0;
+    const bool chained = frameLength + 4 <= size &&
+                         MpegAudioFrameLength(data + frameLength, size - frameLength, nextLayer) > 0 &&
+                         nextLayer == layer;
+    const bool unverifiable = frameLength + 4 > size;
+    if (!chained && !unverifiable) {
+        return {};
+    }
+
+    return Match(layer == 3 ? "mp3" : "mp2", ContainerFormat::Unknown, chained ? matchConfidence : matchConfidence / 2);
+}
+
+ProbeResult ProbeMpegAudio(const uint8_t* data, size_t size) {
+    return ProbeMpegAudioAt(data, size, 90);
+}
+
+// ID3v2-wrapped payloads: FLAC and MP3 are both commonly tagged this way
+ProbeResult ProbeId3(const uint8_t* data, size_t size) {
+    if (size < 10 || std::memcmp(data, "ID3", 3) != 0) {
+        return {};
+    }
+
+    const size_t tagSize = (size_t(data[6] & 0x7F) << 21) | (size_t(data[7] & 0x7F) << 14) |
+                           (size_t(data[8] & 0x7F) << 7) | size_t(data[9] & 0x7F);
+    const size_t payload = 10 + tagSize + ((data[5] & 0x10) ? 10 : 0);
+
+    if (payload + 4 <= size) {
+        if (std::memcmp(data + payload, "fLaC", 4) == 0) {
+            return Match("flac", ContainerFormat::Flac, 100);
+        }
+        ProbeResult audio = ProbeMpegAudioAt(data + payload, size - payload, 95);
+        if (audio.confidence > 0) {
+            return audio;
+        }
+    }
+
+    // Tag extends past the probed window: ID3v2 is overwhelmingly MP3
+    return Match("mp3", ContainerFormat::Unknown, 60);
+}
+
+// EBML DocType distinguishes WebM from generic Matroska
+ProbeResult ProbeEbml(const uint8_t* data, size_t size) {
+    if (size < 8 || ReadBE32(data) != 0x1A45DFA3) {
+        return {};
+    }
+    const size_t window = std::min<size_t>(size, 64);
+    for (size_t i = 4; i + 7 <= window; ++i) {
+        if (data[i] == 0x42 && data[i + 1] == 0x82) {
+            const bool webm = std::memcmp(data + i + 3, "webm", 4) == 0;
+            return Match(webm ? "webm" : "matroska", ContainerFormat::Matroska, 100);
+        }
+    }
+    return {};
+}
+
+} // namespace
+
+std::shared_ptr<FormatProbeRegistry> FormatProbeRegistry::GetInstance() {
+    std::call_once(g_probeRegistryOnce, [] {
+        g_probeRegistry = std::shared_ptr<FormatProbeRegistry>(new FormatProbeRegistry());
+    });
+    return g_probeRegistry;
+}
+
+FormatProbeRegistry::FormatProbeRegistry() {
+    m_signatures.assign(std::begin(kBuiltinSignatures), std::end(kBuiltinSignatures));
+    m_probes.push_back({ "isobmff", ProbeIsoBmff });
+    m_probes.push_back({ "mpegts", ProbeMpegTs });
+    m_probes.push_back({ "ebml", ProbeEbml });
+    m_probes.push_back({ "id3", ProbeId3 });
+    m_probes.push_back({ "mpeg-audio", ProbeMpegAudio });
+}
+
+void FormatProbeRegistry::RegisterSignature(const MagicSignature& signature) {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_signatures.push_back(signature);
+}
+
+void FormatProbeRegistry::RegisterProbe(const std::string& name, ProbeFunction probe) {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_probes.push_back({ name, std::move(probe) });
+}
+
+ProbeResult FormatProbeRegistry::Probe(const uint8_t* data, size_t size) const {
+    ProbeResult best;
+    best.readable = true;
+    if (!data || size == 0) {
+        return best;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+    for (const auto& signature : m_signatures) {
+        if (signature.confidence > best.confidence && MatchSignature(signature, data, size)) {
+            best = Match(signature.format, signature.container, signature.confidence);
+        }
+    }
+
+    for (const auto& entry : m_probes) {
+        if (best.confidence >= 100) {
+            break;
+        }
+        ProbeResult candidate = entry.probe(data, size);
+        if (candidate.confidence > best.confidence) {
+            best = std::move(candidate);
+            best.readable = true;
+        }
+    }
+
+    return best;
+}
+
+ProbeResult FormatProbeRegistry::ProbeFile(const std::string& path) const {
+    uint8_t buffer[kProbeSize];
+    const long bytesRead = ReadHeader(path, buffer, sizeof(buffer));
+    if (bytesRead < 0) {
+        return ProbeResult();
+    }
+    return Probe(buffer, static_cast<size_t>(bytesRead));
+}
+
+std::vector<ProbeResult> FormatProbeRegistry::ProbeBatch(const std::vector<std::string>& paths, size_t threadCount) const {
+    std::vector<ProbeResult> results(paths.size());
+    if (paths.empty()) {
+        return results;
+    }
+
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threadCount = std::min(threadCount, paths.size());
+
+    // Files are handed out one at a time so a slow mount does not stall a whole stripe
+    std::atomic<size_t> next{ 0 };
+    auto worker = [&]() {
+        for (size_t i = next.fetch_add(1, std::memory_order_relaxed); i < paths.size();
+             i = next.fetch_add(1, std::memory_order_relaxed)) {
+            results[i] = ProbeFile(paths[i]);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount - 1);
+    for (size_t t = 1; t < threadCount; ++t) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    return results;
+}
+
+long FormatProbeRegistry::ReadHeader(const std::string& path, uint8_t* buffer, size_t size) {
+    system::RandomAccessFile file;
+    if (!file.Open(path)) {
+        return -1;
+    }
+    return static_cast<long>(file.ReadAt(0, buffer, size));
+}
+
+} // namespace knoux::core::engine
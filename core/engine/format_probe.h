@@ -0,0 +1,134 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <shared_mutex>
+#include <cstddef>
+#include <cstdint>
+#include "container_parser.h"
+
+namespace knoux::core::engine {
+
+/**
+ * @struct ProbeResult
+ * @brief Outcome of probing a file header
+ */
+struct ProbeResult {
+    std::string format = "unknown";                      // Short format name (e.g. "mp4", "matroska")
+    ContainerFormat container = ContainerFormat::Unknown; // Parser to hand the file to, if any
+    int confidence = 0;                                   // 0 (no match) .. 100 (certain)
+    bool readable = false;                                // false if the file could not be read
+};
+
+/**
+ * @struct MagicSignature
+ * @brief Fixed byte pattern matched at an offset, with a per-byte mask
+ *
+ * A byte matches when (data[offset + i] & mask[i]) == (bytes[i] & mask[i]).
+ * A zero mask byte acts as a wildcard, which lets one entry express
+ * patterns such as "RIFF????WAVE".
+ */
+struct MagicSignature {
+    const char* format;
+    ContainerFormat container;
+    size_t offset;
+    size_t length;
+    uint8_t bytes[12];
+    uint8_t mask[12];
+    int confidence;
+};
+
+/**
+ * @class FormatProbeRegistry
+ * @brief Pluggable media format detection working on a single header read.
+ *
+ * Detection runs in two tiers over the same buffer:
+ * - a signature table of masked byte patterns at fixed offsets
+ * - deeper probes that inspect structure (ISO-BMFF ftyp brands, MPEG-TS
+ *   packet cadence, MPEG audio frame headers, ID3-wrapped payloads) and
+ *   return a confidence score
+ *
+ * The highest confidence wins. Each file is opened once and read once
+ * (kProbeSize bytes); callers that already hold a mapping can probe the
+ * mapped bytes directly without any I/O.
+ *
+ * Registration is expected at startup; probing is safe from any thread.
+ */
+class FormatProbeRegistry {
+public:
+    /**
+     * @brief Deep probe callback, returns a result with confidence 0 when it does not match
+     */
+    using ProbeFunction = std::function<ProbeResult(const uint8_t* data, size_t size)>;
+
+    /**
+     * @brief Number of leading bytes read from each file
+     */
+    static constexpr size_t kProbeSize = 4096;
+
+    /**
+     * @brief Returns the process-wide registry with the built-in probes
+     */
+    static std::shared_ptr<FormatProbeRegistry> GetInstance();
+
+    /**
+     * @brief Adds a signature to the table
+     * @param signature Pattern to match
+     */
+    void RegisterSignature(const MagicSignature& signature);
+
+    /**
+     * @brief Adds a deep probe
+     * @param name Identifier used in diagnostics
+     * @param probe Callback inspecting the header buffer
+     */
+    void RegisterProbe(const std::string& name, ProbeFunction probe);
+
+    /**
+     * @brief Probes an in-memory header (e.g. the start of a MappedFile)
+     * @param data Start of the file
+     * @param size Bytes available (only the first kProbeSize are inspected)
+     * @return Best match, or format "unknown" with confidence 0
+     */
+    ProbeResult Probe(const uint8_t* data, size_t size) const;
+
+    /**
+     * @brief Probes a file with one open and one read
+     * @param path Absolute path of the file
+     * @return Best match; readable is false if the file could not be read
+     */
+    ProbeResult ProbeFile(const std::string& path) const;
+
+    /**
+     * @brief Probes many files concurrently
+     * @param paths Files to probe
+     * @param threadCount Worker count, 0 selects hardware concurrency
+     * @return One result per path, in the same order
+     */
+    std::vector<ProbeResult> ProbeBatch(const std::vector<std::string>& paths, size_t threadCount = 0) const;
+
+private:
+    // Private constructor for singleton pattern
+    FormatProbeRegistry();
+
+    struct NamedProbe {
+        std::string name;
+        ProbeFunction probe;
+    };
+
+    // Registered signatures (built-ins first)
+    std::vector<MagicSignature> m_signatures;
+
+    // Registered deep probes
+    std::vector<NamedProbe> m_probes;
+
+    // Guards registration against concurrent probing
+    mutable std::shared_mutex m_mutex;
+
+    // Helper: Reads the file header into buffer, returns bytes read or -1
+    static long ReadHeader(const std::string& path, uint8_t* buffer, size_t size);
+};
+
+} // namespace knoux::core::engine
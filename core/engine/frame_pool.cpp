@@ -0,0 +1,251 @@
+﻿#include "frame_pool.h"
+#include <new>
+#include <algorithm>
+#include <utility>
+
+namespace knoux::core::engine {
+
+namespace {
+
+inline size_t AlignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+struct PlaneLayout {
+    int count = 0;
+    size_t strides[VideoFrame::kMaxPlanes] = {};
+    size_t heights[VideoFrame::kMaxPlanes] = {};
+};
+
+PlaneLayout ComputeLayout(const FrameFormat& format) {
+    PlaneLayout layout;
+    const size_t width = static_cast<size_t>(format.width);
+    const size_t height = static_cast<size_t>(format.height);
+    const size_t chromaWidth = (width + 1) / 2;
+    const size_t chromaHeight = (height + 1) / 2;
+
+    switch (format.pixelFormat) {
+        case PixelFormat::RGBA:
+        case PixelFormat::BGRA:
+            layout.count = 1;
+            layout.strides[0] = AlignUp(width * 4, FramePool::kAlignment);
+            layout.heights[0] = height;
+            break;
+        case PixelFormat::NV12:
+            layout.count = 2;
+            layout.strides[0] = AlignUp(width, FramePool::kAlignment);
+            layout.heights[0] = height;
+            layout.strides[1] = AlignUp(chromaWidth * 2, FramePool::kAlignment);
+            layout.heights[1] = chromaHeight;
+            break;
+        case PixelFormat::YUV420P:
+            layout.count = 3;
+            layout.strides[0] = AlignUp(width, FramePool::kAlignment);
+            layout.heights[0] = height;
+            layout.strides[1] = layout.strides[2] = AlignUp(chromaWidth, FramePool::kAlignment);
+            layout.heights[1] = layout.heights[2] = chromaHeight;
+            break;
+    }
+    return layout;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// VideoFrame
+// ---------------------------------------------------------------------------
+
+VideoFrame::VideoFrame(const FrameFormat& format, uint64_t generation)
+    : m_format(format)
+    , m_generation(generation)
+{
+    const PlaneLayout layout = ComputeLayout(format);
+    m_bufferSize = FramePool::BufferSize(format);
+    m_buffer = static_cast<uint8_t*>(::operator new[](m_bufferSize, std::align_val_t(FramePool::kAlignment)));
+
+    // Every plane starts on an aligned boundary because strides are aligned
+    uint8_t* plane = m_buffer;
+    m_planeCount = layout.count;
+    for (int i = 0; i < layout.count; ++i) {
+        m_planes[i] = plane;
+        m_strides[i] = static_cast<int>(layout.strides[i]);
+        plane += layout.strides[i] * layout.heights[i];
+    }
+}
+
+VideoFrame::~VideoFrame() {
+    ::operator delete[](m_buffer, std::align_val_t(FramePool::kAlignment));
+}
+
+// ---------------------------------------------------------------------------
+// VideoFrameHandle
+// ---------------------------------------------------------------------------
+
+VideoFrameHandle::VideoFrameHandle(VideoFrame* frame)
+    : m_frame(frame)
+{
+    if (m_frame) {
+        m_frame->m_refCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+VideoFrameHandle::~VideoFrameHandle() {
+    Reset();
+}
+
+VideoFrameHandle::VideoFrameHandle(const VideoFrameHandle& other)
+    : VideoFrameHandle(other.m_frame)
+{
+}
+
+VideoFrameHandle& VideoFrameHandle::operator=(const VideoFrameHandle& other) {
+    if (m_frame != other.m_frame) {
+        VideoFrameHandle copy(other);
+        std::swap(m_frame, copy.m_frame);
+    }
+    return *this;
+}
+
+VideoFrameHandle::VideoFrameHandle(VideoFrameHandle&& other) noexcept
+    : m_frame(std::exchange(other.m_frame, nullptr))
+{
+}
+
+VideoFrameHandle& VideoFrameHandle::operator=(VideoFrameHandle&& other) noexcept {
+    if (this != &other) {
+        Reset();
+        m_frame = std::exchange(other.m_frame, nullptr);
+    }
+    return *this;
+}
+
+void VideoFrameHandle::Reset() {
+    VideoFrame* frame = std::exchange(m_frame, nullptr);
+    if (!frame || frame->m_refCount.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+
+    // Hold the pool alive until Recycle() returns; it may be the last reference
+    std::shared_ptr<FramePool> owner = std::move(frame->m_owner);
+    owner->Recycle(frame);
+}
+
+// ---------------------------------------------------------------------------
+// FramePool
+// ---------------------------------------------------------------------------
+
+std::shared_ptr<FramePool> FramePool::Create(size_t maxFrames) {
+    return std::shared_ptr<FramePool>(new FramePool(maxFrames));
+}
+
+FramePool::FramePool(size_t maxFrames)
+    : m_maxFrames(maxFrames > 0 ? maxFrames : 1)
+{
+    m_free.reserve(m_maxFrames);
+}
+
+FramePool::~FramePool() {
+    // Checked-out frames hold a reference to the pool, so only idle frames remain
+    for (VideoFrame* frame : m_free) {
+        delete frame;
+    }
+}
+
+size_t FramePool::BufferSize(const FrameFormat& format) {
+    const PlaneLayout layout = ComputeLayout(format);
+    size_t size = 0;
+    for (int i = 0; i < layout.count; ++i) {
+        size += layout.strides[i] * layout.heights[i];
+    }
+    return size;
+}
+
+bool FramePool::Configure(const FrameFormat& format, size_t frameCount) {
+    if (format.width <= 0 || format.height <= 0) {
+        return false;
+    }
+
+    std::vector<VideoFrame*> stale;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (format != m_format) {
+            stale.swap(m_free);
+            m_free.reserve(m_maxFrames);
+            m_format = format;
+            ++m_generation;
+            m_allocated = 0;
+        }
+
+        frameCount = std::min(frameCount, m_maxFrames);
+        while (m_allocated < frameCount) {
+            m_free.push_back(new VideoFrame(m_format, m_generation));
+            ++m_allocated;
+        }
+    }
+
+    for (VideoFrame* frame : stale) {
+        delete frame;
+    }
+    return true;
+}
+
+VideoFrameHandle FramePool::Acquire() {
+    VideoFrame* frame = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_format.width <= 0) {
+            return VideoFrameHandle();
+        }
+
+        if (!m_free.empty()) {
+            frame = m_free.back();
+            m_free.pop_back();
+            m_hits.fetch_add(1, std::memory_order_relaxed);
+        } else if (m_allocated < m_maxFrames) {
+            frame = new VideoFrame(m_format, m_generation);
+            ++m_allocated;
+            m_misses.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            m_exhausted.fetch_add(1, std::memory_order_relaxed);
+            return VideoFrameHandle();
+        }
+    }
+
+    frame->m_pts = 0;
+    frame->m_acquired = std::chrono::steady_clock::now();
+    frame->m_owner = shared_from_this();
+    m_outstanding.fetch_add(1, std::memory_order_relaxed);
+    return VideoFrameHandle(frame);
+}
+
+void FramePool::Recycle(VideoFrame* frame) {
+    m_outstanding.fetch_sub(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (frame->m_generation == m_generation) {
+            m_free.push_back(frame);
+            return;
+        }
+    }
+    delete frame;
+}
+
+FrameFormat FramePool::Format() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_format;
+}
+
+FramePool::Stats FramePool::GetStats() const {
+    Stats stats;
+    stats.hits = m_hits.load(std::memory_order_relaxed);
+    stats.misses = m_misses.load(std::memory_order_relaxed);
+    stats.exhausted = m_exhausted.load(std::memory_order_relaxed);
+    stats.outstanding = m_outstanding.load(std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        stats.allocated = m_allocated;
+    }
+    return stats;
+}
+
+} // namespace knoux::core::engine
@@ -0,0 +1,236 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace knoux::core::engine {
+
+/**
+ * @enum PixelFormat
+ * @brief Memory layouts supported by pooled video frames
+ */
+enum class PixelFormat {
+    RGBA,
+    BGRA,
+    NV12,
+    YUV420P
+};
+
+/**
+ * @struct FrameFormat
+ * @brief Geometry of the frames a pool hands out
+ */
+struct FrameFormat {
+    int width = 0;
+    int height = 0;
+    PixelFormat pixelFormat = PixelFormat::RGBA;
+
+    bool operator==(const FrameFormat& other) const {
+        return width == other.width && height == other.height && pixelFormat == other.pixelFormat;
+    }
+    bool operator!=(const FrameFormat& other) const { return !(*this == other); }
+};
+
+class FramePool;
+class VideoFrameHandle;
+
+/**
+ * @class VideoFrame
+ * @brief Pooled frame storage; only reachable through VideoFrameHandle
+ */
+class VideoFrame {
+public:
+    static constexpr int kMaxPlanes = 3;
+
+    VideoFrame(const VideoFrame&) = delete;
+    VideoFrame& operator=(const VideoFrame&) = delete;
+
+private:
+    friend class FramePool;
+    friend class VideoFrameHandle;
+
+    VideoFrame(const FrameFormat& format, uint64_t generation);
+    ~VideoFrame();
+
+    FrameFormat m_format;
+    uint64_t m_generation = 0;
+    uint8_t* m_buffer = nullptr;
+    size_t m_bufferSize = 0;
+    int m_planeCount = 0;
+    uint8_t* m_planes[kMaxPlanes] = {};
+    int m_strides[kMaxPlanes] = {};
+    int64_t m_pts = 0;
+    std::chrono::steady_clock::time_point m_acquired;
+
+    // Number of live handles; the frame goes back to the pool when it drops to zero
+    std::atomic<uint32_t> m_refCount{ 0 };
+
+    // Keeps the pool state alive while the frame is checked out
+    std::shared_ptr<FramePool> m_owner;
+};
+
+/**
+ * @class VideoFrameHandle
+ * @brief Ref-counted reference to a pooled video frame.
+ *
+ * Copying a handle only bumps an atomic counter; no pixel data is copied.
+ * Consumers may keep a handle past the frame callback for as long as they
+ * need the pixels. The buffer returns to its pool when the last handle is
+ * destroyed, even if the engine has reconfigured or dropped the pool.
+ */
+class VideoFrameHandle {
+public:
+    VideoFrameHandle() = default;
+    ~VideoFrameHandle();
+
+    VideoFrameHandle(const VideoFrameHandle& other);
+    VideoFrameHandle& operator=(const VideoFrameHandle& other);
+    VideoFrameHandle(VideoFrameHandle&& other) noexcept;
+    VideoFrameHandle& operator=(VideoFrameHandle&& other) noexcept;
+
+    /**
+     * @brief Checks if the handle references a frame
+     */
+    explicit operator bool() const { return m_frame != nullptr; }
+
+    int Width() const { return m_frame->m_format.width; }
+    int Height() const { return m_frame->m_format.height; }
+    PixelFormat Format() const { return m_frame->m_format.pixelFormat; }
+    int PlaneCount() const { return m_frame->m_planeCount; }
+
+    /**
+     * @brief Returns a plane base pointer (64-byte aligned)
+     */
+    const uint8_t* Plane(int index) const { return m_frame->m_planes[index]; }
+
+    /**
+     * @brief Returns a plane pointer for the producer filling the frame
+     */
+    uint8_t* MutablePlane(int index) const { return m_frame->m_planes[index]; }
+
+    /**
+     * @brief Returns the byte stride of a plane (multiple of 64)
+     */
+    int Stride(int index) const { return m_frame->m_strides[index]; }
+
+    /**
+     * @brief Presentation timestamp in microseconds
+     */
+    int64_t Pts() const { return m_frame->m_pts; }
+    void SetPts(int64_t pts) const { m_frame->m_pts = pts; }
+
+    /**
+     * @brief When the frame was checked out of the pool (start of its decode)
+     */
+    std::chrono::steady_clock::time_point AcquiredAt() const { return m_frame->m_acquired; }
+
+    /**
+     * @brief Returns the number of handles sharing the frame
+     */
+    uint32_t UseCount() const { return m_frame ? m_frame->m_refCount.load(std::memory_order_relaxed) : 0; }
+
+    /**
+     * @brief Drops this reference
+     */
+    void Reset();
+
+private:
+    friend class FramePool;
+
+    explicit VideoFrameHandle(VideoFrame* frame);
+
+    VideoFrame* m_frame = nullptr;
+};
+
+/**
+ * @class FramePool
+ * @brief Preallocated, 64-byte aligned video frame buffers.
+ *
+ * Buffers are sized for one FrameFormat and recycled through a free list,
+ * so steady-state playback performs no allocation. Reconfiguring to a new
+ * format bumps the pool generation; frames of the old generation still held
+ * by consumers are freed instead of recycled when they come back.
+ *
+ * Always owned through std::shared_ptr (see Create()).
+ */
+class FramePool : public std::enable_shared_from_this<FramePool> {
+public:
+    /**
+     * @struct Stats
+     * @brief Pool counters since creation
+     */
+    struct Stats {
+        uint64_t hits = 0;         // Acquires served from the free list
+        uint64_t misses = 0;       // Acquires that had to allocate
+        uint64_t exhausted = 0;    // Acquires refused because the pool was at its limit
+        uint64_t outstanding = 0;  // Frames currently checked out
+        uint64_t allocated = 0;    // Frames owned by the current generation
+    };
+
+    /**
+     * @brief Creates an empty pool
+     * @param maxFrames Upper bound on frames of one generation (in use + free)
+     */
+    static std::shared_ptr<FramePool> Create(size_t maxFrames = 16);
+
+    ~FramePool();
+
+    /**
+     * @brief Preallocates buffers for a format, releasing idle buffers of any previous format
+     * @param format Frame geometry
+     * @param frameCount Buffers to allocate up front
+     * @return false if the format is invalid
+     */
+    bool Configure(const FrameFormat& format, size_t frameCount);
+
+    /**
+     * @brief Checks out a frame of the configured format
+     * @return Handle to the frame, or an empty handle when the pool is exhausted
+     */
+    VideoFrameHandle Acquire();
+
+    /**
+     * @brief Returns the configured format
+     */
+    FrameFormat Format() const;
+
+    /**
+     * @brief Returns a snapshot of the pool counters
+     */
+    Stats GetStats() const;
+
+    /**
+     * @brief Computes the buffer size needed for a format, including plane padding
+     */
+    static size_t BufferSize(const FrameFormat& format);
+
+    // Buffer and stride alignment in bytes
+    static constexpr size_t kAlignment = 64;
+
+private:
+    friend class VideoFrameHandle;
+
+    explicit FramePool(size_t maxFrames);
+
+    // Helper: Called by the last handle of a frame
+    void Recycle(VideoFrame* frame);
+
+    mutable std::mutex m_mutex;
+    FrameFormat m_format;
+    uint64_t m_generation = 0;
+    size_t m_maxFrames;
+    size_t m_allocated = 0;
+    std::vector<VideoFrame*> m_free;
+
+    std::atomic<uint64_t> m_hits{ 0 };
+    std::atomic<uint64_t> m_misses{ 0 };
+    std::atomic<uint64_t> m_exhausted{ 0 };
+    std::atomic<uint64_t> m_outstanding{ 0 };
+};
+
+} // namespace knoux::core::engine
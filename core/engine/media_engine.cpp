@@ -1,4 +1,9 @@
 ﻿#include "media_engine.h"
+#include "container_parser.h"
+#include "format_probe.h"
+#include "core/system/binary_log.h"
+#include "core/system/mapped_file.h"
+#include "core/system/user_paths.h"
 #include <fstream>
 #include <sstream>
 #include <iomanip>
@@ -8,22 +13,132 @@
 #include <iostream>
 #include <algorithm>
 #include <codecvt>
+#include <cmath>
+#include <vector>
 
 namespace knoux::core::engine {
 
 // Singleton instance pointer
 static std::shared_ptr<MediaEngine> g_instance = nullptr;
 
+namespace {
+
+// Spans around Load/Parse/Seek, for timelines from binary logs
+KNOUX_LOG_MODULE(kEngineLog, "MediaEngine");
+
+// Flattens a parsed container layout into the metadata JSON exposed to the UI
+nlohmann::json BuildMetadata(const ContainerInfo& info) {
+    nlohmann::json meta;
+    meta["format"] = info.formatName;
+    meta["duration"] = info.duration;
+    meta["bitrate"] = info.bitrate;
+    if (!info.title.empty()) {
+        meta["title"] = info.title;
+    }
+    if (!info.artist.empty()) {
+        meta["artist"] = info.artist;
+    }
+
+    nlohmann::json streams = nlohmann::json::array();
+    bool hasVideo = false;
+    bool hasAudio = false;
+    for (const auto& stream : info.streams) {
+        nlohmann::json s;
+        s["index"] = stream.index;
+        s["type"] = ContainerParser::StreamTypeName(stream.type);
+        s["codec"] = stream.codec;
+        s["timebase"] = { stream.timebaseNum, stream.timebaseDen };
+        s["duration"] = stream.duration;
+        s["bitrate"] = stream.bitrate;
+        if (!stream.language.empty()) {
+            s["language"] = stream.language;
+        }
+
+        if (stream.type == StreamType::Video) {
+            s["width"] = stream.width;
+            s["height"] = stream.height;
+            s["frame_rate"] = stream.frameRate;
+            if (!hasVideo) {
+                meta["width"] = stream.width;
+                meta["height"] = stream.height;
+                meta["frame_rate"] = stream.frameRate;
+                meta["video_codec"] = stream.codec;
+                hasVideo = true;
+            }
+        } else if (stream.type == StreamType::Audio) {
+            s["sample_rate"] = stream.sampleRate;
+            s["channels"] = stream.channels;
+            s["bits_per_sample"] = stream.bitsPerSample;
+            s["encoder_delay"] = stream.encoderDelay;
+            s["encoder_padding"] = stream.encoderPadding;
+            if (!hasAudio) {
+                meta["sample_rate"] = stream.sampleRate;
+                meta["channels"] = stream.channels;
+                meta["audio_codec"] = stream.codec;
+                meta["encoder_delay"] = stream.encoderDelay;
+                meta["encoder_padding"] = stream.encoderPadding;
+                hasAudio = true;
+            }
+        }
+        streams.push_back(std::move(s));
+    }
+    meta["streams"] = std::move(streams);
+    return meta;
+}
+
+} // namespace
+
 std::shared_ptr<MediaEngine> MediaEngine::GetInstance() {
     if (!g_instance) {
-        g_instance = std::make_shared<MediaEngine>();
+        g_instance = std::shared_ptr<MediaEngine>(new MediaEngine());
     }
     return g_instance;
 }
 
 MediaEngine::MediaEngine()
-    : m_workerThread(std::make_unique<std::thread>(&MediaEngine::WorkerLoop, this))
+    : m_metricsRegistry(system::MetricsRegistry::GetInstance())
+    , m_framePool(FramePool::Create(kMaxPooledFrames))
+    , m_audioRing(std::make_unique<AudioRingBuffer>(kDefaultAudioRingFrames, kDefaultAudioChannels))
+    , m_scheduler(std::make_shared<TaskScheduler>())
+    , m_loadCommands(std::make_unique<CommandChannel>([this](std::function<void()> task) {
+          return SubmitTask(TaskPriority::Load, std::move(task));
+      }))
+    , m_seekCommands(std::make_unique<CommandChannel>([this](std::function<void()> task) {
+          return SubmitTask(TaskPriority::Interactive, std::move(task));
+      }))
+    , m_waveformCommands(std::make_unique<CommandChannel>([this](std::function<void()> task) {
+          return SubmitTask(TaskPriority::Background, std::move(task));
+      }))
+    , m_nextCommands(std::make_unique<CommandChannel>([this](std::function<void()> task) {
+          return SubmitTask(TaskPriority::Background, std::move(task));
+      }))
 {
+    system::MetricsRegistry& registry = *m_metricsRegistry;
+    m_metrics.load = &registry.Histogram("engine.load");
+    m_metrics.parse = &registry.Histogram("engine.parse");
+    m_metrics.seekIndex = &registry.Histogram("engine.seek_index");
+    m_metrics.seek = &registry.Histogram("engine.seek");
+    m_metrics.decode = &registry.Histogram("video.decode");
+    m_metrics.videoCallback = &registry.Histogram("callback.video");
+    m_metrics.audioCallback = &registry.Histogram("callback.audio");
+    m_metrics.loads = &registry.Counter("engine.loads");
+    m_metrics.loadFailures = &registry.Counter("engine.load_failures");
+    m_metrics.metadataHits = &registry.Counter("engine.metadata_cache_hits");
+    m_metrics.seeks = &registry.Counter("engine.seeks");
+    m_metrics.framesDelivered = &registry.Counter("video.frames_delivered");
+    m_metrics.framesRejected = &registry.Counter("video.frames_rejected");
+    m_metrics.audioFramesDelivered = &registry.Counter("audio.frames_delivered");
+
+    AllocateTrackAudio();
+
+    // Per user, next to the settings: the temp directory may be shared or cleaned under a running player
+    m_metadataStore.Open((system::UserDataDirectory() / "metadata.kmdb").string());
+}
+
+MediaEngine::~MediaEngine() {
+    StopScheduler();
+    StopPresentation();
+    StopAudioDelivery();
 }
 
 bool MediaEngine::Initialize() {
@@ -31,12 +146,24 @@ bool MediaEngine::Initialize() {
         return true;
     }
 
-    if (!ValidateFilePath(m_mediaPath)) {
+    {
+        std::lock_guard<std::mutex> lock(m_schedulerMutex);
+        if (!m_scheduler) {
+            m_scheduler = std::make_shared<TaskScheduler>();
+        }
+    }
+
+    std::string mediaPath;
+    {
+        std::lock_guard<std::mutex> lock(m_metadataMutex);
+        mediaPath = m_mediaPath;
+    }
+    if (!ValidateFilePath(mediaPath)) {
         return false;
     }
 
     // Ensure config directory exists
-    const auto& configDir = std::filesystem::path(m_mediaPath).parent_path();
+    const auto configDir = std::filesystem::path(mediaPath).parent_path();
     if (!std::filesystem::exists(configDir)) {
         try {
             std::filesystem::create_directories(configDir);
@@ -54,48 +181,204 @@ void MediaEngine::Shutdown() {
         return;
     }
 
-    m_shouldStop.store(true);
-    m_taskCondition.notify_all();
+    // Abandon pending commands, then let in-flight work reach its next checkpoint
+    m_loadCommands->Cancel();
+    m_seekCommands->Cancel();
+    m_waveformCommands->Cancel();
+    m_nextCommands->Cancel();
+    {
+        std::lock_guard<std::mutex> lock(m_waveformMutex);
+        if (m_waveform) {
+            m_waveform->Abandon();
+        }
+    }
+    StopScheduler();
 
-    if (m_workerThread && m_workerThread->joinable()) {
-        m_workerThread->join();
+    StopPresentation();
+    StopAudioDelivery();
+    FlushAudioOutput(0);
+    {
+        std::lock_guard<std::mutex> lock(m_sharedAudioMutex);
+        m_sharedAudio.reset();
     }
+    {
+        std::lock_guard<std::mutex> lock(m_audioCallbackMutex);
+        m_spectrumEnabled = false;
+        if (m_spectrum) {
+            m_spectrum->ShareAs(std::string());
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_metadataMutex);
+        m_source.reset();
+        m_mediaPath.clear();
+        std::lock_guard<std::mutex> nextLock(m_nextMutex);
+        m_next = NextItem();
+        m_spliced = NextItem();
+        m_spliceFrame.store(kNoSplice);
+    }
+    m_nextEpoch.fetch_add(1);
 
     m_isInitialized.store(false);
     m_isLoaded.store(false);
     m_isPlaying.store(false);
-    m_currentTime.store(0.0);
+    m_clock.Pause();
+    ResetTimeline(0);
     m_duration.store(0.0);
-    m_mediaPath.clear();
 }
 
-bool MediaEngine::Load(const std::string& path) {
+CommandFuture MediaEngine::Load(const std::string& path) {
     if (path.empty()) {
-        return false;
+        return MakeReadyCommand(CommandStatus::Failed);
     }
 
-    {
-        std::lock_guard<std::mutex> lock(m_metadataMutex);
-        m_metadata.clear();
-    }
+    m_isPlaying.store(false);
+    StopPresentation();
+    m_clock.Pause();
+    FlushAudioOutput(0);
 
+    // Seeks aimed at the previous file are meaningless now, and so is its next item
+    m_seekCommands->Cancel();
+    m_nextCommands->Cancel();
+
+    // Reset and post under the metadata lock so a superseded load that is
+    // about to commit either lands before the reset or sees its token cancelled
+    std::lock_guard<std::mutex> lock(m_metadataMutex);
     m_mediaPath = path;
+    m_metadata.clear();
+    m_seekIndex.reset();
+    m_seekIndexOrigin = SeekIndexOrigin::None;
+    m_seekIndexBuildUs = 0;
+    m_source.reset();
     m_isLoaded.store(false);
+    {
+        std::lock_guard<std::mutex> nextLock(m_nextMutex);
+        m_next = NextItem();
+        m_spliced = NextItem();
+        m_spliceFrame.store(kNoSplice);
+    }
+    m_nextEpoch.fetch_add(1);
 
-    // Submit load task to worker thread
-    std::unique_lock<std::mutex> lock(m_taskMutex);
-    m_taskQueue.push([this]() {
-        if (!ParseStreams(m_mediaPath)) {
-            return;
+    m_metrics.loads->Add();
+    const auto requested = std::chrono::steady_clock::now();
+    return m_loadCommands->Post([this, path, requested](const CancellationToken& token) {
+        KNOUX_TRACE_SPAN(kEngineLog, "Load");
+        ParsedMedia media;
+        if (LoadCachedMedia(path, media)) {
+            m_metrics.metadataHits->Add();
+        } else {
+            if (!ParseStreams(path, media, token)) {
+                if (token.IsCancelled()) {
+                    return CommandStatus::Superseded;
+                }
+                m_metrics.loadFailures->Add();
+                return CommandStatus::Failed;
+            }
+            m_metadataStore.Store(path, media.meta);
+        }
+        nlohmann::json& meta = media.meta;
+
+        auto source = std::make_shared<system::ByteSource>();
+        if (!source->Open(path)) {
+            m_metrics.loadFailures->Add();
+            return CommandStatus::Failed;
         }
+        source->SetBitrate(meta.value("bitrate", static_cast<int64_t>(0)));
 
+        // Playback starts at the first keyframe; have its bytes loading before Play()
+        SeekPoint first{ 0, 0 };
+        if (media.seekIndex) {
+            media.seekIndex->Find(0, first);
+        }
+        source->Prefetch(first.offset);
+
+        // Audio the decoder pushed since Load() was called is still the previous track's
+        std::lock_guard<AudioRingGate> gate(m_audioGate);
+        std::lock_guard<std::mutex> commitLock(m_metadataMutex);
+        if (token.IsCancelled()) {
+            return CommandStatus::Superseded;
+        }
+
+        // Audio drives the clock when there is audio to follow
+        const bool hasAudio = meta.contains("sample_rate");
+        if (hasAudio) {
+            m_audioSampleRate.store(std::max(meta.value("sample_rate", 48000), 1));
+            // The shared ring's consumer reads the rate from its header
+            std::lock_guard<std::mutex> lock(m_sharedAudioMutex);
+            if (m_sharedAudio) {
+                m_sharedAudio->SetSampleRate(static_cast<uint32_t>(m_audioSampleRate.load()));
+            }
+        }
+        m_clock.SetSource(hasAudio ? PlaybackClock::Source::Audio : PlaybackClock::Source::System);
+
+        // The decoder side picks up the gapless trim with its next push
+        m_loadedDelay.store(static_cast<uint64_t>(std::max<int64_t>(meta.value("encoder_delay", static_cast<int64_t>(0)), 0)));
+        m_loadedPadding.store(static_cast<size_t>(std::clamp<int64_t>(meta.value("encoder_padding", static_cast<int64_t>(0)),
+                                                                      0, kMaxEncoderPaddingFrames)));
+        m_trackAudioReset.store(TrackAudioReset::NewTrack);
+
+        m_duration.store(meta.value("duration", 0.0));
+        m_metadata = std::move(meta);
+        m_seekIndex = std::move(media.seekIndex);
+        m_seekIndexOrigin = media.seekIndexOrigin;
+        m_seekIndexBuildUs = media.seekIndexBuildUs;
+        m_source = std::move(source);
+        {
+            std::lock_guard<std::mutex> statsLock(m_seekStatsMutex);
+            m_seekStats = SeekStats();
+        }
+        DiscardQueuedAudio();
+        ResetTimeline(0);
+        m_presentation.ResetStats();
         m_isLoaded.store(true);
-        m_currentTime.store(0.0);
-        m_duration.store(m_metadata.value("duration", 0.0));
+        m_metrics.load->RecordSince(requested);
+        return CommandStatus::Completed;
     });
+}
 
-    m_taskCondition.notify_one();
-    return true;
+std::shared_ptr<Waveform> MediaEngine::RequestWaveform(const std::string& path, WaveformSource source) {
+    system::FileIdentity identity;
+    if (!system::ReadFileIdentity(path, identity)) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(m_waveformMutex);
+    if (m_waveform && m_waveformIdentity == identity && m_waveform->GetState() != Waveform::State::Abandoned) {
+        return m_waveform;
+    }
+
+    // A superseded build may never get to run, so it is abandoned here rather than by its task
+    if (m_waveform) {
+        m_waveform->Abandon();
+    }
+
+    std::shared_ptr<Waveform> waveform = m_waveformCache.Load(identity);
+    if (waveform) {
+        m_waveformCommands->Cancel();
+    } else {
+        if (!source.read || source.sampleRate <= 0 || source.channels <= 0) {
+            return nullptr;
+        }
+        waveform = std::make_shared<Waveform>(source.sampleRate, source.channels, source.totalFrames);
+        m_waveformCommands->Post([this, waveform, identity, source = std::move(source)](const CancellationToken& token) {
+            std::vector<float> chunk(kWaveformReadFrames * static_cast<size_t>(source.channels));
+            while (!token.IsCancelled()) {
+                const size_t frames = source.read(chunk.data(), kWaveformReadFrames);
+                if (frames == 0) {
+                    waveform->Finish();
+                    m_waveformCache.Store(identity, *waveform);
+                    return CommandStatus::Completed;
+                }
+                waveform->Append(chunk.data(), frames);
+            }
+            waveform->Abandon();
+            return CommandStatus::Superseded;
+        });
+    }
+
+    m_waveform = waveform;
+    m_waveformIdentity = identity;
+    return waveform;
 }
 
 bool MediaEngine::Play() {
@@ -103,11 +386,12 @@ bool MediaEngine::Play() {
         return false;
     }
 
-    if (m_isPlaying.load()) {
+    if (m_isPlaying.exchange(true)) {
         return true;
     }
 
-    m_isPlaying.store(true);
+    m_clock.Start();
+    StartPresentation();
     return true;
 }
 
@@ -117,6 +401,8 @@ bool MediaEngine::Pause() {
     }
 
     m_isPlaying.store(false);
+    StopPresentation();
+    m_clock.Pause();
     return true;
 }
 
@@ -126,30 +412,252 @@ bool MediaEngine::Stop() {
     }
 
     m_isPlaying.store(false);
-    m_currentTime.store(0.0);
+    StopPresentation();
+    m_clock.Pause();
+    CommitPendingSplice();
+    m_trackAudioReset.store(TrackAudioReset::NewTrack);
+    FlushAudioOutput(0);
     return true;
 }
 
-bool MediaEngine::Seek(double time) {
+CommandFuture MediaEngine::Seek(double time) {
     if (!IsLoaded()) {
+        return MakeReadyCommand(CommandStatus::Failed);
+    }
+
+    const auto requested = std::chrono::steady_clock::now();
+    return m_seekCommands->Post([this, time, requested](const CancellationToken& token) {
+        KNOUX_TRACE_SPAN(kEngineLog, "Seek");
+        if (!IsLoaded()) {
+            return CommandStatus::Failed;
+        }
+
+        const double target = std::clamp(time, 0.0, std::max(GetDuration(), 0.0));
+        const int64_t targetUs = static_cast<int64_t>(target * 1e6);
+
+        std::shared_ptr<const SeekIndex> index;
+        std::shared_ptr<system::ByteSource> source;
+        int64_t bitrate = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_metadataMutex);
+            index = m_seekIndex;
+            source = m_source;
+            bitrate = m_metadata.value("bitrate", static_cast<int64_t>(0));
+        }
+
+        // Decoding resumes at the preceding keyframe and discards frames up to the target
+        SeekPoint keyframe{ targetUs, static_cast<uint64_t>(target * static_cast<double>(bitrate) / 8.0) };
+        const bool indexed = index && index->Find(targetUs, keyframe);
+        if (token.IsCancelled()) {
+            return CommandStatus::Superseded;
+        }
+
+        if (source) {
+            source->Prefetch(keyframe.offset);
+        }
+        // A spliced track not yet heard is where the decoder already is
+        CommitPendingSplice();
+        TrackAudioReset expected = TrackAudioReset::None;
+        m_trackAudioReset.compare_exchange_strong(expected, TrackAudioReset::Flush);
+        FlushAudioOutput(targetUs);
+
+        const int64_t latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - requested).count();
+        m_metrics.seek->RecordSince(requested);
+        m_metrics.seeks->Add();
+        std::lock_guard<std::mutex> lock(m_seekStatsMutex);
+        ++m_seekStats.seeks;
+        m_seekStats.indexedSeeks += indexed ? 1 : 0;
+        m_seekStats.lastLatencyUs = latencyUs;
+        m_seekStats.maxLatencyUs = std::max(m_seekStats.maxLatencyUs, latencyUs);
+        m_seekStats.averageLatencyUs += (latencyUs - m_seekStats.averageLatencyUs) / static_cast<int64_t>(m_seekStats.seeks);
+        m_seekStats.lastKeyframeUs = keyframe.timeUs;
+        m_seekStats.lastByteOffset = keyframe.offset;
+        return CommandStatus::Completed;
+    });
+}
+
+MediaEngine::SeekStats MediaEngine::GetSeekStats() const {
+    SeekStats stats;
+    {
+        std::lock_guard<std::mutex> lock(m_seekStatsMutex);
+        stats = m_seekStats;
+    }
+
+    std::lock_guard<std::mutex> lock(m_metadataMutex);
+    stats.indexOrigin = m_seekIndexOrigin;
+    stats.indexBuildUs = m_seekIndexBuildUs;
+    if (m_seekIndex) {
+        stats.indexPoints = m_seekIndex->Size();
+        stats.indexBytes = m_seekIndex->MemoryBytes();
+    }
+    return stats;
+}
+
+int64_t MediaEngine::ReadMedia(uint64_t offset, uint8_t* buffer, size_t length) {
+    std::shared_ptr<system::ByteSource> source;
+    {
+        std::lock_guard<std::mutex> lock(m_metadataMutex);
+        source = m_source;
+    }
+    return source ? source->ReadAt(offset, buffer, length) : -1;
+}
+
+system::ByteSource::Stats MediaEngine::GetIoStats() const {
+    std::shared_ptr<system::ByteSource> source;
+    {
+        std::lock_guard<std::mutex> lock(m_metadataMutex);
+        source = m_source;
+    }
+    return source ? source->GetStats() : system::ByteSource::Stats();
+}
+
+CommandFuture MediaEngine::PrepareNext(const std::string& path) {
+    if (path.empty()) {
+        return MakeReadyCommand(CommandStatus::Failed);
+    }
+
+    return m_nextCommands->Post([this, path](const CancellationToken& token) {
+        const auto started = std::chrono::steady_clock::now();
+
+        NextItem item;
+        item.path = path;
+        if (!LoadCachedMedia(path, item.media)) {
+            if (!ParseStreams(path, item.media, token)) {
+                return token.IsCancelled() ? CommandStatus::Superseded : CommandStatus::Failed;
+            }
+            m_metadataStore.Store(path, item.media.meta);
+        }
+        const nlohmann::json& meta = item.media.meta;
+
+        auto source = std::make_shared<system::ByteSource>();
+        if (!source->Open(path)) {
+            return CommandStatus::Failed;
+        }
+        source->SetBitrate(meta.value("bitrate", static_cast<int64_t>(0)));
+        SeekPoint first{ 0, 0 };
+        if (item.media.seekIndex) {
+            item.media.seekIndex->Find(0, first);
+        }
+        source->Prefetch(first.offset);
+
+        item.source = std::move(source);
+        item.duration = meta.value("duration", 0.0);
+        item.sampleRate = meta.value("sample_rate", 0);
+        item.channels = static_cast<size_t>(std::max(meta.value("channels", 0), 0));
+        item.delayFrames = static_cast<uint64_t>(std::max<int64_t>(meta.value("encoder_delay", static_cast<int64_t>(0)), 0));
+        item.paddingFrames = static_cast<size_t>(std::clamp<int64_t>(meta.value("encoder_padding", static_cast<int64_t>(0)),
+                                                                     0, kMaxEncoderPaddingFrames));
+        item.ready = true;
+
+        {
+            std::lock_guard<std::mutex> lock(m_nextMutex);
+            if (token.IsCancelled()) {
+                return CommandStatus::Superseded;
+            }
+            item.epoch = m_nextEpoch.fetch_add(1) + 1;
+            std::swap(m_next, item);
+        }
+        // The replaced item is released here, outside the lock
+
+        m_nextPrepareUs.store(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - started).count());
+        return CommandStatus::Completed;
+    });
+}
+
+bool MediaEngine::HasNextItem() const {
+    std::lock_guard<std::mutex> lock(m_nextMutex);
+    return m_next.ready;
+}
+
+int64_t MediaEngine::ReadNextMedia(uint64_t offset, uint8_t* buffer, size_t length) {
+    std::shared_ptr<system::ByteSource> source;
+    {
+        std::lock_guard<std::mutex> lock(m_nextMutex);
+        if (m_next.ready) {
+            source = m_next.source;
+        }
+    }
+    return source ? source->ReadAt(offset, buffer, length) : -1;
+}
+
+MediaEngine::GaplessStats MediaEngine::GetGaplessStats() const {
+    GaplessStats stats;
+    stats.transitions = m_gaplessTransitions.load();
+    stats.trimmedFrames = m_gaplessTrimmedFrames.load();
+    stats.lastCrossfadeFrames = m_lastCrossfadeFrames.load();
+    stats.prepareUs = m_nextPrepareUs.load();
+    return stats;
+}
+
+bool MediaEngine::GetMediaSummary(const std::string& path, MetadataSummary& summary) {
+    if (m_metadataStore.Lookup(path, summary)) {
+        return true;
+    }
+
+    ParsedMedia media;
+    if (!ParseStreams(path, media, CancellationToken(), false)) {
         return false;
     }
+    if (m_metadataStore.Store(path, media.meta) && m_metadataStore.Lookup(path, summary)) {
+        return true;
+    }
 
-    if (time < 0.0) {
-        time = 0.0;
+    // Store unavailable: answer from the fresh parse
+    nlohmann::json extended;
+    summary = MetadataStore::Summarize(media.meta, extended);
+    return true;
+}
+
+bool MediaEngine::SetTrackLoudness(const std::string& path, double integratedLufs, double truePeakDb) {
+    ParsedMedia media;
+    if (!m_metadataStore.LookupMetadata(path, media.meta) &&
+        !ParseStreams(path, media, CancellationToken(), false)) {
+        return false;
     }
 
-    const double duration = GetDuration();
-    if (time > duration) {
-        time = duration;
+    media.meta["loudness"] = { { "integrated", integratedLufs }, { "truePeak", truePeakDb } };
+    if (!m_metadataStore.Store(path, media.meta)) {
+        return false;
+    }
+
+    // Keep the loaded track's metadata in step
+    std::lock_guard<std::mutex> lock(m_metadataMutex);
+    if (m_isLoaded.load() && m_mediaPath == path) {
+        m_metadata["loudness"] = media.meta["loudness"];
+    }
+    return true;
+}
+
+bool MediaEngine::GetTrackLoudness(const std::string& path, double& integratedLufs, double& truePeakDb) const {
+    nlohmann::json meta;
+    if (!m_metadataStore.LookupMetadata(path, meta)) {
+        return false;
     }
 
-    m_currentTime.store(time);
+    const auto loudness = meta.find("loudness");
+    if (loudness == meta.end() || !loudness->is_object() ||
+        !loudness->contains("integrated") || !loudness->contains("truePeak")) {
+        return false;
+    }
+    integratedLufs = loudness->at("integrated").get<double>();
+    truePeakDb = loudness->at("truePeak").get<double>();
     return true;
 }
 
+bool MediaEngine::OpenMetadataStore(const std::string& path) {
+    return m_metadataStore.Open(path);
+}
+
+MetadataStore::Stats MediaEngine::GetMetadataStoreStats() const {
+    return m_metadataStore.GetStats();
+}
+
 double MediaEngine::GetCurrentTime() const {
-    return m_currentTime.load();
+    const double time = m_clock.NowSeconds();
+    const double duration = GetDuration();
+    return duration > 0.0 ? std::min(time, duration) : time;
 }
 
 double MediaEngine::GetDuration() const {
@@ -170,11 +678,324 @@ nlohmann::json MediaEngine::GetMetadata() const {
 }
 
 void MediaEngine::SetVideoFrameCallback(std::function<void(const uint8_t*, int, int, int)> callback) {
-    m_videoCallback = callback;
+    std::lock_guard<std::mutex> lock(m_videoCallbackMutex);
+    m_videoCallback = std::move(callback);
+}
+
+void MediaEngine::SetVideoFrameCallback(std::function<void(const VideoFrameHandle&)> callback) {
+    std::lock_guard<std::mutex> lock(m_videoCallbackMutex);
+    m_videoFrameCallback = std::move(callback);
+}
+
+bool MediaEngine::ConfigureVideoFramePool(const FrameFormat& format, size_t frameCount) {
+    return m_framePool->Configure(format, frameCount);
+}
+
+VideoFrameHandle MediaEngine::AcquireVideoFrame() {
+    return m_framePool->Acquire();
+}
+
+bool MediaEngine::DeliverVideoFrame(const VideoFrameHandle& frame) {
+    if (!m_presentation.Push(frame)) {
+        m_metrics.framesRejected->Add();
+        return false;
+    }
+    m_metrics.decode->RecordSince(frame.AcquiredAt());
+    m_metrics.framesDelivered->Add();
+
+    // A frame earlier than the one the presentation thread is sleeping towards
+    if (m_presentationActive.load(std::memory_order_relaxed)) {
+        m_presentationCondition.notify_one();
+    }
+    return true;
+}
+
+FramePool::Stats MediaEngine::GetVideoFramePoolStats() const {
+    return m_framePool->GetStats();
 }
 
 void MediaEngine::SetAudioBufferCallback(std::function<void(const float*, size_t)> callback) {
-    m_audioCallback = callback;
+    const bool enable = static_cast<bool>(callback);
+    {
+        std::unique_lock<std::mutex> lock(m_audioCallbackMutex);
+        m_audioCallback = enable
+            ? std::make_shared<const std::function<void(const float*, size_t)>>(std::move(callback))
+            : nullptr;
+        // The delivery thread calls its copy outside the lock; the caller may free what the old one uses
+        m_audioCallbackIdle.wait(lock, [this] { return !m_audioCallbackRunning; });
+    }
+
+    if (enable) {
+        StartAudioDelivery();
+    } else {
+        bool shared = false;
+        {
+            std::lock_guard<std::mutex> lock(m_sharedAudioMutex);
+            shared = static_cast<bool>(m_sharedAudio);
+        }
+        if (!shared) {
+            StopAudioDelivery();
+        }
+    }
+}
+
+bool MediaEngine::OpenSharedAudioOutput(const std::string& name, size_t capacityFrames) {
+    auto ring = std::make_shared<SharedAudioRing>();
+    if (!ring->Create(name, capacityFrames, m_audioChannels.load(std::memory_order_relaxed),
+                      static_cast<uint32_t>(m_audioSampleRate.load(std::memory_order_relaxed)))) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_sharedAudioMutex);
+        m_sharedAudio = std::move(ring);
+        m_sharedStaleFrames = 0;
+    }
+    StartAudioDelivery();
+    return true;
+}
+
+void MediaEngine::CloseSharedAudioOutput() {
+    {
+        std::lock_guard<std::mutex> lock(m_sharedAudioMutex);
+        if (m_sharedAudio) {
+            // The delivery thread may be waiting on the consumer; it keeps its own reference
+            m_sharedAudio->Interrupt();
+        }
+        m_sharedAudio.reset();
+        m_sharedStaleFrames = 0;
+    }
+    bool callback = false;
+    {
+        std::lock_guard<std::mutex> lock(m_audioCallbackMutex);
+        callback = static_cast<bool>(m_audioCallback);
+    }
+    if (!callback) {
+        StopAudioDelivery();
+    }
+}
+
+SharedAudioRing::Stats MediaEngine::GetSharedAudioStats() const {
+    std::lock_guard<std::mutex> lock(m_sharedAudioMutex);
+    return m_sharedAudio ? m_sharedAudio->GetStats() : SharedAudioRing::Stats();
+}
+
+bool MediaEngine::EnableSpectrumAnalyzer(const std::string& sharedName) {
+    std::lock_guard<std::mutex> lock(m_audioCallbackMutex);
+    if (!m_spectrum) {
+        m_spectrum = std::make_unique<SpectrumAnalyzer>();
+        m_spectrumReader.store(m_spectrum.get(), std::memory_order_release);
+    }
+    if (!m_spectrum->ShareAs(sharedName)) {
+        return false;
+    }
+    m_spectrumEnabled = true;
+    return true;
+}
+
+void MediaEngine::DisableSpectrumAnalyzer() {
+    std::lock_guard<std::mutex> lock(m_audioCallbackMutex);
+    m_spectrumEnabled = false;
+    if (m_spectrum) {
+        m_spectrum->ShareAs(std::string());
+    }
+}
+
+bool MediaEngine::GetSpectrumFrame(SpectrumFrame& frame) const {
+    const SpectrumAnalyzer* analyzer = m_spectrumReader.load(std::memory_order_acquire);
+    return analyzer && analyzer->GetFrame(frame);
+}
+
+SpectrumAnalyzer::Stats MediaEngine::GetSpectrumStats() const {
+    const SpectrumAnalyzer* analyzer = m_spectrumReader.load(std::memory_order_acquire);
+    return analyzer ? analyzer->GetStats() : SpectrumAnalyzer::Stats();
+}
+
+bool MediaEngine::ConfigureAudioRing(size_t capacityFrames, size_t channels) {
+    if (IsPlaying() || capacityFrames == 0 || channels == 0) {
+        return false;
+    }
+
+    const bool wasDelivering = m_audioDeliveryActive.load();
+    StopAudioDelivery();
+    bool configured = false;
+    {
+        // A paused decoder may still push: the gate keeps it (and the output) out of the rings being replaced
+        std::lock_guard<AudioRingGate> gate(m_audioGate);
+        std::lock_guard<std::mutex> lock(m_audioCallbackMutex);
+        std::lock_guard<std::mutex> sharedLock(m_sharedAudioMutex);
+        // The shared ring's layout is fixed at creation
+        if (!IsPlaying() && !(m_sharedAudio && m_sharedAudio->Channels() != channels)) {
+            m_audioRing = std::make_unique<AudioRingBuffer>(capacityFrames, channels);
+            m_audioChannels.store(channels, std::memory_order_relaxed);
+            AllocateTrackAudio();
+            configured = true;
+        }
+    }
+    if (wasDelivering) {
+        StartAudioDelivery();
+    }
+    return configured;
+}
+
+bool MediaEngine::ConfigureCrossfade(size_t frames) {
+    if (frames > kMaxCrossfadeFrames) {
+        return false;
+    }
+
+    // The held rings belong to the decoder side: replace them only while no push is inside
+    std::lock_guard<AudioRingGate> gate(m_audioGate);
+    if (IsPlaying()) {
+        return false;
+    }
+    m_crossfadeFrames = frames;
+    AllocateTrackAudio();
+    return true;
+}
+
+size_t MediaEngine::PushAudioFrames(const float* samples, size_t frames) {
+    AudioRingGate::Scope gate(m_audioGate);
+    CommitHeardSplice();
+    ApplyTrackAudioReset();
+
+    size_t skipped = 0;
+    if (m_trackAudio.skipFrames > 0) {
+        skipped = static_cast<size_t>(std::min<uint64_t>(m_trackAudio.skipFrames, frames));
+        m_trackAudio.skipFrames -= skipped;
+        m_gaplessTrimmedFrames.fetch_add(skipped, std::memory_order_relaxed);
+        samples += skipped * m_audioRing->Channels();
+        frames -= skipped;
+    }
+
+    // Nothing to hold back: straight into the output ring
+    AudioRingBuffer& held = *m_trackAudio.held;
+    const size_t hold = m_trackAudio.paddingFrames + m_crossfadeFrames;
+    if (hold == 0 && held.AvailableToRead() == 0) {
+        return skipped + WriteAudioOutput(samples, frames);
+    }
+
+    DrainHeldAudio(hold);
+    const size_t accepted = held.Write(samples, std::min(frames, held.AvailableToWrite()));
+    DrainHeldAudio(hold);
+    return skipped + accepted;
+}
+
+size_t MediaEngine::PushNextAudioFrames(const float* samples, size_t frames) {
+    AudioRingGate::Scope gate(m_audioGate);
+    if (!ArmNextAudio()) {
+        return 0;
+    }
+
+    size_t skipped = 0;
+    if (m_nextAudio.skipFrames > 0) {
+        skipped = static_cast<size_t>(std::min<uint64_t>(m_nextAudio.skipFrames, frames));
+        m_nextAudio.skipFrames -= skipped;
+        m_gaplessTrimmedFrames.fetch_add(skipped, std::memory_order_relaxed);
+        samples += skipped * m_audioRing->Channels();
+        frames -= skipped;
+    }
+
+    AudioRingBuffer& held = *m_nextAudio.held;
+    return skipped + held.Write(samples, std::min(frames, held.AvailableToWrite()));
+}
+
+bool MediaEngine::FinishAudioTrack() {
+    AudioRingGate::Scope gate(m_audioGate);
+    ApplyTrackAudioReset();
+
+    AudioRingBuffer& held = *m_trackAudio.held;
+    if (!m_ending.active) {
+        const size_t queued = held.AvailableToRead();
+        const size_t valid = queued > m_trackAudio.paddingFrames ? queued - m_trackAudio.paddingFrames : 0;
+        m_gaplessTrimmedFrames.fetch_add(queued - valid, std::memory_order_relaxed);
+
+        m_ending = TrackEnding();
+        m_ending.active = true;
+        if (ArmNextAudio()) {
+            m_ending.mixFrames = std::min({ m_crossfadeFrames, valid, m_nextAudio.held->AvailableToRead() });
+            m_ending.plainFrames = valid - m_ending.mixFrames;
+            m_ending.splice = SpliceNextItem(m_audioFramesQueued.load() + m_ending.plainFrames);
+        }
+        if (!m_ending.splice) {
+            m_ending.mixFrames = 0;
+            m_ending.plainFrames = valid;
+        }
+    }
+
+    const size_t channels = m_audioRing->Channels();
+    float* tail = m_spliceScratch.data();
+
+    // Everything before the overlap goes out as it is
+    while (m_ending.plainFrames > 0) {
+        const size_t frames = std::min({ m_ending.plainFrames, m_audioRing->AvailableToWrite(), kSpliceChunkFrames });
+        if (frames == 0) {
+            return false;
+        }
+        held.Read(tail, frames);
+        WriteAudioOutput(tail, frames);
+        m_ending.plainFrames -= frames;
+    }
+
+    if (!m_ending.splice) {
+        held.Reset();
+        m_ending = TrackEnding();
+        return true;
+    }
+
+    // Equal-power overlap: cos/sin gains keep the summed power constant for uncorrelated tracks
+    float* head = tail + kSpliceChunkFrames * channels;
+    const double step = 1.5707963267948966 / static_cast<double>(std::max<size_t>(m_ending.mixFrames, 1));
+    while (m_ending.mixedFrames < m_ending.mixFrames) {
+        const size_t frames = std::min({ m_ending.mixFrames - m_ending.mixedFrames, m_audioRing->AvailableToWrite(),
+                                         kSpliceChunkFrames });
+        if (frames == 0) {
+            return false;
+        }
+        held.Read(tail, frames);
+        m_nextAudio.held->Read(head, frames);
+        for (size_t i = 0; i < frames; ++i) {
+            const double angle = (static_cast<double>(m_ending.mixedFrames + i) + 0.5) * step;
+            const float fadeOut = static_cast<float>(std::cos(angle));
+            const float fadeIn = static_cast<float>(std::sin(angle));
+            for (size_t c = 0; c < channels; ++c) {
+                const size_t k = i * channels + c;
+                tail[k] = tail[k] * fadeOut + head[k] * fadeIn;
+            }
+        }
+        WriteAudioOutput(tail, frames);
+        m_ending.mixedFrames += frames;
+    }
+
+    m_lastCrossfadeFrames.store(m_ending.mixFrames, std::memory_order_relaxed);
+    m_gaplessTransitions.fetch_add(1, std::memory_order_relaxed);
+    AdoptNextAudio();
+    return true;
+}
+
+size_t MediaEngine::PullAudioFrames(float* out, size_t frames) {
+    // Refused only for the moment a flush holds the gate: play silence rather than wait
+    AudioRingGate::Scope gate(m_audioGate, std::try_to_lock);
+    if (!gate) {
+        // The ring itself may be being replaced (ConfigureAudioRing)
+        std::fill(out, out + frames * m_audioChannels.load(std::memory_order_relaxed), 0.0f);
+        return 0;
+    }
+    const size_t read = m_audioRing->Read(out, frames);
+    ReportAudioPlayed(read);
+    return read;
+}
+
+AudioRingBuffer::Stats MediaEngine::GetAudioRingStats() const {
+    std::lock_guard<std::mutex> lock(m_audioCallbackMutex);
+    return m_audioRing->GetStats();
+}
+
+PlaybackClock::Stats MediaEngine::GetClockStats() const {
+    return m_clock.GetStats();
+}
+
+PresentationScheduler::Stats MediaEngine::GetPresentationStats() const {
+    return m_presentation.GetStats();
 }
 
 void MediaEngine::SetHardwareAcceleration(bool enable) {
@@ -185,113 +1006,581 @@ bool MediaEngine::IsHardwareAccelerated() const {
     return m_useHardwareAccel.load();
 }
 
-void MediaEngine::WorkerLoop() {
-    while (!m_shouldStop.load()) {
-        std::unique_lock<std::mutex> lock(m_taskMutex);
-        m_taskCondition.wait(lock, [this] { return !m_taskQueue.empty() || m_shouldStop.load(); });
+bool MediaEngine::SubmitTask(TaskPriority priority, std::function<void()> task, const std::shared_ptr<TaskGroup>& group) {
+    const std::shared_ptr<TaskScheduler> scheduler = GetScheduler();
+    return scheduler && scheduler->Submit(priority, std::move(task), group);
+}
 
-        if (m_shouldStop.load() && m_taskQueue.empty()) {
-            break;
-        }
+void MediaEngine::WaitForTasks(const std::shared_ptr<TaskGroup>& group) {
+    if (const std::shared_ptr<TaskScheduler> scheduler = GetScheduler()) {
+        scheduler->Wait(group);
+    }
+}
 
-        auto task = std::move(m_taskQueue.front());
-        m_taskQueue.pop();
-        lock.unlock();
+TaskScheduler::Stats MediaEngine::GetSchedulerStats() const {
+    const std::shared_ptr<TaskScheduler> scheduler = GetScheduler();
+    return scheduler ? scheduler->GetStats() : TaskScheduler::Stats();
+}
 
-        task();
+std::shared_ptr<TaskScheduler> MediaEngine::GetScheduler() const {
+    std::lock_guard<std::mutex> lock(m_schedulerMutex);
+    return m_scheduler;
+}
+
+void MediaEngine::StopScheduler() {
+    std::shared_ptr<TaskScheduler> scheduler;
+    {
+        std::lock_guard<std::mutex> lock(m_schedulerMutex);
+        scheduler.swap(m_scheduler);
+    }
+    // Draining tasks see a null scheduler and have follow-up submits refused. This
+    // reference outlives the join, so the last one is never dropped on a worker
+    if (scheduler) {
+        scheduler->Shutdown(true);
     }
 }
 
-bool MediaEngine::ParseStreams(const std::string& path) {
-    std::ifstream file(path, std::ios::binary);
-    if (!file.is_open()) {
-        return false;
+system::MetricsSnapshot MediaEngine::GetStats() const {
+    system::MetricsSnapshot snapshot = m_metricsRegistry->Snapshot();
+
+    // Totals and levels owned by other components are sampled into the snapshot; the registry is left alone
+    static const char* const kPriorityNames[kTaskPriorityCount] = { "interactive", "load", "background" };
+    const TaskScheduler::Stats scheduler = GetSchedulerStats();
+    for (size_t i = 0; i < kTaskPriorityCount; ++i) {
+        snapshot.AddGauge(std::string("scheduler.queued.") + kPriorityNames[i],
+                          static_cast<int64_t>(scheduler.priorities[i].queued));
     }
+    snapshot.AddCounter("scheduler.steals", scheduler.steals);
 
-    // Read first 12 bytes for magic number detection
-    std::vector<uint8_t> header(12);
-    file.read(reinterpret_cast<char*>(header.data()), 12);
-    file.close();
+    const PresentationScheduler::Stats presentation = m_presentation.GetStats();
+    snapshot.AddGauge("video.queued", static_cast<int64_t>(presentation.queued));
+    snapshot.AddCounter("video.presented", presentation.presented);
+    snapshot.AddCounter("video.dropped", presentation.dropped);
+    snapshot.AddCounter("video.late", presentation.late);
+    snapshot.AddGauge("video.av_offset_us", presentation.avOffsetUs);
+    snapshot.AddGauge("video.frames_outstanding", static_cast<int64_t>(m_framePool->GetStats().outstanding));
 
-    std::string format = DetectFormatFromMagicBytes(path);
-    if (format.empty()) {
-        return false;
+    AudioRingBuffer::Stats ring;
+    size_t ringFrames = 0;
+    {
+        // ConfigureAudioRing replaces the ring under this lock
+        std::lock_guard<std::mutex> lock(m_audioCallbackMutex);
+        ring = m_audioRing->GetStats();
+        ringFrames = m_audioRing->AvailableToRead();
     }
+    snapshot.AddGauge("audio.ring_frames", static_cast<int64_t>(ringFrames));
+    snapshot.AddCounter("audio.overruns", ring.overruns);
+    snapshot.AddCounter("audio.underruns", ring.underruns);
 
-    // Simulate metadata extraction
-    nlohmann::json meta;
-    meta["format"] = format;
-    meta["duration"] = 185.34; // seconds
-    meta["title"] = "Sample Movie";
-    meta["artist"] = "Director Name";
-    meta["bitrate"] = 4500000;
-    meta["width"] = 1920;
-    meta["height"] = 1080;
-    meta["frame_rate"] = 24.0;
-    meta["audio_codec"] = "aac";
-    meta["video_codec"] = "h264";
+    return snapshot;
+}
+
+void MediaEngine::StartAudioDelivery() {
+    if (m_audioDeliveryActive.exchange(true)) {
+        return;
+    }
+    m_audioDeliveryThread = std::make_unique<std::thread>(&MediaEngine::AudioDeliveryLoop, this);
+}
+
+void MediaEngine::StopAudioDelivery() {
+    if (!m_audioDeliveryActive.exchange(false)) {
+        return;
+    }
 
     {
-        std::lock_guard<std::mutex> lock(m_metadataMutex);
-        m_metadata = meta;
+        // Idle waits are untimed: notify under the mutex so a waiter cannot miss it
+        std::lock_guard<std::mutex> lock(m_audioDeliveryMutex);
+        m_audioDeliveryCondition.notify_all();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_sharedAudioMutex);
+        if (m_sharedAudio) {
+            m_sharedAudio->Interrupt();
+        }
+    }
+    if (m_audioDeliveryThread && m_audioDeliveryThread->joinable()) {
+        m_audioDeliveryThread->join();
+    }
+    m_audioDeliveryThread.reset();
+}
+
+void MediaEngine::AudioDeliveryLoop() {
+    const size_t channels = m_audioRing->Channels();
+    std::vector<float> chunk(kAudioDeliveryFrames * channels);
+
+    while (m_audioDeliveryActive.load()) {
+        if (DeliverSharedAudio(chunk.data())) {
+            continue;
+        }
+
+        size_t frames = 0;
+        {
+            // Read and report under one admission, so a flush never lands between them.
+            // The callback runs outside it and may call Stop() or Seek()
+            AudioRingGate::Scope gate(m_audioGate);
+            frames = m_audioRing->ReadAvailable(chunk.data(), kAudioDeliveryFrames);
+            ReportAudioPlayed(frames);
+        }
+        CommitHeardSplice();
+        if (frames == 0) {
+            WaitForQueuedAudio();
+            continue;
+        }
+
+        std::shared_ptr<const std::function<void(const float*, size_t)>> callback;
+        {
+            std::lock_guard<std::mutex> lock(m_audioCallbackMutex);
+            callback = m_audioCallback;
+            m_audioCallbackRunning = static_cast<bool>(callback);
+            AnalyzeDeliveredAudio(chunk.data(), frames);
+        }
+        if (callback) {
+            // Unlocked, so a callback that stops, seeks or loads does not wait on itself
+            {
+                system::MetricTimer timer(*m_metrics.audioCallback);
+                (*callback)(chunk.data(), frames * channels);
+            }
+            std::lock_guard<std::mutex> lock(m_audioCallbackMutex);
+            m_audioCallbackRunning = false;
+            m_audioCallbackIdle.notify_all();
+        }
+        m_metrics.audioFramesDelivered->Add(frames);
+    }
+}
+
+bool MediaEngine::DeliverSharedAudio(float* chunk) {
+    std::shared_ptr<SharedAudioRing> shared;
+    uint32_t seenRead = 0;
+    size_t consumed = 0;
+    size_t moved = 0;
+    size_t queued = 0;
+    {
+        AudioRingGate::Scope gate(m_audioGate);
+        {
+            std::lock_guard<std::mutex> lock(m_sharedAudioMutex);
+            if (!m_sharedAudio) {
+                return false;
+            }
+            shared = m_sharedAudio;
+            seenRead = m_sharedAudio->Header()->readFrame.load(std::memory_order_acquire);
+
+            // Frames queued before the last flush belong to the old position
+            consumed = m_sharedAudio->Poll();
+            const size_t stale = std::min(consumed, m_sharedStaleFrames);
+            m_sharedStaleFrames -= stale;
+            consumed -= stale;
+
+            // Only move what fits, so decoder back-pressure still comes from m_audioRing
+            const size_t writable = std::min(m_sharedAudio->Writable(), kAudioDeliveryFrames);
+            if (writable > 0) {
+                moved = m_audioRing->ReadAvailable(chunk, writable);
+                m_sharedAudio->Write(chunk, moved);
+            }
+            queued = m_sharedAudio->GetStats().queuedFrames;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_audioCallbackMutex);
+            AnalyzeDeliveredAudio(chunk, moved);
+        }
+
+        // The clock follows what the consumer has played, not what was handed over
+        ReportAudioPlayed(consumed);
+    }
+    m_metrics.audioFramesDelivered->Add(moved);
+    if (moved > 0) {
+        return true;
     }
 
+    if (queued > 0) {
+        // The consumer is playing (or the ring is full): wake when it takes frames, which the clock must see
+        shared->WaitForRead(seenRead, std::chrono::milliseconds(kSharedAudioIdleWaitMs));
+    } else {
+        // Nothing queued anywhere: sleep until the decoder writes
+        WaitForQueuedAudio();
+    }
     return true;
 }
 
-bool MediaEngine::ValidateFilePath(const std::string& path) const {
-    if (path.empty()) {
-        return false;
+void MediaEngine::WaitForQueuedAudio() {
+    std::unique_lock<std::mutex> lock(m_audioDeliveryMutex);
+    m_audioDeliveryWaiting.store(true);
+    // Pairs with the fence in WriteAudioOutput: either the writer sees the flag or the predicate sees its frames
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    m_audioDeliveryCondition.wait(lock, [this] {
+        return !m_audioDeliveryActive.load() || m_audioRing->AvailableToRead() > 0;
+    });
+    m_audioDeliveryWaiting.store(false, std::memory_order_relaxed);
+}
+
+void MediaEngine::AnalyzeDeliveredAudio(const float* chunk, size_t frames) {
+    if (m_spectrumEnabled && frames > 0) {
+        m_spectrum->Push(chunk, frames, m_audioRing->Channels(), m_audioSampleRate.load(std::memory_order_relaxed));
     }
+}
 
-    try {
-        const std::filesystem::path p(path);
-        return std::filesystem::exists(p) && std::filesystem::is_regular_file(p);
-    } catch (...) {
+void MediaEngine::ReportAudioPlayed(size_t frames) {
+    if (frames == 0) {
+        return;
+    }
+
+    uint64_t played = m_audioFramesPlayed.fetch_add(frames, std::memory_order_relaxed) + frames;
+
+    // Output reached a spliced track: positions restart at its first frame and the clock resyncs
+    // to them below. The item swap takes locks, so CommitHeardSplice() does it off this thread
+    int64_t splice = m_spliceFrame.load(std::memory_order_acquire);
+    if (splice >= 0 && played >= static_cast<uint64_t>(splice) &&
+        m_spliceFrame.compare_exchange_strong(splice, kSpliceHeard, std::memory_order_acq_rel)) {
+        played = RebaseAudioOutput(static_cast<uint64_t>(splice));
+    }
+
+    const int sampleRate = m_audioSampleRate.load(std::memory_order_relaxed);
+    const int64_t positionUs = m_audioBaseUs.load(std::memory_order_relaxed) +
+        static_cast<int64_t>(played * 1000000 / static_cast<uint64_t>(sampleRate));
+    m_clock.UpdateFromAudio(positionUs);
+}
+
+void MediaEngine::ResetTimeline(int64_t mediaUs) {
+    m_clock.SetTime(mediaUs);
+    m_audioBaseUs.store(mediaUs, std::memory_order_relaxed);
+    m_audioFramesPlayed.store(0, std::memory_order_relaxed);
+    m_audioFramesQueued.store(0, std::memory_order_relaxed);
+    m_presentation.Flush();
+}
+
+void MediaEngine::FlushAudioOutput(int64_t mediaUs) {
+    std::lock_guard<AudioRingGate> gate(m_audioGate);
+    DiscardQueuedAudio();
+    ResetTimeline(mediaUs);
+}
+
+void MediaEngine::DiscardQueuedAudio() {
+    m_audioRing->Reset();
+    std::lock_guard<std::mutex> lock(m_sharedAudioMutex);
+    m_sharedStaleFrames = m_sharedAudio ? m_sharedAudio->GetStats().queuedFrames : 0;
+}
+
+void MediaEngine::AllocateTrackAudio() {
+    const size_t channels = m_audioRing->Channels();
+    const size_t capacity = m_crossfadeFrames + kMaxEncoderPaddingFrames + kNextPrerollFrames;
+    m_trackAudio.held = std::make_unique<AudioRingBuffer>(capacity, channels);
+    m_nextAudio.held = std::make_unique<AudioRingBuffer>(capacity, channels);
+    m_nextAudio.armed = false;
+    m_nextAudio.epoch = 0;
+    m_spliceScratch.assign(2 * kSpliceChunkFrames * channels, 0.0f);
+    m_ending = TrackEnding();
+}
+
+void MediaEngine::ApplyTrackAudioReset() {
+    const TrackAudioReset reset = m_trackAudioReset.exchange(TrackAudioReset::None, std::memory_order_acq_rel);
+    if (reset == TrackAudioReset::None) {
+        return;
+    }
+
+    // A splice already handed the output over; the decoder is in the next track
+    if (m_ending.splice) {
+        AdoptNextAudio();
+    }
+    m_ending = TrackEnding();
+    m_trackAudio.held->Reset();
+    m_trackAudio.skipFrames = 0;
+    if (reset == TrackAudioReset::NewTrack) {
+        m_trackAudio.skipFrames = m_loadedDelay.load();
+        m_trackAudio.paddingFrames = m_loadedPadding.load();
+    }
+}
+
+bool MediaEngine::ArmNextAudio() {
+    const uint64_t epoch = m_nextEpoch.load(std::memory_order_acquire);
+    if (epoch == m_nextAudio.epoch) {
+        return m_nextAudio.armed;
+    }
+
+    // A different item (or none): what was pre-decoded belongs to the old one
+    m_nextAudio.epoch = epoch;
+    m_nextAudio.armed = false;
+    m_nextAudio.held->Reset();
+
+    std::lock_guard<std::mutex> lock(m_nextMutex);
+    if (m_next.ready && m_next.epoch == epoch &&
+        m_next.sampleRate == m_audioSampleRate.load(std::memory_order_relaxed) &&
+        m_next.channels == m_audioRing->Channels()) {
+        m_nextAudio.armed = true;
+        m_nextAudio.skipFrames = m_next.delayFrames;
+        m_nextAudio.paddingFrames = m_next.paddingFrames;
+    }
+    return m_nextAudio.armed;
+}
+
+bool MediaEngine::SpliceNextItem(uint64_t startFrame) {
+    std::lock_guard<std::mutex> lock(m_metadataMutex);
+    std::lock_guard<std::mutex> nextLock(m_nextMutex);
+    if (!m_next.ready || m_next.epoch != m_nextAudio.epoch) {
         return false;
     }
+
+    // A previous splice still unheard (a very short track) is committed first
+    startFrame -= std::min(startFrame, CommitSplicedItem());
+
+    // Swaps only: the stale slot contents are released by the next PrepareNext() or Load()
+    std::swap(m_next, m_spliced);
+    m_next.ready = false;
+    std::swap(m_source, m_spliced.source);
+    m_spliceFrame.store(static_cast<int64_t>(startFrame), std::memory_order_release);
+    return true;
+}
+
+void MediaEngine::AdoptNextAudio() {
+    std::swap(m_trackAudio, m_nextAudio);
+    m_nextAudio.held->Reset();
+    m_nextAudio.armed = false;
+    m_nextAudio.epoch = m_trackAudio.epoch;
+    m_ending = TrackEnding();
+}
+
+uint64_t MediaEngine::CommitSplicedItem() {
+    const int64_t splice = m_spliceFrame.exchange(kNoSplice);
+    if (splice == kNoSplice) {
+        return 0;
+    }
+
+    // Not heard yet: output positions and the clock restart at the spliced track's first frame
+    uint64_t offset = 0;
+    if (splice >= 0) {
+        offset = static_cast<uint64_t>(splice);
+        const uint64_t played = RebaseAudioOutput(offset);
+        const uint64_t sampleRate = static_cast<uint64_t>(m_audioSampleRate.load(std::memory_order_relaxed));
+        m_clock.SetTime(static_cast<int64_t>(played * 1000000 / sampleRate));
+    }
+    SwapInSplicedItem();
+    return offset;
+}
+
+void MediaEngine::CommitPendingSplice() {
+    if (m_spliceFrame.load() == kNoSplice) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_metadataMutex);
+    std::lock_guard<std::mutex> nextLock(m_nextMutex);
+    CommitSplicedItem();
+}
+
+void MediaEngine::CommitHeardSplice() {
+    if (m_spliceFrame.load(std::memory_order_relaxed) != kSpliceHeard) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_metadataMutex);
+    std::lock_guard<std::mutex> nextLock(m_nextMutex);
+    int64_t heard = kSpliceHeard;
+    if (!m_spliceFrame.compare_exchange_strong(heard, kNoSplice)) {
+        return;
+    }
+    SwapInSplicedItem();
+
+    // The output thread only nudged a running clock; anchor it even if paused
+    const uint64_t sampleRate = static_cast<uint64_t>(m_audioSampleRate.load(std::memory_order_relaxed));
+    m_clock.SetTime(m_audioBaseUs.load(std::memory_order_relaxed) +
+                    static_cast<int64_t>(m_audioFramesPlayed.load(std::memory_order_relaxed) * 1000000 / sampleRate));
+}
+
+void MediaEngine::SwapInSplicedItem() {
+    if (!m_spliced.ready) {
+        return;
+    }
+
+    std::swap(m_metadata, m_spliced.media.meta);
+    std::swap(m_seekIndex, m_spliced.media.seekIndex);
+    std::swap(m_mediaPath, m_spliced.path);
+    m_seekIndexOrigin = m_spliced.media.seekIndexOrigin;
+    m_seekIndexBuildUs = m_spliced.media.seekIndexBuildUs;
+    m_duration.store(m_spliced.duration);
+    m_loadedDelay.store(m_spliced.delayFrames);
+    m_loadedPadding.store(m_spliced.paddingFrames);
+    m_spliced.ready = false;
+}
+
+uint64_t MediaEngine::RebaseAudioOutput(uint64_t offset) {
+    const uint64_t played = m_audioFramesPlayed.load();
+    m_audioBaseUs.store(0, std::memory_order_relaxed);
+    m_audioFramesPlayed.fetch_sub(std::min(offset, played), std::memory_order_relaxed);
+    m_audioFramesQueued.fetch_sub(std::min(offset, m_audioFramesQueued.load()), std::memory_order_relaxed);
+    return played > offset ? played - offset : 0;
+}
+
+size_t MediaEngine::WriteAudioOutput(const float* samples, size_t frames) {
+    const size_t written = m_audioRing->Write(samples, frames);
+    m_audioFramesQueued.fetch_add(written, std::memory_order_relaxed);
+
+    // Only an idle delivery thread needs a wake-up; the mutex makes sure it is already waiting
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (written > 0 && m_audioDeliveryWaiting.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(m_audioDeliveryMutex);
+        m_audioDeliveryCondition.notify_one();
+    }
+    return written;
 }
 
-std::string MediaEngine::DetectFormatFromMagicBytes(const std::string& path) const {
-    std::ifstream file(path, std::ios::binary);
-    if (!file.is_open()) {
-        return "";
+void MediaEngine::DrainHeldAudio(size_t keepFrames) {
+    AudioRingBuffer& held = *m_trackAudio.held;
+    float* chunk = m_spliceScratch.data();
+    for (;;) {
+        const size_t queued = held.AvailableToRead();
+        const size_t frames = std::min({ queued > keepFrames ? queued - keepFrames : 0,
+                                         m_audioRing->AvailableToWrite(), kSpliceChunkFrames });
+        if (frames == 0) {
+            return;
+        }
+        held.Read(chunk, frames);
+        WriteAudioOutput(chunk, frames);
     }
+}
 
-    std::vector<uint8_t> buffer(12);
-    file.read(reinterpret_cast<char*>(buffer.data()), 12);
-    file.close();
+void MediaEngine::StartPresentation() {
+    if (m_presentationActive.exchange(true)) {
+        return;
+    }
+    m_presentationThread = std::make_unique<std::thread>(&MediaEngine::PresentationLoop, this);
+}
 
-    // Check for common formats by magic bytes
-    if (buffer.size() >= 4 && buffer[0] == 0x00 && buffer[1] == 0x00 && buffer[2] == 0x01 && buffer[3] == 0xB6) {
-        return "mpeg-ts";
+void MediaEngine::StopPresentation() {
+    if (!m_presentationActive.exchange(false)) {
+        return;
     }
-    if (buffer.size() >= 4 && buffer[0] == 0x47 && buffer[1] == 0x40 && buffer[2] == 0x00 && buffer[3] == 0x00) {
-        return "mpeg2-ts";
+
+    m_presentationCondition.notify_all();
+    if (m_presentationThread && m_presentationThread->joinable()) {
+        m_presentationThread->join();
     }
-    if (buffer.size() >= 4 && buffer[0] == 0x1A && buffer[1] == 0x45 && buffer[2] == 0xDF && buffer[3] == 0xA3) {
-        return "matroska";
+    m_presentationThread.reset();
+}
+
+void MediaEngine::PresentationLoop() {
+    while (m_presentationActive.load()) {
+        // Output pulled into a spliced track while the decoder may be idle
+        CommitHeardSplice();
+
+        VideoFrameHandle frame;
+        if (m_presentation.Next(m_clock.NowUs(), frame)) {
+            std::lock_guard<std::mutex> lock(m_videoCallbackMutex);
+            if (m_videoFrameCallback) {
+                system::MetricTimer timer(*m_metrics.videoCallback);
+                m_videoFrameCallback(frame);
+            } else if (m_videoCallback) {
+                system::MetricTimer timer(*m_metrics.videoCallback);
+                m_videoCallback(frame.Plane(0), frame.Width(), frame.Height(), frame.Stride(0));
+            }
+            continue;
+        }
+
+        // Sleep until the next frame is due; Push() wakes us for an earlier one
+        int64_t waitUs = m_presentation.TimeUntilNextUs(m_clock.NowUs());
+        if (waitUs < 0 || waitUs > kPresentationPollUs) {
+            waitUs = kPresentationPollUs;
+        }
+        if (waitUs == 0) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_presentationMutex);
+        m_presentationCondition.wait_for(lock, std::chrono::microseconds(waitUs), [this] {
+            return !m_presentationActive.load();
+        });
+    }
+}
+
+bool MediaEngine::LoadCachedMedia(const std::string& path, ParsedMedia& media) const {
+    if (!m_metadataStore.LookupMetadata(path, media.meta)) {
+        return false;
+    }
+
+    // Only these containers have a seek index; without a cached one the file must be parsed anyway
+    static const char* const kIndexedFormats[] = { "matroska", "webm", "mp4", "mov", "m4a" };
+    const std::string format = media.meta.value("format", "");
+    const bool indexed = std::any_of(std::begin(kIndexedFormats), std::end(kIndexedFormats),
+                                     [&format](const char* f) { return format == f; });
+    if (!indexed) {
+        return true;
     }
-    if (buffer.size() >= 4 && buffer[0] == 0x52 && buffer[1] == 0x49 && buffer[2] == 0x46 && buffer[3] == 0x46) {
-        return "riff";
+
+    const auto started = std::chrono::steady_clock::now();
+    SeekIndex cached;
+    if (!m_seekIndexCache.Load(path, cached)) {
+        media = ParsedMedia();
+        return false;
     }
-    if (buffer.size() >= 4 && buffer[0] == 0xFF && buffer[1] == 0xFB && buffer[2] == 0x00 && buffer[3] == 0x00) {
-        return "mp3";
+    media.seekIndex = std::make_shared<const SeekIndex>(std::move(cached));
+    media.seekIndexOrigin = SeekIndexOrigin::Cache;
+    media.seekIndexBuildUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - started).count();
+    return true;
+}
+
+bool MediaEngine::ParseStreams(const std::string& path, ParsedMedia& media, const CancellationToken& token, bool withSeekIndex) const {
+    KNOUX_TRACE_SPAN(kEngineLog, "Parse");
+    system::MetricTimer timer(*m_metrics.parse);
+    system::MappedFile file;
+    if (!file.Open(path) || token.IsCancelled()) {
+        return false;
     }
-    if (buffer.size() >= 4 && buffer[0] == 0x49 && buffer[1] == 0x44 && buffer[2] == 0x33 && buffer[3] == 0x03) {
-        return "mp3-id3v2";
+
+    // Probe the mapped header in place: no second open or read of the file
+    const ProbeResult probe = FormatProbeRegistry::GetInstance()->Probe(file.Data(), file.Size());
+
+    if (token.IsCancelled()) {
+        return false;
     }
-    if (buffer.size() >= 4 && buffer[0] == 0x66 && buffer[1] == 0x4C && buffer[2] == 0x61 && buffer[3] == 0x63) {
-        return "flac";
+
+    ContainerInfo info;
+    if (probe.container != ContainerFormat::Unknown &&
+        ContainerParser::Parse(probe.container, file.Data(), file.Size(), info)) {
+        media.meta = BuildMetadata(info);
+        if (withSeekIndex) {
+            LoadSeekIndex(path, info, file.Data(), file.Size(), media, token);
+        }
+    } else {
+        // Not a container we can walk (e.g. raw MP3): report the format only
+        media.meta["format"] = probe.format;
+        media.meta["duration"] = 0.0;
+        media.meta["streams"] = nlohmann::json::array();
     }
-    if (buffer.size() >= 4 && buffer[0] == 0x52 && buffer[1] == 0x49 && buffer[2] == 0x46 && buffer[3] == 0x46) {
-        return "wav";
+
+    return !token.IsCancelled();
+}
+
+void MediaEngine::LoadSeekIndex(const std::string& path, const ContainerInfo& info, const uint8_t* data, size_t size,
+                                ParsedMedia& media, const CancellationToken& token) const {
+    KNOUX_TRACE_SPAN(kEngineLog, "SeekIndex");
+    system::MetricTimer timer(*m_metrics.seekIndex);
+    const auto started = std::chrono::steady_clock::now();
+
+    SeekIndex cached;
+    std::vector<SeekPoint> points;
+    SeekIndexOrigin origin = SeekIndexOrigin::None;
+    if (m_seekIndexCache.Load(path, cached)) {
+        media.seekIndex = std::make_shared<const SeekIndex>(std::move(cached));
+        media.seekIndexOrigin = SeekIndexOrigin::Cache;
+    } else if (ContainerParser::BuildSeekIndex(info, data, size, points, origin,
+                                               [&token] { return token.IsCancelled(); })) {
+        auto index = std::make_shared<const SeekIndex>(std::move(points));
+        // Persist container indices too, so a Load answered by the metadata store skips the parse
+        m_seekIndexCache.Store(path, *index);
+        media.seekIndex = std::move(index);
+        media.seekIndexOrigin = origin;
     }
-    if (buffer.size() >= 4 && buffer[0] == 0x4D && buffer[1] == 0x54 && buffer[2] == 0x68 && buffer[3] == 0x64) {
-        return "midi";
+
+    media.seekIndexBuildUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - started).count();
+}
+
+bool MediaEngine::ValidateFilePath(const std::string& path) const {
+    if (path.empty()) {
+        return false;
     }
 
-    return "unknown";
+    try {
+        const std::filesystem::path p(path);
+        return std::filesystem::exists(p) && std::filesystem::is_regular_file(p);
+    } catch (...) {
+        return false;
+    }
 }
 
 } // namespace knoux::core::engine
\ No newline at end of file
@@ -4,10 +4,26 @@
 #include <memory>
 #include <thread>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
 #include <future>
 #include <functional>
+#include <vector>
 #include <filesystem>
 #include <nlohmann/json.hpp>
+#include "async_command.h"
+#include "audio_ring_buffer.h"
+#include "frame_pool.h"
+#include "metadata_store.h"
+#include "playback_clock.h"
+#include "presentation_scheduler.h"
+#include "seek_index.h"
+#include "shared_audio_ring.h"
+#include "spectrum_analyzer.h"
+#include "task_scheduler.h"
+#include "waveform.h"
+#include "core/system/byte_source.h"
+#include "core/system/metrics.h"
 
 namespace knoux::core::engine {
 
@@ -24,15 +40,50 @@ namespace knoux::core::engine {
  * - Buffer management and preloading
  * - Real-time metadata extraction
  *
- * Designed as a single-threaded event loop with offloaded tasks to worker threads.
+ * Control calls return immediately; parsing, decoding and background work
+ * run on a priority work-stealing TaskScheduler.
  */
 class MediaEngine {
 public:
+    /**
+     * @struct SeekStats
+     * @brief Seek index shape and seek latency (Seek() call to completion)
+     */
+    struct SeekStats {
+        SeekIndexOrigin indexOrigin = SeekIndexOrigin::None;
+        size_t indexPoints = 0;
+        size_t indexBytes = 0;          // Encoded size in memory
+        int64_t indexBuildUs = 0;       // Time spent producing the index during Load()
+        uint64_t seeks = 0;             // Completed seeks
+        uint64_t indexedSeeks = 0;      // Completed seeks resolved through the index
+        int64_t lastLatencyUs = 0;
+        int64_t maxLatencyUs = 0;
+        int64_t averageLatencyUs = 0;
+        int64_t lastKeyframeUs = 0;     // Keyframe the last seek resumes decoding from
+        uint64_t lastByteOffset = 0;    // File offset the last seek resumes demuxing at
+    };
+
+    /**
+     * @struct GaplessStats
+     * @brief Track transitions and the next item's preparation cost
+     */
+    struct GaplessStats {
+        uint64_t transitions = 0;        // Next items spliced in by FinishAudioTrack()
+        uint64_t trimmedFrames = 0;      // Encoder delay and padding frames dropped
+        size_t lastCrossfadeFrames = 0;  // Overlap of the last transition, 0 for a plain splice
+        int64_t prepareUs = 0;           // Parse and open time of the last PrepareNext()
+    };
+
     /**
      * @brief Singleton instance accessor
      */
     static std::shared_ptr<MediaEngine> GetInstance();
 
+    /**
+     * @brief Stops background threads, draining queued tasks
+     */
+    ~MediaEngine();
+
     /**
      * @brief Initializes the media engine with required dependencies
      * @return true if initialization succeeded, false otherwise
@@ -47,9 +98,10 @@ public:
     /**
      * @brief Loads a media file from disk or URL
      * @param path Absolute path or URI of the media file
-     * @return true if load request was accepted, false otherwise
+     * @return Completion token; resolves Superseded if a later Load() replaces
+     *         this one before it finishes, in which case its parse is abandoned
      */
-    bool Load(const std::string& path);
+    CommandFuture Load(const std::string& path);
 
     /**
      * @brief Starts playback of loaded media
@@ -72,13 +124,93 @@ public:
     /**
      * @brief Seeks to a specific time in seconds
      * @param time Target position in seconds
-     * @return true if seek successful, false otherwise
+     * @return Completion token; a burst of seeks (e.g. seek-bar dragging)
+     *         collapses to the latest target and the others resolve Superseded.
+     *         Resolves Failed when no media is loaded.
+     *
+     * The target is resolved to the preceding keyframe with an O(log n)
+     * lookup in the seek index built (or loaded from the sidecar cache)
+     * by Load(); without an index the byte offset is estimated from the
+     * average bitrate. The media reader starts loading the keyframe's
+     * bytes before the seek completes, so the first demux read after the
+     * seek finds them in flight or already in memory.
+     */
+    CommandFuture Seek(double time);
+
+    /**
+     * @brief Returns seek index details and seek latency statistics
+     */
+    SeekStats GetSeekStats() const;
+
+    /**
+     * @brief Reads bytes of the loaded media through the readahead layer
+     * @param offset File offset
+     * @param buffer Destination
+     * @param length Bytes wanted
+     * @return Bytes read (short only at end of file), or -1 if nothing is loaded or the read failed
+     *
+     * Used by the demuxer. Sequential reads are served from double-buffered
+     * windows sized to about a second of media at the stream bitrate, with
+     * the next window loading in the background.
+     */
+    int64_t ReadMedia(uint64_t offset, uint8_t* buffer, size_t length);
+
+    /**
+     * @brief Returns read latency, hit rate and bytes in flight of the media reader
      */
-    bool Seek(double time);
+    system::ByteSource::Stats GetIoStats() const;
+
+    /**
+     * @brief Prepares the track that follows the loaded one, for a gapless transition
+     * @param path Media file to play next
+     * @return Completion token; resolves Superseded if a later PrepareNext()
+     *         or Load() replaces it before it finishes
+     *
+     * Parses the file (or reads it from the metadata store), opens its
+     * reader and starts loading its first keyframe on the background pool
+     * while the current track plays. The decoder then demuxes it through
+     * ReadNextMedia(), pre-decodes its start into PushNextAudioFrames() and
+     * calls FinishAudioTrack() at the end of the current track, which
+     * splices the two with no allocation or file access. Only an item with
+     * the current sample rate and channel count is spliced; anything else
+     * needs a Load().
+     */
+    CommandFuture PrepareNext(const std::string& path);
+
+    /**
+     * @brief Returns true once a PrepareNext() item is ready to pre-decode
+     */
+    bool HasNextItem() const;
+
+    /**
+     * @brief Reads bytes of the next item, like ReadMedia()
+     * @return Bytes read, or -1 if no next item is ready or the read failed
+     */
+    int64_t ReadNextMedia(uint64_t offset, uint8_t* buffer, size_t length);
+
+    /**
+     * @brief Returns transition counters and the next item's preparation time
+     */
+    GaplessStats GetGaplessStats() const;
+
+    /**
+     * @brief Returns the seek bar waveform of a media file
+     * @param path Media file
+     * @param source Decoder for the file's audio; only pulled on a cache miss
+     * @return The waveform, or nullptr if the file cannot be identified
+     *
+     * A cached waveform comes back complete, mapped from its cache file. On
+     * a miss a background task decodes the audio once through source and
+     * builds the peak pyramid, which is queryable while it fills (see
+     * Waveform::Query) and stored in the cache when done. Requesting another
+     * file abandons an unfinished build; requesting the same file again
+     * returns the build in progress.
+     */
+    std::shared_ptr<Waveform> RequestWaveform(const std::string& path, WaveformSource source);
 
     /**
      * @brief Returns current playback position in seconds
-     * @return Current time in seconds
+     * @return Current time in seconds, read from the master clock (sub-millisecond resolution)
      */
     double GetCurrentTime() const;
 
@@ -106,18 +238,254 @@ public:
      */
     nlohmann::json GetMetadata() const;
 
+    /**
+     * @brief Returns the hot metadata fields of a file without loading it
+     * @param path Media file
+     * @param summary Receives format, duration, codecs and geometry
+     * @return false if the file cannot be read or parsed
+     *
+     * Meant for library scans: a current record in the metadata store is
+     * answered from the memory-mapped store without decoding any JSON;
+     * otherwise the header is parsed once and the result stored.
+     */
+    bool GetMediaSummary(const std::string& path, MetadataSummary& summary);
+
+    /**
+     * @brief Records the measured loudness of a file in its metadata
+     * @param path Media file
+     * @param integratedLufs Integrated loudness (EBU R128) of the whole track
+     * @param truePeakDb True peak in dBTP
+     * @return false if the file cannot be parsed or the store is unavailable
+     *
+     * Stored as metadata["loudness"] = { "integrated", "truePeak" }, so the
+     * desktop DSP can normalize later playback with a constant gain instead
+     * of measuring the track again. A changed file drops the value with the
+     * rest of its stale record.
+     */
+    bool SetTrackLoudness(const std::string& path, double integratedLufs, double truePeakDb);
+
+    /**
+     * @brief Returns loudness recorded by SetTrackLoudness()
+     * @return false if none is stored for the current version of the file
+     */
+    bool GetTrackLoudness(const std::string& path, double& integratedLufs, double& truePeakDb) const;
+
+    /**
+     * @brief Moves the persistent metadata store (default <temp>/knoux/metadata.kmdb)
+     * @param path Store file
+     * @return false if the store cannot be opened; metadata is then not cached
+     */
+    bool OpenMetadataStore(const std::string& path);
+
+    /**
+     * @brief Returns metadata store size and hit/miss/stale counters
+     */
+    MetadataStore::Stats GetMetadataStoreStats() const;
+
     /**
      * @brief Sets the output video renderer callback
      * @param callback Function to be called when new frame is ready
+     *
+     * Receives the first plane, width, height and stride. The pointer is only
+     * valid during the call; prefer the handle overload to avoid copying.
      */
     void SetVideoFrameCallback(std::function<void(const uint8_t*, int, int, int)> callback);
 
+    /**
+     * @brief Sets the output video renderer callback using pooled frame handles
+     * @param callback Function to be called when new frame is ready
+     *
+     * The renderer may copy the handle to keep the frame past the callback;
+     * the buffer returns to the engine's pool when the last copy is released.
+     * Takes precedence over the raw-pointer callback when both are set.
+     */
+    void SetVideoFrameCallback(std::function<void(const VideoFrameHandle&)> callback);
+
+    /**
+     * @brief Preallocates video frame buffers for the current stream format
+     * @param format Decoded frame geometry
+     * @param frameCount Buffers to allocate up front
+     * @return true if the pool was configured
+     */
+    bool ConfigureVideoFramePool(const FrameFormat& format, size_t frameCount);
+
+    /**
+     * @brief Decoder side: checks out a frame buffer to decode into
+     * @return Frame handle, or an empty handle if every buffer is in use
+     */
+    VideoFrameHandle AcquireVideoFrame();
+
+    /**
+     * @brief Decoder side: queues a decoded frame for presentation at its Pts()
+     * @param frame Frame obtained from AcquireVideoFrame()
+     * @return false if the presentation queue is full; retry after a frame is shown
+     *
+     * While playing, the presentation thread hands the frame to the installed
+     * callback once the master clock reaches its timestamp, dropping frames
+     * that are already overtaken by a later one.
+     */
+    bool DeliverVideoFrame(const VideoFrameHandle& frame);
+
+    /**
+     * @brief Returns frame pool hit/miss counters
+     */
+    FramePool::Stats GetVideoFramePoolStats() const;
+
     /**
      * @brief Sets the output audio buffer callback
      * @param callback Function to be called when new audio chunk is ready
+     *
+     * The callback receives interleaved samples and the sample count. It runs
+     * on a dedicated delivery thread that drains the audio ring, so a slow
+     * consumer never stalls the decoder. Passing nullptr stops the delivery
+     * thread and hands the ring back to PullAudioFrames().
+     *
+     * The callback runs without engine locks held and may call Stop(), Seek()
+     * or Load(); it must not replace itself or call Shutdown(), which wait for
+     * the delivery thread. Once this returns the previous callback is no
+     * longer running.
      */
     void SetAudioBufferCallback(std::function<void(const float*, size_t)> callback);
 
+    /**
+     * @brief Routes audio output into a named shared-memory ring for another process
+     * @param name Shared memory name (see SharedMemory::Create)
+     * @param capacityFrames Minimum shared ring capacity in frames
+     * @return false if the shared memory cannot be created
+     *
+     * The delivery thread moves decoded audio into a SharedAudioRing instead
+     * of the buffer callback (which is ignored while this is open), and the
+     * master clock follows what the other process has consumed. The ring
+     * announces the current channel count and sample rate; reopen it after
+     * either changes. Reopening replaces the previous ring.
+     */
+    bool OpenSharedAudioOutput(const std::string& name, size_t capacityFrames);
+
+    /**
+     * @brief Removes the shared audio ring; the buffer callback resumes if one is set
+     */
+    void CloseSharedAudioOutput();
+
+    /**
+     * @brief Returns shared ring fill, consumer underruns and write-to-read latency
+     */
+    SharedAudioRing::Stats GetSharedAudioStats() const;
+
+    /**
+     * @brief Starts analyzing delivered audio into a band spectrum for visualisation
+     * @param sharedName If not empty, frames are also published to a shared-memory
+     *        SpectrumSnapshot of this name for the UI process
+     * @return false if the shared memory cannot be created
+     *
+     * The analyzer taps the audio delivery thread (buffer callback or shared
+     * ring output) and publishes fixed-size SpectrumFrames at 60 Hz of audio
+     * time; consumers poll them and never see PCM.
+     */
+    bool EnableSpectrumAnalyzer(const std::string& sharedName = std::string());
+
+    /**
+     * @brief Stops analysis and removes the shared snapshot; the last frame stays readable
+     */
+    void DisableSpectrumAnalyzer();
+
+    /**
+     * @brief Copies the latest spectrum frame; lock-free, safe from any thread
+     * @return false if the analyzer was never enabled
+     */
+    bool GetSpectrumFrame(SpectrumFrame& frame) const;
+
+    /**
+     * @brief Returns analysis count and per-frame cost (window, FFT and bands)
+     */
+    SpectrumAnalyzer::Stats GetSpectrumStats() const;
+
+    /**
+     * @brief Resizes the decoder-to-output audio ring, discarding buffered audio
+     * @param capacityFrames Minimum ring capacity in frames
+     * @param channels Interleaved channel count
+     * @return false if playback is active
+     *
+     * Safe while a track is loaded but paused: decoder pushes and output
+     * pulls are held off (pulls play silence) while the rings are replaced.
+     */
+    bool ConfigureAudioRing(size_t capacityFrames, size_t channels);
+
+    // Longest crossfade ConfigureCrossfade() accepts (~10.9 s at 48 kHz)
+    static constexpr size_t kMaxCrossfadeFrames = size_t(1) << 19;
+
+    /**
+     * @brief Sets the equal-power crossfade between gapless tracks
+     * @param frames Overlap in frames; 0 splices the tracks back to back
+     * @return false if playback is active or frames exceeds kMaxCrossfadeFrames
+     *
+     * Discards held-back and pre-decoded audio; like ConfigureAudioRing(),
+     * safe while a track is loaded but paused.
+     */
+    bool ConfigureCrossfade(size_t frames);
+
+    /**
+     * @brief Decoder side: queues decoded interleaved frames for output
+     * @param samples Interleaved samples (frames * channels floats)
+     * @param frames Number of frames offered
+     * @return Frames accepted; the remainder was dropped and counted as an overrun
+     *
+     * The track's encoder delay is dropped here (and counted as accepted).
+     * Its last encoder padding plus crossfade frames are held back until
+     * FinishAudioTrack() knows where the track ends.
+     */
+    size_t PushAudioFrames(const float* samples, size_t frames);
+
+    /**
+     * @brief Decoder side: queues the pre-decoded start of the next item
+     * @param samples Interleaved samples (frames * channels floats)
+     * @param frames Number of frames offered
+     * @return Frames accepted; 0 if no spliceable next item is ready. Frames
+     *         not accepted go to PushAudioFrames() after FinishAudioTrack()
+     *
+     * Call from the decoder thread while the current track is still being
+     * pushed; a new PrepareNext() discards what was queued here.
+     */
+    size_t PushNextAudioFrames(const float* samples, size_t frames);
+
+    /**
+     * @brief Decoder side: ends the current track after its last PushAudioFrames()
+     * @return false while the output ring has no room for the held-back
+     *         frames; call again once it drains
+     *
+     * Drops the track's encoder padding and, if a next item was pre-decoded,
+     * crossfades into it and makes it the current track: ReadMedia() and
+     * PushAudioFrames() continue with it. The clock follows when its first
+     * frame is played; metadata and duration right after, on the decoder or
+     * presentation thread. Allocation- and I/O-free.
+     */
+    bool FinishAudioTrack();
+
+    /**
+     * @brief Audio output side: wait-free pull of interleaved frames
+     * @param out Destination for frames * channels floats
+     * @param frames Number of frames requested
+     * @return Frames delivered; any shortfall is zero-filled and counted as an underrun
+     *
+     * Only valid while no audio callback is installed (the ring has one consumer).
+     * Takes no lock, also when the output reaches a gapless transition.
+     */
+    size_t PullAudioFrames(float* out, size_t frames);
+
+    /**
+     * @brief Returns audio ring fill and underrun/overrun counters
+     */
+    AudioRingBuffer::Stats GetAudioRingStats() const;
+
+    /**
+     * @brief Returns master clock source and drift correction counters
+     */
+    PlaybackClock::Stats GetClockStats() const;
+
+    /**
+     * @brief Returns A/V offset, late, dropped and repeated frame counters
+     */
+    PresentationScheduler::Stats GetPresentationStats() const;
+
     /**
      * @brief Enables/disables hardware acceleration
      * @param enable True to enable GPU decoding, false to use software
@@ -130,6 +498,42 @@ public:
      */
     bool IsHardwareAccelerated() const;
 
+    /**
+     * @brief Queues work on the engine's task scheduler
+     * @param priority Scheduling class (Interactive > Load > Background)
+     * @param task Work to run
+     * @param group Optional group to wait on with WaitForTasks()
+     * @return false if the engine has been shut down
+     */
+    bool SubmitTask(TaskPriority priority, std::function<void()> task, const std::shared_ptr<TaskGroup>& group = nullptr);
+
+    /**
+     * @brief Blocks until every task of a group has finished
+     * @param group Group passed to SubmitTask()
+     */
+    void WaitForTasks(const std::shared_ptr<TaskGroup>& group);
+
+    /**
+     * @brief Returns queue depth, steal and per-priority latency statistics
+     */
+    TaskScheduler::Stats GetSchedulerStats() const;
+
+    /**
+     * @brief Snapshot of every engine metric, for a stats overlay or fleet telemetry
+     *
+     * Histograms (recorded as things happen): engine.load (Load() call to
+     * commit), engine.parse, engine.seek_index, engine.seek (Seek() call to
+     * completion), video.decode (AcquireVideoFrame() to DeliverVideoFrame()),
+     * callback.video, callback.audio and the scheduler's wait/run times.
+     * Counters: loads, failures, metadata cache hits, seeks, frames, plus
+     * totals sampled by this call (scheduler steals, frames presented,
+     * dropped and late, audio ring overruns and underruns). Gauges (sampled
+     * by this call, max equal to value): scheduler queue depths, video
+     * queue, A/V offset, frames outstanding, audio ring fill. The registry
+     * is not modified. MetricsSnapshot::ToJson() gives the wire form.
+     */
+    system::MetricsSnapshot GetStats() const;
+
 private:
     // Private constructor for singleton pattern
     MediaEngine();
@@ -143,54 +547,348 @@ private:
     // Playback state tracking
     std::atomic<bool> m_isPlaying{ false };
 
-    // Current playback time
-    std::atomic<double> m_currentTime{ 0.0 };
+    // Master clock; audio-driven when the media has an audio stream
+    PlaybackClock m_clock;
 
     // Total media duration
     std::atomic<double> m_duration{ 0.0 };
 
-    // Path to currently loaded media
+    // Path to currently loaded media (guarded by m_metadataMutex)
     std::string m_mediaPath;
 
     // Metadata container
     mutable std::mutex m_metadataMutex;
     nlohmann::json m_metadata;
 
-    // Video frame callback
+    // Keyframe index of the loaded media, guarded by m_metadataMutex
+    std::shared_ptr<const SeekIndex> m_seekIndex;
+    SeekIndexOrigin m_seekIndexOrigin = SeekIndexOrigin::None;
+    int64_t m_seekIndexBuildUs = 0;
+
+    // Reader for the loaded media's bytes, guarded by m_metadataMutex;
+    // readers take a reference so a new Load() never closes it under them
+    std::shared_ptr<system::ByteSource> m_source;
+
+    // Sidecar store for seek indices
+    SeekIndexCache m_seekIndexCache;
+
+    // Waveform of the last RequestWaveform() file and its identity, guarded by m_waveformMutex
+    WaveformCache m_waveformCache;
+    std::shared_ptr<Waveform> m_waveform;
+    system::FileIdentity m_waveformIdentity;
+    std::mutex m_waveformMutex;
+
+    // Frames pulled from a WaveformSource per read
+    static constexpr size_t kWaveformReadFrames = 8192;
+
+    // Persistent metadata cache keyed by path, size and mtime
+    MetadataStore m_metadataStore;
+
+    // Instrumentation in the process MetricsRegistry, resolved in the constructor
+    struct Metrics {
+        system::LatencyHistogram* load = nullptr;
+        system::LatencyHistogram* parse = nullptr;
+        system::LatencyHistogram* seekIndex = nullptr;
+        system::LatencyHistogram* seek = nullptr;
+        system::LatencyHistogram* decode = nullptr;
+        system::LatencyHistogram* videoCallback = nullptr;
+        system::LatencyHistogram* audioCallback = nullptr;
+        system::MetricCounter* loads = nullptr;
+        system::MetricCounter* loadFailures = nullptr;
+        system::MetricCounter* metadataHits = nullptr;
+        system::MetricCounter* seeks = nullptr;
+        system::MetricCounter* framesDelivered = nullptr;
+        system::MetricCounter* framesRejected = nullptr;
+        system::MetricCounter* audioFramesDelivered = nullptr;
+    };
+    std::shared_ptr<system::MetricsRegistry> m_metricsRegistry;
+    Metrics m_metrics;
+
+    // Seek latency accounting
+    mutable std::mutex m_seekStatsMutex;
+    SeekStats m_seekStats;
+
+    // Video frame callbacks
     std::function<void(const uint8_t*, int, int, int)> m_videoCallback;
+    std::function<void(const VideoFrameHandle&)> m_videoFrameCallback;
+    std::mutex m_videoCallbackMutex;
 
-    // Audio buffer callback
-    std::function<void(const float*, size_t)> m_audioCallback;
+    // Decoded frame buffers shared with the renderer
+    std::shared_ptr<FramePool> m_framePool;
 
-    // Hardware acceleration toggle
-    std::atomic<bool> m_useHardwareAccel{ true };
+    // Upper bound on pooled frames (decode-ahead plus frames held by the renderer)
+    static constexpr size_t kMaxPooledFrames = 16;
+
+    // Decoded frames waiting for their presentation time
+    PresentationScheduler m_presentation{ kPresentationQueueFrames };
+
+    // Thread pacing m_presentation against m_clock while playing
+    std::unique_ptr<std::thread> m_presentationThread;
+    std::condition_variable m_presentationCondition;
+    std::mutex m_presentationMutex;
+    std::atomic<bool> m_presentationActive{ false };
+
+    // Decode-ahead depth, leaving the rest of the pool to the renderer
+    static constexpr size_t kPresentationQueueFrames = 8;
+    static_assert(kPresentationQueueFrames <= kMaxPooledFrames, "the presentation ring cannot outgrow the frame pool");
+
+    // Longest the presentation thread sleeps, so repeats are still accounted
+    static constexpr int64_t kPresentationPollUs = 10000;
+
+    // Audio buffer callback, only touched by the setter and the delivery thread. The delivery
+    // thread copies it under m_audioCallbackMutex and calls it outside, flagged by m_audioCallbackRunning
+    std::shared_ptr<const std::function<void(const float*, size_t)>> m_audioCallback;
+    bool m_audioCallbackRunning = false;
+    std::condition_variable m_audioCallbackIdle;
+    mutable std::mutex m_audioCallbackMutex;
+
+    // Shared-memory output; replaces m_audioCallback while set (guarded by m_sharedAudioMutex)
+    // Shared so the delivery thread can wait on its consumer outside the lock
+    std::shared_ptr<SharedAudioRing> m_sharedAudio;
+
+    // Frames the shared ring held at the last flush; their consumption is not played time
+    size_t m_sharedStaleFrames = 0;
 
-    // Worker thread for background processing
-    std::unique_ptr<std::thread> m_workerThread;
+    // Guards m_sharedAudio and m_sharedStaleFrames. Taken last: a flush reaches it under m_audioGate
+    // without m_audioCallbackMutex
+    mutable std::mutex m_sharedAudioMutex;
 
-    // Task queue for async operations
-    std::queue<std::function<void()>> m_taskQueue;
+    // Spectrum tap on the delivery thread (guarded by m_audioCallbackMutex). Created on first
+    // enable and kept, so m_spectrumReader can be read without the lock
+    std::unique_ptr<SpectrumAnalyzer> m_spectrum;
+    std::atomic<const SpectrumAnalyzer*> m_spectrumReader{ nullptr };
+    bool m_spectrumEnabled = false;
 
-    // Condition variable for task scheduling
-    std::condition_variable m_taskCondition;
+    // Decoder -> output hand-off (single producer, single consumer). Replaced only
+    // under m_audioGate and m_audioCallbackMutex; readers outside the gate take the latter
+    std::unique_ptr<AudioRingBuffer> m_audioRing;
 
-    // Mutex for task queue access
-    std::mutex m_taskMutex;
+    // Holds decoder pushes and output reads off m_audioRing while it is flushed or replaced.
+    // Taken before m_metadataMutex, m_nextMutex and m_audioCallbackMutex
+    AudioRingGate m_audioGate;
 
-    // Flag to signal shutdown
-    std::atomic<bool> m_shouldStop{ false };
+    // m_audioRing's channel count, for readers that must not wait for the gate
+    std::atomic<size_t> m_audioChannels{ kDefaultAudioChannels };
 
-    // Internal worker loop
-    void WorkerLoop();
+    // Thread draining m_audioRing into m_audioCallback
+    std::unique_ptr<std::thread> m_audioDeliveryThread;
+    std::condition_variable m_audioDeliveryCondition;
+    std::mutex m_audioDeliveryMutex;
+    std::atomic<bool> m_audioDeliveryActive{ false };
+    // Set while the delivery thread sleeps with nothing queued; writers only notify then
+    std::atomic<bool> m_audioDeliveryWaiting{ false };
 
-    // Helper: Extracts stream information from file
-    bool ParseStreams(const std::string& path);
+    // Default ring size: ~340 ms of stereo at 48 kHz
+    static constexpr size_t kDefaultAudioRingFrames = 16384;
+    static constexpr size_t kDefaultAudioChannels = 2;
+
+    // Frames handed to the audio callback per invocation
+    static constexpr size_t kAudioDeliveryFrames = 1024;
+
+    // Longest wait for the shared ring's consumer; consumption itself wakes the delivery thread
+    static constexpr int kSharedAudioIdleWaitMs = 50;
+
+    // Audio output position: media time of the last seek plus frames consumed since
+    std::atomic<int64_t> m_audioBaseUs{ 0 };
+    std::atomic<uint64_t> m_audioFramesPlayed{ 0 };
+    std::atomic<int> m_audioSampleRate{ 48000 };
+
+    // Hardware acceleration toggle
+    std::atomic<bool> m_useHardwareAccel{ true };
+
+    // Worker pool for parsing, decoding and background work. Shutdown()
+    // detaches it while tasks may still submit, so the pointer is guarded
+    // by m_schedulerMutex and users work on a copy (see GetScheduler())
+    std::shared_ptr<TaskScheduler> m_scheduler;
+    mutable std::mutex m_schedulerMutex;
+
+    // Latest-wins command mailboxes; a new request aborts the stale one
+    std::unique_ptr<CommandChannel> m_loadCommands;
+    std::unique_ptr<CommandChannel> m_seekCommands;
+    std::unique_ptr<CommandChannel> m_waveformCommands;
+    std::unique_ptr<CommandChannel> m_nextCommands;
+
+    // Internal audio delivery loop
+    void AudioDeliveryLoop();
+
+    // Helper: Starts/stops the audio delivery thread
+    void StartAudioDelivery();
+    void StopAudioDelivery();
+
+    // Helper: One delivery step into m_sharedAudio; false if no shared ring is open
+    bool DeliverSharedAudio(float* chunk);
+
+    // Helper: Blocks the delivery thread until m_audioRing has frames or delivery stops
+    void WaitForQueuedAudio();
+
+    // Helper: Feeds delivered frames to the spectrum analyzer; caller holds m_audioCallbackMutex
+    void AnalyzeDeliveredAudio(const float* chunk, size_t frames);
+
+    // Helper: Advances the audio output position and feeds it to the master clock
+    void ReportAudioPlayed(size_t frames);
+
+    // Helper: Moves clock, audio position and presentation queue to a media time
+    void ResetTimeline(int64_t mediaUs);
+
+    // Helper: Drops queued output audio and resets the timeline, with decoder and output held off
+    void FlushAudioOutput(int64_t mediaUs);
+
+    // Helper: Empties m_audioRing and writes off what the shared ring still holds; caller holds m_audioGate
+    void DiscardQueuedAudio();
+
+    // Internal presentation loop
+    void PresentationLoop();
+
+    // Helper: Starts/stops the presentation thread
+    void StartPresentation();
+    void StopPresentation();
+
+    // Parsed file, handed from the load task to the commit step
+    struct ParsedMedia {
+        nlohmann::json meta;
+        std::shared_ptr<const SeekIndex> seekIndex;
+        SeekIndexOrigin seekIndexOrigin = SeekIndexOrigin::None;
+        int64_t seekIndexBuildUs = 0;
+    };
+
+    // Helper: Extracts stream information (and optionally the seek index), giving up once the token is cancelled
+    bool ParseStreams(const std::string& path, ParsedMedia& media, const CancellationToken& token, bool withSeekIndex = true) const;
+
+    // Helper: Fills media from the metadata store and seek index cache; false if a parse is still needed
+    bool LoadCachedMedia(const std::string& path, ParsedMedia& media) const;
+
+    // Helper: Loads the seek index from the sidecar cache or builds (and caches) it
+    void LoadSeekIndex(const std::string& path, const ContainerInfo& info, const uint8_t* data, size_t size,
+                       ParsedMedia& media, const CancellationToken& token) const;
+
+    // Next track, prepared by PrepareNext()
+    struct NextItem {
+        std::string path;
+        ParsedMedia media;
+        std::shared_ptr<system::ByteSource> source;
+        double duration = 0.0;
+        int sampleRate = 0;
+        size_t channels = 0;
+        uint64_t delayFrames = 0;
+        size_t paddingFrames = 0;
+        uint64_t epoch = 0;
+        bool ready = false;
+    };
+
+    // Prepared item, and the item spliced into the output but not yet heard.
+    // Guarded by m_nextMutex, which is taken after m_metadataMutex. Slots are
+    // swapped, never freed, during a transition
+    NextItem m_next;
+    NextItem m_spliced;
+    mutable std::mutex m_nextMutex;
+
+    // Bumped whenever m_next changes, so pre-decoded audio of a replaced item is dropped
+    std::atomic<uint64_t> m_nextEpoch{ 0 };
+
+    // Output frame (counted like m_audioFramesPlayed) where m_spliced starts, kNoSplice if
+    // none, or kSpliceHeard once the output reached it and only the item swap is still owed
+    std::atomic<int64_t> m_spliceFrame{ kNoSplice };
+    static constexpr int64_t kNoSplice = -1;
+    static constexpr int64_t kSpliceHeard = -2;
+
+    // Decoder-side audio of one track; only touched by the decoder thread
+    struct TrackAudio {
+        std::unique_ptr<AudioRingBuffer> held;  // Newest frames, held back for the padding trim and crossfade
+        uint64_t skipFrames = 0;                // Encoder delay still to drop
+        size_t paddingFrames = 0;
+        uint64_t epoch = 0;                     // Next slot only: item the frames belong to
+        bool armed = false;                     // Next slot only: that item is ready and spliceable
+    };
+    TrackAudio m_trackAudio;
+    TrackAudio m_nextAudio;
+
+    // FinishAudioTrack() progress across calls that ran out of ring space
+    struct TrackEnding {
+        bool active = false;
+        bool splice = false;
+        size_t plainFrames = 0;   // Tail frames still to write as they are
+        size_t mixFrames = 0;     // Crossfade length
+        size_t mixedFrames = 0;   // Crossfade frames written
+    };
+    TrackEnding m_ending;
+
+    // Chunk buffers for moving held audio: current track tail, next track head
+    std::vector<float> m_spliceScratch;
+    size_t m_crossfadeFrames = 0;
+
+    // How Load() and Seek() want the decoder-side track state reset before the next push
+    enum class TrackAudioReset {
+        None,
+        Flush,      // Same track, new position: drop held audio
+        NewTrack    // Also restart the encoder delay trim with m_loadedDelay/m_loadedPadding
+    };
+    std::atomic<TrackAudioReset> m_trackAudioReset{ TrackAudioReset::None };
+    std::atomic<uint64_t> m_loadedDelay{ 0 };
+    std::atomic<size_t> m_loadedPadding{ 0 };
+
+    // Frames written to m_audioRing since the last timeline reset
+    std::atomic<uint64_t> m_audioFramesQueued{ 0 };
+
+    // Gapless counters
+    std::atomic<uint64_t> m_gaplessTransitions{ 0 };
+    std::atomic<uint64_t> m_gaplessTrimmedFrames{ 0 };
+    std::atomic<size_t> m_lastCrossfadeFrames{ 0 };
+    std::atomic<int64_t> m_nextPrepareUs{ 0 };
+
+    // Encoder padding beyond this is not trimmed (no real codec comes close)
+    static constexpr size_t kMaxEncoderPaddingFrames = 8192;
+
+    // Pre-decoded start of the next item on top of the crossfade
+    static constexpr size_t kNextPrerollFrames = 8192;
+
+    // Frames moved per step out of the held-back audio
+    static constexpr size_t kSpliceChunkFrames = 1024;
+
+    // Helper: Sizes the held-back rings and splice buffers for the ring channels and crossfade
+    void AllocateTrackAudio();
+
+    // Helper: Applies a pending m_trackAudioReset; decoder thread
+    void ApplyTrackAudioReset();
+
+    // Helper: Arms m_nextAudio for the current m_next; false if there is nothing spliceable
+    bool ArmNextAudio();
+
+    // Helper: Moves m_spliced into place and records its start; false if m_next went away
+    bool SpliceNextItem(uint64_t startFrame);
+
+    // Helper: Makes the pre-decoded next audio the current track's
+    void AdoptNextAudio();
+
+    // Helper: Makes m_spliced the current item, heard or not; caller holds m_metadataMutex and
+    // m_nextMutex. Returns how many frames the output positions moved back (0 if already heard)
+    uint64_t CommitSplicedItem();
+
+    // Helper: Commits a spliced item early, before the timeline is reset under it
+    void CommitPendingSplice();
+
+    // Helper: Swaps in a spliced item the output has reached; never called on the output thread
+    void CommitHeardSplice();
+
+    // Helper: Moves m_spliced's metadata, index and path into place; caller holds both locks
+    void SwapInSplicedItem();
+
+    // Helper: Restarts output positions offset frames later, wait-free; returns the new played count
+    uint64_t RebaseAudioOutput(uint64_t offset);
+
+    // Helper: Writes to m_audioRing, counting queued frames and waking delivery
+    size_t WriteAudioOutput(const float* samples, size_t frames);
+
+    // Helper: Moves held-back frames beyond keepFrames into m_audioRing
+    void DrainHeldAudio(size_t keepFrames);
 
     // Helper: Validates file existence and permissions
     bool ValidateFilePath(const std::string& path) const;
 
-    // Helper: Attempts to detect media format using magic bytes
-    std::string DetectFormatFromMagicBytes(const std::string& path) const;
+    // Helper: Copy of m_scheduler, null after Shutdown()
+    std::shared_ptr<TaskScheduler> GetScheduler() const;
+
+    // Helper: Detaches m_scheduler, then drains and joins it outside m_schedulerMutex
+    void StopScheduler();
 };
 
 } // namespace knoux::core::engine
\ No newline at end of file
@@ -0,0 +1,444 @@
+﻿#include "metadata_store.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <system_error>
+#include <type_traits>
+
+namespace knoux::core::engine {
+
+namespace {
+
+constexpr char kStoreMagic[4] = { 'K', 'X', 'M', 'D' };
+constexpr uint32_t kStoreVersion = 1;
+constexpr uint32_t kRecordMagic = 0x524D584B;  // "KXMR"
+constexpr size_t kFileHeaderSize = 16;
+
+// Copies a string into a fixed field; returns false (and leaves the field empty) if it does not fit
+template <size_t N>
+bool CopyField(char (&field)[N], const std::string& value) {
+    if (value.size() >= N) {
+        return false;
+    }
+    std::memcpy(field, value.data(), value.size());
+    return true;
+}
+
+template <size_t N>
+std::string FieldString(const char (&field)[N]) {
+    return std::string(field, strnlen(field, N));
+}
+
+} // namespace
+
+struct MetadataStore::RecordHeader {
+    uint32_t magic = kRecordMagic;
+    uint32_t size = 0;            // Whole record including padding, multiple of 8
+    uint64_t pathHash = 0;
+    uint32_t pathLength = 0;
+    uint32_t extendedLength = 0;
+    uint64_t checksum = 0;        // Over summary, path and extended bytes
+    MetadataSummary summary;
+};
+
+static_assert(std::is_trivially_copyable_v<MetadataSummary>, "MetadataSummary is stored as raw bytes");
+
+MetadataStore::~MetadataStore() {
+    Close();
+}
+
+bool MetadataStore::Open(const std::string& path) {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_appendStream.close();
+    m_file.Close();
+    m_path = path;
+    m_hits.store(0, std::memory_order_relaxed);
+    m_misses.store(0, std::memory_order_relaxed);
+    m_stale.store(0, std::memory_order_relaxed);
+
+    try {
+        const std::filesystem::path p(path);
+        if (p.has_parent_path()) {
+            std::filesystem::create_directories(p.parent_path());
+        }
+
+        // The store file itself is replaced by Compact(), so the lock lives beside it
+        if (!m_lock.TryLock(path + ".lock")) {
+            m_path.clear();
+            return false;
+        }
+
+        std::error_code ec;
+        if (!std::filesystem::exists(p) || std::filesystem::file_size(p, ec) == 0) {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            uint8_t header[kFileHeaderSize] = {};
+            std::memcpy(header, kStoreMagic, 4);
+            std::memcpy(header + 4, &kStoreVersion, 4);
+            out.write(reinterpret_cast<const char*>(header), sizeof(header));
+            if (!out) {
+                m_lock.Unlock();
+                m_path.clear();
+                return false;
+            }
+        }
+    } catch (...) {
+        m_lock.Unlock();
+        m_path.clear();
+        return false;
+    }
+
+    if (!MapAndIndex()) {
+        m_lock.Unlock();
+        m_path.clear();
+        return false;
+    }
+
+    if (m_deadBytes > kCompactThresholdBytes && m_deadBytes > m_fileBytes - m_deadBytes) {
+        lock.unlock();
+        Compact();
+    }
+    return true;
+}
+
+void MetadataStore::Close() {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_appendStream.close();
+    m_file.Close();
+    m_appended.clear();
+    m_index.clear();
+    m_path.clear();
+    m_fileBytes = 0;
+    m_deadBytes = 0;
+    m_lock.Unlock();
+}
+
+bool MetadataStore::IsOpen() const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_appendStream.is_open();
+}
+
+bool MetadataStore::Lookup(const std::string& mediaPath, MetadataSummary& summary) const {
+    system::FileIdentity identity;
+    if (!system::ReadFileIdentity(mediaPath, identity)) {
+        return false;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    const uint8_t* record = FindCurrent(identity);
+    if (!record) {
+        return false;
+    }
+    std::memcpy(&summary, record + offsetof(RecordHeader, summary), sizeof(summary));
+    return true;
+}
+
+bool MetadataStore::LookupMetadata(const std::string& mediaPath, nlohmann::json& metadata) const {
+    system::FileIdentity identity;
+    if (!system::ReadFileIdentity(mediaPath, identity)) {
+        return false;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    const uint8_t* record = FindCurrent(identity);
+    if (!record) {
+        return false;
+    }
+
+    RecordHeader header;
+    std::memcpy(&header, record, sizeof(header));
+    const uint8_t* extended = record + sizeof(RecordHeader) + header.pathLength;
+    nlohmann::json meta = nlohmann::json::from_msgpack(extended, extended + header.extendedLength, true, false);
+    lock.unlock();
+
+    if (!meta.is_object()) {
+        return false;
+    }
+
+    // Put the hot fields back where BuildMetadata() had them
+    const MetadataSummary& s = header.summary;
+    if (!meta.contains("format")) meta["format"] = FieldString(s.format);
+    meta["duration"] = s.duration;
+    if (s.flags & MetadataSummary::kHasBitrate) meta["bitrate"] = s.bitrate;
+    if (s.flags & MetadataSummary::kHasVideo) {
+        meta["width"] = s.width;
+        meta["height"] = s.height;
+        meta["frame_rate"] = s.frameRate;
+        if (!meta.contains("video_codec")) meta["video_codec"] = FieldString(s.videoCodec);
+    }
+    if (s.flags & MetadataSummary::kHasAudio) {
+        meta["sample_rate"] = s.sampleRate;
+        meta["channels"] = s.channels;
+        if (!meta.contains("audio_codec")) meta["audio_codec"] = FieldString(s.audioCodec);
+    }
+    metadata = std::move(meta);
+    return true;
+}
+
+bool MetadataStore::Store(const std::string& mediaPath, const nlohmann::json& metadata) {
+    system::FileIdentity identity;
+    if (!metadata.is_object() || !system::ReadFileIdentity(mediaPath, identity)) {
+        return false;
+    }
+
+    nlohmann::json extended;
+    MetadataSummary summary = Summarize(metadata, extended);
+    summary.fileSize = identity.size;
+    summary.modified = identity.modified;
+
+    std::vector<uint8_t> record;
+    EncodeRecord(identity, summary, nlohmann::json::to_msgpack(extended), record);
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    if (!m_appendStream.is_open()) {
+        return false;
+    }
+
+    m_appendStream.write(reinterpret_cast<const char*>(record.data()), static_cast<std::streamsize>(record.size()));
+    m_appendStream.flush();
+    if (!m_appendStream) {
+        // Leave the tail for Open() to truncate; the in-memory view stays consistent
+        m_appendStream.clear();
+        return false;
+    }
+
+    const uint64_t hash = system::HashBytes(identity.path.data(), identity.path.size());
+    const Location location{ m_fileBytes, static_cast<uint32_t>(record.size()) };
+    auto [it, inserted] = m_index.try_emplace(hash, location);
+    if (!inserted) {
+        m_deadBytes += it->second.size;
+        it->second = location;
+    }
+    m_appended.insert(m_appended.end(), record.begin(), record.end());
+    m_fileBytes += record.size();
+    return true;
+}
+
+bool MetadataStore::Compact() {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    // An open store holds m_lock, so no other process has the file open across the rename
+    if (m_path.empty() || !m_lock.IsLocked()) {
+        return false;
+    }
+
+    const std::string staging = m_path + ".compact";
+    try {
+        {
+            std::ofstream out(staging, std::ios::binary | std::ios::trunc);
+            uint8_t header[kFileHeaderSize] = {};
+            std::memcpy(header, kStoreMagic, 4);
+            std::memcpy(header + 4, &kStoreVersion, 4);
+            out.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+            // Keep file order so the rewritten store pages in the same way
+            std::vector<Location> live;
+            live.reserve(m_index.size());
+            for (const auto& entry : m_index) {
+                live.push_back(entry.second);
+            }
+            std::sort(live.begin(), live.end(), [](const Location& a, const Location& b) { return a.offset < b.offset; });
+            for (const Location& location : live) {
+                const uint8_t* bytes = RecordBytes(location);
+                if (bytes) {
+                    out.write(reinterpret_cast<const char*>(bytes), location.size);
+                }
+            }
+            if (!out) {
+                std::filesystem::remove(staging);
+                return false;
+            }
+        }
+
+        // The mapping must go before the rename on platforms that lock mapped files
+        m_appendStream.close();
+        m_file.Close();
+        std::filesystem::rename(staging, m_path);
+    } catch (...) {
+        std::error_code ec;
+        std::filesystem::remove(staging, ec);
+        if (!m_file.IsOpen()) {
+            MapAndIndex();
+        }
+        return false;
+    }
+    return MapAndIndex();
+}
+
+MetadataStore::Stats MetadataStore::GetStats() const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    Stats stats;
+    stats.entries = m_index.size();
+    stats.fileBytes = m_fileBytes;
+    stats.deadBytes = m_deadBytes;
+    stats.hits = m_hits.load(std::memory_order_relaxed);
+    stats.misses = m_misses.load(std::memory_order_relaxed);
+    stats.stale = m_stale.load(std::memory_order_relaxed);
+    return stats;
+}
+
+MetadataSummary MetadataStore::Summarize(const nlohmann::json& metadata, nlohmann::json& extended) {
+    MetadataSummary summary;
+    extended = metadata.is_object() ? metadata : nlohmann::json::object();
+
+    // Numbers always move to the summary; strings only when they fit their field
+    auto takeString = [&extended](const char* key, auto& field) {
+        const auto it = extended.find(key);
+        if (it != extended.end() && it->is_string() && CopyField(field, it->template get<std::string>())) {
+            extended.erase(it);
+        }
+    };
+    auto takeNumber = [&extended](const char* key, auto& field) {
+        const auto it = extended.find(key);
+        if (it == extended.end() || !it->is_number()) {
+            return false;
+        }
+        field = it->template get<std::remove_reference_t<decltype(field)>>();
+        extended.erase(it);
+        return true;
+    };
+
+    takeString("format", summary.format);
+    takeNumber("duration", summary.duration);
+    if (takeNumber("bitrate", summary.bitrate)) {
+        summary.flags |= MetadataSummary::kHasBitrate;
+    }
+    if (extended.contains("video_codec")) {
+        summary.flags |= MetadataSummary::kHasVideo;
+        takeNumber("width", summary.width);
+        takeNumber("height", summary.height);
+        takeNumber("frame_rate", summary.frameRate);
+        takeString("video_codec", summary.videoCodec);
+    }
+    if (extended.contains("audio_codec")) {
+        summary.flags |= MetadataSummary::kHasAudio;
+        takeNumber("sample_rate", summary.sampleRate);
+        takeNumber("channels", summary.channels);
+        takeString("audio_codec", summary.audioCodec);
+    }
+
+    const auto streams = extended.find("streams");
+    if (streams != extended.end() && streams->is_array()) {
+        summary.streamCount = static_cast<uint32_t>(streams->size());
+    }
+    return summary;
+}
+
+bool MetadataStore::MapAndIndex() {
+    m_appendStream.close();
+    m_appended.clear();
+    m_index.clear();
+    m_fileBytes = 0;
+    m_deadBytes = 0;
+
+    if (!m_file.Open(m_path, system::MappedFile::AccessHint::Sequential) || m_file.Size() < kFileHeaderSize ||
+        std::memcmp(m_file.Data(), kStoreMagic, 4) != 0) {
+        m_file.Close();
+        return false;
+    }
+    uint32_t version = 0;
+    std::memcpy(&version, m_file.Data() + 4, 4);
+    if (version != kStoreVersion) {
+        m_file.Close();
+        return false;
+    }
+
+    // Only record headers are read here; paths and extended fields stay untouched
+    const uint8_t* data = m_file.Data();
+    const size_t size = m_file.Size();
+    size_t offset = kFileHeaderSize;
+    while (size - offset >= sizeof(RecordHeader)) {
+        RecordHeader header;
+        std::memcpy(&header, data + offset, sizeof(header));
+        if (header.magic != kRecordMagic || header.size % 8 != 0 || header.size > size - offset ||
+            sizeof(RecordHeader) + uint64_t(header.pathLength) + header.extendedLength > header.size) {
+            break;
+        }
+
+        const Location location{ offset, header.size };
+        auto [it, inserted] = m_index.try_emplace(header.pathHash, location);
+        if (!inserted) {
+            m_deadBytes += it->second.size;
+            it->second = location;
+        }
+        offset += header.size;
+    }
+
+    if (offset < size) {
+        // Torn or corrupt tail (e.g. a crash mid-append): drop it so appends stay aligned
+        m_file.Close();
+        std::error_code ec;
+        std::filesystem::resize_file(m_path, offset, ec);
+        if (ec || !m_file.Open(m_path, system::MappedFile::AccessHint::Sequential)) {
+            return false;
+        }
+    }
+
+    m_fileBytes = offset;
+    m_appendStream.open(m_path, std::ios::binary | std::ios::app);
+    return m_appendStream.is_open();
+}
+
+const uint8_t* MetadataStore::RecordBytes(const Location& location) const {
+    if (location.offset + location.size <= m_file.Size()) {
+        return m_file.Data() + location.offset;
+    }
+    const uint64_t appendedOffset = location.offset - m_file.Size();
+    if (location.offset >= m_file.Size() && appendedOffset + location.size <= m_appended.size()) {
+        return m_appended.data() + appendedOffset;
+    }
+    return nullptr;
+}
+
+const uint8_t* MetadataStore::FindCurrent(const system::FileIdentity& identity) const {
+    const uint64_t hash = system::HashBytes(identity.path.data(), identity.path.size());
+    const auto it = m_index.find(hash);
+    const uint8_t* record = it != m_index.end() ? RecordBytes(it->second) : nullptr;
+    if (!record) {
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    RecordHeader header;
+    std::memcpy(&header, record, sizeof(header));
+    const uint8_t* path = record + sizeof(RecordHeader);
+    if (header.pathLength != identity.path.size() || std::memcmp(path, identity.path.data(), header.pathLength) != 0) {
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    if (header.summary.fileSize != identity.size || header.summary.modified != identity.modified) {
+        m_stale.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    // Checked on use rather than on Open() so indexing never reads the payload
+    uint64_t checksum = system::HashBytes(&header.summary, sizeof(header.summary));
+    checksum ^= system::HashBytes(path, header.pathLength + size_t(header.extendedLength));
+    if (checksum != header.checksum) {
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    m_hits.fetch_add(1, std::memory_order_relaxed);
+    return record;
+}
+
+void MetadataStore::EncodeRecord(const system::FileIdentity& identity, const MetadataSummary& summary,
+                                 const std::vector<uint8_t>& extended, std::vector<uint8_t>& out) {
+    RecordHeader header;
+    header.pathHash = system::HashBytes(identity.path.data(), identity.path.size());
+    header.pathLength = static_cast<uint32_t>(identity.path.size());
+    header.extendedLength = static_cast<uint32_t>(extended.size());
+    header.summary = summary;
+
+    const size_t payload = sizeof(RecordHeader) + identity.path.size() + extended.size();
+    header.size = static_cast<uint32_t>((payload + 7) & ~size_t(7));
+
+    out.assign(header.size, 0);
+    std::memcpy(out.data() + sizeof(RecordHeader), identity.path.data(), identity.path.size());
+    std::memcpy(out.data() + sizeof(RecordHeader) + identity.path.size(), extended.data(), extended.size());
+    header.checksum = system::HashBytes(&header.summary, sizeof(header.summary)) ^
+        system::HashBytes(out.data() + sizeof(RecordHeader), identity.path.size() + extended.size());
+    std::memcpy(out.data(), &header, sizeof(header));
+}
+
+} // namespace knoux::core::engine
@@ -0,0 +1,190 @@
+﻿#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <shared_mutex>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include "core/system/file_identity.h"
+#include "core/system/file_lock.h"
+#include "core/system/mapped_file.h"
+
+namespace knoux::core::engine {
+
+/**
+ * @struct MetadataSummary
+ * @brief Fixed-layout hot fields of a media file, as stored on disk.
+ *
+ * Enough for library views (format, duration, codecs, geometry) without
+ * touching the extended fields. Strings longer than their field are left
+ * empty here and only kept in the extended fields.
+ */
+struct MetadataSummary {
+    uint64_t fileSize = 0;
+    int64_t modified = 0;
+    double duration = 0.0;
+    int64_t bitrate = 0;
+    double frameRate = 0.0;
+    int32_t width = 0;
+    int32_t height = 0;
+    int32_t sampleRate = 0;
+    int32_t channels = 0;
+    uint32_t streamCount = 0;
+    uint32_t flags = 0;
+    char format[16] = {};
+    char videoCodec[16] = {};
+    char audioCodec[16] = {};
+
+    static constexpr uint32_t kHasVideo = 1u << 0;
+    static constexpr uint32_t kHasAudio = 1u << 1;
+    static constexpr uint32_t kHasBitrate = 1u << 2;
+};
+
+/**
+ * @class MetadataStore
+ * @brief Persistent, memory-mapped cache of parsed media metadata.
+ *
+ * The store is a single append-only file of records keyed by the hash of
+ * the canonical path. Each record holds the file size and modification
+ * time it was parsed from, a MetadataSummary, the path, and the remaining
+ * metadata fields as MessagePack:
+ * - Open() maps the file and walks the fixed record headers only, so
+ *   indexing 150k entries is one sequential pass with no JSON parsing
+ * - Lookup() compares size and mtime with the file on disk; a changed
+ *   file misses and its next Store() appends a record that supersedes
+ *   the stale one
+ * - extended fields are decoded only by LookupMetadata()
+ * - a torn tail left by a crash is truncated on Open(), and the file is
+ *   compacted there once superseded records outweigh live ones
+ *
+ * Records use host byte order; a store is not meant to move between
+ * machines. Readers share a lock, Store() takes it exclusively. Across
+ * processes, an advisory lock on "<path>.lock" is held from Open() to
+ * Close(), so a second instance neither appends to the file nor has it
+ * renamed away by Compact(); its Open() fails instead.
+ */
+class MetadataStore {
+public:
+    /**
+     * @struct Stats
+     * @brief Store shape and lookup counters since Open()
+     */
+    struct Stats {
+        size_t entries = 0;         // Live records
+        uint64_t fileBytes = 0;     // Store file size, including superseded records
+        uint64_t deadBytes = 0;     // Bytes held by superseded records
+        uint64_t hits = 0;
+        uint64_t misses = 0;        // No record for the path
+        uint64_t stale = 0;         // Record found but the file changed since
+    };
+
+    MetadataStore() = default;
+    ~MetadataStore();
+
+    MetadataStore(const MetadataStore&) = delete;
+    MetadataStore& operator=(const MetadataStore&) = delete;
+
+    /**
+     * @brief Opens or creates a store file
+     * @param path Store file; its directory is created if needed
+     * @return false if the file cannot be created, is not a metadata store
+     *         or is held open by another process
+     */
+    bool Open(const std::string& path);
+
+    /**
+     * @brief Flushes pending appends, unmaps the store and releases its lock
+     */
+    void Close();
+
+    /**
+     * @brief Checks if a store is open
+     */
+    bool IsOpen() const;
+
+    /**
+     * @brief Returns the hot fields of a file if its record is current
+     * @param mediaPath Media file (resolved to its canonical path)
+     * @param summary Receives the cached fields
+     * @return false on a miss or if the file changed since it was stored
+     */
+    bool Lookup(const std::string& mediaPath, MetadataSummary& summary) const;
+
+    /**
+     * @brief Returns the full metadata JSON of a file if its record is current
+     * @param mediaPath Media file (resolved to its canonical path)
+     * @param metadata Receives hot and extended fields merged
+     * @return false on a miss, a stale record or undecodable extended fields
+     */
+    bool LookupMetadata(const std::string& mediaPath, nlohmann::json& metadata) const;
+
+    /**
+     * @brief Appends the metadata of a file, superseding any previous record
+     * @param mediaPath Media file the metadata was parsed from
+     * @param metadata Metadata JSON as produced by MediaEngine
+     * @return false if the file cannot be identified or the append failed
+     */
+    bool Store(const std::string& mediaPath, const nlohmann::json& metadata);
+
+    /**
+     * @brief Rewrites the file with live records only
+     * @return false if the rewrite failed (the old file is kept)
+     */
+    bool Compact();
+
+    /**
+     * @brief Returns entry counts and lookup counters
+     */
+    Stats GetStats() const;
+
+    /**
+     * @brief Splits metadata JSON into hot fields and the extended remainder
+     */
+    static MetadataSummary Summarize(const nlohmann::json& metadata, nlohmann::json& extended);
+
+    // Compaction runs on Open() once dead bytes exceed both this and the live bytes
+    static constexpr uint64_t kCompactThresholdBytes = 1 << 20;
+
+private:
+    struct RecordHeader;
+
+    // Where a record lives: the mapped file, or the buffer of appends made since mapping
+    struct Location {
+        uint64_t offset = 0;
+        uint32_t size = 0;
+    };
+
+    // Helper: Maps the file and rebuilds m_index; caller holds m_mutex exclusively
+    bool MapAndIndex();
+
+    // Helper: Returns the bytes of a record, or nullptr if the location is out of range
+    const uint8_t* RecordBytes(const Location& location) const;
+
+    // Helper: Finds the current record of a file; caller holds m_mutex
+    const uint8_t* FindCurrent(const system::FileIdentity& identity) const;
+
+    // Helper: Encodes one record
+    static void EncodeRecord(const system::FileIdentity& identity, const MetadataSummary& summary,
+                             const std::vector<uint8_t>& extended, std::vector<uint8_t>& out);
+
+    mutable std::shared_mutex m_mutex;
+    std::string m_path;
+    // Held while open; guards the file (and Compact()'s rename) against other processes
+    system::FileLock m_lock;
+    system::MappedFile m_file;
+    std::ofstream m_appendStream;
+    std::vector<uint8_t> m_appended;
+    std::unordered_map<uint64_t, Location> m_index;
+    uint64_t m_fileBytes = 0;
+    uint64_t m_deadBytes = 0;
+
+    mutable std::atomic<uint64_t> m_hits{ 0 };
+    mutable std::atomic<uint64_t> m_misses{ 0 };
+    mutable std::atomic<uint64_t> m_stale{ 0 };
+};
+
+} // namespace knoux::core::engine
@@ -0,0 +1,163 @@
+﻿#include "playback_clock.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+namespace knoux::core::engine {
+
+namespace {
+
+int64_t SteadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+PlaybackClock::PlaybackClock() {
+    m_anchorSteadyNs.store(SteadyNowNs(), std::memory_order_relaxed);
+}
+
+int64_t PlaybackClock::NowUs() const {
+    return Extrapolate(LoadAnchor(), SteadyNowNs());
+}
+
+void PlaybackClock::Start() {
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    Anchor anchor = LoadAnchor();
+    if (anchor.running) {
+        return;
+    }
+    anchor.steadyNs = SteadyNowNs();
+    anchor.running = true;
+    StoreAnchor(anchor);
+}
+
+void PlaybackClock::Pause() {
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    Anchor anchor = LoadAnchor();
+    if (!anchor.running) {
+        return;
+    }
+    const int64_t now = SteadyNowNs();
+    anchor.mediaUs = Extrapolate(anchor, now);
+    anchor.steadyNs = now;
+    anchor.running = false;
+    StoreAnchor(anchor);
+}
+
+bool PlaybackClock::IsRunning() const {
+    return LoadAnchor().running;
+}
+
+void PlaybackClock::SetTime(int64_t mediaUs) {
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    Anchor anchor = LoadAnchor();
+    anchor.mediaUs = mediaUs;
+    anchor.steadyNs = SteadyNowNs();
+    anchor.rate = 1.0;
+    StoreAnchor(anchor);
+
+    m_driftUs.store(0, std::memory_order_relaxed);
+    m_maxDriftUs.store(0, std::memory_order_relaxed);
+}
+
+void PlaybackClock::SetSource(Source source) {
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    if (m_source.exchange(source, std::memory_order_relaxed) == source) {
+        return;
+    }
+
+    const int64_t now = SteadyNowNs();
+    Anchor anchor = LoadAnchor();
+    anchor.mediaUs = Extrapolate(anchor, now);
+    anchor.steadyNs = now;
+    anchor.rate = 1.0;
+    StoreAnchor(anchor);
+}
+
+void PlaybackClock::UpdateFromAudio(int64_t audioUs) {
+    if (m_source.load(std::memory_order_relaxed) != Source::Audio) {
+        return;
+    }
+
+    // Never block the audio thread; the next update will catch up
+    std::unique_lock<std::mutex> lock(m_writeMutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+
+    Anchor anchor = LoadAnchor();
+    if (!anchor.running) {
+        return;
+    }
+
+    const int64_t now = SteadyNowNs();
+    const int64_t clockUs = Extrapolate(anchor, now);
+    const int64_t drift = audioUs - clockUs;
+    m_driftUs.store(drift, std::memory_order_relaxed);
+    if (std::llabs(drift) > m_maxDriftUs.load(std::memory_order_relaxed)) {
+        m_maxDriftUs.store(std::llabs(drift), std::memory_order_relaxed);
+    }
+
+    anchor.steadyNs = now;
+    if (std::llabs(drift) > kResyncThresholdUs) {
+        anchor.mediaUs = audioUs;
+        anchor.rate = 1.0;
+        m_resyncs.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        // Re-anchor at the current reading so the clock stays continuous
+        anchor.mediaUs = clockUs;
+        const double slew = static_cast<double>(drift) / static_cast<double>(kSlewWindowUs);
+        anchor.rate = 1.0 + std::clamp(slew, -kMaxSlew, kMaxSlew);
+        m_corrections.fetch_add(1, std::memory_order_relaxed);
+    }
+    StoreAnchor(anchor);
+}
+
+PlaybackClock::Stats PlaybackClock::GetStats() const {
+    Stats stats;
+    stats.source = m_source.load(std::memory_order_relaxed);
+    stats.driftUs = m_driftUs.load(std::memory_order_relaxed);
+    stats.maxDriftUs = m_maxDriftUs.load(std::memory_order_relaxed);
+    stats.rate = LoadAnchor().rate;
+    stats.corrections = m_corrections.load(std::memory_order_relaxed);
+    stats.resyncs = m_resyncs.load(std::memory_order_relaxed);
+    return stats;
+}
+
+PlaybackClock::Anchor PlaybackClock::LoadAnchor() const {
+    Anchor anchor;
+    uint32_t before = 0;
+    do {
+        before = m_sequence.load(std::memory_order_acquire);
+        anchor.mediaUs = m_anchorMediaUs.load(std::memory_order_relaxed);
+        anchor.steadyNs = m_anchorSteadyNs.load(std::memory_order_relaxed);
+        anchor.rate = m_anchorRate.load(std::memory_order_relaxed);
+        anchor.running = m_anchorRunning.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((before & 1) != 0 || m_sequence.load(std::memory_order_relaxed) != before);
+    return anchor;
+}
+
+void PlaybackClock::StoreAnchor(const Anchor& anchor) {
+    const uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+    m_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_anchorMediaUs.store(anchor.mediaUs, std::memory_order_relaxed);
+    m_anchorSteadyNs.store(anchor.steadyNs, std::memory_order_relaxed);
+    m_anchorRate.store(anchor.rate, std::memory_order_relaxed);
+    m_anchorRunning.store(anchor.running, std::memory_order_relaxed);
+    m_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+int64_t PlaybackClock::Extrapolate(const Anchor& anchor, int64_t steadyNs) {
+    if (!anchor.running) {
+        return anchor.mediaUs;
+    }
+    // A reader that sampled steady_clock before a newer anchor was published sees no elapsed time
+    const double elapsedUs = static_cast<double>(std::max<int64_t>(steadyNs - anchor.steadyNs, 0)) / 1000.0;
+    return anchor.mediaUs + static_cast<int64_t>(elapsedUs * anchor.rate);
+}
+
+} // namespace knoux::core::engine
@@ -0,0 +1,143 @@
+﻿#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+
+namespace knoux::core::engine {
+
+/**
+ * @class PlaybackClock
+ * @brief Monotonic master clock for media presentation time.
+ *
+ * Media time is extrapolated from an anchor (media time, steady_clock time,
+ * rate), so reading it costs one steady_clock call and has nanosecond
+ * resolution. With Source::Audio the audio output reports the position of
+ * the samples it just consumed; small errors are absorbed by nudging the
+ * rate (at most kMaxSlew), which keeps the clock monotonic, and only
+ * errors beyond kResyncThresholdUs snap the clock to the audio position.
+ *
+ * Readers are lock-free (seqlock); writers are serialized by a mutex and
+ * UpdateFromAudio() skips the update instead of blocking on it, so it is
+ * safe to call from the real-time audio thread.
+ */
+class PlaybackClock {
+public:
+    /**
+     * @enum Source
+     * @brief What the clock follows
+     */
+    enum class Source {
+        System,  // steady_clock only (no audio stream)
+        Audio    // steady_clock slewed towards the audio output position
+    };
+
+    /**
+     * @struct Stats
+     * @brief Drift correction counters
+     */
+    struct Stats {
+        Source source = Source::System;
+        int64_t driftUs = 0;          // Last measured audio position minus clock
+        int64_t maxDriftUs = 0;       // Largest absolute drift since the last SetTime()
+        double rate = 1.0;            // Current slewed rate
+        uint64_t corrections = 0;     // Audio updates that adjusted the rate
+        uint64_t resyncs = 0;         // Audio updates that snapped the clock
+    };
+
+    PlaybackClock();
+
+    PlaybackClock(const PlaybackClock&) = delete;
+    PlaybackClock& operator=(const PlaybackClock&) = delete;
+
+    /**
+     * @brief Returns the current media time in microseconds
+     */
+    int64_t NowUs() const;
+
+    /**
+     * @brief Returns the current media time in seconds
+     */
+    double NowSeconds() const { return static_cast<double>(NowUs()) / 1e6; }
+
+    /**
+     * @brief Starts or resumes advancing from the current media time
+     */
+    void Start();
+
+    /**
+     * @brief Freezes the clock at the current media time
+     */
+    void Pause();
+
+    /**
+     * @brief Checks if the clock is advancing
+     */
+    bool IsRunning() const;
+
+    /**
+     * @brief Jumps to a media time (seek, stop), keeping the running state
+     * @param mediaUs New media time in microseconds
+     */
+    void SetTime(int64_t mediaUs);
+
+    /**
+     * @brief Selects what the clock follows; switching resets the rate to 1
+     */
+    void SetSource(Source source);
+    Source GetSource() const { return m_source.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Audio output side: reports the media time of the samples just played
+     * @param audioUs Position of the last consumed sample in microseconds
+     */
+    void UpdateFromAudio(int64_t audioUs);
+
+    /**
+     * @brief Returns a snapshot of the drift statistics
+     */
+    Stats GetStats() const;
+
+    // Maximum rate deviation used to absorb drift (0.5%, inaudible and invisible)
+    static constexpr double kMaxSlew = 0.005;
+
+    // Drift is closed over roughly this window
+    static constexpr int64_t kSlewWindowUs = 500000;
+
+    // Errors larger than this snap the clock to the audio position
+    static constexpr int64_t kResyncThresholdUs = 200000;
+
+private:
+    struct Anchor {
+        int64_t mediaUs = 0;
+        int64_t steadyNs = 0;
+        double rate = 1.0;
+        bool running = false;
+    };
+
+    // Helper: Reads a consistent anchor without locking
+    Anchor LoadAnchor() const;
+
+    // Helper: Publishes a new anchor; caller holds m_writeMutex
+    void StoreAnchor(const Anchor& anchor);
+
+    // Helper: Media time of an anchor at a steady_clock instant
+    static int64_t Extrapolate(const Anchor& anchor, int64_t steadyNs);
+
+    // Seqlock-protected anchor; odd sequence means a write is in progress
+    std::atomic<uint32_t> m_sequence{ 0 };
+    std::atomic<int64_t> m_anchorMediaUs{ 0 };
+    std::atomic<int64_t> m_anchorSteadyNs{ 0 };
+    std::atomic<double> m_anchorRate{ 1.0 };
+    std::atomic<bool> m_anchorRunning{ false };
+
+    std::mutex m_writeMutex;
+    std::atomic<Source> m_source{ Source::System };
+
+    std::atomic<int64_t> m_driftUs{ 0 };
+    std::atomic<int64_t> m_maxDriftUs{ 0 };
+    std::atomic<uint64_t> m_corrections{ 0 };
+    std::atomic<uint64_t> m_resyncs{ 0 };
+};
+
+} // namespace knoux::core::engine
@@ -0,0 +1,114 @@
+﻿#include "presentation_scheduler.h"
+#include <algorithm>
+#include <utility>
+
+namespace knoux::core::engine {
+
+PresentationScheduler::PresentationScheduler(size_t capacity)
+    : m_slots(std::max<size_t>(capacity, 1))
+{
+}
+
+VideoFrameHandle PresentationScheduler::PopFront() {
+    VideoFrameHandle frame = std::move(m_slots[m_head]);
+    m_head = (m_head + 1) % m_slots.size();
+    --m_count;
+    return frame;
+}
+
+bool PresentationScheduler::Push(const VideoFrameHandle& frame) {
+    if (!frame) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_count >= m_slots.size()) {
+        return false;
+    }
+
+    // Decoders emit in presentation order except around B-frames, so search from the back,
+    // moving later frames up one slot as we go
+    size_t index = m_count;
+    while (index > 0 && At(index - 1).Pts() > frame.Pts()) {
+        At(index) = std::move(At(index - 1));
+        --index;
+    }
+    At(index) = frame;
+    ++m_count;
+    return true;
+}
+
+bool PresentationScheduler::Next(int64_t clockUs, VideoFrameHandle& frame) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_count == 0 || At(0).Pts() > clockUs) {
+        // The current frame stays up for another period
+        if (m_hasLast && clockUs >= m_nextRepeatUs) {
+            ++m_stats.repeated;
+            m_nextRepeatUs += m_frameDurationUs;
+        }
+        return false;
+    }
+
+    while (m_count > 1 && At(1).Pts() <= clockUs) {
+        PopFront();
+        ++m_stats.dropped;
+    }
+
+    frame = PopFront();
+
+    const int64_t pts = frame.Pts();
+    if (m_hasLast && pts > m_lastPts) {
+        // Smooth the period estimate; it only drives repeat accounting
+        m_frameDurationUs = (m_frameDurationUs * 7 + (pts - m_lastPts)) / 8;
+    }
+    m_lastPts = pts;
+    m_hasLast = true;
+    m_nextRepeatUs = std::max(pts, clockUs) + m_frameDurationUs;
+
+    const int64_t lateness = clockUs - pts;
+    ++m_stats.presented;
+    m_stats.avOffsetUs = -lateness;
+    if (lateness > kLateThresholdUs) {
+        ++m_stats.late;
+    }
+    m_stats.maxLatenessUs = std::max(m_stats.maxLatenessUs, lateness);
+    return true;
+}
+
+int64_t PresentationScheduler::TimeUntilNextUs(int64_t clockUs) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_count == 0) {
+        return -1;
+    }
+    return std::max<int64_t>(At(0).Pts() - clockUs, 0);
+}
+
+void PresentationScheduler::Flush() {
+    // Seek/stop path, not steady state: allocating the holding array here is fine
+    std::vector<VideoFrameHandle> frames;
+    frames.reserve(m_slots.size());
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        while (m_count > 0) {
+            frames.push_back(PopFront());
+        }
+        m_head = 0;
+        m_hasLast = false;
+    }
+    // Handles go back to the pool outside the lock
+}
+
+PresentationScheduler::Stats PresentationScheduler::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats stats = m_stats;
+    stats.queued = m_count;
+    return stats;
+}
+
+void PresentationScheduler::ResetStats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats = Stats();
+}
+
+} // namespace knoux::core::engine
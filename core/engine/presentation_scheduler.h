@@ -0,0 +1,121 @@
+﻿#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "frame_pool.h"
+
+namespace knoux::core::engine {
+
+/**
+ * @class PresentationScheduler
+ * @brief Paces decoded video frames against the master clock.
+ *
+ * The decoder pushes frames (in any order, they are kept sorted by Pts());
+ * the presentation thread calls Next() with the current clock reading and
+ * shows whatever it returns. For each call:
+ * - queued frames whose successor is already due are dropped, so a late
+ *   pipeline catches up instead of falling further behind
+ * - the newest due frame is returned and counted late if it is more than
+ *   kLateThresholdUs behind the clock
+ * - when nothing new is due past the current frame's display period, the
+ *   frame on screen is counted as repeated
+ *
+ * Thread-safe; the queue is bounded so a decoder running ahead gets
+ * back-pressure from Push(). It is a ring of capacity slots allocated up
+ * front, so pushing and presenting never allocate.
+ */
+class PresentationScheduler {
+public:
+    /**
+     * @struct Stats
+     * @brief Presentation counters since construction or the last ResetStats()
+     */
+    struct Stats {
+        uint64_t presented = 0;     // Frames handed to the renderer
+        uint64_t dropped = 0;       // Frames skipped because a later frame was already due
+        uint64_t late = 0;          // Presented frames more than kLateThresholdUs behind the clock
+        uint64_t repeated = 0;      // Frame periods with no new frame to show
+        int64_t avOffsetUs = 0;     // Last presented frame's PTS minus the clock (negative = late)
+        int64_t maxLatenessUs = 0;  // Worst lateness of a presented frame
+        size_t queued = 0;          // Frames waiting
+    };
+
+    /**
+     * @brief Creates an empty queue
+     * @param capacity Maximum frames waiting for presentation
+     */
+    explicit PresentationScheduler(size_t capacity = 8);
+
+    PresentationScheduler(const PresentationScheduler&) = delete;
+    PresentationScheduler& operator=(const PresentationScheduler&) = delete;
+
+    /**
+     * @brief Decoder side: queues a frame for presentation at its Pts()
+     * @return false if the queue is full (the frame is not kept)
+     */
+    bool Push(const VideoFrameHandle& frame);
+
+    /**
+     * @brief Presentation side: picks the frame to show now
+     * @param clockUs Current master clock reading in microseconds
+     * @param frame Receives the frame to present when one is due
+     * @return true if frame was set
+     */
+    bool Next(int64_t clockUs, VideoFrameHandle& frame);
+
+    /**
+     * @brief Returns how long until the next queued frame is due
+     * @param clockUs Current master clock reading in microseconds
+     * @return Microseconds until due (0 if due now), or -1 if the queue is empty
+     */
+    int64_t TimeUntilNextUs(int64_t clockUs) const;
+
+    /**
+     * @brief Discards queued frames (seek, stop)
+     */
+    void Flush();
+
+    /**
+     * @brief Returns a snapshot of the counters
+     */
+    Stats GetStats() const;
+
+    /**
+     * @brief Clears the counters
+     */
+    void ResetStats();
+
+    // Lateness above which a presented frame is counted late (about one frame at 50 fps)
+    static constexpr int64_t kLateThresholdUs = 20000;
+
+    // Frame period assumed until two frames have been presented
+    static constexpr int64_t kDefaultFrameDurationUs = 40000;
+
+private:
+    // Helper: Queued frame at position index (0 = earliest); caller holds m_mutex
+    VideoFrameHandle& At(size_t index) { return m_slots[(m_head + index) % m_slots.size()]; }
+    const VideoFrameHandle& At(size_t index) const { return m_slots[(m_head + index) % m_slots.size()]; }
+
+    // Helper: Removes the earliest frame; caller holds m_mutex
+    VideoFrameHandle PopFront();
+
+    mutable std::mutex m_mutex;
+
+    // Fixed ring sorted by Pts(): m_count frames starting at m_head
+    std::vector<VideoFrameHandle> m_slots;
+    size_t m_head = 0;
+    size_t m_count = 0;
+
+    // Last presented frame, used for repeat detection and frame period estimation
+    int64_t m_lastPts = 0;
+    bool m_hasLast = false;
+    int64_t m_frameDurationUs = kDefaultFrameDurationUs;
+    int64_t m_nextRepeatUs = 0;
+
+    Stats m_stats;
+};
+
+} // namespace knoux::core::engine
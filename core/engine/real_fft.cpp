@@ -0,0 +1,164 @@
+﻿#include "real_fft.h"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KNOUX_FFT_SSE 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64)
+#define KNOUX_FFT_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace knoux::core::engine {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+// One radix-2 stage with span h >= 4 over every group; w holds the h twiddles of the stage
+void ButterflyStage(float* re, float* im, size_t count, size_t h, const float* wRe, const float* wIm) {
+    for (size_t group = 0; group < count; group += 2 * h) {
+        float* aRe = re + group;
+        float* aIm = im + group;
+        float* bRe = aRe + h;
+        float* bIm = aIm + h;
+#if defined(KNOUX_FFT_SSE)
+        for (size_t j = 0; j < h; j += 4) {
+            const __m128 wr = _mm_loadu_ps(wRe + j);
+            const __m128 wi = _mm_loadu_ps(wIm + j);
+            const __m128 br = _mm_loadu_ps(bRe + j);
+            const __m128 bi = _mm_loadu_ps(bIm + j);
+            const __m128 tr = _mm_sub_ps(_mm_mul_ps(br, wr), _mm_mul_ps(bi, wi));
+            const __m128 ti = _mm_add_ps(_mm_mul_ps(br, wi), _mm_mul_ps(bi, wr));
+            const __m128 ar = _mm_loadu_ps(aRe + j);
+            const __m128 ai = _mm_loadu_ps(aIm + j);
+            _mm_storeu_ps(aRe + j, _mm_add_ps(ar, tr));
+            _mm_storeu_ps(aIm + j, _mm_add_ps(ai, ti));
+            _mm_storeu_ps(bRe + j, _mm_sub_ps(ar, tr));
+            _mm_storeu_ps(bIm + j, _mm_sub_ps(ai, ti));
+        }
+#elif defined(KNOUX_FFT_NEON)
+        for (size_t j = 0; j < h; j += 4) {
+            const float32x4_t wr = vld1q_f32(wRe + j);
+            const float32x4_t wi = vld1q_f32(wIm + j);
+            const float32x4_t br = vld1q_f32(bRe + j);
+            const float32x4_t bi = vld1q_f32(bIm + j);
+            const float32x4_t tr = vmlsq_f32(vmulq_f32(br, wr), bi, wi);
+            const float32x4_t ti = vmlaq_f32(vmulq_f32(br, wi), bi, wr);
+            const float32x4_t ar = vld1q_f32(aRe + j);
+            const float32x4_t ai = vld1q_f32(aIm + j);
+            vst1q_f32(aRe + j, vaddq_f32(ar, tr));
+            vst1q_f32(aIm + j, vaddq_f32(ai, ti));
+            vst1q_f32(bRe + j, vsubq_f32(ar, tr));
+            vst1q_f32(bIm + j, vsubq_f32(ai, ti));
+        }
+#else
+        for (size_t j = 0; j < h; ++j) {
+            const float tr = bRe[j] * wRe[j] - bIm[j] * wIm[j];
+            const float ti = bRe[j] * wIm[j] + bIm[j] * wRe[j];
+            const float ar = aRe[j];
+            const float ai = aIm[j];
+            aRe[j] = ar + tr;
+            aIm[j] = ai + ti;
+            bRe[j] = ar - tr;
+            bIm[j] = ai - ti;
+        }
+#endif
+    }
+}
+
+} // namespace
+
+RealFft::RealFft(size_t size) {
+    m_size = 8;
+    while (m_size < size) {
+        m_size <<= 1;
+    }
+    m_half = m_size / 2;
+
+    size_t bits = 0;
+    while ((size_t(1) << bits) < m_half) {
+        ++bits;
+    }
+    m_bitReverse.resize(m_half);
+    for (size_t i = 0; i < m_half; ++i) {
+        size_t reversed = 0;
+        for (size_t b = 0; b < bits; ++b) {
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        m_bitReverse[i] = reversed;
+    }
+
+    m_twiddleRe.assign(m_half, 0.0f);
+    m_twiddleIm.assign(m_half, 0.0f);
+    for (size_t h = 4; h < m_half; h <<= 1) {
+        for (size_t j = 0; j < h; ++j) {
+            const double angle = -kPi * static_cast<double>(j) / static_cast<double>(h);
+            m_twiddleRe[h - 1 + j] = static_cast<float>(std::cos(angle));
+            m_twiddleIm[h - 1 + j] = static_cast<float>(std::sin(angle));
+        }
+    }
+
+    m_splitRe.resize(m_half + 1);
+    m_splitIm.resize(m_half + 1);
+    for (size_t k = 0; k <= m_half; ++k) {
+        const double angle = -2.0 * kPi * static_cast<double>(k) / static_cast<double>(m_size);
+        m_splitRe[k] = static_cast<float>(std::cos(angle));
+        m_splitIm[k] = static_cast<float>(std::sin(angle));
+    }
+
+    m_re.resize(m_half);
+    m_im.resize(m_half);
+}
+
+void RealFft::Forward(const float* input, float* real, float* imag) {
+    // Pack even samples as real and odd samples as imaginary parts, in bit-reversed order
+    for (size_t i = 0; i < m_half; ++i) {
+        const size_t source = 2 * m_bitReverse[i];
+        m_re[i] = input[source];
+        m_im[i] = input[source + 1];
+    }
+    Transform();
+
+    // Split: X[k] = E[k] + W^k O[k] with E and O the spectra of the even and odd samples
+    const float* zRe = m_re.data();
+    const float* zIm = m_im.data();
+    for (size_t k = 0; k <= m_half; ++k) {
+        const size_t a = k == m_half ? 0 : k;
+        const size_t b = k == 0 ? 0 : m_half - k;
+        const float evenRe = 0.5f * (zRe[a] + zRe[b]);
+        const float evenIm = 0.5f * (zIm[a] - zIm[b]);
+        const float oddRe = 0.5f * (zIm[a] + zIm[b]);
+        const float oddIm = -0.5f * (zRe[a] - zRe[b]);
+        real[k] = evenRe + m_splitRe[k] * oddRe - m_splitIm[k] * oddIm;
+        imag[k] = evenIm + m_splitRe[k] * oddIm + m_splitIm[k] * oddRe;
+    }
+}
+
+void RealFft::Transform() {
+    float* re = m_re.data();
+    float* im = m_im.data();
+
+    // Spans 1 and 2 as one radix-4 pass; their twiddles are 1 and -i
+    for (size_t k = 0; k < m_half; k += 4) {
+        const float r0 = re[k] + re[k + 1], i0 = im[k] + im[k + 1];
+        const float r1 = re[k] - re[k + 1], i1 = im[k] - im[k + 1];
+        const float r2 = re[k + 2] + re[k + 3], i2 = im[k + 2] + im[k + 3];
+        const float r3 = re[k + 2] - re[k + 3], i3 = im[k + 2] - im[k + 3];
+        re[k] = r0 + r2;
+        im[k] = i0 + i2;
+        re[k + 2] = r0 - r2;
+        im[k + 2] = i0 - i2;
+        // (r3, i3) * -i = (i3, -r3)
+        re[k + 1] = r1 + i3;
+        im[k + 1] = i1 - r3;
+        re[k + 3] = r1 - i3;
+        im[k + 3] = i1 + r3;
+    }
+
+    for (size_t h = 4; h < m_half; h <<= 1) {
+        ButterflyStage(re, im, m_half, h, m_twiddleRe.data() + h - 1, m_twiddleIm.data() + h - 1);
+    }
+}
+
+} // namespace knoux::core::engine
@@ -0,0 +1,65 @@
+﻿#pragma once
+
+#include <vector>
+#include <cstddef>
+
+namespace knoux::core::engine {
+
+/**
+ * @class RealFft
+ * @brief Forward FFT of real input, power-of-two sizes.
+ *
+ * An n-point real transform is computed as an n/2-point complex FFT of
+ * the even/odd samples packed as real/imaginary parts, followed by a
+ * split step that separates the two spectra. The complex FFT is an
+ * iterative radix-2 decimation in time over separate real and imaginary
+ * arrays, so the butterflies of every stage from span 4 on run four at a
+ * time with SSE2 or NEON; the two first stages are fused into one scalar
+ * radix-4 pass.
+ *
+ * Twiddles and the bit-reversal table are built once per size; Forward()
+ * does not allocate.
+ */
+class RealFft {
+public:
+    /**
+     * @param size Transform size; rounded up to a power of two, minimum 8
+     */
+    explicit RealFft(size_t size);
+
+    size_t Size() const { return m_size; }
+
+    // Number of output bins, DC to Nyquist
+    size_t Bins() const { return m_size / 2 + 1; }
+
+    /**
+     * @brief Transforms Size() real samples
+     * @param input Real samples
+     * @param real Receives Bins() real parts
+     * @param imag Receives Bins() imaginary parts
+     */
+    void Forward(const float* input, float* real, float* imag);
+
+private:
+    // Helper: In-place complex FFT of m_re/m_im after bit-reversed loading
+    void Transform();
+
+    size_t m_size = 0;
+    size_t m_half = 0;  // Complex FFT size
+
+    std::vector<size_t> m_bitReverse;
+
+    // Twiddles of the stage with span h at offset h - 1 (h = 4, 8, ...; earlier stages need none)
+    std::vector<float> m_twiddleRe;
+    std::vector<float> m_twiddleIm;
+
+    // exp(-2 pi i k / size) for the split step, k = 0..size/2
+    std::vector<float> m_splitRe;
+    std::vector<float> m_splitIm;
+
+    // Complex FFT work buffers
+    std::vector<float> m_re;
+    std::vector<float> m_im;
+};
+
+} // namespace knoux::core::engine
@@ -0,0 +1,295 @@
+﻿#include "seek_index.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+
+namespace knoux::core::engine {
+
+namespace {
+
+constexpr char kCacheMagic[4] = { 'K', 'X', 'S', 'I' };
+constexpr uint32_t kCacheVersion = 1;
+
+inline uint64_t ZigZag(int64_t v) { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+inline int64_t UnZigZag(uint64_t v) { return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+
+void WriteVarint(std::vector<uint8_t>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+bool ReadVarint(const uint8_t*& p, const uint8_t* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        const uint8_t b = *p++;
+        v |= static_cast<uint64_t>(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void WriteLE(std::vector<uint8_t>& out, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+}
+
+uint64_t ReadLE(const uint8_t* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; --i) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+} // namespace
+
+SeekIndex::SeekIndex(std::vector<SeekPoint> points) {
+    if (points.empty()) {
+        return;
+    }
+
+    // Keep the earliest byte position when several entries share a time (e.g. one per track)
+    std::sort(points.begin(), points.end(), [](const SeekPoint& a, const SeekPoint& b) {
+        return a.timeUs != b.timeUs ? a.timeUs < b.timeUs : a.offset < b.offset;
+    });
+    points.erase(std::unique(points.begin(), points.end(), [](const SeekPoint& a, const SeekPoint& b) {
+        return a.timeUs == b.timeUs;
+    }), points.end());
+
+    m_count = points.size();
+    m_first = points.front();
+    m_deltas.reserve(points.size() * 5);
+    for (size_t i = 1; i < points.size(); ++i) {
+        WriteVarint(m_deltas, static_cast<uint64_t>(points[i].timeUs - points[i - 1].timeUs));
+        WriteVarint(m_deltas, ZigZag(static_cast<int64_t>(points[i].offset - points[i - 1].offset)));
+    }
+    m_deltas.shrink_to_fit();
+    BuildCheckpoints(m_first);
+}
+
+bool SeekIndex::Find(int64_t timeUs, SeekPoint& point) const {
+    if (m_count == 0) {
+        return false;
+    }
+    if (timeUs <= m_first.timeUs) {
+        point = m_first;
+        return true;
+    }
+
+    // Last checkpoint at or before the target, then decode within its block
+    const auto it = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), timeUs,
+        [](int64_t t, const Checkpoint& c) { return t < c.timeUs; });
+    const Checkpoint& block = *std::prev(it);
+    const size_t blockIndex = static_cast<size_t>(std::distance(m_checkpoints.begin(), it)) - 1;
+    const size_t remaining = std::min(kBlockSize - 1, m_count - 1 - blockIndex * kBlockSize);
+
+    point = { block.timeUs, block.offset };
+    const uint8_t* p = m_deltas.data() + block.bytePos;
+    const uint8_t* end = m_deltas.data() + m_deltas.size();
+    for (size_t i = 0; i < remaining; ++i) {
+        uint64_t dt = 0;
+        uint64_t doff = 0;
+        if (!ReadVarint(p, end, dt) || !ReadVarint(p, end, doff)) {
+            break;
+        }
+        const int64_t t = point.timeUs + static_cast<int64_t>(dt);
+        if (t > timeUs) {
+            break;
+        }
+        point.timeUs = t;
+        point.offset += static_cast<uint64_t>(UnZigZag(doff));
+    }
+    return true;
+}
+
+std::vector<SeekPoint> SeekIndex::Points() const {
+    std::vector<SeekPoint> points;
+    if (m_count == 0) {
+        return points;
+    }
+
+    points.reserve(m_count);
+    points.push_back(m_first);
+    const uint8_t* p = m_deltas.data();
+    const uint8_t* end = p + m_deltas.size();
+    for (size_t i = 1; i < m_count; ++i) {
+        uint64_t dt = 0;
+        uint64_t doff = 0;
+        if (!ReadVarint(p, end, dt) || !ReadVarint(p, end, doff)) {
+            break;
+        }
+        const SeekPoint& prev = points.back();
+        points.push_back({ prev.timeUs + static_cast<int64_t>(dt), prev.offset + static_cast<uint64_t>(UnZigZag(doff)) });
+    }
+    return points;
+}
+
+size_t SeekIndex::MemoryBytes() const {
+    return m_deltas.capacity() + m_checkpoints.capacity() * sizeof(Checkpoint);
+}
+
+void SeekIndex::Serialize(std::vector<uint8_t>& out) const {
+    WriteVarint(out, m_count);
+    WriteVarint(out, ZigZag(m_first.timeUs));
+    WriteVarint(out, m_first.offset);
+    WriteVarint(out, m_deltas.size());
+    out.insert(out.end(), m_deltas.begin(), m_deltas.end());
+}
+
+bool SeekIndex::Deserialize(const uint8_t* data, size_t size) {
+    *this = SeekIndex();
+
+    const uint8_t* p = data;
+    const uint8_t* end = data + size;
+    uint64_t count = 0;
+    uint64_t firstTime = 0;
+    uint64_t firstOffset = 0;
+    uint64_t deltaBytes = 0;
+    if (!ReadVarint(p, end, count) || !ReadVarint(p, end, firstTime) || !ReadVarint(p, end, firstOffset) ||
+        !ReadVarint(p, end, deltaBytes) || deltaBytes != static_cast<uint64_t>(end - p) || deltaBytes > UINT32_MAX) {
+        return false;
+    }
+    if (count == 0) {
+        return deltaBytes == 0;
+    }
+
+    m_count = static_cast<size_t>(count);
+    m_first = { UnZigZag(firstTime), firstOffset };
+    m_deltas.assign(p, end);
+    if (!BuildCheckpoints(m_first)) {
+        *this = SeekIndex();
+        return false;
+    }
+    return true;
+}
+
+bool SeekIndex::BuildCheckpoints(const SeekPoint& first) {
+    m_checkpoints.clear();
+    m_checkpoints.reserve((m_count + kBlockSize - 1) / kBlockSize);
+    m_checkpoints.push_back({ first.timeUs, first.offset, 0 });
+
+    SeekPoint point = first;
+    const uint8_t* begin = m_deltas.data();
+    const uint8_t* p = begin;
+    const uint8_t* end = begin + m_deltas.size();
+    for (size_t i = 1; i < m_count; ++i) {
+        uint64_t dt = 0;
+        uint64_t doff = 0;
+        if (!ReadVarint(p, end, dt) || !ReadVarint(p, end, doff)) {
+            return false;
+        }
+        point.timeUs += static_cast<int64_t>(dt);
+        point.offset += static_cast<uint64_t>(UnZigZag(doff));
+        if (i % kBlockSize == 0) {
+            m_checkpoints.push_back({ point.timeUs, point.offset, static_cast<uint32_t>(p - begin) });
+        }
+    }
+    return p == end;
+}
+
+SeekIndexCache::SeekIndexCache() {
+    std::error_code ec;
+    const std::filesystem::path temp = std::filesystem::temp_directory_path(ec);
+    m_directory = ((ec ? std::filesystem::path(".") : temp) / "knoux" / "seek-index").string();
+}
+
+SeekIndexCache::SeekIndexCache(std::string directory)
+    : m_directory(std::move(directory))
+{
+}
+
+bool SeekIndexCache::Load(const std::string& mediaPath, SeekIndex& index) const {
+    system::FileIdentity identity;
+    if (!system::ReadFileIdentity(mediaPath, identity)) {
+        return false;
+    }
+
+    std::ifstream in(EntryPath(identity), std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    const std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    // magic, version, size, mtime, path length
+    constexpr size_t kHeaderSize = 4 + 4 + 8 + 8 + 4;
+    if (bytes.size() < kHeaderSize + 12 || !std::equal(kCacheMagic, kCacheMagic + 4, bytes.begin())) {
+        return false;
+    }
+
+    const uint8_t* p = bytes.data() + 4;
+    const uint8_t* end = bytes.data() + bytes.size();
+    const size_t pathLength = static_cast<size_t>(ReadLE(p + 20, 4));
+    if (ReadLE(p, 4) != kCacheVersion || ReadLE(p + 4, 8) != identity.size ||
+        static_cast<int64_t>(ReadLE(p + 12, 8)) != identity.modified ||
+        pathLength != identity.path.size() || static_cast<size_t>(end - (p + 24)) < pathLength + 12 ||
+        !std::equal(identity.path.begin(), identity.path.end(), p + 24)) {
+        return false;
+    }
+
+    // Hash collisions and stale entries both land here as a plain miss
+    p += 24 + pathLength;
+    const uint64_t payloadSize = ReadLE(p, 4);
+    const uint64_t checksum = ReadLE(p + 4, 8);
+    p += 12;
+    if (payloadSize != static_cast<uint64_t>(end - p) || system::HashBytes(p, payloadSize) != checksum) {
+        return false;
+    }
+    return index.Deserialize(p, static_cast<size_t>(payloadSize));
+}
+
+bool SeekIndexCache::Store(const std::string& mediaPath, const SeekIndex& index) const {
+    system::FileIdentity identity;
+    if (!system::ReadFileIdentity(mediaPath, identity)) {
+        return false;
+    }
+
+    std::vector<uint8_t> payload;
+    index.Serialize(payload);
+
+    std::vector<uint8_t> bytes(kCacheMagic, kCacheMagic + 4);
+    WriteLE(bytes, kCacheVersion, 4);
+    WriteLE(bytes, identity.size, 8);
+    WriteLE(bytes, static_cast<uint64_t>(identity.modified), 8);
+    WriteLE(bytes, identity.path.size(), 4);
+    bytes.insert(bytes.end(), identity.path.begin(), identity.path.end());
+    WriteLE(bytes, payload.size(), 4);
+    WriteLE(bytes, system::HashBytes(payload.data(), payload.size()), 8);
+    bytes.insert(bytes.end(), payload.begin(), payload.end());
+
+    try {
+        std::filesystem::create_directories(m_directory);
+
+        const std::string entry = EntryPath(identity);
+        const std::string staging = entry + ".tmp";
+        {
+            std::ofstream out(staging, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+            if (!out) {
+                std::filesystem::remove(staging);
+                return false;
+            }
+        }
+        std::filesystem::rename(staging, entry);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+std::string SeekIndexCache::EntryPath(const system::FileIdentity& identity) const {
+    const uint64_t key = system::HashBytes(identity.path.data(), identity.path.size());
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.kidx", static_cast<unsigned long long>(key));
+    return (std::filesystem::path(m_directory) / name).string();
+}
+
+} // namespace knoux::core::engine
@@ -0,0 +1,135 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "container_parser.h"
+#include "core/system/file_identity.h"
+
+namespace knoux::core::engine {
+
+/**
+ * @class SeekIndex
+ * @brief Compact, immutable keyframe index (presentation time -> byte offset).
+ *
+ * Points are sorted by time and stored as zig-zag varint deltas of both
+ * time and offset, so a keyframe typically costs 4-6 bytes instead of 16.
+ * Every kBlockSize-th point is also kept as an absolute checkpoint; Find()
+ * binary-searches the checkpoints and decodes at most one block, which
+ * keeps lookups O(log n) on multi-hour files.
+ *
+ * Immutable after construction, so it can be shared between threads.
+ */
+class SeekIndex {
+public:
+    SeekIndex() = default;
+
+    /**
+     * @brief Builds the index from unordered keyframe positions
+     * @param points Keyframes; duplicates and out-of-order entries are tolerated
+     */
+    explicit SeekIndex(std::vector<SeekPoint> points);
+
+    /**
+     * @brief Finds the last keyframe at or before a time
+     * @param timeUs Target presentation time in microseconds
+     * @param point Receives the keyframe (the first one if timeUs precedes it)
+     * @return false if the index is empty
+     */
+    bool Find(int64_t timeUs, SeekPoint& point) const;
+
+    /**
+     * @brief Decodes every point (debugging, re-encoding)
+     */
+    std::vector<SeekPoint> Points() const;
+
+    size_t Size() const { return m_count; }
+    bool Empty() const { return m_count == 0; }
+
+    /**
+     * @brief Returns the heap footprint of the encoded index in bytes
+     */
+    size_t MemoryBytes() const;
+
+    /**
+     * @brief Appends the encoded index to a byte buffer
+     */
+    void Serialize(std::vector<uint8_t>& out) const;
+
+    /**
+     * @brief Restores an index written by Serialize()
+     * @return false if the buffer is truncated or inconsistent
+     */
+    bool Deserialize(const uint8_t* data, size_t size);
+
+    // Points per absolute checkpoint
+    static constexpr size_t kBlockSize = 64;
+
+private:
+    struct Checkpoint {
+        int64_t timeUs = 0;
+        uint64_t offset = 0;
+        uint32_t bytePos = 0;  // Position of the point following this one in m_deltas
+    };
+
+    // Helper: Rebuilds m_checkpoints by walking m_deltas
+    bool BuildCheckpoints(const SeekPoint& first);
+
+    size_t m_count = 0;
+    SeekPoint m_first;
+    std::vector<uint8_t> m_deltas;
+    std::vector<Checkpoint> m_checkpoints;
+};
+
+/**
+ * @class SeekIndexCache
+ * @brief On-disk sidecar store for seek indices.
+ *
+ * Saves the payload scan of files without a stored index and, together
+ * with the metadata store, lets a reopened file skip parsing entirely.
+ *
+ * Entries are keyed by file identity (canonical path, size and
+ * modification time), so an edited or replaced file misses instead of
+ * seeking to stale offsets. Each entry is one small file under the cache
+ * directory, written to a temporary name and renamed into place so a
+ * crash never leaves a torn entry behind.
+ *
+ * Stateless apart from the directory; safe to call concurrently.
+ */
+class SeekIndexCache {
+public:
+    /**
+     * @brief Uses <temp>/knoux/seek-index
+     */
+    SeekIndexCache();
+
+    /**
+     * @param directory Directory holding the sidecar files (created on first Store())
+     */
+    explicit SeekIndexCache(std::string directory);
+
+    /**
+     * @brief Loads the index of a media file
+     * @param mediaPath Media file the index belongs to
+     * @param index Receives the cached index
+     * @return false on a miss (no entry, file changed, corrupt entry)
+     */
+    bool Load(const std::string& mediaPath, SeekIndex& index) const;
+
+    /**
+     * @brief Stores the index of a media file, replacing any previous entry
+     * @return false if the file identity could not be read or the write failed
+     */
+    bool Store(const std::string& mediaPath, const SeekIndex& index) const;
+
+    const std::string& Directory() const { return m_directory; }
+
+private:
+    // Helper: Sidecar file name for an identity
+    std::string EntryPath(const system::FileIdentity& identity) const;
+
+    std::string m_directory;
+};
+
+} // namespace knoux::core::engine
@@ -0,0 +1,312 @@
+﻿#include "shared_audio_ring.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+#endif
+
+namespace knoux::core::engine {
+
+static_assert(offsetof(SharedAudioHeader, writeFrame) == 64, "writeFrame offset is part of the protocol");
+static_assert(offsetof(SharedAudioHeader, readFrame) == 128, "readFrame offset is part of the protocol");
+static_assert(offsetof(SharedAudioHeader, underruns) == 132, "underruns offset is part of the protocol");
+static_assert(offsetof(SharedAudioHeader, underrunFrames) == 136, "underrunFrames offset is part of the protocol");
+static_assert(offsetof(SharedAudioHeader, consumerWaiting) == 68, "consumerWaiting offset is part of the protocol");
+static_assert(offsetof(SharedAudioHeader, producerWaiting) == 140, "producerWaiting offset is part of the protocol");
+static_assert(offsetof(SharedAudioHeader, sampleRate) == 12, "sampleRate offset is part of the protocol");
+static_assert(sizeof(SharedAudioHeader) <= SharedAudioHeader::kDataOffset, "header overlaps the samples");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "counters must be lock-free to be shared");
+
+namespace {
+
+// Helper: Sleeps while word holds expected, up to timeout; process-shared, so the other process can wake it
+void WaitOnWord(std::atomic<uint32_t>& word, uint32_t expected, std::chrono::microseconds timeout) {
+#ifdef __linux__
+    const timespec limit{ static_cast<time_t>(timeout.count() / 1000000),
+                          static_cast<long>(timeout.count() % 1000000 * 1000) };
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, &limit, nullptr, 0);
+#else
+    if (word.load(std::memory_order_acquire) == expected) {
+        std::this_thread::sleep_for(std::min(timeout, SharedAudioRing::kFallbackWait));
+    }
+#endif
+}
+
+// Helper: Wakes every WaitOnWord() sleeping on word
+void WakeWord(std::atomic<uint32_t>& word) {
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#else
+    (void)word;
+#endif
+}
+
+// Helper: One side's sleep on the other side's counter, announced through waiting
+bool WaitForChange(std::atomic<uint32_t>& counter, std::atomic<uint32_t>& waiting, uint32_t seen,
+                   std::chrono::microseconds timeout) {
+    // Announce before the last look, so a publish either is seen here or sees the flag (see Publish)
+    waiting.store(1, std::memory_order_seq_cst);
+    if (counter.load(std::memory_order_seq_cst) == seen) {
+        WaitOnWord(counter, seen, timeout);
+    }
+    waiting.store(0, std::memory_order_relaxed);
+    return counter.load(std::memory_order_acquire) != seen;
+}
+
+// Helper: Stores a counter and wakes the other side if it announced a wait
+void Publish(std::atomic<uint32_t>& counter, std::atomic<uint32_t>& waiting, uint32_t value) {
+    counter.store(value, std::memory_order_seq_cst);
+    if (waiting.load(std::memory_order_seq_cst) != 0) {
+        WakeWord(counter);
+    }
+}
+
+} // namespace
+
+SharedAudioRing::~SharedAudioRing() {
+    Close();
+}
+
+size_t SharedAudioRing::RegionSize(size_t capacityFrames, size_t channels) {
+    return SharedAudioHeader::kDataOffset + capacityFrames * channels * sizeof(float);
+}
+
+bool SharedAudioRing::Create(const std::string& name, size_t capacityFrames, size_t channels, uint32_t sampleRate) {
+    Close();
+    if (channels == 0 || capacityFrames == 0 || capacityFrames > kMaxCapacityFrames) {
+        return false;
+    }
+
+    size_t capacity = 1;
+    while (capacity < capacityFrames) {
+        capacity <<= 1;
+    }
+
+    if (!m_memory.Create(name, RegionSize(capacity, channels))) {
+        return false;
+    }
+
+    // The region is zero-filled, so placement-new only gives the atomics their type
+    auto* header = new (m_memory.Data()) SharedAudioHeader();
+    header->version = SharedAudioHeader::kVersion;
+    header->channels = static_cast<uint32_t>(channels);
+    header->sampleRate.store(sampleRate, std::memory_order_relaxed);
+    header->capacityFrames = static_cast<uint32_t>(capacity);
+    header->dataOffset = SharedAudioHeader::kDataOffset;
+    header->writeFrame.store(0, std::memory_order_relaxed);
+    header->readFrame.store(0, std::memory_order_relaxed);
+    header->underruns.store(0, std::memory_order_relaxed);
+    header->underrunFrames.store(0, std::memory_order_relaxed);
+    header->consumerWaiting.store(0, std::memory_order_relaxed);
+    header->producerWaiting.store(0, std::memory_order_relaxed);
+    header->magic.store(SharedAudioHeader::kMagic, std::memory_order_release);
+
+    m_header = header;
+    m_samples = reinterpret_cast<float*>(m_memory.Data() + SharedAudioHeader::kDataOffset);
+    m_channels = channels;
+    m_capacity = capacity;
+    return true;
+}
+
+bool SharedAudioRing::Open(const std::string& name) {
+    Close();
+    if (!m_memory.Open(name) || m_memory.Size() < SharedAudioHeader::kDataOffset) {
+        m_memory.Close();
+        return false;
+    }
+
+    auto* header = reinterpret_cast<SharedAudioHeader*>(m_memory.Data());
+    const uint32_t capacity = header->capacityFrames;
+    const uint32_t channels = header->channels;
+    if (header->magic.load(std::memory_order_acquire) != SharedAudioHeader::kMagic ||
+        header->version != SharedAudioHeader::kVersion ||
+        header->dataOffset != SharedAudioHeader::kDataOffset ||
+        channels == 0 || capacity == 0 || (capacity & (capacity - 1)) != 0 ||
+        capacity > kMaxCapacityFrames ||
+        m_memory.Size() < RegionSize(capacity, channels)) {
+        m_memory.Close();
+        return false;
+    }
+
+    m_header = header;
+    m_samples = reinterpret_cast<float*>(m_memory.Data() + SharedAudioHeader::kDataOffset);
+    m_channels = channels;
+    m_capacity = capacity;
+    return true;
+}
+
+void SharedAudioRing::Close() {
+    m_memory.Close();
+    m_header = nullptr;
+    m_samples = nullptr;
+    m_channels = 0;
+    m_capacity = 0;
+
+    m_polledFrame = 0;
+    m_framesWritten = 0;
+    m_framesConsumed = 0;
+    m_checkpointHead = 0;
+    m_checkpointCount = 0;
+    m_lastLatencyUs = 0;
+    m_maxLatencyUs = 0;
+    m_totalLatencyUs = 0;
+    m_latencySamples = 0;
+}
+
+size_t SharedAudioRing::Writable() const {
+    if (!m_header) {
+        return 0;
+    }
+    const uint32_t write = m_header->writeFrame.load(std::memory_order_relaxed);
+    const uint32_t read = m_header->readFrame.load(std::memory_order_acquire);
+    const size_t queued = static_cast<uint32_t>(write - read);
+    // A consumer writing garbage positions must not push the producer out of bounds
+    return queued >= m_capacity ? 0 : m_capacity - queued;
+}
+
+size_t SharedAudioRing::Write(const float* samples, size_t frames) {
+    frames = std::min(frames, Writable());
+    if (frames == 0) {
+        return 0;
+    }
+
+    const uint32_t write = m_header->writeFrame.load(std::memory_order_relaxed);
+    const size_t start = write & (m_capacity - 1);
+    const size_t first = std::min(frames, m_capacity - start);
+    std::memcpy(m_samples + start * m_channels, samples, first * m_channels * sizeof(float));
+    if (first < frames) {
+        std::memcpy(m_samples, samples + first * m_channels, (frames - first) * m_channels * sizeof(float));
+    }
+
+    const uint32_t end = write + static_cast<uint32_t>(frames);
+    Publish(m_header->writeFrame, m_header->consumerWaiting, end);
+    m_framesWritten += frames;
+
+    const size_t slot = (m_checkpointHead + m_checkpointCount) % kLatencyCheckpoints;
+    if (m_checkpointCount == kLatencyCheckpoints) {
+        // Full: forget the oldest buffer rather than the newest
+        m_checkpointHead = (m_checkpointHead + 1) % kLatencyCheckpoints;
+    } else {
+        m_checkpointCount++;
+    }
+    m_checkpoints[slot] = { end, NowUs() };
+    return frames;
+}
+
+size_t SharedAudioRing::Poll() {
+    if (!m_header) {
+        return 0;
+    }
+
+    const uint32_t write = m_header->writeFrame.load(std::memory_order_relaxed);
+    const uint32_t read = m_header->readFrame.load(std::memory_order_acquire);
+    // The consumer can only have taken what was written since the last poll
+    const uint32_t pending = write - m_polledFrame;
+    const uint32_t consumed = std::min(static_cast<uint32_t>(read - m_polledFrame), pending);
+    if (consumed == 0) {
+        return 0;
+    }
+    m_polledFrame += consumed;
+    m_framesConsumed += consumed;
+
+    const int64_t now = NowUs();
+    while (m_checkpointCount > 0) {
+        const Checkpoint& checkpoint = m_checkpoints[m_checkpointHead];
+        // Finished once the consumer is at or past its last frame (wrap-safe)
+        if (static_cast<int32_t>(m_polledFrame - checkpoint.endFrame) < 0) {
+            break;
+        }
+        m_lastLatencyUs = now - checkpoint.writtenUs;
+        m_maxLatencyUs = std::max(m_maxLatencyUs, m_lastLatencyUs);
+        m_totalLatencyUs += m_lastLatencyUs;
+        m_latencySamples++;
+        m_checkpointHead = (m_checkpointHead + 1) % kLatencyCheckpoints;
+        m_checkpointCount--;
+    }
+    return consumed;
+}
+
+size_t SharedAudioRing::Read(float* out, size_t frames) {
+    if (!m_header) {
+        std::fill(out, out + frames * m_channels, 0.0f);
+        return 0;
+    }
+
+    const uint32_t read = m_header->readFrame.load(std::memory_order_relaxed);
+    const uint32_t write = m_header->writeFrame.load(std::memory_order_acquire);
+    const size_t queued = std::min<size_t>(static_cast<uint32_t>(write - read), m_capacity);
+    const size_t count = std::min(frames, queued);
+
+    const size_t start = read & (m_capacity - 1);
+    const size_t first = std::min(count, m_capacity - start);
+    std::memcpy(out, m_samples + start * m_channels, first * m_channels * sizeof(float));
+    if (first < count) {
+        std::memcpy(out + first * m_channels, m_samples, (count - first) * m_channels * sizeof(float));
+    }
+    PublishRead(read + static_cast<uint32_t>(count));
+
+    if (count < frames) {
+        std::fill(out + count * m_channels, out + frames * m_channels, 0.0f);
+        m_header->underruns.fetch_add(1, std::memory_order_relaxed);
+        m_header->underrunFrames.fetch_add(static_cast<uint32_t>(frames - count), std::memory_order_relaxed);
+    }
+    return count;
+}
+
+void SharedAudioRing::PublishRead(uint32_t readFrame) {
+    if (m_header) {
+        Publish(m_header->readFrame, m_header->producerWaiting, readFrame);
+    }
+}
+
+void SharedAudioRing::SetSampleRate(uint32_t sampleRate) {
+    if (m_header) {
+        m_header->sampleRate.store(sampleRate, std::memory_order_relaxed);
+    }
+}
+
+bool SharedAudioRing::WaitForWrite(uint32_t seenWrite, std::chrono::microseconds timeout) {
+    return m_header && WaitForChange(m_header->writeFrame, m_header->consumerWaiting, seenWrite, timeout);
+}
+
+bool SharedAudioRing::WaitForRead(uint32_t seenRead, std::chrono::microseconds timeout) {
+    return m_header && WaitForChange(m_header->readFrame, m_header->producerWaiting, seenRead, timeout);
+}
+
+void SharedAudioRing::Interrupt() {
+    if (m_header) {
+        WakeWord(m_header->writeFrame);
+        WakeWord(m_header->readFrame);
+    }
+}
+
+SharedAudioRing::Stats SharedAudioRing::GetStats() const {
+    Stats stats;
+    if (!m_header) {
+        return stats;
+    }
+    stats.framesWritten = m_framesWritten;
+    stats.framesConsumed = m_framesConsumed;
+    stats.queuedFrames = m_capacity - Writable();
+    stats.underruns = m_header->underruns.load(std::memory_order_relaxed);
+    stats.underrunFrames = m_header->underrunFrames.load(std::memory_order_relaxed);
+    stats.lastLatencyUs = m_lastLatencyUs;
+    stats.maxLatencyUs = m_maxLatencyUs;
+    stats.latencySamples = m_latencySamples;
+    stats.avgLatencyUs = m_latencySamples ? m_totalLatencyUs / static_cast<int64_t>(m_latencySamples) : 0;
+    return stats;
+}
+
+int64_t SharedAudioRing::NowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace knoux::core::engine
@@ -0,0 +1,232 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include "core/system/shared_memory.h"
+
+namespace knoux::core::engine {
+
+/**
+ * @struct SharedAudioHeader
+ * @brief Control block at the start of a shared audio ring.
+ *
+ * The layout is the protocol: the renderer reads it from JavaScript
+ * through an Int32Array (index = byte offset / 4), so offsets are fixed:
+ *
+ *   0  magic, version, channels, sampleRate, capacityFrames, dataOffset
+ *  64  writeFrame      producer: frames written so far
+ *  68  consumerWaiting consumer: nonzero while it sleeps on writeFrame
+ * 128  readFrame       consumer: frames taken so far
+ * 132  underruns       consumer: pulls it could not fully serve
+ * 136  underrunFrames  consumer: frames it zero-filled
+ * 140  producerWaiting producer: nonzero while it sleeps on readFrame
+ * 256  samples         interleaved float32, frame f at (f mod capacityFrames)
+ *
+ * Positions are free-running 32-bit counters; queued = writeFrame -
+ * readFrame in unsigned arithmetic, which holds because capacityFrames
+ * is a power of two well below 2^31. Each side publishes its counter
+ * with a release store after touching the samples, and loads the other
+ * side's with acquire (Atomics.load/store in JavaScript). The producer
+ * never writes past readFrame + capacityFrames, so a slow consumer
+ * makes it wait instead of being overwritten. magic is stored last, so a
+ * consumer that sees it sees an initialised header. sampleRate is
+ * atomic because the producer re-announces it when a track changes rate.
+ *
+ * A side with nothing to do sleeps on the other side's counter
+ * (WaitForWrite/WaitForRead) instead of polling it; the waiting flags
+ * let the other side skip the wake-up syscall while nobody sleeps.
+ * JavaScript consumers never wait and may ignore both flags.
+ */
+struct SharedAudioHeader {
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint32_t channels;
+    std::atomic<uint32_t> sampleRate;
+    uint32_t capacityFrames;
+    uint32_t dataOffset;
+
+    alignas(64) std::atomic<uint32_t> writeFrame;
+    std::atomic<uint32_t> consumerWaiting;
+
+    alignas(64) std::atomic<uint32_t> readFrame;
+    std::atomic<uint32_t> underruns;
+    std::atomic<uint32_t> underrunFrames;
+    std::atomic<uint32_t> producerWaiting;
+
+    static constexpr uint32_t kMagic = 0x52414E4B;  // "KNAR"
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kDataOffset = 256;
+};
+
+/**
+ * @class SharedAudioRing
+ * @brief Single-producer/single-consumer PCM ring in shared memory.
+ *
+ * Carries the engine's audio output to another process without a
+ * syscall, copy or serialisation per buffer: the engine writes into the
+ * ring and the consumer (the renderer's AudioWorklet, via its mirror)
+ * reads the same memory. See SharedAudioHeader for the protocol.
+ *
+ * The producer keeps write timestamps of recent buffers; Poll() matches
+ * them against the consumer's position, which measures how long audio
+ * waited between Write() and the consumer taking it, all on the engine's
+ * clock.
+ *
+ * Exactly one thread may produce (Create, Write, Poll, SetSampleRate,
+ * WaitForRead) and one consumer may read.
+ */
+class SharedAudioRing {
+public:
+    /**
+     * @struct Stats
+     * @brief Producer-side view, counters since Create()
+     */
+    struct Stats {
+        uint64_t framesWritten = 0;
+        uint64_t framesConsumed = 0;
+        size_t queuedFrames = 0;
+        uint32_t underruns = 0;         // Reported by the consumer
+        uint32_t underrunFrames = 0;
+        int64_t lastLatencyUs = 0;      // Write() to consumer read, per buffer
+        int64_t avgLatencyUs = 0;
+        int64_t maxLatencyUs = 0;
+        uint64_t latencySamples = 0;
+    };
+
+    SharedAudioRing() = default;
+    ~SharedAudioRing();
+
+    SharedAudioRing(const SharedAudioRing&) = delete;
+    SharedAudioRing& operator=(const SharedAudioRing&) = delete;
+
+    /**
+     * @brief Producer: creates the named ring
+     * @param name Shared memory name (see SharedMemory::Create)
+     * @param capacityFrames Minimum capacity, rounded up to a power of two
+     * @param channels Interleaved channel count
+     * @param sampleRate Sample rate announced to the consumer
+     * @return false if the shared memory cannot be created
+     */
+    bool Create(const std::string& name, size_t capacityFrames, size_t channels, uint32_t sampleRate);
+
+    /**
+     * @brief Consumer: maps a ring created by another process
+     * @return false if it does not exist or its header is not a valid ring
+     */
+    bool Open(const std::string& name);
+
+    void Close();
+
+    bool IsOpen() const { return m_header != nullptr; }
+
+    size_t Channels() const { return m_channels; }
+
+    size_t CapacityFrames() const { return m_capacity; }
+
+    uint32_t SampleRate() const { return m_header ? m_header->sampleRate.load(std::memory_order_relaxed) : 0; }
+
+    /**
+     * @brief Producer: announces a new sample rate, e.g. when a track of another rate loads
+     */
+    void SetSampleRate(uint32_t sampleRate);
+
+    /**
+     * @brief Producer: frames that fit before the consumer's position
+     */
+    size_t Writable() const;
+
+    /**
+     * @brief Producer: appends up to Writable() frames and publishes them
+     * @return Frames stored
+     */
+    size_t Write(const float* samples, size_t frames);
+
+    /**
+     * @brief Producer: collects latency samples for the buffers the consumer has finished
+     * @return Frames the consumer took since the previous Poll()
+     */
+    size_t Poll();
+
+    /**
+     * @brief Consumer: copies up to frames frames, zero-filling and counting any shortfall
+     * @return Frames actually read
+     */
+    size_t Read(float* out, size_t frames);
+
+    /**
+     * @brief Consumer: publishes a position taken elsewhere (e.g. by a mirror's reader), waking a waiting producer
+     */
+    void PublishRead(uint32_t readFrame);
+
+    /**
+     * @brief Consumer: sleeps until writeFrame moves past seenWrite, Interrupt() or the timeout
+     * @return true if new frames were written
+     *
+     * Cross-process on Linux (a shared futex on writeFrame); elsewhere a
+     * short sleep of at most kFallbackWait.
+     */
+    bool WaitForWrite(uint32_t seenWrite, std::chrono::microseconds timeout);
+
+    /**
+     * @brief Producer: sleeps until readFrame moves past seenRead, Interrupt() or the timeout
+     * @return true if the consumer took frames
+     */
+    bool WaitForRead(uint32_t seenRead, std::chrono::microseconds timeout);
+
+    /**
+     * @brief Wakes both sides' waits early, e.g. before closing the ring
+     */
+    void Interrupt();
+
+    Stats GetStats() const;
+
+    /**
+     * @brief Control block, for consumers that mirror the ring (e.g. into a SharedArrayBuffer)
+     */
+    SharedAudioHeader* Header() const { return m_header; }
+
+    float* Samples() const { return m_samples; }
+
+    // Bytes of shared memory a ring of this shape occupies
+    static size_t RegionSize(size_t capacityFrames, size_t channels);
+
+    // Buffers whose latency can be pending at once; older ones are dropped from the statistics
+    static constexpr size_t kLatencyCheckpoints = 64;
+
+    static constexpr size_t kMaxCapacityFrames = size_t(1) << 24;
+
+    // Longest single sleep of a wait where no cross-process wake-up is available
+    static constexpr std::chrono::microseconds kFallbackWait{ 1000 };
+
+private:
+    struct Checkpoint {
+        uint32_t endFrame = 0;
+        int64_t writtenUs = 0;
+    };
+
+    // Helper: Monotonic time in microseconds
+    static int64_t NowUs();
+
+    system::SharedMemory m_memory;
+    SharedAudioHeader* m_header = nullptr;
+    float* m_samples = nullptr;
+    size_t m_channels = 0;
+    size_t m_capacity = 0;
+
+    // Producer only
+    uint32_t m_polledFrame = 0;
+    uint64_t m_framesWritten = 0;
+    uint64_t m_framesConsumed = 0;
+    Checkpoint m_checkpoints[kLatencyCheckpoints];
+    size_t m_checkpointHead = 0;
+    size_t m_checkpointCount = 0;
+    int64_t m_lastLatencyUs = 0;
+    int64_t m_maxLatencyUs = 0;
+    int64_t m_totalLatencyUs = 0;
+    uint64_t m_latencySamples = 0;
+};
+
+} // namespace knoux::core::engine
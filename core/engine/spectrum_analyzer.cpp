@@ -0,0 +1,248 @@
+﻿#include "spectrum_analyzer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <new>
+
+namespace knoux::core::engine {
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "sequence must be lock-free to be shared");
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+// Reader attempts before giving up on a busy writer
+constexpr int kSnapshotReadAttempts = 64;
+
+} // namespace
+
+void SpectrumSnapshot::Initialize() {
+    version = kVersion;
+    sequence.store(0, std::memory_order_relaxed);
+    frame = SpectrumFrame();
+    magic.store(kMagic, std::memory_order_release);
+}
+
+void SpectrumSnapshot::Publish(const SpectrumFrame& source) {
+    const uint32_t start = sequence.load(std::memory_order_relaxed);
+    sequence.store(start + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&frame, &source, sizeof(SpectrumFrame));
+    sequence.store(start + 2, std::memory_order_release);
+}
+
+bool SpectrumSnapshot::Read(SpectrumFrame& target) const {
+    for (int attempt = 0; attempt < kSnapshotReadAttempts; ++attempt) {
+        const uint32_t before = sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            continue;
+        }
+        std::memcpy(&target, &frame, sizeof(SpectrumFrame));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before) {
+            return true;
+        }
+    }
+    return false;
+}
+
+SpectrumAnalyzer::SpectrumAnalyzer() : SpectrumAnalyzer(Settings()) {}
+
+SpectrumAnalyzer::SpectrumAnalyzer(const Settings& settings)
+    : m_settings(settings), m_fft(settings.fftSize) {
+    m_settings.fftSize = m_fft.Size();
+    m_settings.bandCount = std::clamp<size_t>(m_settings.bandCount, 1, SpectrumFrame::kMaxBands);
+
+    const size_t size = m_fft.Size();
+    m_history.assign(size, 0.0f);
+    m_windowed.resize(size);
+    m_real.resize(m_fft.Bins());
+    m_imag.resize(m_fft.Bins());
+
+    // Periodic Hann; a full-scale sine peaks at amplitude * sum(window) / 2 in its bin
+    m_window.resize(size);
+    double windowSum = 0.0;
+    for (size_t i = 0; i < size; ++i) {
+        m_window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * kPi * static_cast<double>(i) / size));
+        windowSum += m_window[i];
+    }
+    m_powerOffsetDb = static_cast<float>(20.0 * std::log10(2.0 / windowSum));
+
+    m_peakHoldMs.assign(m_settings.bandCount, 0.0f);
+    m_snapshot.Initialize();
+    Configure(48000);
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer() {
+    ShareAs(std::string());
+}
+
+void SpectrumAnalyzer::Configure(int sampleRate) {
+    m_sampleRate = sampleRate;
+    m_hopFrames = std::max<size_t>(1, static_cast<size_t>(sampleRate / std::max(1.0f, m_settings.updateRate)));
+
+    const size_t bins = m_fft.Bins();
+    const double binHz = static_cast<double>(sampleRate) / m_fft.Size();
+    const double nyquist = sampleRate * 0.5;
+    const double low = std::clamp<double>(m_settings.minFrequency, binHz, nyquist * 0.5);
+    const double high = std::clamp<double>(m_settings.maxFrequency, low * 2.0, nyquist);
+    const size_t bands = m_settings.bandCount;
+
+    m_bandFirst.resize(bands);
+    m_bandLast.resize(bands);
+    for (size_t band = 0; band < bands; ++band) {
+        const double lower = low * std::pow(high / low, static_cast<double>(band) / bands);
+        const double upper = low * std::pow(high / low, static_cast<double>(band + 1) / bands);
+        const size_t first = static_cast<size_t>(std::ceil(lower / binHz));
+        const size_t last = std::min(bins - 1, static_cast<size_t>(std::ceil(upper / binHz)) - 1);
+        if (first <= last) {
+            m_bandFirst[band] = first;
+            m_bandLast[band] = last;
+        } else {
+            const size_t centre = std::min(bins - 1, static_cast<size_t>(std::lround(std::sqrt(lower * upper) / binHz)));
+            m_bandFirst[band] = centre;
+            m_bandLast[band] = centre;
+        }
+    }
+
+    m_frame.bandCount = static_cast<uint32_t>(bands);
+    m_frame.sampleRate = static_cast<uint32_t>(sampleRate);
+    m_frame.minFrequency = static_cast<float>(low);
+    m_frame.maxFrequency = static_cast<float>(high);
+    Reset();
+}
+
+void SpectrumAnalyzer::Reset() {
+    std::fill(m_history.begin(), m_history.end(), 0.0f);
+    m_historyPos = 0;
+    m_sinceAnalysis = 0;
+    std::fill(m_peakHoldMs.begin(), m_peakHoldMs.end(), 0.0f);
+    std::fill(std::begin(m_frame.levels), std::end(m_frame.levels), m_settings.floorDb);
+    std::fill(std::begin(m_frame.peaks), std::end(m_frame.peaks), m_settings.floorDb);
+}
+
+void SpectrumAnalyzer::Push(const float* samples, size_t frames, size_t channels, int sampleRate) {
+    if (channels == 0 || sampleRate <= 0) {
+        return;
+    }
+    if (sampleRate != m_sampleRate) {
+        Configure(sampleRate);
+    }
+
+    const size_t size = m_history.size();
+    const float scale = 1.0f / static_cast<float>(channels);
+    size_t offset = 0;
+    while (offset < frames) {
+        // Feed up to the next analysis point, so analyses fall every hop whatever the chunking
+        const size_t count = std::min(frames - offset, m_hopFrames - m_sinceAnalysis);
+        const float* frame = samples + offset * channels;
+        for (size_t i = 0; i < count; ++i, frame += channels) {
+            float sum = 0.0f;
+            for (size_t c = 0; c < channels; ++c) {
+                sum += frame[c];
+            }
+            m_history[m_historyPos] = sum * scale;
+            m_historyPos = (m_historyPos + 1) & (size - 1);
+        }
+        offset += count;
+        m_sinceAnalysis += count;
+        m_sampleIndex += count;
+
+        if (m_sinceAnalysis >= m_hopFrames) {
+            Analyze(m_sinceAnalysis);
+            m_sinceAnalysis = 0;
+        }
+    }
+}
+
+void SpectrumAnalyzer::Analyze(size_t elapsedFrames) {
+    const auto start = std::chrono::steady_clock::now();
+
+    // Oldest sample first
+    const size_t size = m_history.size();
+    const size_t tail = size - m_historyPos;
+    for (size_t i = 0; i < tail; ++i) {
+        m_windowed[i] = m_history[m_historyPos + i] * m_window[i];
+    }
+    for (size_t i = tail; i < size; ++i) {
+        m_windowed[i] = m_history[i - tail] * m_window[i];
+    }
+    m_fft.Forward(m_windowed.data(), m_real.data(), m_imag.data());
+
+    const float elapsedMs = 1000.0f * static_cast<float>(elapsedFrames) / static_cast<float>(m_sampleRate);
+    const float release = 1.0f - std::exp(-elapsedMs / std::max(1.0f, m_settings.releaseMs));
+    const float peakFall = m_settings.peakFallDbPerSecond * elapsedMs * 0.001f;
+    const float floorDb = m_settings.floorDb;
+    const float floorPower = std::pow(10.0f, (floorDb - m_powerOffsetDb) * 0.1f);
+
+    for (size_t band = 0; band < m_bandFirst.size(); ++band) {
+        float power = floorPower;
+        for (size_t bin = m_bandFirst[band]; bin <= m_bandLast[band]; ++bin) {
+            power = std::max(power, m_real[bin] * m_real[bin] + m_imag[bin] * m_imag[bin]);
+        }
+        const float db = std::max(floorDb, 10.0f * std::log10(power) + m_powerOffsetDb);
+
+        float& level = m_frame.levels[band];
+        level = db >= level ? db : level + (db - level) * release;
+
+        float& peak = m_frame.peaks[band];
+        if (level >= peak) {
+            peak = level;
+            m_peakHoldMs[band] = m_settings.peakHoldMs;
+        } else if (m_peakHoldMs[band] > 0.0f) {
+            m_peakHoldMs[band] -= elapsedMs;
+        } else {
+            peak = std::max(level, peak - peakFall);
+        }
+    }
+
+    m_frame.frameIndex++;
+    m_frame.sampleIndex = m_sampleIndex;
+    m_snapshot.Publish(m_frame);
+    if (m_shared) {
+        m_shared->Publish(m_frame);
+    }
+
+    const int64_t elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    m_lastAnalysisNs.store(elapsedNs, std::memory_order_relaxed);
+    m_totalAnalysisNs.fetch_add(elapsedNs, std::memory_order_relaxed);
+    if (elapsedNs > m_maxAnalysisNs.load(std::memory_order_relaxed)) {
+        m_maxAnalysisNs.store(elapsedNs, std::memory_order_relaxed);
+    }
+    m_framesAnalyzed.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool SpectrumAnalyzer::ShareAs(const std::string& name) {
+    m_shared = nullptr;
+    m_sharedMemory.Close();
+    if (name.empty()) {
+        return true;
+    }
+    if (!m_sharedMemory.Create(name, sizeof(SpectrumSnapshot))) {
+        return false;
+    }
+
+    // The region is zero-filled, so placement-new only gives the atomics their type
+    m_shared = new (m_sharedMemory.Data()) SpectrumSnapshot();
+    m_shared->Initialize();
+    m_shared->Publish(m_frame);
+    return true;
+}
+
+SpectrumAnalyzer::Stats SpectrumAnalyzer::GetStats() const {
+    Stats stats;
+    stats.framesAnalyzed = m_framesAnalyzed.load(std::memory_order_relaxed);
+    stats.lastAnalysisNs = m_lastAnalysisNs.load(std::memory_order_relaxed);
+    stats.maxAnalysisNs = m_maxAnalysisNs.load(std::memory_order_relaxed);
+    if (stats.framesAnalyzed > 0) {
+        stats.avgAnalysisNs = m_totalAnalysisNs.load(std::memory_order_relaxed) /
+            static_cast<int64_t>(stats.framesAnalyzed);
+    }
+    stats.fftSize = m_fft.Size();
+    return stats;
+}
+
+} // namespace knoux::core::engine
@@ -0,0 +1,195 @@
+﻿#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "real_fft.h"
+#include "core/system/shared_memory.h"
+
+namespace knoux::core::engine {
+
+/**
+ * @struct SpectrumFrame
+ * @brief One display frame of band levels, small enough to copy per vsync.
+ */
+struct SpectrumFrame {
+    static constexpr size_t kMaxBands = 128;
+
+    uint32_t bandCount = 0;
+    uint32_t sampleRate = 0;
+    float minFrequency = 0.0f;      // Lower edge of the first band, Hz
+    float maxFrequency = 0.0f;      // Upper edge of the last band, Hz
+    uint64_t frameIndex = 0;        // Analyses published so far; unchanged means no new frame
+    uint64_t sampleIndex = 0;       // Input frames up to the end of the analyzed window
+    float levels[kMaxBands] = {};   // Smoothed band levels, dBFS (full-scale sine = 0)
+    float peaks[kMaxBands] = {};    // Held and falling band peaks, dBFS
+};
+
+/**
+ * @struct SpectrumSnapshot
+ * @brief Seqlock around the latest SpectrumFrame.
+ *
+ * One writer, any number of readers, no locks: the writer makes sequence
+ * odd, copies the frame and makes it even again; a reader copies the frame
+ * between two equal even sequence values and retries otherwise. Readers
+ * never block the audio thread, and the writer never waits for them.
+ *
+ * Trivially laid out so that it can also live in shared memory, where
+ * another process (the UI) reads it; magic is stored last by Initialize().
+ */
+struct SpectrumSnapshot {
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    std::atomic<uint32_t> sequence;
+    SpectrumFrame frame;
+
+    static constexpr uint32_t kMagic = 0x5053484B;  // "KHSP"
+    static constexpr uint32_t kVersion = 1;
+
+    /**
+     * @brief Prepares zero-filled memory (or a fresh instance) for publishing
+     */
+    void Initialize();
+
+    /**
+     * @brief Writer: replaces the frame
+     */
+    void Publish(const SpectrumFrame& source);
+
+    /**
+     * @brief Reader: copies a consistent frame
+     * @return false if the writer kept it busy for every attempt
+     */
+    bool Read(SpectrumFrame& target) const;
+};
+
+/**
+ * @class SpectrumAnalyzer
+ * @brief Real-time log-frequency spectrum of an interleaved PCM stream.
+ *
+ * Fed from the audio output path. Channels are averaged into a mono
+ * history; every hop (1/updateRate seconds of input) the last fftSize
+ * samples are Hann-windowed and transformed with RealFft, and bin powers
+ * are aggregated into log-spaced bands (the strongest bin per band; a band
+ * narrower than a bin takes the bin at its centre). Levels rise at once and
+ * fall with the release time constant; peaks hold, then fall at a fixed
+ * rate. The result is published to a SpectrumSnapshot, so consumers read
+ * fixed-size frames and never touch PCM.
+ *
+ * Time runs on input samples, so smoothing is independent of how audio is
+ * chunked. Push() does not allocate; it must be called from one thread.
+ */
+class SpectrumAnalyzer {
+public:
+    struct Settings {
+        size_t fftSize = 8192;
+        size_t bandCount = 64;
+        float minFrequency = 20.0f;
+        float maxFrequency = 20000.0f;     // Capped below Nyquist
+        float updateRate = 60.0f;          // Analyses per second of input
+        float releaseMs = 300.0f;          // Level fall time constant
+        float peakHoldMs = 800.0f;
+        float peakFallDbPerSecond = 24.0f;
+        float floorDb = -120.0f;
+    };
+
+    /**
+     * @struct Stats
+     * @brief Analysis cost, counters since construction
+     */
+    struct Stats {
+        uint64_t framesAnalyzed = 0;
+        int64_t lastAnalysisNs = 0;        // Window, FFT, bands and publish
+        int64_t avgAnalysisNs = 0;
+        int64_t maxAnalysisNs = 0;
+        size_t fftSize = 0;
+    };
+
+    SpectrumAnalyzer();
+    explicit SpectrumAnalyzer(const Settings& settings);
+    ~SpectrumAnalyzer();
+
+    SpectrumAnalyzer(const SpectrumAnalyzer&) = delete;
+    SpectrumAnalyzer& operator=(const SpectrumAnalyzer&) = delete;
+
+    /**
+     * @brief Analyzes interleaved audio as it is played
+     * @param samples Interleaved samples (frames * channels floats)
+     * @param frames Frame count
+     * @param channels Interleaved channel count
+     * @param sampleRate Sample rate; a change of rate restarts the analysis
+     */
+    void Push(const float* samples, size_t frames, size_t channels, int sampleRate);
+
+    /**
+     * @brief Clears history, levels and peaks, e.g. after a seek
+     */
+    void Reset();
+
+    /**
+     * @brief Additionally publishes frames into a named shared-memory SpectrumSnapshot
+     * @param name Shared memory name (see SharedMemory::Create); empty stops sharing
+     * @return false if the shared memory cannot be created
+     */
+    bool ShareAs(const std::string& name);
+
+    /**
+     * @brief Copies the latest frame without blocking the analyzer
+     */
+    bool GetFrame(SpectrumFrame& frame) const { return m_snapshot.Read(frame); }
+
+    Stats GetStats() const;
+
+    const Settings& GetSettings() const { return m_settings; }
+
+private:
+    // Helper: Rebuilds window and band tables for a sample rate
+    void Configure(int sampleRate);
+
+    // Helper: Windows the history, transforms it and publishes a frame
+    void Analyze(size_t elapsedFrames);
+
+    Settings m_settings;
+    RealFft m_fft;
+
+    // Mono history ring of fftSize samples
+    std::vector<float> m_history;
+    size_t m_historyPos = 0;
+
+    // Input frames since the last analysis, and per analysis
+    size_t m_sinceAnalysis = 0;
+    size_t m_hopFrames = 0;
+    uint64_t m_sampleIndex = 0;
+
+    std::vector<float> m_window;
+    std::vector<float> m_windowed;
+    std::vector<float> m_real;
+    std::vector<float> m_imag;
+
+    // Inclusive bin range of each band
+    std::vector<size_t> m_bandFirst;
+    std::vector<size_t> m_bandLast;
+
+    // Converts bin power to dBFS (window gain and real-spectrum halving)
+    float m_powerOffsetDb = 0.0f;
+
+    std::vector<float> m_peakHoldMs;
+    SpectrumFrame m_frame;
+    int m_sampleRate = 0;
+
+    SpectrumSnapshot m_snapshot;
+
+    // Optional copy for another process
+    system::SharedMemory m_sharedMemory;
+    SpectrumSnapshot* m_shared = nullptr;
+
+    std::atomic<uint64_t> m_framesAnalyzed{ 0 };
+    std::atomic<int64_t> m_lastAnalysisNs{ 0 };
+    std::atomic<int64_t> m_totalAnalysisNs{ 0 };
+    std::atomic<int64_t> m_maxAnalysisNs{ 0 };
+};
+
+} // namespace knoux::core::engine
@@ -0,0 +1,76 @@
+﻿/**
+ * Cost of the spectrum analyzer: RealFft per size, and one full analysis
+ * (window, 8192-point FFT, band aggregation, publish) per 60 Hz frame.
+ *
+ * Standalone; not part of the knoux_core build:
+ *   g++ -std=c++17 -O2 -I. core/engine/spectrum_benchmark.cpp core/engine/spectrum_analyzer.cpp \
+ *       core/engine/real_fft.cpp core/system/shared_memory.cpp -lrt -o spectrum_benchmark
+ *
+ * Add -U__SSE2__ on x86 to time the scalar butterflies.
+ */
+
+#include "spectrum_analyzer.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace knoux::core::engine;
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+double FftMicroseconds(size_t size) {
+    RealFft fft(size);
+    std::vector<float> input(size);
+    std::vector<float> real(fft.Bins());
+    std::vector<float> imag(fft.Bins());
+    for (size_t i = 0; i < size; ++i) {
+        input[i] = static_cast<float>(std::sin(0.01 * i) + 0.25 * std::sin(0.37 * i));
+    }
+
+    const int iterations = static_cast<int>(std::max<size_t>(200, (1 << 24) / size));
+    for (int i = 0; i < iterations / 10; ++i) {
+        fft.Forward(input.data(), real.data(), imag.data());
+    }
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        fft.Forward(input.data(), real.data(), imag.data());
+    }
+    const double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    return elapsed / iterations;
+}
+
+} // namespace
+
+int main() {
+    std::printf("RealFft, us per transform\n");
+    for (size_t size = 1024; size <= 16384; size <<= 1) {
+        std::printf("%6zu %9.2f\n", size, FftMicroseconds(size));
+    }
+
+    // Ten seconds of stereo 48 kHz in 1024-frame chunks, as the delivery thread hands it over
+    const int rate = 48000;
+    const size_t chunkFrames = 1024;
+    std::vector<float> signal(static_cast<size_t>(rate) * 10 * 2);
+    for (size_t i = 0; i < signal.size() / 2; ++i) {
+        const float sample = static_cast<float>(0.5 * std::sin(2.0 * kPi * 440.0 * i / rate));
+        signal[i * 2] = sample;
+        signal[i * 2 + 1] = sample;
+    }
+
+    SpectrumAnalyzer analyzer;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t offset = 0; offset + chunkFrames * 2 <= signal.size(); offset += chunkFrames * 2) {
+        analyzer.Push(signal.data() + offset, chunkFrames, 2, rate);
+    }
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const SpectrumAnalyzer::Stats stats = analyzer.GetStats();
+    std::printf("\nAnalysis, fft %zu, %zu bands\n", stats.fftSize, analyzer.GetSettings().bandCount);
+    std::printf("frames %llu  avg %.1f us  max %.1f us  load %.2f%% of one core (incl. downmix)\n",
+                static_cast<unsigned long long>(stats.framesAnalyzed), stats.avgAnalysisNs / 1000.0,
+                stats.maxAnalysisNs / 1000.0, 100.0 * elapsed / 10.0);
+    return 0;
+}
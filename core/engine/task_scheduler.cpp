@@ -0,0 +1,257 @@
+﻿#include "task_scheduler.h"
+#include <algorithm>
+
+namespace knoux::core::engine {
+
+namespace {
+
+// Identifies the scheduler and worker slot of the calling thread
+thread_local const TaskScheduler* t_currentScheduler = nullptr;
+thread_local size_t t_workerIndex = 0;
+
+void UpdateMax(std::atomic<uint64_t>& target, uint64_t value) {
+    uint64_t current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// TaskGroup
+// ---------------------------------------------------------------------------
+
+void TaskGroup::Wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this] { return IsDone(); });
+}
+
+void TaskGroup::Complete() {
+    if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_condition.notify_all();
+    }
+}
+
+// ---------------------------------------------------------------------------
+// TaskScheduler
+// ---------------------------------------------------------------------------
+
+TaskScheduler::TaskScheduler(size_t workerCount)
+    : m_metrics(system::MetricsRegistry::GetInstance())
+{
+    static const char* const kPriorityNames[kTaskPriorityCount] = { "interactive", "load", "background" };
+    for (size_t i = 0; i < kTaskPriorityCount; ++i) {
+        m_waitHistograms[i] = &m_metrics->Histogram(std::string("scheduler.wait.") + kPriorityNames[i]);
+        m_runHistograms[i] = &m_metrics->Histogram(std::string("scheduler.run.") + kPriorityNames[i]);
+    }
+
+    if (workerCount == 0) {
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    m_workers.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; ++i) {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < workerCount; ++i) {
+        m_workers[i]->thread = std::thread(&TaskScheduler::WorkerLoop, this, i);
+    }
+}
+
+TaskScheduler::~TaskScheduler() {
+    Shutdown(true);
+}
+
+bool TaskScheduler::Submit(TaskPriority priority, std::function<void()> task, const std::shared_ptr<TaskGroup>& group) {
+    if (!task || !m_accepting.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    const size_t p = static_cast<size_t>(priority);
+    const size_t target = (t_currentScheduler == this)
+        ? t_workerIndex
+        : m_nextWorker.fetch_add(1, std::memory_order_relaxed) % m_workers.size();
+
+    {
+        // Rechecked under the queue lock Shutdown() sweeps, so a task is either
+        // refused or counted before the workers are told to stop
+        std::lock_guard<std::mutex> lock(m_workers[target]->mutex);
+        if (!m_accepting.load(std::memory_order_acquire)) {
+            return false;
+        }
+        m_workers[target]->queues[p].push_back({ std::move(task), group, std::chrono::steady_clock::now() });
+        if (group) {
+            group->Add();
+        }
+        m_counters[p].queued.fetch_add(1, std::memory_order_relaxed);
+        m_pending.fetch_add(1, std::memory_order_release);
+    }
+
+    {
+        // Taking the sleep mutex orders this wake-up after a worker's predicate check
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+    }
+    m_sleepCondition.notify_one();
+    return true;
+}
+
+void TaskScheduler::Wait(const std::shared_ptr<TaskGroup>& group) {
+    if (!group) {
+        return;
+    }
+
+    if (t_currentScheduler != this) {
+        group->Wait();
+        return;
+    }
+
+    // Blocking a worker could starve the group it waits on, so help instead
+    while (!group->IsDone()) {
+        Task task;
+        size_t priority = 0;
+        if (TryTakeTask(t_workerIndex, task, priority)) {
+            Execute(task, priority);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void TaskScheduler::Shutdown(bool drain) {
+    std::lock_guard<std::mutex> shutdownLock(m_shutdownMutex);
+    m_accepting.store(false, std::memory_order_release);
+    if (m_stopping.load()) {
+        return;
+    }
+
+    // Taking every queue lock once waits out a Submit() that saw m_accepting still set
+    for (auto& worker : m_workers) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        if (!drain) {
+            for (size_t p = 0; p < kTaskPriorityCount; ++p) {
+                for (Task& task : worker->queues[p]) {
+                    if (task.group) {
+                        task.group->Complete();
+                    }
+                }
+                m_counters[p].queued.fetch_sub(worker->queues[p].size(), std::memory_order_relaxed);
+                m_pending.fetch_sub(worker->queues[p].size(), std::memory_order_relaxed);
+                worker->queues[p].clear();
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stopping.store(true);
+    }
+    m_sleepCondition.notify_all();
+
+    for (auto& worker : m_workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+TaskScheduler::Stats TaskScheduler::GetStats() const {
+    Stats stats;
+    stats.workerCount = m_workers.size();
+    stats.steals = m_steals.load(std::memory_order_relaxed);
+
+    for (size_t p = 0; p < kTaskPriorityCount; ++p) {
+        const PriorityCounters& counters = m_counters[p];
+        PriorityStats& out = stats.priorities[p];
+        out.queued = counters.queued.load(std::memory_order_relaxed);
+        out.executed = counters.executed.load(std::memory_order_relaxed);
+        out.maxWaitMs = static_cast<double>(counters.maxWaitNs.load(std::memory_order_relaxed)) / 1e6;
+        if (out.executed > 0) {
+            out.avgWaitMs = static_cast<double>(counters.totalWaitNs.load(std::memory_order_relaxed)) / 1e6 /
+                            static_cast<double>(out.executed);
+        }
+    }
+    return stats;
+}
+
+void TaskScheduler::WorkerLoop(size_t index) {
+    t_currentScheduler = this;
+    t_workerIndex = index;
+
+    while (true) {
+        Task task;
+        size_t priority = 0;
+        if (TryTakeTask(index, task, priority)) {
+            Execute(task, priority);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_sleepCondition.wait(lock, [this] {
+            return m_pending.load(std::memory_order_acquire) > 0 || m_stopping.load();
+        });
+        if (m_stopping.load() && m_pending.load(std::memory_order_acquire) == 0) {
+            break;
+        }
+    }
+
+    t_currentScheduler = nullptr;
+}
+
+bool TaskScheduler::TryTakeTask(size_t index, Task& task, size_t& priority) {
+    if (m_pending.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+
+    const size_t workerCount = m_workers.size();
+    for (size_t p = 0; p < kTaskPriorityCount; ++p) {
+        for (size_t offset = 0; offset < workerCount; ++offset) {
+            Worker& worker = *m_workers[(index + offset) % workerCount];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            auto& queue = worker.queues[p];
+            if (queue.empty()) {
+                continue;
+            }
+
+            if (offset == 0) {
+                task = std::move(queue.front());
+                queue.pop_front();
+            } else {
+                task = std::move(queue.back());
+                queue.pop_back();
+                m_steals.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            priority = p;
+            m_counters[p].queued.fetch_sub(1, std::memory_order_relaxed);
+            m_pending.fetch_sub(1, std::memory_order_acq_rel);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TaskScheduler::Execute(Task& task, size_t priority) {
+    const auto started = std::chrono::steady_clock::now();
+    const uint64_t waitNs = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(started - task.enqueued).count());
+
+    PriorityCounters& counters = m_counters[priority];
+    counters.totalWaitNs.fetch_add(waitNs, std::memory_order_relaxed);
+    UpdateMax(counters.maxWaitNs, waitNs);
+    m_waitHistograms[priority]->Record(waitNs);
+
+    try {
+        task.run();
+    } catch (...) {
+        // A throwing task must not take its worker down with it
+    }
+    m_runHistograms[priority]->RecordSince(started);
+
+    counters.executed.fetch_add(1, std::memory_order_relaxed);
+    if (task.group) {
+        task.group->Complete();
+    }
+}
+
+} // namespace knoux::core::engine
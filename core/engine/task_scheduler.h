@@ -0,0 +1,196 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "core/system/metrics.h"
+
+namespace knoux::core::engine {
+
+/**
+ * @enum TaskPriority
+ * @brief Scheduling classes, highest first
+ */
+enum class TaskPriority {
+    Interactive = 0,  // Seek, play/pause: user is waiting on the result
+    Load = 1,         // Opening and parsing media
+    Background = 2    // Metadata scans, thumbnails, cache maintenance
+};
+
+constexpr size_t kTaskPriorityCount = 3;
+
+/**
+ * @class TaskGroup
+ * @brief Completion counter for a set of submitted tasks
+ *
+ * Pass the same group to several Submit() calls, then wait on it through
+ * TaskScheduler::Wait() (which helps run queued work when called from a
+ * worker) or TaskGroup::Wait() from non-worker threads.
+ */
+class TaskGroup {
+public:
+    /**
+     * @brief Checks if every task added to the group has finished
+     */
+    bool IsDone() const { return m_pending.load(std::memory_order_acquire) == 0; }
+
+    /**
+     * @brief Blocks until the group is done; must not be called from a scheduler worker
+     */
+    void Wait();
+
+private:
+    friend class TaskScheduler;
+
+    void Add() { m_pending.fetch_add(1, std::memory_order_relaxed); }
+    void Complete();
+
+    std::atomic<size_t> m_pending{ 0 };
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+};
+
+/**
+ * @class TaskScheduler
+ * @brief Work-stealing thread pool with strict priority classes.
+ *
+ * Each worker owns one deque per priority. Tasks submitted from a worker go
+ * to its own deque; tasks submitted from other threads are spread
+ * round-robin. Owners run their deque front to back, so tasks submitted by
+ * one worker start in submission order, while thieves take from the back
+ * to stay off the owner's end. An idle worker scans priorities from
+ * Interactive down, checking its own deque and then stealing from the
+ * others at each level, so a long Load task on one worker never delays an
+ * Interactive task that another worker can pick up.
+ *
+ * Shutdown(true) stops accepting work and drains everything already queued.
+ *
+ * Wait and run times also go to the process MetricsRegistry as
+ * "scheduler.wait.<priority>" and "scheduler.run.<priority>" histograms.
+ */
+class TaskScheduler {
+public:
+    /**
+     * @struct PriorityStats
+     * @brief Counters for one priority class
+     */
+    struct PriorityStats {
+        uint64_t queued = 0;            // Tasks currently waiting
+        uint64_t executed = 0;          // Tasks finished
+        double avgWaitMs = 0.0;         // Mean submit-to-start latency
+        double maxWaitMs = 0.0;         // Worst submit-to-start latency
+    };
+
+    /**
+     * @struct Stats
+     * @brief Scheduler-wide counters
+     */
+    struct Stats {
+        size_t workerCount = 0;
+        uint64_t steals = 0;
+        PriorityStats priorities[kTaskPriorityCount];
+    };
+
+    /**
+     * @brief Starts the worker threads
+     * @param workerCount Number of workers, 0 selects hardware concurrency
+     */
+    explicit TaskScheduler(size_t workerCount = 0);
+
+    /**
+     * @brief Drains queued work and joins the workers
+     */
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    /**
+     * @brief Queues a task
+     * @param priority Scheduling class
+     * @param task Work to run
+     * @param group Optional group notified when the task finishes
+     * @return false if the scheduler is shutting down
+     */
+    bool Submit(TaskPriority priority, std::function<void()> task, const std::shared_ptr<TaskGroup>& group = nullptr);
+
+    /**
+     * @brief Waits for a group, running queued tasks meanwhile when called from a worker
+     * @param group Group to wait on
+     */
+    void Wait(const std::shared_ptr<TaskGroup>& group);
+
+    /**
+     * @brief Stops accepting tasks and joins the workers
+     * @param drain true to run every queued task first, false to discard them
+     */
+    void Shutdown(bool drain = true);
+
+    /**
+     * @brief Returns a snapshot of queue depths, steal counts and latencies
+     */
+    Stats GetStats() const;
+
+    /**
+     * @brief Returns the number of worker threads
+     */
+    size_t WorkerCount() const { return m_workers.size(); }
+
+private:
+    struct Task {
+        std::function<void()> run;
+        std::shared_ptr<TaskGroup> group;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+
+    struct alignas(64) Worker {
+        std::mutex mutex;
+        std::deque<Task> queues[kTaskPriorityCount];
+        std::thread thread;
+    };
+
+    struct alignas(64) PriorityCounters {
+        std::atomic<uint64_t> queued{ 0 };
+        std::atomic<uint64_t> executed{ 0 };
+        std::atomic<uint64_t> totalWaitNs{ 0 };
+        std::atomic<uint64_t> maxWaitNs{ 0 };
+    };
+
+    // Internal worker loop
+    void WorkerLoop(size_t index);
+
+    // Helper: Pops the best task visible to a worker (own queues first, then steals)
+    bool TryTakeTask(size_t index, Task& task, size_t& priority);
+
+    // Helper: Runs a task and records its statistics
+    void Execute(Task& task, size_t priority);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    PriorityCounters m_counters[kTaskPriorityCount];
+
+    // Latency distributions in the process registry, resolved at construction
+    std::shared_ptr<system::MetricsRegistry> m_metrics;
+    system::LatencyHistogram* m_waitHistograms[kTaskPriorityCount] = {};
+    system::LatencyHistogram* m_runHistograms[kTaskPriorityCount] = {};
+    std::atomic<uint64_t> m_steals{ 0 };
+    std::atomic<size_t> m_nextWorker{ 0 };
+
+    // Tasks queued across all workers; idle workers sleep while it is zero
+    std::atomic<size_t> m_pending{ 0 };
+    std::mutex m_sleepMutex;
+    std::condition_variable m_sleepCondition;
+
+    std::atomic<bool> m_accepting{ true };
+    std::atomic<bool> m_stopping{ false };
+    std::mutex m_shutdownMutex;
+};
+
+} // namespace knoux::core::engine
@@ -0,0 +1,335 @@
+﻿#include "waveform.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+namespace knoux::core::engine {
+
+static_assert(sizeof(WaveformPeak) == 6, "WaveformPeak is stored as-is in cache files");
+
+namespace {
+
+constexpr char kCacheMagic[4] = { 'K', 'W', 'A', 'V' };
+constexpr uint32_t kCacheVersion = 1;
+
+// magic, version, size, modified, sampleRate, channels, totalFrames, baseFrames, levelCount, pathLength, reserved
+constexpr size_t kHeaderSize = 4 + 4 + 8 + 8 + 4 + 4 + 8 + 4 + 4 + 4 + 4;
+
+// Per level: byte offset and bucket count
+constexpr size_t kLevelEntrySize = 16;
+
+void WriteLE(std::vector<uint8_t>& out, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+}
+
+uint64_t ReadLE(const uint8_t* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; --i) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+WaveformPeak Merge(const WaveformPeak& a, const WaveformPeak& b) {
+    WaveformPeak merged;
+    merged.min = std::min(a.min, b.min);
+    merged.max = std::max(a.max, b.max);
+    const double squares = (static_cast<double>(a.rms) * a.rms + static_cast<double>(b.rms) * b.rms) * 0.5;
+    merged.rms = static_cast<uint16_t>(std::lround(std::sqrt(squares)));
+    return merged;
+}
+
+int16_t QuantiseSample(float value) {
+    return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+} // namespace
+
+Waveform::Waveform(int sampleRate, int channels, uint64_t expectedFrames)
+    : m_sampleRate(sampleRate)
+    , m_channels(std::max(channels, 1))
+    , m_levels(kMaxLevels)
+{
+    m_totalFrames.store(expectedFrames, std::memory_order_relaxed);
+}
+
+void Waveform::Append(const float* samples, size_t frames) {
+    if (GetState() != State::Building) {
+        return;
+    }
+
+    // Scan outside the lock; only finished buckets are published
+    const size_t channels = static_cast<size_t>(m_channels);
+    const double sampleCount = static_cast<double>(kBaseFrames * channels);
+    for (size_t frame = 0; frame < frames; ++frame) {
+        const float* p = samples + frame * channels;
+        if (m_bucketFrames == 0) {
+            m_bucketMin = p[0];
+            m_bucketMax = p[0];
+            m_bucketSquares = 0.0;
+        }
+        for (size_t c = 0; c < channels; ++c) {
+            m_bucketMin = std::min(m_bucketMin, p[c]);
+            m_bucketMax = std::max(m_bucketMax, p[c]);
+            m_bucketSquares += static_cast<double>(p[c]) * p[c];
+        }
+        if (++m_bucketFrames == kBaseFrames) {
+            WaveformPeak peak;
+            peak.min = QuantiseSample(m_bucketMin);
+            peak.max = QuantiseSample(m_bucketMax);
+            peak.rms = static_cast<uint16_t>(std::lround(std::min(1.0, std::sqrt(m_bucketSquares / sampleCount)) * 65535.0));
+            m_staged.push_back(peak);
+            m_bucketFrames = 0;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const WaveformPeak& peak : m_staged) {
+            PushBucket(peak);
+        }
+        RefreshViews();
+    }
+    m_staged.clear();
+
+    const uint64_t built = m_framesBuilt.fetch_add(frames, std::memory_order_relaxed) + frames;
+    if (built > m_totalFrames.load(std::memory_order_relaxed)) {
+        m_totalFrames.store(built, std::memory_order_relaxed);
+    }
+}
+
+void Waveform::Finish() {
+    if (GetState() != State::Building) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_bucketFrames > 0) {
+            const double sampleCount = static_cast<double>(m_bucketFrames * static_cast<size_t>(m_channels));
+            WaveformPeak peak;
+            peak.min = QuantiseSample(m_bucketMin);
+            peak.max = QuantiseSample(m_bucketMax);
+            peak.rms = static_cast<uint16_t>(std::lround(std::min(1.0, std::sqrt(m_bucketSquares / sampleCount)) * 65535.0));
+            PushBucket(peak);
+            m_bucketFrames = 0;
+            RefreshViews();
+        }
+    }
+
+    m_totalFrames.store(m_framesBuilt.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    // An Abandon() since the check above stands; only Building becomes Complete
+    State expected = State::Building;
+    m_state.compare_exchange_strong(expected, State::Complete, std::memory_order_acq_rel);
+}
+
+void Waveform::Abandon() {
+    State expected = State::Building;
+    m_state.compare_exchange_strong(expected, State::Abandoned, std::memory_order_acq_rel);
+}
+
+void Waveform::PushBucket(const WaveformPeak& peak) {
+    m_levels[0].push_back(peak);
+
+    // Keep every level's last bucket the merge of what exists below it, so
+    // coarse zooms cover everything built so far, not only completed pairs
+    for (size_t level = 0; level + 1 < kMaxLevels && m_levels[level].size() > 1; ++level) {
+        const std::vector<WaveformPeak>& below = m_levels[level];
+        std::vector<WaveformPeak>& above = m_levels[level + 1];
+        const size_t parent = (below.size() - 1) / 2;
+        const WaveformPeak merged = below.size() % 2 ? below.back() : Merge(below[below.size() - 2], below.back());
+        if (above.size() <= parent) {
+            above.push_back(merged);
+        } else {
+            above[parent] = merged;
+        }
+    }
+}
+
+void Waveform::RefreshViews() {
+    m_views.clear();
+    for (const std::vector<WaveformPeak>& level : m_levels) {
+        if (level.empty()) {
+            break;
+        }
+        m_views.push_back({ level.data(), level.size() });
+    }
+}
+
+size_t Waveform::LevelCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_views.size();
+}
+
+size_t Waveform::Query(double startFrame, double framesPerPixel, size_t columns, WaveformColumn* out) const {
+    if (framesPerPixel <= 0.0 || startFrame < 0.0) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_views.empty()) {
+        return 0;
+    }
+
+    // Coarsest level with buckets no wider than a column: each column then spans at most three buckets
+    size_t level = 0;
+    while (level + 1 < m_views.size() && static_cast<double>(kBaseFrames << (level + 1)) <= framesPerPixel) {
+        ++level;
+    }
+    const LevelView& view = m_views[level];
+    const double bucketFrames = static_cast<double>(kBaseFrames << level);
+    const double frames = static_cast<double>(FramesBuilt());
+
+    for (size_t column = 0; column < columns; ++column) {
+        const double first = startFrame + framesPerPixel * column;
+        if (first >= frames) {
+            return column;
+        }
+        const size_t begin = static_cast<size_t>(first / bucketFrames);
+        const size_t end = std::min(view.count,
+                                    std::max(begin + 1, static_cast<size_t>(std::ceil((first + framesPerPixel) / bucketFrames))));
+        if (begin >= view.count) {
+            return column;
+        }
+
+        int16_t low = view.data[begin].min;
+        int16_t high = view.data[begin].max;
+        double squares = 0.0;
+        for (size_t bucket = begin; bucket < end; ++bucket) {
+            low = std::min(low, view.data[bucket].min);
+            high = std::max(high, view.data[bucket].max);
+            squares += static_cast<double>(view.data[bucket].rms) * view.data[bucket].rms;
+        }
+        out[column].min = low / 32767.0f;
+        out[column].max = high / 32767.0f;
+        out[column].rms = static_cast<float>(std::sqrt(squares / (end - begin)) / 65535.0);
+    }
+    return columns;
+}
+
+WaveformCache::WaveformCache() {
+    std::error_code ec;
+    const std::filesystem::path temp = std::filesystem::temp_directory_path(ec);
+    m_directory = ((ec ? std::filesystem::path(".") : temp) / "knoux" / "waveform").string();
+}
+
+WaveformCache::WaveformCache(std::string directory)
+    : m_directory(std::move(directory))
+{
+}
+
+std::shared_ptr<Waveform> WaveformCache::Load(const system::FileIdentity& identity) const {
+    std::shared_ptr<Waveform> waveform(new Waveform());
+    if (!waveform->m_file.Open(EntryPath(identity), system::MappedFile::AccessHint::Random)) {
+        return nullptr;
+    }
+
+    const uint8_t* data = waveform->m_file.Data();
+    const size_t size = waveform->m_file.Size();
+    if (size < kHeaderSize || !std::equal(kCacheMagic, kCacheMagic + 4, data)) {
+        return nullptr;
+    }
+
+    const uint8_t* p = data + 4;
+    const size_t levelCount = static_cast<size_t>(ReadLE(p + 40, 4));
+    const size_t pathLength = static_cast<size_t>(ReadLE(p + 44, 4));
+    const size_t tableEnd = kHeaderSize + levelCount * kLevelEntrySize;
+    if (ReadLE(p, 4) != kCacheVersion || ReadLE(p + 4, 8) != identity.size ||
+        static_cast<int64_t>(ReadLE(p + 12, 8)) != identity.modified || ReadLE(p + 36, 4) != Waveform::kBaseFrames ||
+        levelCount == 0 || levelCount > Waveform::kMaxLevels || pathLength != identity.path.size() ||
+        size < tableEnd + pathLength || !std::equal(identity.path.begin(), identity.path.end(), data + tableEnd)) {
+        return nullptr;
+    }
+
+    // Bucket arrays are stored in host order (little-endian on every supported platform) and read in place
+    for (size_t level = 0; level < levelCount; ++level) {
+        const uint8_t* entry = data + kHeaderSize + level * kLevelEntrySize;
+        const uint64_t offset = ReadLE(entry, 8);
+        const uint64_t count = ReadLE(entry + 8, 8);
+        if (count == 0 || offset % alignof(WaveformPeak) != 0 || offset > size ||
+            count > (size - offset) / sizeof(WaveformPeak)) {
+            return nullptr;
+        }
+        waveform->m_views.push_back({ reinterpret_cast<const WaveformPeak*>(data + offset), static_cast<size_t>(count) });
+    }
+
+    waveform->m_sampleRate = static_cast<int>(ReadLE(p + 20, 4));
+    waveform->m_channels = static_cast<int>(ReadLE(p + 24, 4));
+    const uint64_t totalFrames = ReadLE(p + 28, 8);
+    waveform->m_framesBuilt.store(totalFrames, std::memory_order_relaxed);
+    waveform->m_totalFrames.store(totalFrames, std::memory_order_relaxed);
+    waveform->m_state.store(Waveform::State::Complete, std::memory_order_release);
+    return waveform;
+}
+
+bool WaveformCache::Store(const system::FileIdentity& identity, const Waveform& waveform) const {
+    if (waveform.GetState() != Waveform::State::Complete) {
+        return false;
+    }
+
+    std::vector<uint8_t> bytes(kCacheMagic, kCacheMagic + 4);
+    {
+        std::lock_guard<std::mutex> lock(waveform.m_mutex);
+        const size_t levelCount = waveform.m_views.size();
+        WriteLE(bytes, kCacheVersion, 4);
+        WriteLE(bytes, identity.size, 8);
+        WriteLE(bytes, static_cast<uint64_t>(identity.modified), 8);
+        WriteLE(bytes, static_cast<uint32_t>(waveform.m_sampleRate), 4);
+        WriteLE(bytes, static_cast<uint32_t>(waveform.m_channels), 4);
+        WriteLE(bytes, waveform.TotalFrames(), 8);
+        WriteLE(bytes, Waveform::kBaseFrames, 4);
+        WriteLE(bytes, levelCount, 4);
+        WriteLE(bytes, identity.path.size(), 4);
+        WriteLE(bytes, 0, 4);
+
+        // Level data starts 8-byte aligned after the table and the path
+        uint64_t offset = kHeaderSize + levelCount * kLevelEntrySize + identity.path.size();
+        offset = (offset + 7) & ~uint64_t(7);
+        for (const Waveform::LevelView& view : waveform.m_views) {
+            WriteLE(bytes, offset, 8);
+            WriteLE(bytes, view.count, 8);
+            offset += view.count * sizeof(WaveformPeak);
+        }
+        bytes.insert(bytes.end(), identity.path.begin(), identity.path.end());
+        bytes.resize((bytes.size() + 7) & ~size_t(7), 0);
+        for (const Waveform::LevelView& view : waveform.m_views) {
+            const uint8_t* begin = reinterpret_cast<const uint8_t*>(view.data);
+            bytes.insert(bytes.end(), begin, begin + view.count * sizeof(WaveformPeak));
+        }
+    }
+
+    try {
+        std::filesystem::create_directories(m_directory);
+
+        const std::string entry = EntryPath(identity);
+        const std::string staging = entry + ".tmp";
+        {
+            std::ofstream out(staging, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+            if (!out) {
+                std::filesystem::remove(staging);
+                return false;
+            }
+        }
+        std::filesystem::rename(staging, entry);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+std::string WaveformCache::EntryPath(const system::FileIdentity& identity) const {
+    const uint64_t key = system::HashBytes(identity.path.data(), identity.path.size());
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.kwav", static_cast<unsigned long long>(key));
+    return (std::filesystem::path(m_directory) / name).string();
+}
+
+} // namespace knoux::core::engine
@@ -0,0 +1,222 @@
+﻿#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "core/system/file_identity.h"
+#include "core/system/mapped_file.h"
+
+namespace knoux::core::engine {
+
+/**
+ * @struct WaveformPeak
+ * @brief One stored bucket: extremes and RMS of all channels, quantised to 16 bits
+ */
+struct WaveformPeak {
+    int16_t min = 0;    // Sample * 32767
+    int16_t max = 0;
+    uint16_t rms = 0;   // RMS * 65535
+};
+
+/**
+ * @struct WaveformColumn
+ * @brief One queried pixel column, in sample units (full scale = 1)
+ */
+struct WaveformColumn {
+    float min = 0.0f;
+    float max = 0.0f;
+    float rms = 0.0f;
+};
+
+/**
+ * @struct WaveformSource
+ * @brief Decoded audio of one file, pulled by the waveform build job
+ */
+struct WaveformSource {
+    int sampleRate = 0;
+    int channels = 0;
+
+    // Expected length in frames, 0 if unknown; only used for progress
+    uint64_t totalFrames = 0;
+
+    // Fills up to frames interleaved frames; returns frames written, 0 at the end of the stream
+    std::function<size_t(float* samples, size_t frames)> read;
+};
+
+/**
+ * @class Waveform
+ * @brief Min/max/RMS peak pyramid of a file's audio, for the seek bar.
+ *
+ * Level 0 holds one WaveformPeak per kBaseFrames frames; each level above
+ * merges pairs of the level below, so level L covers kBaseFrames << L
+ * frames per bucket. Query() picks the coarsest level whose buckets are no
+ * wider than a pixel, so every pixel merges at most three buckets and any
+ * range at any zoom costs O(pixels), independent of the file's length. A
+ * two-hour 48 kHz track takes about 16 MB across all levels.
+ *
+ * A waveform either comes complete from WaveformCache (its levels point
+ * into the mapped cache file) or is built by Append()/Finish(). While it is
+ * building, Query() answers from what is already there and reports how
+ * many columns it could fill, so the seek bar draws progressively.
+ *
+ * Thread-safe: one builder, any number of concurrent queries.
+ */
+class Waveform {
+public:
+    enum class State {
+        Building,
+        Complete,
+        Abandoned   // Build cancelled or failed; the partial levels stay queryable
+    };
+
+    // Frames per level-0 bucket (5.3 ms at 48 kHz)
+    static constexpr size_t kBaseFrames = 256;
+
+    // Levels beyond this would cover more than 2^32 frames per bucket
+    static constexpr size_t kMaxLevels = 24;
+
+    /**
+     * @brief Starts an empty waveform to be built
+     */
+    Waveform(int sampleRate, int channels, uint64_t expectedFrames);
+
+    Waveform(const Waveform&) = delete;
+    Waveform& operator=(const Waveform&) = delete;
+
+    /**
+     * @brief Builder: adds interleaved frames
+     */
+    void Append(const float* samples, size_t frames);
+
+    /**
+     * @brief Builder: flushes the partial buckets and marks the waveform complete, unless it was abandoned
+     */
+    void Finish();
+
+    /**
+     * @brief Builder: gives up; what was built stays queryable
+     */
+    void Abandon();
+
+    /**
+     * @brief Fills pixel columns of a frame range
+     * @param startFrame First frame of the first column
+     * @param framesPerPixel Zoom, frames per column (any positive value)
+     * @param columns Column count
+     * @param out Receives columns entries
+     * @return Columns filled; fewer than requested where the file ends or the build has not got there yet
+     */
+    size_t Query(double startFrame, double framesPerPixel, size_t columns, WaveformColumn* out) const;
+
+    State GetState() const { return m_state.load(std::memory_order_acquire); }
+
+    int SampleRate() const { return m_sampleRate; }
+
+    int Channels() const { return m_channels; }
+
+    /**
+     * @brief Frames analysed so far (all of them once complete)
+     */
+    uint64_t FramesBuilt() const { return m_framesBuilt.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Expected length while building, exact once complete; 0 if unknown
+     */
+    uint64_t TotalFrames() const { return m_totalFrames.load(std::memory_order_relaxed); }
+
+    size_t LevelCount() const;
+
+private:
+    friend class WaveformCache;
+
+    struct LevelView {
+        const WaveformPeak* data = nullptr;
+        size_t count = 0;
+    };
+
+    // Used by WaveformCache to wrap a mapped file
+    Waveform() = default;
+
+    // Helper: Appends a level-0 bucket and merges completed pairs upwards; caller holds m_mutex
+    void PushBucket(const WaveformPeak& peak);
+
+    // Helper: Points m_views at the build vectors; caller holds m_mutex
+    void RefreshViews();
+
+    int m_sampleRate = 0;
+    int m_channels = 0;
+
+    // Level buckets while building; empty for a mapped waveform
+    std::vector<std::vector<WaveformPeak>> m_levels;
+
+    // Backing file of a waveform loaded from the cache
+    system::MappedFile m_file;
+
+    // What Query() reads, either the build vectors or the mapped file
+    std::vector<LevelView> m_views;
+    mutable std::mutex m_mutex;
+
+    // Builder-only accumulator of the current level-0 bucket
+    float m_bucketMin = 0.0f;
+    float m_bucketMax = 0.0f;
+    double m_bucketSquares = 0.0;
+    size_t m_bucketFrames = 0;
+    std::vector<WaveformPeak> m_staged;
+
+    std::atomic<State> m_state{ State::Building };
+    std::atomic<uint64_t> m_framesBuilt{ 0 };
+    std::atomic<uint64_t> m_totalFrames{ 0 };
+};
+
+/**
+ * @class WaveformCache
+ * @brief On-disk store of completed waveforms, one memory-mapped file each.
+ *
+ * Entries are keyed by file identity like SeekIndexCache, written to a
+ * temporary name and renamed into place. A loaded waveform maps its file
+ * and queries read the buckets straight out of the mapping, so opening
+ * the seek bar of a long file costs page faults for the columns shown,
+ * not a read of the whole entry.
+ *
+ * Stateless apart from the directory; safe to call concurrently.
+ */
+class WaveformCache {
+public:
+    /**
+     * @brief Uses <temp>/knoux/waveform
+     */
+    WaveformCache();
+
+    /**
+     * @param directory Directory holding the entries (created on first Store())
+     */
+    explicit WaveformCache(std::string directory);
+
+    /**
+     * @brief Maps the cached waveform of a file
+     * @return nullptr on a miss (no entry, file changed, damaged entry)
+     */
+    std::shared_ptr<Waveform> Load(const system::FileIdentity& identity) const;
+
+    /**
+     * @brief Writes a complete waveform, replacing any previous entry
+     * @param identity Identity of the file when the build started
+     * @return false if the waveform is not complete or the write failed
+     */
+    bool Store(const system::FileIdentity& identity, const Waveform& waveform) const;
+
+    const std::string& Directory() const { return m_directory; }
+
+private:
+    // Helper: Entry file name for an identity
+    std::string EntryPath(const system::FileIdentity& identity) const;
+
+    std::string m_directory;
+};
+
+} // namespace knoux::core::engine
@@ -0,0 +1,795 @@
+﻿#include "binary_log.h"
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <thread>
+
+namespace knoux::core::system {
+
+namespace {
+
+// Registered formats; entries below count are immutable once published
+struct FormatTable {
+    std::mutex mutex;
+    std::atomic<size_t> count{ 1 };
+    const char* texts[BinaryLog::kMaxFormats] = {};
+    LogLevel levels[BinaryLog::kMaxFormats] = {};
+    LogModule modules[BinaryLog::kMaxFormats] = {};
+    bool spans[BinaryLog::kMaxFormats] = {};
+};
+
+FormatTable& Formats() {
+    static FormatTable table;
+    return table;
+}
+
+template <typename T>
+void AppendRaw(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool ReadRaw(const uint8_t*& cursor, const uint8_t* end, T& value) {
+    if (static_cast<size_t>(end - cursor) < sizeof(value)) {
+        return false;
+    }
+    std::memcpy(&value, cursor, sizeof(value));
+    cursor += sizeof(value);
+    return true;
+}
+
+struct DecodedArg {
+    BinaryArgType type = BinaryArgType::Int;
+    int64_t i = 0;
+    uint64_t u = 0;
+    double d = 0.0;
+    std::string s;
+
+    long long AsSigned() const {
+        switch (type) {
+            case BinaryArgType::Int:    return static_cast<long long>(i);
+            case BinaryArgType::Double: return static_cast<long long>(d);
+            case BinaryArgType::String: return 0;
+            default:                    return static_cast<long long>(u);
+        }
+    }
+
+    unsigned long long AsUnsigned() const {
+        return type == BinaryArgType::Int ? static_cast<unsigned long long>(i) : static_cast<unsigned long long>(AsSigned());
+    }
+
+    double AsDouble() const {
+        switch (type) {
+            case BinaryArgType::Double: return d;
+            case BinaryArgType::Int:    return static_cast<double>(i);
+            case BinaryArgType::String: return 0.0;
+            default:                    return static_cast<double>(u);
+        }
+    }
+};
+
+// Helper: snprintf into a string, whatever the length
+template <typename... Args>
+void AppendFormatted(std::string& out, const std::string& spec, Args... args) {
+    char buffer[128];
+    const int length = std::snprintf(buffer, sizeof(buffer), spec.c_str(), args...);
+    if (length < 0) {
+        return;
+    }
+    if (static_cast<size_t>(length) < sizeof(buffer)) {
+        out.append(buffer, static_cast<size_t>(length));
+        return;
+    }
+    std::string large(static_cast<size_t>(length) + 1, '\0');
+    std::snprintf(large.data(), large.size(), spec.c_str(), args...);
+    out.append(large.data(), static_cast<size_t>(length));
+}
+
+// Helper: Replays a printf format against recorded arguments. Each
+// conversion is redone by snprintf with the length modifier replaced to
+// match the recorded width, so flags, width and precision behave as in
+// the original call; arguments of the wrong kind are converted
+std::string ReplayFormat(const std::string& format, const std::vector<DecodedArg>& args) {
+    std::string out;
+    out.reserve(format.size() + 32);
+    size_t next = 0;
+    const auto take = [&args, &next]() -> const DecodedArg* {
+        return next < args.size() ? &args[next++] : nullptr;
+    };
+
+    for (size_t i = 0; i < format.size(); ++i) {
+        if (format[i] != '%') {
+            out += format[i];
+            continue;
+        }
+        if (i + 1 < format.size() && format[i + 1] == '%') {
+            out += '%';
+            ++i;
+            continue;
+        }
+
+        const size_t start = i;
+        std::string spec = "%";
+        size_t j = i + 1;
+        while (j < format.size() && std::strchr("-+ #0", format[j]) != nullptr) {
+            spec += format[j++];
+        }
+        for (int part = 0; part < 2; ++part) {
+            if (part == 1) {
+                if (j >= format.size() || format[j] != '.') {
+                    break;
+                }
+                spec += format[j++];
+            }
+            if (j < format.size() && format[j] == '*') {
+                const DecodedArg* star = take();
+                spec += std::to_string(star ? star->AsSigned() : 0);
+                ++j;
+            } else {
+                while (j < format.size() && format[j] >= '0' && format[j] <= '9') {
+                    spec += format[j++];
+                }
+            }
+        }
+        while (j < format.size() && std::strchr("hljztLq", format[j]) != nullptr) {
+            ++j;
+        }
+        if (j >= format.size()) {
+            out.append(format, i, std::string::npos);
+            break;
+        }
+
+        const char conversion = format[j];
+        i = j;
+        if (std::strchr("diuoxXceEfFgGaAsp", conversion) == nullptr) {
+            out.append(format, start, j - start + 1);
+            continue;
+        }
+        const DecodedArg* arg = take();
+        if (!arg) {
+            out += "<missing>";
+            continue;
+        }
+        switch (conversion) {
+            case 'd':
+            case 'i':
+                AppendFormatted(out, spec + "lld", arg->AsSigned());
+                break;
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+                AppendFormatted(out, spec + "ll" + conversion, arg->AsUnsigned());
+                break;
+            case 'c':
+                AppendFormatted(out, spec + 'c', static_cast<int>(arg->AsSigned()));
+                break;
+            case 'e':
+            case 'E':
+            case 'f':
+            case 'F':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+                AppendFormatted(out, spec + conversion, arg->AsDouble());
+                break;
+            case 's':
+                if (arg->type == BinaryArgType::String) {
+                    AppendFormatted(out, spec + 's', arg->s.c_str());
+                } else {
+                    AppendFormatted(out, spec + 's', std::to_string(arg->AsSigned()).c_str());
+                }
+                break;
+            case 'p':
+                AppendFormatted(out, spec + 'p', reinterpret_cast<void*>(static_cast<uintptr_t>(arg->AsUnsigned())));
+                break;
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+// Static instance pointer
+static std::shared_ptr<BinaryLog> g_binaryLogInstance = nullptr;
+static std::once_flag g_binaryLogOnce;
+
+std::shared_ptr<BinaryLog> BinaryLog::GetInstance() {
+    std::call_once(g_binaryLogOnce, [] { g_binaryLogInstance = std::shared_ptr<BinaryLog>(new BinaryLog()); });
+    return g_binaryLogInstance;
+}
+
+BinaryLog::~BinaryLog() {
+    Close();
+}
+
+uint64_t BinaryLog::TicksPerSecond() {
+#ifdef KNOUX_BINARY_LOG_TSC
+    static const uint64_t rate = [] {
+        const auto steadyStart = std::chrono::steady_clock::now();
+        const uint64_t ticksStart = Now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        const uint64_t ticks = Now() - ticksStart;
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - steadyStart).count();
+        return static_cast<uint64_t>(static_cast<double>(ticks) / seconds);
+    }();
+    return rate;
+#else
+    return 1000000000ull;
+#endif
+}
+
+uint32_t BinaryLog::CurrentThreadId() {
+    static std::atomic<uint32_t> nextId{ 1 };
+    thread_local const uint32_t id = nextId.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+bool BinaryLog::Open(const Settings& settings) {
+    // Calibrate before any segment header needs the rate, outside the lock
+    TicksPerSecond();
+
+    std::lock_guard<std::mutex> control(m_controlMutex);
+    StopWriter();
+
+    m_settings = settings;
+    m_settings.segmentBytes = std::max<uint64_t>(m_settings.segmentBytes, kHeaderBytes + kMaxRecordBytes * 4);
+    m_settings.maxSegments = std::max<size_t>(m_settings.maxSegments, 1);
+    try {
+        std::filesystem::create_directories(m_settings.directory);
+    } catch (...) {
+        return false;
+    }
+
+    // The writer is stopped, so the first segment is opened here and a failure reported
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!OpenSegment(m_segmentSequence + 1)) {
+            return false;
+        }
+        m_pending.reserve(kMaxQueuedBatches);
+        m_spareBatches.reserve(kMaxQueuedBatches + 1);
+        StartSegment();
+        m_writerActive = true;
+    }
+    try {
+        m_writerThread = std::make_unique<std::thread>(&BinaryLog::WriterLoop, this);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_writerActive = false;
+        m_batch.clear();
+        m_segment.close();
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_open = true;
+    }
+    g_binaryLogActive.store(true);
+    return true;
+}
+
+void BinaryLog::Close() {
+    g_binaryLogActive.store(false);
+
+    std::lock_guard<std::mutex> control(m_controlMutex);
+    StopWriter();
+}
+
+void BinaryLog::StopWriter() {
+    if (!m_writerThread) {
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        WaitForWriter(lock);
+        QueueBatch();
+        m_open = false;
+        m_writerActive = false;
+    }
+    m_writerCondition.notify_one();
+    m_writerThread->join();
+    m_writerThread.reset();
+    m_segment.close();
+}
+
+uint32_t BinaryLog::RegisterSite(BinaryLogSite& site, LogLevel level, LogModule module, const char* text, bool span) {
+    FormatTable& table = Formats();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    const uint32_t existing = site.id.load(std::memory_order_relaxed);
+    if (existing != 0) {
+        return existing;
+    }
+
+    const size_t count = table.count.load(std::memory_order_relaxed);
+    uint32_t id = 0;
+    for (size_t i = 1; i < count && id == 0; ++i) {
+        if (table.levels[i] == level && table.modules[i] == module && table.spans[i] == span &&
+            std::strcmp(table.texts[i], text) == 0) {
+            id = static_cast<uint32_t>(i);
+        }
+    }
+    if (id == 0) {
+        if (count == kMaxFormats) {
+            return 0;
+        }
+        table.texts[count] = text;
+        table.levels[count] = level;
+        table.modules[count] = module;
+        table.spans[count] = span;
+        table.count.store(count + 1, std::memory_order_release);
+        id = static_cast<uint32_t>(count);
+    }
+    site.id.store(id, std::memory_order_release);
+    return id;
+}
+
+void BinaryLog::CommitMessage(uint32_t id, LogLevel level, uint8_t* record, size_t size, bool truncated) {
+    const uint16_t length = static_cast<uint16_t>(size - 4);
+    const uint32_t thread = CurrentThreadId();
+    const uint64_t now = Now();
+    record[0] = static_cast<uint8_t>(RecordKind::Message);
+    record[1] = 0;
+    std::memcpy(record + 2, &length, 2);
+    std::memcpy(record + 4, &id, 4);
+    std::memcpy(record + 8, &thread, 4);
+    std::memcpy(record + 12, &now, 8);
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        WaitForWriter(lock);
+        if (!m_open) {
+            return;
+        }
+        AppendRecord(id, record, size);
+        if (level >= LogLevel::ERROR) {
+            QueueBatch();
+        }
+    }
+    m_records.fetch_add(1, std::memory_order_relaxed);
+    if (truncated) {
+        m_truncated.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (level == LogLevel::FATAL) {
+        Flush();
+    }
+}
+
+void BinaryLog::WriteSpan(BinaryLogSite& site, LogModule module, const char* name, uint64_t start, uint64_t end) {
+    uint32_t id = site.id.load(std::memory_order_acquire);
+    if (id == 0) {
+        id = RegisterSite(site, LogLevel::INFO, module, name, true);
+        if (id == 0) {
+            return;
+        }
+    }
+
+    uint8_t record[28];
+    const uint16_t length = sizeof(record) - 4;
+    const uint32_t thread = CurrentThreadId();
+    const uint64_t duration = end > start ? end - start : 0;
+    record[0] = static_cast<uint8_t>(RecordKind::Span);
+    record[1] = 0;
+    std::memcpy(record + 2, &length, 2);
+    std::memcpy(record + 4, &id, 4);
+    std::memcpy(record + 8, &thread, 4);
+    std::memcpy(record + 12, &start, 8);
+    std::memcpy(record + 20, &duration, 8);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    WaitForWriter(lock);
+    if (!m_open) {
+        return;
+    }
+    AppendRecord(id, record, sizeof(record));
+    m_spans.fetch_add(1, std::memory_order_relaxed);
+}
+
+void BinaryLog::Flush() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    WaitForWriter(lock);
+    if (m_open) {
+        QueueBatch();
+    }
+    const uint64_t target = m_queuedBatches;
+    m_flushCondition.wait(lock, [this, target] { return m_writtenBatches >= target; });
+}
+
+BinaryLog::Stats BinaryLog::GetStats() const {
+    Stats stats;
+    stats.records = m_records.load(std::memory_order_relaxed);
+    stats.spans = m_spans.load(std::memory_order_relaxed);
+    stats.truncated = m_truncated.load(std::memory_order_relaxed);
+    stats.bytes = m_bytes.load(std::memory_order_relaxed);
+    stats.segments = m_segments.load(std::memory_order_relaxed);
+    stats.failedWrites = m_failedWrites.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void BinaryLog::AppendRecord(uint32_t id, const uint8_t* record, size_t size) {
+    if (id >= m_definedIn.size()) {
+        m_definedIn.resize(kMaxFormats, 0);
+    }
+
+    // Definition, if needed, plus the record must land in one segment
+    const FormatTable& table = Formats();
+    const bool define = m_definedIn[id] != m_segmentSequence;
+    const std::string_view module = define ? Logger::ModuleName(table.modules[id]) : std::string_view();
+    const size_t textLength = define ? std::min<size_t>(std::strlen(table.texts[id]), 0xFFFF - 10 - module.size()) : 0;
+    const size_t needed = size + (define ? 4 + 10 + module.size() + textLength : 0);
+    if (m_segmentSize + m_batch.size() + needed > m_settings.segmentBytes) {
+        StartSegment();
+        return AppendRecord(id, record, size);
+    }
+
+    if (define) {
+        const uint16_t length = static_cast<uint16_t>(10 + module.size() + textLength);
+        const uint8_t level = static_cast<uint8_t>(table.levels[id]);
+        const uint8_t span = table.spans[id] ? 1 : 0;
+        AppendRaw(m_batch, static_cast<uint8_t>(RecordKind::Definition));
+        AppendRaw(m_batch, static_cast<uint8_t>(0));
+        AppendRaw(m_batch, length);
+        AppendRaw(m_batch, id);
+        AppendRaw(m_batch, level);
+        AppendRaw(m_batch, span);
+        AppendRaw(m_batch, static_cast<uint16_t>(module.size()));
+        AppendRaw(m_batch, static_cast<uint16_t>(textLength));
+        m_batch.append(module.data(), module.size());
+        m_batch.append(table.texts[id], textLength);
+        m_definedIn[id] = m_segmentSequence;
+    }
+
+    m_batch.append(reinterpret_cast<const char*>(record), size);
+
+    if (m_batch.size() >= kBatchBytes) {
+        QueueBatch();
+    }
+}
+
+void BinaryLog::WaitForWriter(std::unique_lock<std::mutex>& lock) {
+    // A record hands over at most two batches: the old segment's, then itself at ERROR
+    m_flushCondition.wait(lock, [this] { return !m_writerActive || m_pending.size() + 2 <= kMaxQueuedBatches; });
+}
+
+void BinaryLog::QueueBatch() {
+    if (m_batch.empty() || !m_writerActive) {
+        return;
+    }
+    m_segmentSize += m_batch.size();
+    m_pending.push_back(Batch{ std::move(m_batch), m_segmentSequence });
+    ++m_queuedBatches;
+    if (!m_spareBatches.empty()) {
+        m_batch = std::move(m_spareBatches.back());
+        m_spareBatches.pop_back();
+    } else {
+        m_batch = std::string();
+        m_batch.reserve(kBatchBytes + kMaxRecordBytes);
+    }
+    m_writerCondition.notify_one();
+}
+
+void BinaryLog::StartSegment() {
+    QueueBatch();
+    ++m_segmentSequence;
+    m_segmentSize = 0;
+
+    const int64_t unixNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    const uint64_t steadyNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+    const uint64_t ticks = Now();
+    m_batch.append(kMagic, sizeof(kMagic));
+    AppendRaw(m_batch, kVersion);
+    AppendRaw(m_batch, static_cast<uint32_t>(kHeaderBytes));
+    AppendRaw(m_batch, unixNs);
+    AppendRaw(m_batch, steadyNs);
+    AppendRaw(m_batch, ticks);
+    AppendRaw(m_batch, TicksPerSecond());
+}
+
+void BinaryLog::WriterLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_writerCondition.wait(lock, [this] { return !m_pending.empty() || !m_writerActive; });
+        if (m_pending.empty()) {
+            return;
+        }
+        Batch batch = std::move(m_pending.front());
+        m_pending.erase(m_pending.begin());
+
+        lock.unlock();
+        WriteBatch(batch);
+        batch.bytes.clear();
+        lock.lock();
+
+        m_spareBatches.push_back(std::move(batch.bytes));
+        ++m_writtenBatches;
+        m_flushCondition.notify_all();
+    }
+}
+
+void BinaryLog::WriteBatch(const Batch& batch) {
+    if (batch.segment != m_fileSequence) {
+        OpenSegment(batch.segment);
+    }
+    if (!m_segment.is_open()) {
+        m_failedWrites.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    m_segment.write(batch.bytes.data(), static_cast<std::streamsize>(batch.bytes.size()));
+    m_segment.flush();
+    if (m_segment) {
+        m_bytes.fetch_add(batch.bytes.size(), std::memory_order_relaxed);
+    } else {
+        m_failedWrites.fetch_add(1, std::memory_order_relaxed);
+        m_segment.clear();
+    }
+}
+
+bool BinaryLog::OpenSegment(uint32_t sequence) {
+    m_segment.close();
+    m_fileSequence = sequence;
+
+    // Date-time first so names sort oldest first across runs
+    const std::time_t time = std::time(nullptr);
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &time);
+#else
+    localtime_r(&time, &local);
+#endif
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &local);
+    char name[64];
+    std::snprintf(name, sizeof(name), "knoux_%s_%06u.klog", stamp, sequence);
+    const std::filesystem::path path = std::filesystem::path(m_settings.directory) / name;
+
+    m_segment.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!m_segment.is_open()) {
+        g_binaryLogActive.store(false);
+        return false;
+    }
+
+    // Keep at most maxSegments, this one included
+    const std::vector<std::string> segments = BinaryLogReader::ListSegments(m_settings.directory);
+    for (size_t i = 0; i + m_settings.maxSegments < segments.size(); ++i) {
+        std::error_code error;
+        std::filesystem::remove(segments[i], error);
+    }
+    m_segments.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool BinaryLogReader::Open(const std::string& path) {
+    m_offset = 0;
+    m_damaged = false;
+    m_definitions.clear();
+    if (!m_file.Open(path, MappedFile::AccessHint::Sequential) || m_file.Size() < BinaryLog::kHeaderBytes) {
+        return false;
+    }
+
+    const uint8_t* cursor = m_file.Data();
+    if (std::memcmp(cursor, BinaryLog::kMagic, sizeof(BinaryLog::kMagic)) != 0) {
+        return false;
+    }
+    cursor += sizeof(BinaryLog::kMagic);
+    const uint8_t* end = m_file.Data() + m_file.Size();
+    uint32_t version = 0;
+    uint32_t headerBytes = 0;
+    ReadRaw(cursor, end, version);
+    ReadRaw(cursor, end, headerBytes);
+    uint64_t ticksPerSecond = 0;
+    ReadRaw(cursor, end, m_anchorUnixNs);
+    ReadRaw(cursor, end, m_anchorSteadyNs);
+    ReadRaw(cursor, end, m_anchorTicks);
+    ReadRaw(cursor, end, ticksPerSecond);
+    if (version != BinaryLog::kVersion || headerBytes < BinaryLog::kHeaderBytes || headerBytes > m_file.Size() ||
+        ticksPerSecond == 0) {
+        return false;
+    }
+    m_nsPerTick = 1e9 / static_cast<double>(ticksPerSecond);
+    m_offset = headerBytes;
+    return true;
+}
+
+bool BinaryLogReader::Next(BinaryLogEntry& entry) {
+    const uint8_t* const end = m_file.Data() + m_file.Size();
+    while (m_offset < m_file.Size()) {
+        const uint8_t* cursor = m_file.Data() + m_offset;
+        uint8_t kind = 0;
+        uint8_t reserved = 0;
+        uint16_t length = 0;
+        if (!ReadRaw(cursor, end, kind) || !ReadRaw(cursor, end, reserved) || !ReadRaw(cursor, end, length) ||
+            static_cast<size_t>(end - cursor) < length) {
+            m_damaged = true;
+            return false;
+        }
+        const uint8_t* const recordEnd = cursor + length;
+        m_offset = static_cast<size_t>(recordEnd - m_file.Data());
+
+        uint32_t id = 0;
+        if (!ReadRaw(cursor, recordEnd, id)) {
+            m_damaged = true;
+            return false;
+        }
+
+        if (kind == static_cast<uint8_t>(BinaryLog::RecordKind::Definition)) {
+            uint8_t level = 0;
+            uint8_t span = 0;
+            uint16_t moduleLength = 0;
+            uint16_t textLength = 0;
+            if (!ReadRaw(cursor, recordEnd, level) || !ReadRaw(cursor, recordEnd, span) ||
+                !ReadRaw(cursor, recordEnd, moduleLength) || !ReadRaw(cursor, recordEnd, textLength) ||
+                static_cast<size_t>(recordEnd - cursor) < static_cast<size_t>(moduleLength) + textLength) {
+                m_damaged = true;
+                return false;
+            }
+            Definition& definition = m_definitions[id];
+            definition.level = static_cast<LogLevel>(level);
+            definition.span = span != 0;
+            definition.module.assign(reinterpret_cast<const char*>(cursor), moduleLength);
+            definition.text.assign(reinterpret_cast<const char*>(cursor) + moduleLength, textLength);
+            continue;
+        }
+
+        const auto found = m_definitions.find(id);
+        if (found == m_definitions.end()) {
+            m_damaged = true;
+            return false;
+        }
+        const Definition& definition = found->second;
+
+        entry.level = definition.level;
+        entry.module = definition.module;
+        entry.durationNs = 0;
+        uint64_t ticks = 0;
+        if (!ReadRaw(cursor, recordEnd, entry.thread) || !ReadRaw(cursor, recordEnd, ticks)) {
+            m_damaged = true;
+            return false;
+        }
+        // Signed: another core's counter may read a little behind the anchor
+        const int64_t sinceAnchorNs = static_cast<int64_t>(static_cast<double>(static_cast<int64_t>(ticks - m_anchorTicks)) * m_nsPerTick);
+        entry.steadyNs = m_anchorSteadyNs + static_cast<uint64_t>(sinceAnchorNs);
+        entry.unixNs = m_anchorUnixNs + sinceAnchorNs;
+
+        if (kind == static_cast<uint8_t>(BinaryLog::RecordKind::Span)) {
+            entry.kind = BinaryLog::RecordKind::Span;
+            entry.text = definition.text;
+            uint64_t durationTicks = 0;
+            if (!ReadRaw(cursor, recordEnd, durationTicks)) {
+                m_damaged = true;
+                return false;
+            }
+            entry.durationNs = static_cast<uint64_t>(static_cast<double>(durationTicks) * m_nsPerTick);
+            return true;
+        }
+        if (kind != static_cast<uint8_t>(BinaryLog::RecordKind::Message)) {
+            // Unknown record kinds are skipped so newer writers stay readable
+            continue;
+        }
+
+        std::vector<DecodedArg> args;
+        while (cursor < recordEnd) {
+            DecodedArg arg;
+            uint8_t type = 0;
+            ReadRaw(cursor, recordEnd, type);
+            arg.type = static_cast<BinaryArgType>(type);
+            bool valid = true;
+            switch (arg.type) {
+                case BinaryArgType::Int:
+                    valid = ReadRaw(cursor, recordEnd, arg.i);
+                    break;
+                case BinaryArgType::UInt:
+                case BinaryArgType::Pointer:
+                    valid = ReadRaw(cursor, recordEnd, arg.u);
+                    break;
+                case BinaryArgType::Double:
+                    valid = ReadRaw(cursor, recordEnd, arg.d);
+                    break;
+                case BinaryArgType::String: {
+                    uint16_t size = 0;
+                    valid = ReadRaw(cursor, recordEnd, size) && static_cast<size_t>(recordEnd - cursor) >= size;
+                    if (valid) {
+                        arg.s.assign(reinterpret_cast<const char*>(cursor), size);
+                        cursor += size;
+                    }
+                    break;
+                }
+                default:
+                    valid = false;
+                    break;
+            }
+            if (!valid) {
+                m_damaged = true;
+                return false;
+            }
+            args.push_back(std::move(arg));
+        }
+
+        entry.kind = BinaryLog::RecordKind::Message;
+        entry.text = ReplayFormat(definition.text, args);
+        return true;
+    }
+    return false;
+}
+
+std::vector<std::string> BinaryLogReader::ListSegments(const std::string& directory) {
+    std::vector<std::string> segments;
+    std::error_code error;
+    for (const auto& item : std::filesystem::directory_iterator(directory, error)) {
+        const std::filesystem::path& path = item.path();
+        if (item.is_regular_file(error) && path.extension() == ".klog") {
+            segments.push_back(path.string());
+        }
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+std::string BinaryLogReader::FormatText(const BinaryLogEntry& entry) {
+    const int64_t unixMs = entry.unixNs / 1000000;
+    const std::time_t time = static_cast<std::time_t>(unixMs / 1000);
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &time);
+#else
+    localtime_r(&time, &local);
+#endif
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &local);
+
+    char prefix[64];
+    std::snprintf(prefix, sizeof(prefix), "[%s.%03d] [", stamp, static_cast<int>(unixMs % 1000));
+    std::string line = prefix;
+    line += entry.kind == BinaryLog::RecordKind::Span ? "SPAN " : Logger::LevelToString(entry.level);
+    line += "] [";
+    line += entry.module;
+    line += "] ";
+    line += entry.text;
+    if (entry.kind == BinaryLog::RecordKind::Span) {
+        char duration[48];
+        std::snprintf(duration, sizeof(duration), " (%.3f ms)", static_cast<double>(entry.durationNs) / 1e6);
+        line += duration;
+    }
+    return line;
+}
+
+BinaryLogTraceWriter::BinaryLogTraceWriter(std::ostream& out) : m_out(out) {
+    m_out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+}
+
+BinaryLogTraceWriter::~BinaryLogTraceWriter() {
+    Finish();
+}
+
+void BinaryLogTraceWriter::Write(const BinaryLogEntry& entry) {
+    nlohmann::json event;
+    event["name"] = entry.text;
+    event["cat"] = entry.module.empty() ? "log" : entry.module;
+    event["pid"] = 1;
+    event["tid"] = entry.thread;
+    event["ts"] = static_cast<double>(entry.steadyNs) / 1e3;
+    if (entry.kind == BinaryLog::RecordKind::Span) {
+        event["ph"] = "X";
+        event["dur"] = static_cast<double>(entry.durationNs) / 1e3;
+    } else {
+        event["ph"] = "i";
+        event["s"] = "t";
+        event["args"] = { { "level", Logger::LevelToString(entry.level) } };
+    }
+    m_out << (m_first ? "\n" : ",\n") << event.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+    m_first = false;
+}
+
+void BinaryLogTraceWriter::Finish() {
+    if (m_finished) {
+        return;
+    }
+    m_finished = true;
+    m_out << "\n]}\n";
+}
+
+} // namespace knoux::core::system
@@ -0,0 +1,520 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "logging.h"
+#include "mapped_file.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define KNOUX_BINARY_LOG_TSC 1
+#endif
+
+namespace knoux::core::system {
+
+// True while a BinaryLog segment is open; what every binary log site checks first
+inline std::atomic<bool> g_binaryLogActive{ false };
+
+/**
+ * @brief Tag in front of each argument of a binary message record
+ */
+enum class BinaryArgType : uint8_t {
+    Int = 1,        // int64_t
+    UInt = 2,       // uint64_t
+    Double = 3,     // double
+    String = 4,     // uint16_t length, then the bytes
+    Pointer = 5     // uint64_t
+};
+
+/**
+ * @struct BinaryLogSite
+ * @brief Per-call-site slot holding the site's format ID once registered
+ *
+ * The macros declare one as a function-local static, so a site registers
+ * its format string once and every later record carries 4 bytes instead.
+ */
+struct BinaryLogSite {
+    std::atomic<uint32_t> id{ 0 };
+};
+
+/**
+ * @class BinaryArgEncoder
+ * @brief Appends tagged arguments to a fixed record buffer; cuts strings that do not fit
+ */
+class BinaryArgEncoder {
+public:
+    BinaryArgEncoder(uint8_t* data, size_t capacity) : m_data(data), m_capacity(capacity) {}
+
+    template <typename T>
+    void Put(const T& value) {
+        using Type = std::decay_t<T>;
+        if constexpr (std::is_same_v<Type, bool>) {
+            PutScalar(BinaryArgType::UInt, static_cast<uint64_t>(value));
+        } else if constexpr (std::is_enum_v<Type>) {
+            Put(static_cast<std::underlying_type_t<Type>>(value));
+        } else if constexpr (std::is_integral_v<Type> && std::is_signed_v<Type>) {
+            PutScalar(BinaryArgType::Int, static_cast<int64_t>(value));
+        } else if constexpr (std::is_integral_v<Type>) {
+            PutScalar(BinaryArgType::UInt, static_cast<uint64_t>(value));
+        } else if constexpr (std::is_floating_point_v<Type>) {
+            PutScalar(BinaryArgType::Double, static_cast<double>(value));
+        } else if constexpr (std::is_array_v<T>) {
+            PutString(std::string_view(value));
+        } else if constexpr (std::is_same_v<Type, char*> || std::is_same_v<Type, const char*>) {
+            PutString(value != nullptr ? std::string_view(value) : std::string_view("(null)"));
+        } else if constexpr (std::is_convertible_v<const Type&, std::string_view>) {
+            PutString(std::string_view(value));
+        } else if constexpr (std::is_pointer_v<Type>) {
+            PutScalar(BinaryArgType::Pointer, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value)));
+        } else {
+            static_assert(std::is_pointer_v<Type>, "unsupported binary log argument type");
+        }
+    }
+
+    size_t Size() const { return m_size; }
+
+    bool Truncated() const { return m_truncated; }
+
+private:
+    template <typename Scalar>
+    void PutScalar(BinaryArgType type, Scalar value) {
+        if (m_size + 1 + sizeof(value) > m_capacity) {
+            m_truncated = true;
+            return;
+        }
+        m_data[m_size] = static_cast<uint8_t>(type);
+        std::memcpy(m_data + m_size + 1, &value, sizeof(value));
+        m_size += 1 + sizeof(value);
+    }
+
+    void PutString(std::string_view text) {
+        if (m_size + 3 > m_capacity) {
+            m_truncated = true;
+            return;
+        }
+        const uint16_t length = static_cast<uint16_t>(std::min(text.size(), m_capacity - m_size - 3));
+        m_truncated |= length < text.size();
+        m_data[m_size] = static_cast<uint8_t>(BinaryArgType::String);
+        std::memcpy(m_data + m_size + 1, &length, sizeof(length));
+        std::memcpy(m_data + m_size + 3, text.data(), length);
+        m_size += 3 + length;
+    }
+
+    uint8_t* m_data;
+    size_t m_capacity;
+    size_t m_size = 0;
+    bool m_truncated = false;
+};
+
+/**
+ * @class BinaryLog
+ * @brief Compact binary log sink: format-string IDs, raw arguments, TSC timestamps.
+ *
+ * A record is a format ID, a thread ID, a clock tick count and the
+ * printf arguments as tagged raw bytes; no text is produced at the call
+ * site. Each format string is written once per segment as a definition
+ * record the first time a site uses it, so every segment decodes on its
+ * own. Scoped spans (KNOUX_TRACE_SPAN) write one record with their start
+ * and duration, for timelines exported as Chrome trace events.
+ *
+ * Segments are files named knoux_<date-time>_<sequence>.klog, rotated by
+ * size; the oldest are deleted beyond Settings::maxSegments. Layout
+ * (host byte order, little-endian on every supported platform):
+ *   header   "KNXBLOG1", uint32 version, uint32 header bytes, then taken
+ *            together int64 unix ns, uint64 steady ns and uint64 ticks,
+ *            and uint64 ticks per second (the anchor that turns record
+ *            ticks into steady and wall-clock time)
+ *   record   uint8 kind, uint8 0, uint16 payload bytes, payload
+ *     Definition  uint32 id, uint8 level, uint8 span, uint16 module bytes, uint16 text bytes, module, text
+ *     Message     uint32 id, uint32 thread, uint64 ticks, tagged arguments (BinaryArgType)
+ *     Span        uint32 id, uint32 thread, uint64 start ticks, uint64 duration ticks
+ *
+ * Ticks are the TSC on x86-64 (a few ns to read, calibrated against the
+ * steady clock once per process; assumes an invariant TSC, as on every
+ * x86-64 CPU of the last decade) and steady-clock nanoseconds elsewhere.
+ *
+ * Records collect in a memory batch that is handed to a writer thread at
+ * kBatchBytes, on ERROR and above, by Flush() and by Close(); the writer
+ * owns the segment file, so writes, flushes and rotation never run on a
+ * logging thread. FATAL records, Flush() and Close() wait until what was
+ * batched before them is written. Decode with knoux_log_decode
+ * (BinaryLogReader).
+ *
+ * Thread-safe: writers serialize on one mutex for a memcpy of the record,
+ * and wait only while kMaxQueuedBatches batches are behind the writer.
+ */
+class BinaryLog {
+public:
+    /**
+     * @struct Settings
+     * @brief Where and how much to keep
+     */
+    struct Settings {
+        std::string directory;
+        uint64_t segmentBytes = 16ull << 20;   // Rotate once a segment would exceed this
+        size_t maxSegments = 8;                // Segments kept in the directory, including the open one
+    };
+
+    /**
+     * @struct Stats
+     * @brief Counters since the sink was created
+     */
+    struct Stats {
+        uint64_t records = 0;       // Message records written
+        uint64_t spans = 0;         // Span records written
+        uint64_t truncated = 0;     // Records with an argument cut to kMaxRecordBytes
+        uint64_t bytes = 0;         // Bytes written to segments, headers included
+        uint64_t segments = 0;      // Segments opened
+        uint64_t failedWrites = 0;  // Batches the file rejected
+    };
+
+    enum class RecordKind : uint8_t {
+        Definition = 1,
+        Message = 2,
+        Span = 3
+    };
+
+    static constexpr char kMagic[8] = { 'K', 'N', 'X', 'B', 'L', 'O', 'G', '1' };
+    static constexpr uint32_t kVersion = 1;
+    static constexpr size_t kHeaderBytes = 48;
+
+    // Largest message record; longer string arguments are cut
+    static constexpr size_t kMaxRecordBytes = 1024;
+
+    // Distinct format strings and span names per process (ID 0 is reserved)
+    static constexpr size_t kMaxFormats = 4096;
+
+    // Batch handed to the writer once it reaches this size
+    static constexpr size_t kBatchBytes = 64 * 1024;
+
+    // Filled batches the writer may fall behind by before call sites wait
+    static constexpr size_t kMaxQueuedBatches = 8;
+
+    ~BinaryLog();
+
+    /**
+     * @brief Gets singleton instance of the binary log
+     */
+    static std::shared_ptr<BinaryLog> GetInstance();
+
+    /**
+     * @brief Opens a new segment in settings.directory and starts routing LOGF_* and spans here
+     * @return false if the directory or the segment cannot be created
+     */
+    bool Open(const Settings& settings);
+
+    /**
+     * @brief Writes what is batched, stops the writer and closes the segment; sites go back to the text logger
+     */
+    void Close();
+
+    /**
+     * @brief True while a segment is open; one relaxed load
+     */
+    static bool IsActive() { return g_binaryLogActive.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Record timestamp in ticks (see TicksPerSecond())
+     */
+    static uint64_t Now() {
+#ifdef KNOUX_BINARY_LOG_TSC
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    /**
+     * @brief Tick rate of Now(); measured over ~20 ms on first use with the TSC
+     */
+    static uint64_t TicksPerSecond();
+
+    /**
+     * @brief Small sequential ID of the calling thread (1, 2, ...), stable for its lifetime
+     */
+    static uint32_t CurrentThreadId();
+
+    /**
+     * @brief Writes a message record; what LOGF_* expand to while the sink is open
+     * @param site Call-site slot; registers format on first use
+     * @param format printf format, kept by pointer, so it must be a string literal
+     */
+    template <typename... Args>
+    void Write(BinaryLogSite& site, LogLevel level, LogModule module, const char* format, const Args&... args) {
+        uint32_t id = site.id.load(std::memory_order_acquire);
+        if (id == 0) {
+            id = RegisterSite(site, level, module, format, false);
+            if (id == 0) {
+                return;
+            }
+        }
+        uint8_t record[kMaxRecordBytes];
+        BinaryArgEncoder encoder(record + kMessageFixedBytes, sizeof(record) - kMessageFixedBytes);
+        (encoder.Put(args), ...);
+        CommitMessage(id, level, record, kMessageFixedBytes + encoder.Size(), encoder.Truncated());
+    }
+
+    /**
+     * @brief Writes a span record
+     * @param name Span name, kept by pointer like a format string
+     */
+    void WriteSpan(BinaryLogSite& site, LogModule module, const char* name, uint64_t start, uint64_t end);
+
+    /**
+     * @brief Hands the batch to the writer and waits until everything batched before the call is written
+     */
+    void Flush();
+
+    Stats GetStats() const;
+
+private:
+    // Record header plus id, thread and timestamp
+    static constexpr size_t kMessageFixedBytes = 4 + 16;
+
+    struct Format {
+        const char* text = nullptr;
+        LogLevel level = LogLevel::INFO;
+        LogModule module = 0;
+        bool span = false;
+    };
+
+    // Filled batch on its way to the writer
+    struct Batch {
+        std::string bytes;
+        uint32_t segment = 0;   // Sequence of the segment the bytes belong to
+    };
+
+    BinaryLog() = default;
+
+    // Helper: Assigns the site an ID, reusing one with the same text, level and module
+    static uint32_t RegisterSite(BinaryLogSite& site, LogLevel level, LogModule module, const char* text, bool span);
+
+    // Helper: Fills in the fixed fields of a message record whose arguments follow them, and batches it
+    void CommitMessage(uint32_t id, LogLevel level, uint8_t* record, size_t size, bool truncated);
+
+    // Helper: Appends a framed record, preceded by its format's definition if this segment lacks it; caller holds m_mutex
+    void AppendRecord(uint32_t id, const uint8_t* record, size_t size);
+
+    // Helper: Waits until the writer has room for the two batches one record can hand over; lock holds m_mutex
+    void WaitForWriter(std::unique_lock<std::mutex>& lock);
+
+    // Helper: Hands m_batch to the writer and takes an empty one; caller holds m_mutex
+    void QueueBatch();
+
+    // Helper: Starts the next segment in the batch: its header, and a fresh size and definition count; caller holds m_mutex
+    void StartSegment();
+
+    // Helper: Hands over what is batched, then stops and joins the writer and closes the segment; caller holds m_controlMutex
+    void StopWriter();
+
+    // Background writer loop
+    void WriterLoop();
+
+    // Helper: Writes a batch, opening its segment first if it is a new one (writer thread)
+    void WriteBatch(const Batch& batch);
+
+    // Helper: Closes the current segment file, opens the given one and prunes old ones (writer thread, or Open())
+    bool OpenSegment(uint32_t sequence);
+
+    Settings m_settings;
+
+    // Call-site state (guarded by m_mutex): the batch being filled, the
+    // segment it belongs to and the bytes handed over for that segment
+    bool m_open = false;
+    std::string m_batch;
+    uint32_t m_segmentSequence = 0;
+    uint64_t m_segmentSize = 0;
+
+    // Segment sequence each format ID was last defined in (guarded by m_mutex)
+    std::vector<uint32_t> m_definedIn;
+
+    // Batches waiting for the writer, emptied ones kept for reuse, and
+    // how many were handed over and written (guarded by m_mutex)
+    std::vector<Batch> m_pending;
+    std::vector<std::string> m_spareBatches;
+    uint64_t m_queuedBatches = 0;
+    uint64_t m_writtenBatches = 0;
+
+    // Writer thread; it alone touches the segment file while it runs
+    std::unique_ptr<std::thread> m_writerThread;
+    bool m_writerActive = false;
+    std::condition_variable m_writerCondition;
+    std::condition_variable m_flushCondition;
+    std::ofstream m_segment;
+    uint32_t m_fileSequence = 0;
+
+    mutable std::mutex m_mutex;
+
+    // Serializes Open() and Close()
+    std::mutex m_controlMutex;
+
+    std::atomic<uint64_t> m_records{ 0 };
+    std::atomic<uint64_t> m_spans{ 0 };
+    std::atomic<uint64_t> m_truncated{ 0 };
+    std::atomic<uint64_t> m_bytes{ 0 };
+    std::atomic<uint64_t> m_segments{ 0 };
+    std::atomic<uint64_t> m_failedWrites{ 0 };
+};
+
+/**
+ * @class BinaryLogSpan
+ * @brief RAII span: records its scope's start and duration when the sink is open
+ */
+class BinaryLogSpan {
+public:
+    BinaryLogSpan(BinaryLogSite& site, LogModule module, const char* name)
+        : m_site(site), m_module(module), m_name(name), m_active(BinaryLog::IsActive()),
+          m_start(m_active ? BinaryLog::Now() : 0) {}
+
+    ~BinaryLogSpan() {
+        if (m_active && BinaryLog::IsActive()) {
+            BinaryLog::GetInstance()->WriteSpan(m_site, m_module, m_name, m_start, BinaryLog::Now());
+        }
+    }
+
+    BinaryLogSpan(const BinaryLogSpan&) = delete;
+    BinaryLogSpan& operator=(const BinaryLogSpan&) = delete;
+
+private:
+    BinaryLogSite& m_site;
+    LogModule m_module;
+    const char* m_name;
+    bool m_active;
+    uint64_t m_start;
+};
+
+/**
+ * @struct BinaryLogEntry
+ * @brief One decoded message or span
+ */
+struct BinaryLogEntry {
+    BinaryLog::RecordKind kind = BinaryLog::RecordKind::Message;
+    LogLevel level = LogLevel::INFO;
+    std::string module;
+    std::string text;           // Formatted message, or the span name
+    uint32_t thread = 0;
+    uint64_t steadyNs = 0;      // Timestamp on the writer's steady clock, or span start
+    uint64_t durationNs = 0;    // Spans only
+    int64_t unixNs = 0;         // steadyNs on the wall clock, from the segment anchor
+};
+
+/**
+ * @class BinaryLogReader
+ * @brief Offline decoder of BinaryLog segments.
+ *
+ * Replays each message's printf format against its recorded arguments,
+ * so the text matches what the text logger would have written. A segment
+ * cut short by a crash decodes up to its last complete record.
+ */
+class BinaryLogReader {
+public:
+    /**
+     * @brief Maps a segment and checks its header
+     */
+    bool Open(const std::string& path);
+
+    /**
+     * @brief Decodes the next message or span
+     * @return false at the end of the segment or at a damaged record
+     */
+    bool Next(BinaryLogEntry& entry);
+
+    /**
+     * @brief True if decoding stopped before the end of the segment
+     */
+    bool IsDamaged() const { return m_damaged; }
+
+    /**
+     * @brief Segment files of a directory, oldest first
+     */
+    static std::vector<std::string> ListSegments(const std::string& directory);
+
+    /**
+     * @brief Formats an entry like the text logger: "[time] [LEVEL] [Module] message"
+     */
+    static std::string FormatText(const BinaryLogEntry& entry);
+
+private:
+    struct Definition {
+        LogLevel level = LogLevel::INFO;
+        bool span = false;
+        std::string module;
+        std::string text;
+    };
+
+    MappedFile m_file;
+    size_t m_offset = 0;
+    int64_t m_anchorUnixNs = 0;
+    uint64_t m_anchorSteadyNs = 0;
+    uint64_t m_anchorTicks = 0;
+    double m_nsPerTick = 1.0;
+    bool m_damaged = false;
+    std::unordered_map<uint32_t, Definition> m_definitions;
+};
+
+/**
+ * @class BinaryLogTraceWriter
+ * @brief Streams entries as Chrome trace-event JSON (also read by Perfetto)
+ *
+ * Spans become complete ("X") events and messages instant ("i") events,
+ * on one track per thread. Each entry is written as it is passed in, so
+ * a log of millions of records is never held in memory.
+ */
+class BinaryLogTraceWriter {
+public:
+    /**
+     * @brief Writes the opening of the document to out
+     */
+    explicit BinaryLogTraceWriter(std::ostream& out);
+
+    ~BinaryLogTraceWriter();
+
+    BinaryLogTraceWriter(const BinaryLogTraceWriter&) = delete;
+    BinaryLogTraceWriter& operator=(const BinaryLogTraceWriter&) = delete;
+
+    /**
+     * @brief Writes one entry as one event
+     */
+    void Write(const BinaryLogEntry& entry);
+
+    /**
+     * @brief Closes the document; the destructor does it if not called
+     */
+    void Finish();
+
+private:
+    std::ostream& m_out;
+    bool m_first = true;
+    bool m_finished = false;
+};
+
+} // namespace knoux::core::system
+
+#define KNOUX_LOG_CONCAT_INNER(a, b) a##b
+#define KNOUX_LOG_CONCAT(a, b) KNOUX_LOG_CONCAT_INNER(a, b)
+
+// Times the rest of the enclosing scope: KNOUX_TRACE_SPAN(kEngineLog, "Load");
+#define KNOUX_TRACE_SPAN(module, name)                                                              \
+    static knoux::core::system::BinaryLogSite KNOUX_LOG_CONCAT(knouxSpanSite_, __LINE__);           \
+    knoux::core::system::BinaryLogSpan KNOUX_LOG_CONCAT(knouxSpan_, __LINE__)(                      \
+        KNOUX_LOG_CONCAT(knouxSpanSite_, __LINE__), module, name)
@@ -0,0 +1,321 @@
+﻿#include "byte_source.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <utility>
+
+namespace knoux::core::system {
+
+namespace {
+
+int64_t NowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t AlignDown(uint64_t offset) {
+    return offset & ~(ByteSource::kAlignment - 1);
+}
+
+} // namespace
+
+ByteSource::ByteSource(std::shared_ptr<IoBackend> backend)
+    : m_backend(backend ? std::move(backend) : IoBackend::GetDefault()) {
+    m_stats.windowBytes = m_windowBytes;
+    m_stats.backend = m_backend->Name();
+}
+
+ByteSource::~ByteSource() {
+    Close();
+}
+
+bool ByteSource::Open(const std::string& path) {
+    Close();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.Open(path)) {
+        return false;
+    }
+
+    for (auto& window : m_windows) {
+        window.state = WindowState::Idle;
+        window.offset = 0;
+        window.requested = 0;
+        window.length = 0;
+    }
+    m_hasDeferred = false;
+    m_latencyTotalUs = 0;
+    m_latencySamples = 0;
+    m_stats = Stats{};
+    m_stats.windowBytes = m_windowBytes;
+    m_stats.backend = m_backend->Name();
+    return true;
+}
+
+void ByteSource::Close() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_hasDeferred = false;
+
+    // The backend writes into the windows until their completions have run
+    m_fetched.wait(lock, [this] {
+        return std::none_of(std::begin(m_windows), std::end(m_windows),
+                            [](const Window& window) { return window.state == WindowState::Pending; });
+    });
+
+    for (auto& window : m_windows) {
+        window.state = WindowState::Idle;
+    }
+    m_file.Close();
+}
+
+bool ByteSource::IsOpen() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_file.IsOpen();
+}
+
+uint64_t ByteSource::Size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_file.Size();
+}
+
+int64_t ByteSource::ReadAt(uint64_t offset, void* buffer, size_t length) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_file.IsOpen()) {
+        return -1;
+    }
+
+    const uint64_t size = m_file.Size();
+    if (length == 0 || offset >= size) {
+        return 0;
+    }
+    length = static_cast<size_t>(std::min<uint64_t>(length, size - offset));
+    m_stats.reads++;
+
+    // Larger than a window: the windows would only add a copy
+    if (length >= m_windowBytes) {
+        m_stats.misses++;
+        m_stats.backendReads++;
+        lock.unlock();
+
+        const int64_t started = NowUs();
+        const int64_t result = m_file.ReadAt(offset, buffer, length);
+        const int64_t latencyUs = NowUs() - started;
+
+        lock.lock();
+        RecordLatency(latencyUs);
+        if (result > 0) {
+            m_stats.bytesFetched += static_cast<uint64_t>(result);
+            m_stats.bytesRead += static_cast<uint64_t>(result);
+        }
+        return result;
+    }
+
+    uint8_t* out = static_cast<uint8_t*>(buffer);
+    size_t copied = 0;
+    bool waited = false;
+    bool missed = false;
+
+    while (copied < length) {
+        const uint64_t position = offset + copied;
+        size_t index = FindWindow(position);
+
+        if (index == kWindowCount) {
+            index = FreeWindow(kWindowCount);
+            if (index == kWindowCount) {
+                // Both windows are loading other ranges
+                waited = true;
+                m_fetched.wait(lock);
+                continue;
+            }
+            missed = true;
+            StartFetch(index, AlignDown(position), lock);
+            continue;
+        }
+
+        Window& window = m_windows[index];
+        if (window.state == WindowState::Pending) {
+            waited = true;
+            m_fetched.wait(lock, [&window] { return window.state != WindowState::Pending; });
+            continue;
+        }
+
+        if (window.state == WindowState::Failed) {
+            // Let the next read retry instead of failing forever
+            window.state = WindowState::Idle;
+            if (copied == 0) {
+                return -1;
+            }
+            break;
+        }
+
+        const uint64_t end = window.offset + window.length;
+        if (position >= end) {
+            // Short window: the file shrank since it was opened
+            break;
+        }
+
+        const size_t chunk = static_cast<size_t>(std::min<uint64_t>(length - copied, end - position));
+        std::memcpy(out + copied, window.data.data() + (position - window.offset), chunk);
+        copied += chunk;
+
+        ReadAhead(index, lock);
+    }
+
+    if (missed) {
+        m_stats.misses++;
+    } else if (waited) {
+        m_stats.waits++;
+    } else {
+        m_stats.hits++;
+    }
+    m_stats.bytesRead += copied;
+    return static_cast<int64_t>(copied);
+}
+
+void ByteSource::Prefetch(uint64_t offset) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_file.IsOpen() || offset >= m_file.Size()) {
+        return;
+    }
+    m_stats.prefetches++;
+
+    const size_t covering = FindWindow(offset);
+    if (covering != kWindowCount) {
+        if (m_windows[covering].state == WindowState::Ready) {
+            ReadAhead(covering, lock);
+        }
+        return;
+    }
+
+    const size_t index = FreeWindow(kWindowCount);
+    if (index == kWindowCount) {
+        // Picked up by the first completion
+        m_hasDeferred = true;
+        m_deferredOffset = offset;
+        return;
+    }
+    StartFetch(index, AlignDown(offset), lock);
+}
+
+void ByteSource::SetBitrate(int64_t bitsPerSecond) {
+    uint64_t bytes = bitsPerSecond > 0 ? static_cast<uint64_t>(bitsPerSecond) / 8 * kReadaheadSeconds : 0;
+    bytes = std::clamp<uint64_t>(bytes, kMinWindowBytes, kMaxWindowBytes);
+    bytes = (bytes + kAlignment - 1) & ~(kAlignment - 1);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Windows already loaded keep their size until refilled
+    m_windowBytes = static_cast<size_t>(bytes);
+    m_stats.windowBytes = m_windowBytes;
+}
+
+ByteSource::Stats ByteSource::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void ByteSource::StartFetch(size_t index, uint64_t offset, std::unique_lock<std::mutex>& lock) {
+    const uint64_t size = m_file.Size();
+    if (offset >= size) {
+        return;
+    }
+
+    Window& window = m_windows[index];
+    window.offset = offset;
+    window.requested = static_cast<size_t>(std::min<uint64_t>(m_windowBytes, size - offset));
+    window.length = 0;
+    window.data.resize(window.requested);
+    window.state = WindowState::Pending;
+    window.submittedUs = NowUs();
+
+    m_stats.backendReads++;
+    m_stats.bytesInFlight += window.requested;
+    m_stats.maxBytesInFlight = std::max(m_stats.maxBytesInFlight, m_stats.bytesInFlight);
+
+    // A Pending window is left alone by everyone but its completion
+    void* buffer = window.data.data();
+    const size_t requested = window.requested;
+    lock.unlock();
+    m_backend->Submit(m_file, offset, buffer, requested,
+                      [this, index](int64_t result) { OnFetched(index, result); });
+    lock.lock();
+}
+
+void ByteSource::OnFetched(size_t index, int64_t result) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Window& window = m_windows[index];
+
+    RecordLatency(NowUs() - window.submittedUs);
+    m_stats.bytesInFlight -= window.requested;
+    if (result < 0) {
+        window.state = WindowState::Failed;
+    } else {
+        window.length = static_cast<size_t>(result);
+        window.state = WindowState::Ready;
+        m_stats.bytesFetched += window.length;
+    }
+
+    // Notify under the lock: Close() may destroy this object as soon as it is released
+    m_fetched.notify_all();
+
+    if (m_hasDeferred) {
+        m_hasDeferred = false;
+        if (FindWindow(m_deferredOffset) == kWindowCount) {
+            // The deferred target supersedes whatever either idle window holds
+            const size_t target = FreeWindow(index);
+            StartFetch(target == kWindowCount ? index : target, AlignDown(m_deferredOffset), lock);
+        }
+    }
+}
+
+size_t ByteSource::FindWindow(uint64_t offset) const {
+    for (size_t i = 0; i < kWindowCount; ++i) {
+        const Window& window = m_windows[i];
+        if (window.state != WindowState::Idle &&
+            offset >= window.offset && offset < window.offset + window.requested) {
+            return i;
+        }
+    }
+    return kWindowCount;
+}
+
+size_t ByteSource::FreeWindow(size_t avoid) const {
+    size_t found = kWindowCount;
+    for (size_t i = 0; i < kWindowCount; ++i) {
+        if (m_windows[i].state == WindowState::Pending) {
+            continue;
+        }
+        if (i != avoid) {
+            return i;
+        }
+        found = i;
+    }
+    return found;
+}
+
+void ByteSource::ReadAhead(size_t current, std::unique_lock<std::mutex>& lock) {
+    const Window& window = m_windows[current];
+    if (window.state != WindowState::Ready || window.length < window.requested) {
+        return;
+    }
+
+    const uint64_t next = window.offset + window.length;
+    if (next >= m_file.Size() || FindWindow(next) != kWindowCount) {
+        return;
+    }
+
+    const size_t other = (current + 1) % kWindowCount;
+    if (m_windows[other].state == WindowState::Pending) {
+        return;
+    }
+    StartFetch(other, next, lock);
+}
+
+void ByteSource::RecordLatency(int64_t latencyUs) {
+    m_latencyTotalUs += latencyUs;
+    m_latencySamples++;
+    m_stats.lastLatencyUs = latencyUs;
+    m_stats.maxLatencyUs = std::max(m_stats.maxLatencyUs, latencyUs);
+    m_stats.averageLatencyUs = m_latencyTotalUs / m_latencySamples;
+}
+
+} // namespace knoux::core::system
@@ -0,0 +1,165 @@
+﻿#pragma once
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "io_backend.h"
+
+namespace knoux::core::system {
+
+/**
+ * @class ByteSource
+ * @brief Shared reader for media bytes with asynchronous, double-buffered readahead.
+ *
+ * Reads are served from two windows. When a read lands in one window the
+ * other is filled with the bytes that follow, so a sequential consumer
+ * (the demuxer) finds its next window already loaded or in flight instead
+ * of stalling on the disk. Window size follows the stream bitrate
+ * (kReadaheadSeconds of media per window, clamped) and Prefetch() retargets
+ * both windows, e.g. at a seek's keyframe offset, before the first read.
+ *
+ * Reads larger than a window bypass the windows. All methods are
+ * thread-safe; concurrent readers share the windows.
+ */
+class ByteSource {
+public:
+    /**
+     * @struct Stats
+     * @brief Counters since Open()
+     */
+    struct Stats {
+        uint64_t reads = 0;             // ReadAt() calls
+        uint64_t bytesRead = 0;         // Bytes returned by ReadAt()
+        uint64_t hits = 0;              // Reads served without waiting for I/O
+        uint64_t waits = 0;             // Reads that waited for an in-flight window
+        uint64_t misses = 0;            // Reads that had to start their own I/O
+        uint64_t prefetches = 0;        // Prefetch() calls
+        uint64_t backendReads = 0;      // Reads issued to the backend
+        uint64_t bytesFetched = 0;      // Bytes delivered by the backend
+        uint64_t bytesInFlight = 0;     // Bytes requested and not yet completed
+        uint64_t maxBytesInFlight = 0;
+        int64_t lastLatencyUs = 0;      // Backend read latency
+        int64_t averageLatencyUs = 0;
+        int64_t maxLatencyUs = 0;
+        size_t windowBytes = 0;
+        const char* backend = "";
+    };
+
+    /**
+     * @param backend Read engine; the process-wide default when null
+     */
+    explicit ByteSource(std::shared_ptr<IoBackend> backend = nullptr);
+
+    /**
+     * @brief Waits for in-flight reads, then closes the file
+     */
+    ~ByteSource();
+
+    ByteSource(const ByteSource&) = delete;
+    ByteSource& operator=(const ByteSource&) = delete;
+
+    /**
+     * @brief Opens a file, resetting windows and counters
+     * @param path Absolute path of the file
+     * @return true if the file was opened
+     */
+    bool Open(const std::string& path);
+
+    /**
+     * @brief Waits for in-flight reads and closes the file
+     */
+    void Close();
+
+    bool IsOpen() const;
+    uint64_t Size() const;
+
+    /**
+     * @brief Blocking read through the readahead windows
+     * @param offset File offset
+     * @param buffer Destination
+     * @param length Bytes wanted
+     * @return Bytes read (short only at end of file), or -1 on error
+     */
+    int64_t ReadAt(uint64_t offset, void* buffer, size_t length);
+
+    /**
+     * @brief Starts loading the windows at an offset without waiting
+     * @param offset Where the next reads will start (e.g. a seek target)
+     */
+    void Prefetch(uint64_t offset);
+
+    /**
+     * @brief Sizes the readahead windows from the stream bitrate
+     * @param bitsPerSecond Average bitrate, 0 for the minimum window
+     */
+    void SetBitrate(int64_t bitsPerSecond);
+
+    /**
+     * @brief Returns a snapshot of the counters
+     */
+    Stats GetStats() const;
+
+    // Media duration held by one window
+    static constexpr int64_t kReadaheadSeconds = 1;
+
+    static constexpr size_t kMinWindowBytes = 256 * 1024;
+    static constexpr size_t kMaxWindowBytes = 16 * 1024 * 1024;
+
+    // Windows start on this boundary so reads stay sector and page aligned
+    static constexpr uint64_t kAlignment = 4096;
+
+private:
+    enum class WindowState { Idle, Pending, Ready, Failed };
+
+    struct Window {
+        std::vector<uint8_t> data;
+        uint64_t offset = 0;
+        size_t requested = 0;   // Bytes asked for
+        size_t length = 0;      // Bytes available once Ready (short at end of file)
+        WindowState state = WindowState::Idle;
+        int64_t submittedUs = 0;
+    };
+
+    static constexpr size_t kWindowCount = 2;
+
+    // Helper: Starts an asynchronous load into a window that is not Pending.
+    // The lock is released around the submit since completions may run inline.
+    void StartFetch(size_t index, uint64_t offset, std::unique_lock<std::mutex>& lock);
+
+    // Helper: Completion of a window load
+    void OnFetched(size_t index, int64_t result);
+
+    // Helper: Window whose requested range covers an offset, or kWindowCount
+    size_t FindWindow(uint64_t offset) const;
+
+    // Helper: Window that may be refilled (not Pending), preferring `avoid`'s sibling, or kWindowCount
+    size_t FreeWindow(size_t avoid) const;
+
+    // Helper: Loads the bytes following a Ready window into the other one
+    void ReadAhead(size_t current, std::unique_lock<std::mutex>& lock);
+
+    // Helper: Records a completed backend read; caller holds m_mutex
+    void RecordLatency(int64_t latencyUs);
+
+    std::shared_ptr<IoBackend> m_backend;
+    RandomAccessFile m_file;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_fetched;
+    Window m_windows[kWindowCount];
+    size_t m_windowBytes = kMinWindowBytes;
+
+    // Prefetch target waiting for a window to become idle
+    bool m_hasDeferred = false;
+    uint64_t m_deferredOffset = 0;
+
+    Stats m_stats;
+    int64_t m_latencyTotalUs = 0;
+    int64_t m_latencySamples = 0;
+};
+
+} // namespace knoux::core::system
@@ -0,0 +1,37 @@
+﻿#include "file_identity.h"
+#include <filesystem>
+#include <system_error>
+
+namespace knoux::core::system {
+
+bool ReadFileIdentity(const std::string& path, FileIdentity& identity) {
+    std::error_code ec;
+    const std::filesystem::path canonical = std::filesystem::canonical(path, ec);
+    if (ec) {
+        return false;
+    }
+    const uint64_t size = std::filesystem::file_size(canonical, ec);
+    if (ec) {
+        return false;
+    }
+    const auto modified = std::filesystem::last_write_time(canonical, ec);
+    if (ec) {
+        return false;
+    }
+
+    identity.path = canonical.string();
+    identity.size = size;
+    identity.modified = static_cast<int64_t>(modified.time_since_epoch().count());
+    return true;
+}
+
+uint64_t HashBytes(const void* data, size_t size) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ p[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+} // namespace knoux::core::system
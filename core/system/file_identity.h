@@ -0,0 +1,40 @@
+﻿#pragma once
+
+#include <string>
+#include <cstdint>
+
+namespace knoux::core::system {
+
+/**
+ * @struct FileIdentity
+ * @brief What a persistent cache keys a media file by
+ *
+ * Two identities are equal only if the file was neither moved, resized nor
+ * rewritten in between, which is what lets caches detect stale entries
+ * without reading the file.
+ */
+struct FileIdentity {
+    std::string path;      // Canonical absolute path
+    uint64_t size = 0;     // Size in bytes
+    int64_t modified = 0;  // Last write time in filesystem clock ticks
+
+    bool operator==(const FileIdentity& other) const {
+        return size == other.size && modified == other.modified && path == other.path;
+    }
+    bool operator!=(const FileIdentity& other) const { return !(*this == other); }
+};
+
+/**
+ * @brief Reads the identity of a file
+ * @param path Path of the file (resolved to its canonical form)
+ * @param identity Receives the identity
+ * @return false if the file does not exist or cannot be inspected
+ */
+bool ReadFileIdentity(const std::string& path, FileIdentity& identity);
+
+/**
+ * @brief 64-bit FNV-1a hash, used for cache keys
+ */
+uint64_t HashBytes(const void* data, size_t size);
+
+} // namespace knoux::core::system
@@ -0,0 +1,88 @@
+﻿#include "file_lock.h"
+#include <filesystem>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+namespace knoux::core::system {
+
+FileLock::~FileLock() {
+    Unlock();
+}
+
+#ifdef _WIN32
+
+bool FileLock::TryLock(const std::string& path) {
+    Unlock();
+
+    const std::wstring widePath = std::filesystem::u8path(path).wstring();
+    HANDLE handle = CreateFileW(widePath.c_str(), GENERIC_READ | GENERIC_WRITE,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_ALWAYS,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    OVERLAPPED overlapped = {};
+    if (!LockFileEx(handle, LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY, 0, 1, 0, &overlapped)) {
+        CloseHandle(handle);
+        return false;
+    }
+    m_handle = handle;
+    return true;
+}
+
+void FileLock::Unlock() {
+    if (m_handle) {
+        OVERLAPPED overlapped = {};
+        UnlockFileEx(m_handle, 0, 1, 0, &overlapped);
+        CloseHandle(m_handle);
+        m_handle = nullptr;
+    }
+}
+
+bool FileLock::IsLocked() const {
+    return m_handle != nullptr;
+}
+
+#else
+
+bool FileLock::TryLock(const std::string& path) {
+    Unlock();
+
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    // flock() locks belong to the open file description, so they also exclude other opens in this process
+    if (::flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        ::close(fd);
+        return false;
+    }
+    m_fd = fd;
+    return true;
+}
+
+void FileLock::Unlock() {
+    if (m_fd >= 0) {
+        ::flock(m_fd, LOCK_UN);
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+bool FileLock::IsLocked() const {
+    return m_fd >= 0;
+}
+
+#endif
+
+} // namespace knoux::core::system
@@ -0,0 +1,50 @@
+﻿#pragma once
+
+#include <string>
+
+namespace knoux::core::system {
+
+/**
+ * @class FileLock
+ * @brief Exclusive advisory lock on a lock file, held until Unlock() or destruction.
+ *
+ * Guards files that several processes (e.g. two app instances) could
+ * open at once. Lock a dedicated file next to the guarded one rather
+ * than the file itself: a lock does not survive the file being replaced
+ * by a rename. Locks taken through separate FileLock objects exclude
+ * each other within one process too.
+ */
+class FileLock {
+public:
+    FileLock() = default;
+    ~FileLock();
+
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+    /**
+     * @brief Creates the lock file if needed and locks it without waiting
+     * @param path Lock file
+     * @return false if another holder has it locked or it cannot be opened
+     */
+    bool TryLock(const std::string& path);
+
+    /**
+     * @brief Releases the lock; the lock file is left in place
+     */
+    void Unlock();
+
+    /**
+     * @brief Checks if the lock is held
+     */
+    bool IsLocked() const;
+
+private:
+#ifdef _WIN32
+    void* m_handle = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
+
+} // namespace knoux::core::system
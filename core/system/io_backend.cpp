@@ -0,0 +1,572 @@
+﻿#include "io_backend.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define KNOUX_HAVE_IO_URING 1
+#endif
+#endif
+
+namespace knoux::core::system {
+
+// ---------------------------------------------------------------------------
+// RandomAccessFile
+// ---------------------------------------------------------------------------
+
+RandomAccessFile::~RandomAccessFile() {
+    Close();
+}
+
+RandomAccessFile::RandomAccessFile(RandomAccessFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+RandomAccessFile& RandomAccessFile::operator=(RandomAccessFile&& other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+
+    Close();
+    std::swap(m_size, other.m_size);
+#ifdef _WIN32
+    std::swap(m_handle, other.m_handle);
+#else
+    std::swap(m_fd, other.m_fd);
+#endif
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool RandomAccessFile::Open(const std::string& path) {
+    Close();
+
+    const std::wstring widePath = std::filesystem::u8path(path).wstring();
+    HANDLE file = CreateFileW(widePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    m_handle = file;
+    m_size = static_cast<uint64_t>(size.QuadPart);
+    return true;
+}
+
+void RandomAccessFile::Close() {
+    if (m_handle) {
+        CloseHandle(m_handle);
+    }
+    m_handle = nullptr;
+    m_size = 0;
+}
+
+bool RandomAccessFile::IsOpen() const {
+    return m_handle != nullptr;
+}
+
+int64_t RandomAccessFile::ReadAt(uint64_t offset, void* buffer, size_t length) const {
+    uint8_t* out = static_cast<uint8_t*>(buffer);
+    size_t total = 0;
+    while (total < length) {
+        OVERLAPPED overlapped = {};
+        const uint64_t position = offset + total;
+        overlapped.Offset = static_cast<DWORD>(position);
+        overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+
+        DWORD chunk = static_cast<DWORD>(std::min<size_t>(length - total, 1u << 30));
+        DWORD bytesRead = 0;
+        if (!ReadFile(m_handle, out + total, chunk, &bytesRead, &overlapped)) {
+            return GetLastError() == ERROR_HANDLE_EOF ? static_cast<int64_t>(total) : -1;
+        }
+        if (bytesRead == 0) {
+            break;
+        }
+        total += bytesRead;
+    }
+    return static_cast<int64_t>(total);
+}
+
+#else
+
+bool RandomAccessFile::Open(const std::string& path) {
+    Close();
+
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+
+    m_fd = fd;
+    m_size = static_cast<uint64_t>(st.st_size);
+    return true;
+}
+
+void RandomAccessFile::Close() {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+    m_fd = -1;
+    m_size = 0;
+}
+
+bool RandomAccessFile::IsOpen() const {
+    return m_fd >= 0;
+}
+
+int64_t RandomAccessFile::ReadAt(uint64_t offset, void* buffer, size_t length) const {
+    uint8_t* out = static_cast<uint8_t*>(buffer);
+    size_t total = 0;
+    while (total < length) {
+        const ssize_t n = ::pread(m_fd, out + total, length - total, static_cast<off_t>(offset + total));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        total += static_cast<size_t>(n);
+    }
+    return static_cast<int64_t>(total);
+}
+
+#endif
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// Thread pool backend
+// ---------------------------------------------------------------------------
+
+class ThreadPoolBackend : public IoBackend {
+public:
+    explicit ThreadPoolBackend(size_t threads) {
+        for (size_t i = 0; i < threads; ++i) {
+            m_threads.emplace_back(&ThreadPoolBackend::WorkerLoop, this);
+        }
+    }
+
+    ~ThreadPoolBackend() override {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_condition.notify_all();
+        for (auto& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    void Submit(const RandomAccessFile& file, uint64_t offset, void* buffer, size_t length, Completion done) override {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back({ &file, offset, buffer, length, std::move(done) });
+        }
+        m_condition.notify_one();
+    }
+
+    const char* Name() const override { return "threadpool"; }
+
+private:
+    struct Request {
+        const RandomAccessFile* file;
+        uint64_t offset;
+        void* buffer;
+        size_t length;
+        Completion done;
+    };
+
+    void WorkerLoop() {
+        for (;;) {
+            Request request;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+                // Drain before exiting so every completion runs
+                if (m_queue.empty()) {
+                    return;
+                }
+                request = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+            request.done(request.file->ReadAt(request.offset, request.buffer, request.length));
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<Request> m_queue;
+    std::vector<std::thread> m_threads;
+    bool m_stopping = false;
+};
+
+#ifdef KNOUX_HAVE_IO_URING
+
+// ---------------------------------------------------------------------------
+// io_uring backend (raw syscalls, no liburing dependency)
+// ---------------------------------------------------------------------------
+
+class IoUringBackend : public IoBackend {
+public:
+    ~IoUringBackend() override {
+        if (m_completionThread.joinable()) {
+            // A NOP without a request wakes the completion thread; it exits once nothing is in flight
+            m_stopping.store(true);
+            while (!m_completionDone.load() && !SubmitEntry(IORING_OP_NOP, -1, 0, nullptr)) {
+                std::this_thread::sleep_for(kSubmitBackoff);
+            }
+            m_completionThread.join();
+        }
+        if (m_sqes) ::munmap(m_sqes, m_sqesSize);
+        if (m_cqRing && m_cqRing != m_sqRing) ::munmap(m_cqRing, m_cqRingSize);
+        if (m_sqRing) ::munmap(m_sqRing, m_sqRingSize);
+        if (m_ringFd >= 0) ::close(m_ringFd);
+    }
+
+    // Returns false when the kernel lacks io_uring or a sandbox forbids it
+    bool Initialize(unsigned entries) {
+        io_uring_params params = {};
+        m_ringFd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (m_ringFd < 0) {
+            return false;
+        }
+
+        m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMap) {
+            m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+        }
+
+        m_sqRing = ::mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQ_RING);
+        if (m_sqRing == MAP_FAILED) {
+            m_sqRing = nullptr;
+            return false;
+        }
+        m_cqRing = singleMap ? m_sqRing
+            : ::mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_CQ_RING);
+        if (m_cqRing == MAP_FAILED) {
+            m_cqRing = nullptr;
+            return false;
+        }
+        m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = ::mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            return false;
+        }
+        m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+        uint8_t* sq = static_cast<uint8_t*>(m_sqRing);
+        m_sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        m_sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        m_sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        m_sqEntries = params.sq_entries;
+        m_sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+        uint8_t* cq = static_cast<uint8_t*>(m_cqRing);
+        m_cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        m_cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        m_cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        // A synchronous NOP round trip proves the ring works (seccomp may allow setup but not enter)
+        io_uring_sqe& sqe = m_sqes[*m_sqTail & m_sqMask];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_NOP;
+        m_sqArray[*m_sqTail & m_sqMask] = *m_sqTail & m_sqMask;
+        __atomic_store_n(m_sqTail, *m_sqTail + 1, __ATOMIC_RELEASE);
+        if (::syscall(__NR_io_uring_enter, m_ringFd, 1, 1, IORING_ENTER_GETEVENTS, nullptr, 0) != 1 ||
+            __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE) == *m_cqHead) {
+            return false;
+        }
+        __atomic_store_n(m_cqHead, *m_cqHead + 1, __ATOMIC_RELEASE);
+
+        // One request per completion slot, so the completion queue can never overflow
+        m_requestCount = params.cq_entries;
+        m_requests = std::make_unique<Request[]>(m_requestCount);
+        m_freeRequests.reserve(m_requestCount);
+        for (size_t i = 0; i < m_requestCount; ++i) {
+            m_freeRequests.push_back(&m_requests[i]);
+        }
+
+        m_completionThread = std::thread(&IoUringBackend::CompletionLoop, this);
+        return true;
+    }
+
+    void Submit(const RandomAccessFile& file, uint64_t offset, void* buffer, size_t length, Completion done) override {
+        if (Request* request = AcquireRequest()) {
+            request->file = &file;
+            request->iov = { buffer, length };
+            request->offset = offset;
+            request->done = std::move(done);
+            if (SubmitEntry(IORING_OP_READV, file.Descriptor(), offset, request)) {
+                return;
+            }
+            done = std::move(request->done);
+            ReleaseRequest(request);
+        }
+        // Every request in flight, submission queue full, enter refused or the ring failed:
+        // read inline rather than drop the request
+        done(file.ReadAt(offset, buffer, length));
+    }
+
+    const char* Name() const override { return "io_uring"; }
+
+private:
+    struct Request {
+        const RandomAccessFile* file = nullptr;
+        iovec iov = {};
+        Completion done;
+        uint64_t offset = 0;
+        // Set under m_submitMutex once the kernel may see the entry; cleared by whoever completes it
+        std::atomic<bool> inFlight{ false };
+    };
+
+    // Transient enter failures (EAGAIN, EBUSY) are retried this often before reading inline
+    static constexpr int kSubmitRetries = 8;
+    static constexpr std::chrono::microseconds kSubmitBackoff{ 50 };
+
+    // Helper: Takes a pooled request; nullptr when all are in flight
+    Request* AcquireRequest() {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        if (m_freeRequests.empty()) {
+            return nullptr;
+        }
+        Request* request = m_freeRequests.back();
+        m_freeRequests.pop_back();
+        return request;
+    }
+
+    // Helper: Returns a request to the pool; its completion has been moved out
+    void ReleaseRequest(Request* request) {
+        request->done = nullptr;
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        m_freeRequests.push_back(request);
+    }
+
+    // Queues one entry and enters it; false if the kernel did not take it (nothing is left queued)
+    bool SubmitEntry(uint8_t opcode, int fd, uint64_t offset, Request* request) {
+        std::lock_guard<std::mutex> lock(m_submitMutex);
+        const unsigned tail = *m_sqTail;
+        if (m_failed || tail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) >= m_sqEntries) {
+            return false;
+        }
+
+        const unsigned index = tail & m_sqMask;
+        io_uring_sqe& sqe = m_sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = opcode;
+        sqe.fd = fd;
+        sqe.off = offset;
+        if (opcode == IORING_OP_READV) {
+            sqe.addr = reinterpret_cast<uint64_t>(&request->iov);
+            sqe.len = 1;
+        }
+        sqe.user_data = reinterpret_cast<uint64_t>(request);
+        m_sqArray[index] = index;
+        if (request) {
+            request->inFlight.store(true, std::memory_order_release);
+        }
+        __atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+
+        auto backoff = kSubmitBackoff;
+        for (int attempt = 0;;) {
+            const long submitted = ::syscall(__NR_io_uring_enter, m_ringFd, 1, 0, 0, nullptr, 0);
+            if (submitted > 0) {
+                return true;
+            }
+            if (submitted < 0 && errno == EINTR) {
+                continue;
+            }
+            // Out of kernel resources or completions backed up: give the completion thread time to drain
+            if (submitted < 0 && (errno == EAGAIN || errno == EBUSY) && ++attempt < kSubmitRetries) {
+                std::this_thread::sleep_for(backoff);
+                backoff *= 2;
+                continue;
+            }
+            break;
+        }
+
+        if (__atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) != tail) {
+            // The kernel consumed the entry after all; its completion will arrive
+            return true;
+        }
+        // Take the entry back, so it cannot be submitted by a later enter as well as run inline
+        __atomic_store_n(m_sqTail, tail, __ATOMIC_RELEASE);
+        if (request) {
+            request->inFlight.store(false, std::memory_order_relaxed);
+        }
+        return false;
+    }
+
+    void CompletionLoop() {
+        bool stopSeen = false;
+        for (;;) {
+            const long waited = ::syscall(__NR_io_uring_enter, m_ringFd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (waited < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                break;
+            }
+
+            unsigned head = *m_cqHead;
+            const unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head) {
+                const io_uring_cqe& cqe = m_cqes[head & m_cqMask];
+                auto* request = reinterpret_cast<Request*>(cqe.user_data);
+                if (!request) {
+                    stopSeen = stopSeen || m_stopping.load();
+                    continue;
+                }
+                Complete(request, cqe.res);
+            }
+            __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+            // Reads submitted before the stop NOP may complete after it
+            if (stopSeen && InFlight() == 0) {
+                break;
+            }
+        }
+
+        // The ring is unusable (or stopping with nothing left): no request may be left unresolved
+        FailPending();
+        m_completionDone.store(true);
+    }
+
+    void Complete(Request* request, int result) {
+        // Pairs with the release in SubmitEntry: the request's fields are the submitter's
+        if (!request->inFlight.exchange(false, std::memory_order_acq_rel)) {
+            return;
+        }
+
+        // Short reads before end of file (e.g. signals on network mounts) are finished synchronously
+        int64_t total = result;
+        if (result > 0 && request->file && static_cast<size_t>(result) < request->iov.iov_len) {
+            uint8_t* rest = static_cast<uint8_t*>(request->iov.iov_base) + result;
+            const int64_t more = request->file->ReadAt(request->offset + result, rest, request->iov.iov_len - result);
+            total = more < 0 ? -1 : result + more;
+        } else if (result < 0) {
+            total = -1;
+        }
+        Completion completion = std::move(request->done);
+        ReleaseRequest(request);
+        completion(total);
+    }
+
+    // Helper: Requests the kernel still owes a completion for
+    size_t InFlight() const {
+        size_t count = 0;
+        for (size_t i = 0; i < m_requestCount; ++i) {
+            count += m_requests[i].inFlight.load(std::memory_order_acquire) ? 1 : 0;
+        }
+        return count;
+    }
+
+    // Helper: Stops further submissions (they run inline) and fails every request still in flight
+    void FailPending() {
+        {
+            std::lock_guard<std::mutex> lock(m_submitMutex);
+            m_failed = true;
+        }
+        for (size_t i = 0; i < m_requestCount; ++i) {
+            Request& request = m_requests[i];
+            if (request.inFlight.exchange(false, std::memory_order_acq_rel)) {
+                Completion completion = std::move(request.done);
+                ReleaseRequest(&request);
+                completion(-1);
+            }
+        }
+    }
+
+    int m_ringFd = -1;
+    void* m_sqRing = nullptr;
+    void* m_cqRing = nullptr;
+    size_t m_sqRingSize = 0;
+    size_t m_cqRingSize = 0;
+    io_uring_sqe* m_sqes = nullptr;
+    size_t m_sqesSize = 0;
+
+    unsigned* m_sqHead = nullptr;
+    unsigned* m_sqTail = nullptr;
+    unsigned* m_sqArray = nullptr;
+    unsigned m_sqMask = 0;
+    unsigned m_sqEntries = 0;
+
+    unsigned* m_cqHead = nullptr;
+    unsigned* m_cqTail = nullptr;
+    unsigned m_cqMask = 0;
+    io_uring_cqe* m_cqes = nullptr;
+
+    // Preallocated requests; the free list is guarded by m_requestMutex
+    std::unique_ptr<Request[]> m_requests;
+    size_t m_requestCount = 0;
+    std::vector<Request*> m_freeRequests;
+    std::mutex m_requestMutex;
+
+    std::mutex m_submitMutex;
+    bool m_failed = false;  // Guarded by m_submitMutex; set once the completion thread has exited
+    std::thread m_completionThread;
+    std::atomic<bool> m_stopping{ false };
+    std::atomic<bool> m_completionDone{ false };
+};
+
+#endif
+
+} // namespace
+
+std::shared_ptr<IoBackend> IoBackend::Create(IoBackendKind kind, size_t threads) {
+#ifdef KNOUX_HAVE_IO_URING
+    if (kind != IoBackendKind::ThreadPool) {
+        auto ring = std::make_shared<IoUringBackend>();
+        if (ring->Initialize(kRingEntries)) {
+            return ring;
+        }
+    }
+#endif
+    return std::make_shared<ThreadPoolBackend>(threads == 0 ? kDefaultThreads : threads);
+}
+
+std::shared_ptr<IoBackend> IoBackend::GetDefault() {
+    static const std::shared_ptr<IoBackend> instance = Create(IoBackendKind::Auto);
+    return instance;
+}
+
+} // namespace knoux::core::system
@@ -0,0 +1,128 @@
+﻿#pragma once
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+namespace knoux::core::system {
+
+/**
+ * @class RandomAccessFile
+ * @brief Read-only file handle for positional reads (pread / overlapped ReadFile).
+ *
+ * Positional reads do not share a file cursor, so any number of threads
+ * may call ReadAt() on the same handle concurrently. Move-only.
+ */
+class RandomAccessFile {
+public:
+    RandomAccessFile() = default;
+    ~RandomAccessFile();
+
+    RandomAccessFile(const RandomAccessFile&) = delete;
+    RandomAccessFile& operator=(const RandomAccessFile&) = delete;
+    RandomAccessFile(RandomAccessFile&& other) noexcept;
+    RandomAccessFile& operator=(RandomAccessFile&& other) noexcept;
+
+    /**
+     * @brief Opens a file for reading
+     * @param path Absolute path of the file
+     * @return true if the file was opened
+     */
+    bool Open(const std::string& path);
+
+    /**
+     * @brief Closes the handle
+     */
+    void Close();
+
+    bool IsOpen() const;
+    uint64_t Size() const { return m_size; }
+
+    /**
+     * @brief Blocking positional read
+     * @return Bytes read (short only at end of file), or -1 on error
+     */
+    int64_t ReadAt(uint64_t offset, void* buffer, size_t length) const;
+
+#ifndef _WIN32
+    /**
+     * @brief Returns the POSIX descriptor (used by the io_uring backend)
+     */
+    int Descriptor() const { return m_fd; }
+#endif
+
+private:
+    uint64_t m_size = 0;
+
+#ifdef _WIN32
+    void* m_handle = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
+
+/**
+ * @enum IoBackendKind
+ * @brief Asynchronous read implementations
+ */
+enum class IoBackendKind {
+    Auto,        // io_uring when the kernel allows it, otherwise ThreadPool
+    ThreadPool,  // Blocking positional reads on a dedicated I/O thread pool
+    IoUring      // Linux io_uring submission/completion rings
+};
+
+/**
+ * @class IoBackend
+ * @brief Pluggable asynchronous positional read engine.
+ *
+ * Reads complete on a backend-owned thread; completions must be short and
+ * must not block on other reads. The caller keeps the file and buffer
+ * alive until its completion has run.
+ *
+ * I/O runs on its own threads rather than the engine's TaskScheduler so a
+ * slow mount never occupies the workers that parse and decode.
+ */
+class IoBackend {
+public:
+    // Receives bytes read, or -1 on error
+    using Completion = std::function<void(int64_t result)>;
+
+    virtual ~IoBackend() = default;
+
+    /**
+     * @brief Queues a read
+     * @param file Open file; must outlive the completion
+     * @param offset File offset
+     * @param buffer Destination; must outlive the completion
+     * @param length Bytes to read
+     * @param done Completion callback
+     */
+    virtual void Submit(const RandomAccessFile& file, uint64_t offset, void* buffer, size_t length, Completion done) = 0;
+
+    /**
+     * @brief Returns the backend name for diagnostics
+     */
+    virtual const char* Name() const = 0;
+
+    /**
+     * @brief Creates a backend
+     * @param kind Requested implementation; IoUring falls back to ThreadPool when unavailable
+     * @param threads Worker count for the thread pool (0 selects a default)
+     */
+    static std::shared_ptr<IoBackend> Create(IoBackendKind kind = IoBackendKind::Auto, size_t threads = 0);
+
+    /**
+     * @brief Returns the process-wide backend (created with Auto on first use)
+     */
+    static std::shared_ptr<IoBackend> GetDefault();
+
+    // Thread pool size when none is given: enough to keep a NAS or RAID busy
+    static constexpr size_t kDefaultThreads = 4;
+
+    // io_uring queue depth
+    static constexpr unsigned kRingEntries = 64;
+};
+
+} // namespace knoux::core::system
@@ -6,109 +6,315 @@
 #include <ctime>
 #include <algorithm>
 #include <filesystem>
+#include <ctime>
+#include <cstdio>
 
 namespace knoux::core::system {
 
 // Static instance pointer
 static std::shared_ptr<Logger> g_loggerInstance = nullptr;
 
+namespace {
+
+// Interned module names; entries below count are immutable once published
+struct ModuleTable {
+    std::mutex mutex;
+    std::atomic<size_t> count{ 1 };
+    char names[Logger::kMaxModules][LogRecord::kModuleBytes] = {};
+    uint8_t lengths[Logger::kMaxModules] = {};
+};
+
+// Helper: Function-local so modules registered during static initialisation find it built
+ModuleTable& Modules() {
+    static ModuleTable table;
+    return table;
+}
+
+int64_t UnixMillisecondsNow() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
 std::shared_ptr<Logger> Logger::GetInstance() {
     if (!g_loggerInstance) {
-        g_loggerInstance = std::make_shared<Logger>();
+        g_loggerInstance = std::shared_ptr<Logger>(new Logger());
     }
     return g_loggerInstance;
 }
 
-Logger::Logger()
-    : m_logLevel(LogLevel::INFO)
+LogQueue::LogQueue(size_t capacity)
+    : m_mask([capacity] {
+          size_t rounded = 2;
+          while (rounded < capacity) {
+              rounded <<= 1;
+          }
+          return rounded - 1;
+      }())
 {
+    m_cells.reset(new Cell[m_mask + 1]);
+    for (size_t i = 0; i <= m_mask; ++i) {
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+const LogRecord* LogQueue::Front() const {
+    const size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+    const Cell& cell = m_cells[pos & m_mask];
+    return cell.sequence.load(std::memory_order_acquire) == pos + 1 ? &cell.record : nullptr;
+}
+
+void LogQueue::Pop() {
+    const size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+    m_cells[pos & m_mask].sequence.store(pos + m_mask + 1, std::memory_order_release);
+    m_dequeuePos.store(pos + 1, std::memory_order_relaxed);
+}
+
+size_t LogQueue::Size() const {
+    const size_t enqueued = m_enqueuePos.load(std::memory_order_relaxed);
+    const size_t dequeued = m_dequeuePos.load(std::memory_order_relaxed);
+    return enqueued > dequeued ? enqueued - dequeued : 0;
+}
+
+Logger::Logger() = default;
+
+Logger::~Logger() {
+    DisableAsync();
 }
 
 bool Logger::Initialize(const std::string& logDir) {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
 
-    m_logDir = std::filesystem::path(logDir);
-    
-    if (!EnsureLogDirectory()) {
-        return false;
-    }
+        m_logDir = std::filesystem::path(logDir);
 
-    // Create initial log file with timestamp
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d_%H-%M-%S");
-    
-    m_currentLogFile = m_logDir / ("knoux_player_x_" + ss.str() + ".log");
+        if (!EnsureLogDirectory()) {
+            return false;
+        }
 
-    m_fileStream.open(m_currentLogFile, std::ios::out | std::ios::app);
-    if (!m_fileStream.is_open()) {
-        return false;
+        // Create initial log file with timestamp
+        auto now = std::chrono::system_clock::now();
+        auto time_t = std::chrono::system_clock::to_time_t(now);
+        std::stringstream ss;
+        ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d_%H-%M-%S");
+
+        m_currentLogFile = m_logDir / ("knoux_player_x_" + ss.str() + ".log");
+
+        m_fileStream.open(m_currentLogFile, std::ios::out | std::ios::app);
+        if (!m_fileStream.is_open()) {
+            return false;
+        }
     }
 
+    // Outside the lock: the synchronous path takes it again
     Info("Logger", "Logging system initialized successfully");
     return true;
 }
 
+LogModule Logger::RegisterModule(std::string_view name) {
+    name = name.substr(0, LogRecord::kModuleBytes);
+
+    ModuleTable& table = Modules();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    const size_t count = table.count.load(std::memory_order_relaxed);
+    for (size_t id = 1; id < count; ++id) {
+        if (std::string_view(table.names[id], table.lengths[id]) == name) {
+            return static_cast<LogModule>(id);
+        }
+    }
+    if (count == kMaxModules) {
+        return 0;
+    }
+
+    std::memcpy(table.names[count], name.data(), name.size());
+    table.lengths[count] = static_cast<uint8_t>(name.size());
+    table.count.store(count + 1, std::memory_order_release);
+    return static_cast<LogModule>(count);
+}
+
+std::string_view Logger::ModuleName(LogModule module) {
+    const ModuleTable& table = Modules();
+    if (module == 0 || module >= table.count.load(std::memory_order_acquire)) {
+        return std::string_view();
+    }
+    return std::string_view(table.names[module], table.lengths[module]);
+}
+
+void Logger::Log(LogLevel level, LogModule module, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+
+    if (m_async.load(std::memory_order_acquire)) {
+        const int64_t unixMs = UnixMillisecondsNow();
+        bool truncated = false;
+        const auto fill = [&](LogRecord& record) {
+            // Formats straight into the claimed cell; TryPush runs fill exactly once
+            const int length = std::vsnprintf(record.message, LogRecord::kMessageBytes, format, args);
+            record.unixMs = unixMs;
+            record.level = level;
+            record.moduleId = module;
+            record.moduleLength = 0;
+            record.messageLength = static_cast<uint16_t>(std::clamp(length, 0, static_cast<int>(LogRecord::kMessageBytes) - 1));
+            truncated = length >= static_cast<int>(LogRecord::kMessageBytes);
+        };
+        if (PushRecord(level, fill) && truncated) {
+            m_truncated.fetch_add(1, std::memory_order_relaxed);
+        }
+    } else {
+        char message[LogRecord::kMessageBytes];
+        const int length = std::vsnprintf(message, sizeof(message), format, args);
+        const size_t size = static_cast<size_t>(std::clamp(length, 0, static_cast<int>(sizeof(message)) - 1));
+        const int64_t unixMs = UnixMillisecondsNow();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        AppendLogEntry(unixMs, level, ModuleName(module), std::string_view(message, size));
+        WriteBatches();
+    }
+
+    va_end(args);
+}
+
 void Logger::SetLogLevel(LogLevel level) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    m_logLevel = level;
+    g_logLevel.store(level, std::memory_order_relaxed);
 }
 
 void Logger::Trace(const std::string& module, const std::string& message) {
-    if (m_logLevel <= LogLevel::TRACE) {
+    if (IsEnabled(LogLevel::TRACE)) {
         WriteLogEntry(LogLevel::TRACE, module, message);
     }
 }
 
 void Logger::Debug(const std::string& module, const std::string& message) {
-    if (m_logLevel <= LogLevel::DEBUG) {
+    if (IsEnabled(LogLevel::DEBUG)) {
         WriteLogEntry(LogLevel::DEBUG, module, message);
     }
 }
 
 void Logger::Info(const std::string& module, const std::string& message) {
-    if (m_logLevel <= LogLevel::INFO) {
+    if (IsEnabled(LogLevel::INFO)) {
         WriteLogEntry(LogLevel::INFO, module, message);
     }
 }
 
 void Logger::Warn(const std::string& module, const std::string& message) {
-    if (m_logLevel <= LogLevel::WARN) {
+    if (IsEnabled(LogLevel::WARN)) {
         WriteLogEntry(LogLevel::WARN, module, message);
     }
 }
 
 void Logger::Error(const std::string& module, const std::string& message) {
-    if (m_logLevel <= LogLevel::ERROR) {
+    if (IsEnabled(LogLevel::ERROR)) {
         WriteLogEntry(LogLevel::ERROR, module, message);
     }
 }
 
 void Logger::Fatal(const std::string& module, const std::string& message) {
-    if (m_logLevel <= LogLevel::FATAL) {
+    if (IsEnabled(LogLevel::FATAL)) {
         WriteLogEntry(LogLevel::FATAL, module, message);
     }
 }
 
 void Logger::Flush() {
+    if (m_async.load(std::memory_order_acquire)) {
+        const uint64_t target = m_queued.load();
+        WakeWriter();
+        std::unique_lock<std::mutex> lock(m_writerMutex);
+        m_flushCondition.wait(lock, [this, target] {
+            return m_written.load() >= target || !m_writerActive.load();
+        });
+    }
+
     std::lock_guard<std::mutex> lock(m_mutex);
     if (m_fileStream.is_open()) {
         m_fileStream.flush();
     }
+    std::cout.flush();
 }
 
-std::string Logger::GetTimestamp() const {
-    auto now = std::chrono::system_clock::now();
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % 1000;
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
-    ss << '.' << std::setfill('0') << std::setw(3) << ms.count();
-    return ss.str();
+bool Logger::EnableAsync(size_t queueRecords, LogOverflow overflow) {
+    std::lock_guard<std::mutex> lock(m_writerMutex);
+    if (m_writerActive.load()) {
+        return true;
+    }
+
+    // The queue outlives DisableAsync() so a racing log call never sees it freed
+    if (!m_queue) {
+        m_queue = std::make_unique<LogQueue>(std::max<size_t>(queueRecords, 2));
+    }
+    m_overflow = overflow;
+    m_writerActive.store(true);
+    try {
+        m_writerThread = std::make_unique<std::thread>(&Logger::WriterLoop, this);
+    } catch (...) {
+        m_writerActive.store(false);
+        return false;
+    }
+    m_async.store(true, std::memory_order_release);
+    return true;
 }
 
-std::string Logger::LevelToString(LogLevel level) const {
+void Logger::DisableAsync() {
+    {
+        std::lock_guard<std::mutex> lock(m_writerMutex);
+        if (!m_writerActive.load()) {
+            return;
+        }
+        m_async.store(false);
+    }
+
+    // A call that saw m_async set is pushing now; later ones see it clear and write directly.
+    // The writer keeps draining meanwhile, so a blocked push gets its slot
+    while (m_pushing.load() != 0) {
+        std::this_thread::yield();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_writerMutex);
+        m_writerActive.store(false);
+    }
+    m_writerCondition.notify_all();
+    if (m_writerThread && m_writerThread->joinable()) {
+        m_writerThread->join();
+    }
+    m_writerThread.reset();
+
+    // Records queued after the writer's last pass
+    DrainQueue();
+    m_flushCondition.notify_all();
+}
+
+Logger::Stats Logger::GetStats() const {
+    Stats stats;
+    stats.queued = m_queued.load();
+    stats.written = m_written.load();
+    stats.dropped = m_dropped.load();
+    stats.blocked = m_blocked.load();
+    stats.truncated = m_truncated.load();
+    stats.batches = m_batches.load();
+    return stats;
+}
+
+void Logger::AppendTimestamp(std::string& out, int64_t unixMs) {
+    const int64_t second = unixMs / 1000;
+    if (second != m_stampSecond) {
+        const std::time_t time = static_cast<std::time_t>(second);
+        std::tm local{};
+#ifdef _WIN32
+        localtime_s(&local, &time);
+#else
+        localtime_r(&time, &local);
+#endif
+        std::strftime(m_stamp, sizeof(m_stamp), "%Y-%m-%d %H:%M:%S", &local);
+        m_stampSecond = second;
+    }
+
+    const int millis = static_cast<int>(unixMs % 1000);
+    const char fraction[4] = { '.', static_cast<char>('0' + millis / 100), static_cast<char>('0' + millis / 10 % 10),
+                               static_cast<char>('0' + millis % 10) };
+    out.append(m_stamp, 19);
+    out.append(fraction, 4);
+}
+
+const char* Logger::LevelToString(LogLevel level) {
     switch (level) {
         case LogLevel::TRACE: return "TRACE";
         case LogLevel::DEBUG: return "DEBUG";
@@ -120,7 +326,7 @@ std::string Logger::LevelToString(LogLevel level) const {
     }
 }
 
-std::string Logger::GetColorCode(LogLevel level) const {
+const char* Logger::GetColorCode(LogLevel level) const {
     switch (level) {
         case LogLevel::TRACE: return "\033[90m";  // Dark gray
         case LogLevel::DEBUG: return "\033[36m";  // Cyan
@@ -132,33 +338,183 @@ std::string Logger::GetColorCode(LogLevel level) const {
     }
 }
 
+void Logger::AppendLogEntry(int64_t unixMs, LogLevel level, std::string_view module, std::string_view message) {
+    const size_t start = m_fileBatch.size();
+    m_fileBatch += '[';
+    AppendTimestamp(m_fileBatch, unixMs);
+    m_fileBatch += "] [";
+    m_fileBatch += LevelToString(level);
+    m_fileBatch += "] [";
+    m_fileBatch += module;
+    m_fileBatch += "] ";
+    m_fileBatch += message;
+
+    // Console line: the same text wrapped in the level's color
+    m_consoleBatch += GetColorCode(level);
+    m_consoleBatch.append(m_fileBatch, start, std::string::npos);
+    m_consoleBatch += "\033[0m\n";
+    m_fileBatch += '\n';
+}
+
+void Logger::WriteBatches() {
+    if (m_fileStream.is_open() && !m_fileBatch.empty()) {
+        m_fileStream.write(m_fileBatch.data(), static_cast<std::streamsize>(m_fileBatch.size()));
+        m_fileStream.flush();
+
+        // Check if rotation needed
+        if (m_fileStream.tellp() > static_cast<std::streampos>(MAX_LOG_SIZE)) {
+            RotateLogFile();
+        }
+    }
+    if (!m_consoleBatch.empty()) {
+        std::cout.write(m_consoleBatch.data(), static_cast<std::streamsize>(m_consoleBatch.size()));
+        std::cout.flush();
+    }
+    m_fileBatch.clear();
+    m_consoleBatch.clear();
+}
+
 void Logger::WriteLogEntry(LogLevel level, const std::string& module, const std::string& message) {
+    if (m_async.load(std::memory_order_acquire)) {
+        EnqueueLogEntry(level, module, message);
+        return;
+    }
+
+    const int64_t unixMs = UnixMillisecondsNow();
     std::lock_guard<std::mutex> lock(m_mutex);
+    AppendLogEntry(unixMs, level, module, message);
+    WriteBatches();
+}
 
-    std::string timestamp = GetTimestamp();
-    std::string levelStr = LevelToString(level);
-    std::string colorCode = GetColorCode(level);
-    std::string resetCode = "\033[0m";
+template <typename Fill>
+bool Logger::PushRecord(LogLevel level, const Fill& fill) {
+    // Counted before m_async is checked (both sequentially consistent), so DisableAsync()
+    // either waits for this call or this call sees asynchronous mode switched off
+    m_pushing.fetch_add(1);
+    struct Pushing {
+        std::atomic<int>& count;
+        ~Pushing() { count.fetch_sub(1); }
+    } pushing{ m_pushing };
+
+    bool waited = false;
+    for (;;) {
+        // Checked on every retry: a full queue must not outlive the writer that empties it
+        if (!m_async.load() || !m_writerActive.load()) {
+            WriteRecord(fill);
+            return true;
+        }
+        if (m_queue->TryPush(fill)) {
+            break;
+        }
+        if (m_overflow == LogOverflow::Drop) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (!waited) {
+            waited = true;
+            m_blocked.fetch_add(1, std::memory_order_relaxed);
+        }
+        WakeWriter();
+        std::this_thread::yield();
+    }
+    m_queued.fetch_add(1, std::memory_order_relaxed);
 
-    // Format log entry
-    std::stringstream fileEntry;
-    fileEntry << "[" << timestamp << "] [" << levelStr << "] [" << module << "] " << message << std::endl;
+    // Otherwise the writer's poll picks the record up; no wake-up cost on the hot path
+    if (level >= LogLevel::ERROR || m_queue->Size() >= m_queue->Capacity() / 2) {
+        WakeWriter();
+    }
+    if (level == LogLevel::FATAL) {
+        Flush();
+    }
+    return true;
+}
 
-    std::stringstream consoleEntry;
-    consoleEntry << colorCode << "[" << timestamp << "] [" << levelStr << "] [" << module << "] " << message << resetCode << std::endl;
+template <typename Fill>
+void Logger::WriteRecord(const Fill& fill) {
+    LogRecord record;
+    fill(record);
+    DrainQueue();
 
-    // Write to file
-    if (m_fileStream.is_open()) {
-        m_fileStream << fileEntry.str();
-        
-        // Check if rotation needed
-        if (m_fileStream.tellp() > static_cast<std::streampos>(MAX_LOG_SIZE)) {
-            RotateLogFile();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    AppendLogRecord(record);
+    WriteBatches();
+}
+
+void Logger::EnqueueLogEntry(LogLevel level, const std::string& module, const std::string& message) {
+    const int64_t unixMs = UnixMillisecondsNow();
+
+    bool truncated = false;
+    const auto fill = [&](LogRecord& record) {
+        record.unixMs = unixMs;
+        record.level = level;
+        record.moduleId = 0;
+        record.moduleLength = static_cast<uint16_t>(std::min(module.size(), LogRecord::kModuleBytes));
+        record.messageLength = static_cast<uint16_t>(std::min(message.size(), LogRecord::kMessageBytes));
+        std::memcpy(record.module, module.data(), record.moduleLength);
+        std::memcpy(record.message, message.data(), record.messageLength);
+        truncated = record.moduleLength < module.size() || record.messageLength < message.size();
+    };
+    if (PushRecord(level, fill) && truncated) {
+        m_truncated.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Logger::WakeWriter() {
+    m_wakeRequested.store(true);
+    m_writerCondition.notify_one();
+}
+
+size_t Logger::DrainQueue() {
+    if (!m_queue) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t written = 0;
+    while (const LogRecord* record = m_queue->Front()) {
+        AppendLogRecord(*record);
+        m_queue->Pop();
+        ++written;
+        if (m_fileBatch.size() >= kBatchBytes) {
+            WriteBatches();
         }
     }
+    if (written > 0) {
+        WriteBatches();
+        m_batches.fetch_add(1, std::memory_order_relaxed);
+        m_written.fetch_add(written);
+    }
+    return written;
+}
 
-    // Write to console
-    std::cout << consoleEntry.str();
+void Logger::AppendLogRecord(const LogRecord& record) {
+    const std::string_view module = record.moduleId != 0 ? ModuleName(record.moduleId)
+                                                         : std::string_view(record.module, record.moduleLength);
+    AppendLogEntry(record.unixMs, record.level, module, std::string_view(record.message, record.messageLength));
+}
+
+void Logger::WriterLoop() {
+    {
+        // Synchronous writes may still be using the batches
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_fileBatch.reserve(kBatchBytes * 2);
+        m_consoleBatch.reserve(kBatchBytes * 2);
+    }
+
+    while (m_writerActive.load()) {
+        {
+            std::unique_lock<std::mutex> lock(m_writerMutex);
+            m_writerCondition.wait_for(lock, std::chrono::milliseconds(kWriterPollMs), [this] {
+                return !m_writerActive.load() || m_wakeRequested.exchange(false);
+            });
+        }
+        if (DrainQueue() > 0) {
+            // Taking the lock orders the wake-up after a Flush() waiter's check
+            { std::lock_guard<std::mutex> lock(m_writerMutex); }
+            m_flushCondition.notify_all();
+        }
+    }
+    DrainQueue();
 }
 
 void Logger::RotateLogFile() {
@@ -1,14 +1,22 @@
 ﻿#pragma once
 
 #include <string>
+#include <string_view>
 #include <memory>
 #include <fstream>
 #include <sstream>
 #include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
 #include <chrono>
 #include <iomanip>
 #include <iostream>
 #include <filesystem>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 
 namespace knoux::core::system {
 
@@ -25,6 +33,130 @@ enum class LogLevel {
     FATAL = 5
 };
 
+// Lowest level compiled in; log macros below it expand to nothing. Release
+// builds (NDEBUG) drop TRACE and DEBUG unless the build defines it
+#ifndef KNOUX_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define KNOUX_LOG_MIN_LEVEL 2
+#else
+#define KNOUX_LOG_MIN_LEVEL 0
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define KNOUX_PRINTF_FORMAT(formatIndex, firstArgIndex) __attribute__((format(printf, formatIndex, firstArgIndex)))
+#else
+#define KNOUX_PRINTF_FORMAT(formatIndex, firstArgIndex)
+#endif
+
+// Runtime threshold read by every log site (relaxed); set through Logger::SetLogLevel()
+inline std::atomic<LogLevel> g_logLevel{ LogLevel::INFO };
+
+/**
+ * @brief Interned module name (see Logger::RegisterModule); 0 means none
+ */
+using LogModule = uint16_t;
+
+/**
+ * @enum LogOverflow
+ * @brief What an asynchronous log call does when the record queue is full
+ */
+enum class LogOverflow {
+    Drop,   // Discard the record and count it (never waits)
+    Block   // Wait for the writer to free a record
+};
+
+/**
+ * @struct LogRecord
+ * @brief One preallocated queue entry; longer modules/messages are truncated
+ */
+struct LogRecord {
+    static constexpr size_t kModuleBytes = 32;
+    static constexpr size_t kMessageBytes = 464;
+
+    int64_t unixMs = 0;
+    LogLevel level = LogLevel::INFO;
+    LogModule moduleId = 0;         // Interned name; module[] is used when 0
+    uint16_t moduleLength = 0;
+    uint16_t messageLength = 0;
+    char module[kModuleBytes];
+    char message[kMessageBytes];
+};
+
+/**
+ * @class LogQueue
+ * @brief Bounded lock-free multi-producer/single-consumer queue of LogRecords.
+ *
+ * Every cell carries a sequence number (Vyukov's bounded queue): a producer
+ * claims a cell with one compare-and-swap on the enqueue position, fills the
+ * record in place and publishes it by bumping the cell's sequence; the
+ * consumer reads published cells in order. No allocation after construction
+ * and no lock on either side.
+ */
+class LogQueue {
+public:
+    /**
+     * @param capacity Minimum record count (rounded up to a power of two)
+     */
+    explicit LogQueue(size_t capacity);
+
+    LogQueue(const LogQueue&) = delete;
+    LogQueue& operator=(const LogQueue&) = delete;
+
+    /**
+     * @brief Producer: claims a record, lets fill write it and publishes it
+     * @return false if the queue is full (fill is not called)
+     */
+    template <typename Fill>
+    bool TryPush(Fill&& fill) {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = m_cells[pos & m_mask];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    fill(cell.record);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Consumer: next published record, or nullptr if none is ready
+     */
+    const LogRecord* Front() const;
+
+    /**
+     * @brief Consumer: releases the record returned by Front()
+     */
+    void Pop();
+
+    /**
+     * @brief Records queued (approximate while producers are active)
+     */
+    size_t Size() const;
+
+    size_t Capacity() const { return m_mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence{ 0 };
+        LogRecord record;
+    };
+
+    std::unique_ptr<Cell[]> m_cells;
+    const size_t m_mask;
+    alignas(64) std::atomic<size_t> m_enqueuePos{ 0 };
+    alignas(64) std::atomic<size_t> m_dequeuePos{ 0 };
+};
+
 /**
  * @class Logger
  * @brief Thread-safe logging system with file and console output
@@ -40,9 +172,33 @@ enum class LogLevel {
  * - File/console dual output
  * - ANSI color support for terminals
  * - Log file rotation based on size
+ * - Optional asynchronous mode (EnableAsync): callers only copy the record
+ *   into a lock-free queue and a background writer formats and writes in
+ *   batches, so logging from the decode or audio path never waits on I/O
  */
 class Logger {
 public:
+    /**
+     * @struct Stats
+     * @brief Asynchronous mode counters since the logger was created
+     */
+    struct Stats {
+        uint64_t queued = 0;      // Records handed to the writer
+        uint64_t written = 0;     // Records the writer has output
+        uint64_t dropped = 0;     // Records discarded by LogOverflow::Drop
+        uint64_t blocked = 0;     // Calls that waited under LogOverflow::Block
+        uint64_t truncated = 0;   // Records whose module or message was cut to fit
+        uint64_t batches = 0;     // Writer passes that output at least one record
+    };
+
+    // Records preallocated by EnableAsync() unless asked otherwise (~1 MB)
+    static constexpr size_t kDefaultQueueRecords = 2048;
+
+    // Distinct module names RegisterModule() interns (ID 0 is reserved)
+    static constexpr size_t kMaxModules = 256;
+
+    ~Logger();
+
     /**
      * @brief Gets singleton instance of logger
      * @return Shared pointer to Logger instance
@@ -59,9 +215,42 @@ public:
     /**
      * @brief Sets minimum log level to output
      * @param level Minimum level to log
+     *
+     * Levels below KNOUX_LOG_MIN_LEVEL stay compiled out of the macros.
      */
     void SetLogLevel(LogLevel level);
 
+    /**
+     * @brief Returns true if a level passes the runtime threshold; one relaxed load
+     */
+    static bool IsEnabled(LogLevel level) { return level >= g_logLevel.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Interns a module name for the LOGF_* macros
+     * @param name Module name, truncated to LogRecord::kModuleBytes
+     * @return Module ID, the same for the same name; 0 once kMaxModules names exist
+     *
+     * Meant for namespace-scope constants (KNOUX_LOG_MODULE), so log sites
+     * pass a 16-bit ID and the writer looks the name up.
+     */
+    static LogModule RegisterModule(std::string_view name);
+
+    /**
+     * @brief Returns the name of an interned module; empty for 0 or an unknown ID
+     */
+    static std::string_view ModuleName(LogModule module);
+
+    /**
+     * @brief Logs a printf-style message; what the LOGF_* macros call
+     * @param level Severity (not re-checked against the threshold)
+     * @param module Interned module ID
+     * @param format printf format, checked by the compiler on GCC/Clang
+     *
+     * Formats straight into the queue record in asynchronous mode, or into
+     * a stack buffer otherwise; messages are truncated to LogRecord::kMessageBytes - 1.
+     */
+    void Log(LogLevel level, LogModule module, const char* format, ...) KNOUX_PRINTF_FORMAT(4, 5);
+
     /**
      * @brief Logs a message at TRACE level
      * @param module Module/component name
@@ -106,16 +295,44 @@ public:
 
     /**
      * @brief Forces flush of all pending log entries
+     *
+     * In asynchronous mode, waits until the writer has output every record
+     * queued before the call.
      */
     void Flush();
 
+    /**
+     * @brief Switches to asynchronous logging
+     * @param queueRecords Queue capacity, allocated once on the first call
+     * @param overflow What a log call does when the queue is full
+     * @return false if a writer thread could not be started
+     *
+     * A log call then costs a clock read and a copy into a preallocated
+     * record (tens of nanoseconds); the writer wakes every kWriterPollMs, or
+     * sooner for ERROR/FATAL records and a half-full queue. FATAL records
+     * are flushed before the call returns.
+     */
+    bool EnableAsync(size_t queueRecords = kDefaultQueueRecords, LogOverflow overflow = LogOverflow::Drop);
+
+    /**
+     * @brief Writes out the queue and returns to synchronous logging
+     */
+    void DisableAsync();
+
+    /**
+     * @brief Returns asynchronous mode counters
+     */
+    Stats GetStats() const;
+
+    /**
+     * @brief Level name as written in log lines, padded to five characters
+     */
+    static const char* LevelToString(LogLevel level);
+
 private:
     // Private constructor for singleton pattern
     Logger();
 
-    // Current log level threshold
-    LogLevel m_logLevel;
-
     // Output file stream
     std::ofstream m_fileStream;
 
@@ -131,18 +348,80 @@ private:
     // Maximum log file size before rotation (10 MB)
     static constexpr size_t MAX_LOG_SIZE = 10 * 1024 * 1024;
 
-    // Helper: Formats current timestamp
-    std::string GetTimestamp() const;
+    // Asynchronous mode: record queue, writer thread and its wake-up
+    std::unique_ptr<LogQueue> m_queue;
+    std::atomic<bool> m_async{ false };
+    LogOverflow m_overflow = LogOverflow::Drop;
+    std::unique_ptr<std::thread> m_writerThread;
+    std::atomic<bool> m_writerActive{ false };
+    std::mutex m_writerMutex;
+    std::condition_variable m_writerCondition;
+    std::condition_variable m_flushCondition;
+    std::atomic<bool> m_wakeRequested{ false };
+    // Calls inside PushRecord(); DisableAsync() lets them finish before stopping the writer
+    std::atomic<int> m_pushing{ 0 };
+
+    // Writer's output batches, reused across passes (guarded by m_mutex)
+    std::string m_fileBatch;
+    std::string m_consoleBatch;
+
+    // Local time of m_stampSecond as "YYYY-MM-DD HH:MM:SS", reformatted once per second (guarded by m_mutex)
+    int64_t m_stampSecond = -1;
+    char m_stamp[20] = {};
+
+    // Asynchronous mode counters
+    std::atomic<uint64_t> m_queued{ 0 };
+    std::atomic<uint64_t> m_written{ 0 };
+    std::atomic<uint64_t> m_dropped{ 0 };
+    std::atomic<uint64_t> m_blocked{ 0 };
+    std::atomic<uint64_t> m_truncated{ 0 };
+    std::atomic<uint64_t> m_batches{ 0 };
 
-    // Helper: Converts log level to string
-    std::string LevelToString(LogLevel level) const;
+    // Longest the writer sleeps while records may be waiting
+    static constexpr int kWriterPollMs = 20;
+
+    // Batch size that is written out before the writer continues draining
+    static constexpr size_t kBatchBytes = 64 * 1024;
+
+    // Helper: Appends "YYYY-MM-DD HH:MM:SS.mmm"; caller holds m_mutex
+    void AppendTimestamp(std::string& out, int64_t unixMs);
 
     // Helper: Gets ANSI color code for log level
-    std::string GetColorCode(LogLevel level) const;
+    const char* GetColorCode(LogLevel level) const;
+
+    // Helper: Appends one formatted line to the file and console batches; caller holds m_mutex
+    void AppendLogEntry(int64_t unixMs, LogLevel level, std::string_view module, std::string_view message);
+
+    // Helper: AppendLogEntry() for a queue record; caller holds m_mutex
+    void AppendLogRecord(const LogRecord& record);
+
+    // Helper: Writes and clears the batches, rotating the file if needed; caller holds m_mutex
+    void WriteBatches();
 
     // Helper: Writes formatted log entry
     void WriteLogEntry(LogLevel level, const std::string& module, const std::string& message);
 
+    // Helper: Copies an entry into the queue (asynchronous mode)
+    void EnqueueLogEntry(LogLevel level, const std::string& module, const std::string& message);
+
+    // Helper: Claims a record, lets fill write it and applies the overflow policy; writes it
+    // directly once asynchronous mode is switched off. Returns false if the record was dropped
+    template <typename Fill>
+    bool PushRecord(LogLevel level, const Fill& fill);
+
+    // Helper: Writes a record synchronously, after what is still queued
+    template <typename Fill>
+    void WriteRecord(const Fill& fill);
+
+    // Helper: Wakes the writer before its next poll
+    void WakeWriter();
+
+    // Helper: Drains the queue into the batches and writes them; returns records written
+    size_t DrainQueue();
+
+    // Background writer loop
+    void WriterLoop();
+
     // Helper: Rotates log file when size limit reached
     void RotateLogFile();
 
@@ -150,12 +429,53 @@ private:
     bool EnsureLogDirectory() const;
 };
 
+// Runs call only if level is compiled in and enabled, so its arguments
+// (string concatenation, formatting inputs) cost nothing otherwise
+#define KNOUX_LOG_IF_ENABLED(level, call)                                        \
+    do {                                                                         \
+        if constexpr (static_cast<int>(level) >= KNOUX_LOG_MIN_LEVEL) {          \
+            if (knoux::core::system::Logger::IsEnabled(level)) {                 \
+                call;                                                            \
+            }                                                                    \
+        }                                                                        \
+    } while (0)
+
 // Convenience macros for easier logging
-#define LOG_TRACE(module, msg) knoux::core::system::Logger::GetInstance()->Trace(module, msg)
-#define LOG_DEBUG(module, msg) knoux::core::system::Logger::GetInstance()->Debug(module, msg)
-#define LOG_INFO(module, msg) knoux::core::system::Logger::GetInstance()->Info(module, msg)
-#define LOG_WARN(module, msg) knoux::core::system::Logger::GetInstance()->Warn(module, msg)
-#define LOG_ERROR(module, msg) knoux::core::system::Logger::GetInstance()->Error(module, msg)
-#define LOG_FATAL(module, msg) knoux::core::system::Logger::GetInstance()->Fatal(module, msg)
-
-} // namespace knoux::core::system
\ No newline at end of file
+#define LOG_TRACE(module, msg) KNOUX_LOG_IF_ENABLED(knoux::core::system::LogLevel::TRACE, \
+    knoux::core::system::Logger::GetInstance()->Trace(module, msg))
+#define LOG_DEBUG(module, msg) KNOUX_LOG_IF_ENABLED(knoux::core::system::LogLevel::DEBUG, \
+    knoux::core::system::Logger::GetInstance()->Debug(module, msg))
+#define LOG_INFO(module, msg) KNOUX_LOG_IF_ENABLED(knoux::core::system::LogLevel::INFO, \
+    knoux::core::system::Logger::GetInstance()->Info(module, msg))
+#define LOG_WARN(module, msg) KNOUX_LOG_IF_ENABLED(knoux::core::system::LogLevel::WARN, \
+    knoux::core::system::Logger::GetInstance()->Warn(module, msg))
+#define LOG_ERROR(module, msg) KNOUX_LOG_IF_ENABLED(knoux::core::system::LogLevel::ERROR, \
+    knoux::core::system::Logger::GetInstance()->Error(module, msg))
+#define LOG_FATAL(module, msg) KNOUX_LOG_IF_ENABLED(knoux::core::system::LogLevel::FATAL, \
+    knoux::core::system::Logger::GetInstance()->Fatal(module, msg))
+
+// Declares an interned module ID: KNOUX_LOG_MODULE(kDecoderLog, "Decoder");
+#define KNOUX_LOG_MODULE(id, name) \
+    static const knoux::core::system::LogModule id = knoux::core::system::Logger::RegisterModule(name)
+
+// printf-style logging with an interned module: LOGF_DEBUG(kDecoderLog, "pts %lld", pts);
+// While a BinaryLog is open the record goes there unformatted instead of to the text log
+#define KNOUX_LOGF(level, module, ...) KNOUX_LOG_IF_ENABLED(level, KNOUX_LOGF_EMIT(level, module, __VA_ARGS__))
+#define KNOUX_LOGF_EMIT(level, module, ...)                                                              \
+    if (knoux::core::system::BinaryLog::IsActive()) {                                                    \
+        static knoux::core::system::BinaryLogSite knouxLogSite_;                                         \
+        knoux::core::system::BinaryLog::GetInstance()->Write(knouxLogSite_, level, module, __VA_ARGS__);  \
+    } else {                                                                                             \
+        knoux::core::system::Logger::GetInstance()->Log(level, module, __VA_ARGS__);                     \
+    }
+#define LOGF_TRACE(module, ...) KNOUX_LOGF(knoux::core::system::LogLevel::TRACE, module, __VA_ARGS__)
+#define LOGF_DEBUG(module, ...) KNOUX_LOGF(knoux::core::system::LogLevel::DEBUG, module, __VA_ARGS__)
+#define LOGF_INFO(module, ...) KNOUX_LOGF(knoux::core::system::LogLevel::INFO, module, __VA_ARGS__)
+#define LOGF_WARN(module, ...) KNOUX_LOGF(knoux::core::system::LogLevel::WARN, module, __VA_ARGS__)
+#define LOGF_ERROR(module, ...) KNOUX_LOGF(knoux::core::system::LogLevel::ERROR, module, __VA_ARGS__)
+#define LOGF_FATAL(module, ...) KNOUX_LOGF(knoux::core::system::LogLevel::FATAL, module, __VA_ARGS__)
+
+} // namespace knoux::core::system
+
+// After Logger: LOGF_* expand to BinaryLog calls, and binary_log.h builds on this header
+#include "binary_log.h"
@@ -0,0 +1,103 @@
+﻿/**
+ * Cost of a log site: disabled sites (lazy LOG_*, LOGF_*, a level compiled
+ * out by KNOUX_LOG_MIN_LEVEL) against an eagerly built message, and an
+ * enabled LOGF_* in asynchronous mode and into the binary sink.
+ *
+ * Standalone; not part of the knoux_core build:
+ *   g++ -std=c++17 -O2 -I. core/system/logging_benchmark.cpp core/system/logging.cpp \
+ *       core/system/binary_log.cpp core/system/mapped_file.cpp -pthread -o logging_benchmark
+ *   ./logging_benchmark > /dev/null
+ *
+ * Results go to stderr; stdout carries the logger's console output.
+ */
+
+// Compile TRACE out of this file only, to time a stripped site
+#define KNOUX_LOG_MIN_LEVEL 1
+
+#include "logging.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+using namespace knoux::core::system;
+
+namespace {
+
+KNOUX_LOG_MODULE(kBenchLog, "Bench");
+
+constexpr int kIterations = 10'000'000;
+
+// Keeps the optimizer from folding the loop counter away
+volatile int g_sink = 0;
+
+template <typename Site>
+double NanosecondsPerCall(int iterations, Site site) {
+    for (int i = 0; i < iterations / 10; ++i) {
+        site(i);
+    }
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        site(i);
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+} // namespace
+
+int main() {
+    const auto logDir = std::filesystem::temp_directory_path() / "knoux_logging_benchmark";
+    auto logger = Logger::GetInstance();
+    logger->Initialize(logDir.string());
+    logger->SetLogLevel(LogLevel::INFO);
+
+    std::fprintf(stderr, "Disabled site (level INFO), ns per call\n");
+    std::fprintf(stderr, "  eager Debug(std::string)  %7.2f\n", NanosecondsPerCall(kIterations / 10, [&](int i) {
+        g_sink = i;
+        logger->Debug("Bench", "frame " + std::to_string(i) + " decoded");
+    }));
+    std::fprintf(stderr, "  LOG_DEBUG                 %7.2f\n", NanosecondsPerCall(kIterations, [](int i) {
+        g_sink = i;
+        LOG_DEBUG("Bench", "frame " + std::to_string(i) + " decoded");
+    }));
+    std::fprintf(stderr, "  LOGF_DEBUG                %7.2f\n", NanosecondsPerCall(kIterations, [](int i) {
+        g_sink = i;
+        LOGF_DEBUG(kBenchLog, "frame %d decoded", i);
+    }));
+    std::fprintf(stderr, "  LOGF_TRACE (compiled out) %7.2f\n", NanosecondsPerCall(kIterations, [](int i) {
+        g_sink = i;
+        LOGF_TRACE(kBenchLog, "frame %d decoded", i);
+    }));
+    std::fprintf(stderr, "  loop only                 %7.2f\n", NanosecondsPerCall(kIterations, [](int i) {
+        g_sink = i;
+    }));
+
+    logger->EnableAsync(Logger::kDefaultQueueRecords, LogOverflow::Block);
+    std::fprintf(stderr, "\nEnabled site, asynchronous, ns per call\n");
+    std::fprintf(stderr, "  LOG_INFO                  %7.2f\n", NanosecondsPerCall(100'000, [](int i) {
+        LOG_INFO("Bench", "frame " + std::to_string(i) + " decoded");
+    }));
+    std::fprintf(stderr, "  LOGF_INFO                 %7.2f\n", NanosecondsPerCall(100'000, [](int i) {
+        LOGF_INFO(kBenchLog, "frame %d decoded", i);
+    }));
+    logger->DisableAsync();
+
+    BinaryLog::Settings settings;
+    settings.directory = (logDir / "binary").string();
+    BinaryLog::GetInstance()->Open(settings);
+    std::fprintf(stderr, "\nEnabled site, binary sink, ns per call\n");
+    std::fprintf(stderr, "  LOGF_INFO                 %7.2f\n", NanosecondsPerCall(1'000'000, [](int i) {
+        LOGF_INFO(kBenchLog, "frame %d decoded", i);
+    }));
+    BinaryLog::GetInstance()->Close();
+
+    const Logger::Stats stats = logger->GetStats();
+    std::fprintf(stderr, "queued %llu  written %llu  dropped %llu\n",
+                 static_cast<unsigned long long>(stats.queued), static_cast<unsigned long long>(stats.written),
+                 static_cast<unsigned long long>(stats.dropped));
+
+    std::error_code error;
+    std::filesystem::remove_all(logDir, error);
+    return 0;
+}
@@ -0,0 +1,156 @@
+﻿#include "mapped_file.h"
+#include <utility>
+#include <filesystem>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace knoux::core::system {
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+
+    Close();
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    std::swap(m_isOpen, other.m_isOpen);
+#ifdef _WIN32
+    std::swap(m_fileHandle, other.m_fileHandle);
+    std::swap(m_mappingHandle, other.m_mappingHandle);
+#else
+    std::swap(m_fd, other.m_fd);
+#endif
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& path, AccessHint hint) {
+    Close();
+
+    const std::wstring widePath = std::filesystem::u8path(path).wstring();
+    const DWORD flags = (hint == AccessHint::Sequential) ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS;
+    HANDLE file = CreateFileW(widePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | flags, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    m_fileHandle = file;
+    m_size = static_cast<size_t>(size.QuadPart);
+    m_isOpen = true;
+
+    if (m_size == 0) {
+        return true;
+    }
+
+    m_mappingHandle = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mappingHandle) {
+        Close();
+        return false;
+    }
+
+    m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (!m_data) {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedFile::Close() {
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mappingHandle) {
+        CloseHandle(m_mappingHandle);
+    }
+    if (m_fileHandle) {
+        CloseHandle(m_fileHandle);
+    }
+
+    m_data = nullptr;
+    m_mappingHandle = nullptr;
+    m_fileHandle = nullptr;
+    m_size = 0;
+    m_isOpen = false;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path, AccessHint hint) {
+    Close();
+
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+
+    m_fd = fd;
+    m_size = static_cast<size_t>(st.st_size);
+    m_isOpen = true;
+
+    if (m_size == 0) {
+        return true;
+    }
+
+    void* addr = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+        Close();
+        return false;
+    }
+
+    ::madvise(addr, m_size, (hint == AccessHint::Sequential) ? MADV_SEQUENTIAL : MADV_RANDOM);
+    m_data = static_cast<const uint8_t*>(addr);
+    return true;
+}
+
+void MappedFile::Close() {
+    if (m_data) {
+        ::munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+
+    m_data = nullptr;
+    m_fd = -1;
+    m_size = 0;
+    m_isOpen = false;
+}
+
+#endif
+
+} // namespace knoux::core::system
@@ -0,0 +1,78 @@
+﻿#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace knoux::core::system {
+
+/**
+ * @class MappedFile
+ * @brief Read-only memory mapping of a file on disk.
+ *
+ * The mapping is established lazily by the OS: only the pages that are
+ * actually dereferenced get faulted in, which lets parsers walk container
+ * headers of multi-gigabyte files without reading the payload.
+ *
+ * Move-only; the mapping is released on destruction.
+ */
+class MappedFile {
+public:
+    /**
+     * @brief Access pattern hint passed to the kernel
+     */
+    enum class AccessHint {
+        Random,     // Header walking, skip readahead
+        Sequential  // Linear scans, aggressive readahead
+    };
+
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    /**
+     * @brief Maps the whole file read-only
+     * @param path Absolute path of the file
+     * @param hint Expected access pattern
+     * @return true if the file was opened (an empty file maps to a null view)
+     */
+    bool Open(const std::string& path, AccessHint hint = AccessHint::Random);
+
+    /**
+     * @brief Unmaps the file and closes the underlying handle
+     */
+    void Close();
+
+    /**
+     * @brief Checks if a file is currently open
+     */
+    bool IsOpen() const { return m_isOpen; }
+
+    /**
+     * @brief Returns the start of the mapped view (nullptr for empty files)
+     */
+    const uint8_t* Data() const { return m_data; }
+
+    /**
+     * @brief Returns the size of the mapped view in bytes
+     */
+    size_t Size() const { return m_size; }
+
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_isOpen = false;
+
+#ifdef _WIN32
+    void* m_fileHandle = nullptr;
+    void* m_mappingHandle = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
+
+} // namespace knoux::core::system
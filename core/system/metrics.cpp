@@ -0,0 +1,185 @@
+﻿#include "metrics.h"
+#include <algorithm>
+
+namespace knoux::core::system {
+
+size_t MetricShardIndex() {
+    static std::atomic<size_t> nextShard{ 0 };
+    thread_local const size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+    return shard;
+}
+
+uint64_t MetricCounter::Value() const {
+    uint64_t total = 0;
+    for (const Shard& shard : m_shards) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+size_t LatencyHistogram::BucketIndex(uint64_t nanoseconds) {
+    if (nanoseconds < kSubBuckets) {
+        return static_cast<size_t>(nanoseconds);
+    }
+    int exponent = 63;
+    while ((nanoseconds >> exponent) == 0) {
+        --exponent;
+    }
+    const size_t subBucket = static_cast<size_t>(nanoseconds >> (exponent - kSubBucketBits)) - kSubBuckets;
+    return static_cast<size_t>(exponent - kSubBucketBits + 1) * kSubBuckets + subBucket;
+}
+
+uint64_t LatencyHistogram::BucketLowerBound(size_t index) {
+    if (index < kSubBuckets) {
+        return index;
+    }
+    const int exponent = static_cast<int>(index / kSubBuckets) + kSubBucketBits - 1;
+    return static_cast<uint64_t>(kSubBuckets + index % kSubBuckets) << (exponent - kSubBucketBits);
+}
+
+void LatencyHistogram::Record(uint64_t nanoseconds) {
+    m_buckets[BucketIndex(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    m_sumNs.fetch_add(nanoseconds, std::memory_order_relaxed);
+    uint64_t current = m_maxNs.load(std::memory_order_relaxed);
+    while (nanoseconds > current && !m_maxNs.compare_exchange_weak(current, nanoseconds, std::memory_order_relaxed)) {
+    }
+}
+
+HistogramSnapshot LatencyHistogram::Snapshot() const {
+    uint64_t counts[kBucketCount];
+    uint64_t total = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    HistogramSnapshot snapshot;
+    snapshot.count = total;
+    if (total == 0) {
+        return snapshot;
+    }
+    const uint64_t maxNs = m_maxNs.load(std::memory_order_relaxed);
+    snapshot.meanUs = static_cast<double>(m_sumNs.load(std::memory_order_relaxed)) / static_cast<double>(total) / 1e3;
+    snapshot.maxUs = static_cast<double>(maxNs) / 1e3;
+
+    // Midpoint of the bucket holding the rank, capped at the recorded maximum
+    const auto percentile = [&](double fraction) {
+        const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * static_cast<double>(total) + 0.5));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBucketCount; ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                const uint64_t lower = BucketLowerBound(i);
+                const uint64_t upper = i + 1 < kBucketCount ? BucketLowerBound(i + 1) : maxNs;
+                const double middle = static_cast<double>(lower) + static_cast<double>(upper - lower) / 2.0;
+                return std::min(middle, static_cast<double>(maxNs)) / 1e3;
+            }
+        }
+        return snapshot.maxUs;
+    };
+    snapshot.p50Us = percentile(0.50);
+    snapshot.p90Us = percentile(0.90);
+    snapshot.p99Us = percentile(0.99);
+    snapshot.p999Us = percentile(0.999);
+    return snapshot;
+}
+
+nlohmann::json MetricsSnapshot::ToJson() const {
+    nlohmann::json json;
+    json["unix_ms"] = unixMs;
+
+    nlohmann::json& counterJson = json["counters"] = nlohmann::json::object();
+    for (const auto& [name, value] : counters) {
+        counterJson[name] = value;
+    }
+
+    nlohmann::json& gaugeJson = json["gauges"] = nlohmann::json::object();
+    for (const auto& [name, gauge] : gauges) {
+        gaugeJson[name] = { { "value", gauge.value }, { "max", gauge.max } };
+    }
+
+    nlohmann::json& histogramJson = json["histograms"] = nlohmann::json::object();
+    for (const auto& [name, histogram] : histograms) {
+        histogramJson[name] = {
+            { "count", histogram.count },
+            { "mean_us", histogram.meanUs },
+            { "p50_us", histogram.p50Us },
+            { "p90_us", histogram.p90Us },
+            { "p99_us", histogram.p99Us },
+            { "p999_us", histogram.p999Us },
+            { "max_us", histogram.maxUs }
+        };
+    }
+    return json;
+}
+
+// Static instance pointer
+static std::shared_ptr<MetricsRegistry> g_metricsInstance = nullptr;
+static std::once_flag g_metricsOnce;
+
+std::shared_ptr<MetricsRegistry> MetricsRegistry::GetInstance() {
+    std::call_once(g_metricsOnce, [] { g_metricsInstance = std::shared_ptr<MetricsRegistry>(new MetricsRegistry()); });
+    return g_metricsInstance;
+}
+
+MetricCounter& MetricsRegistry::Counter(const std::string& name) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::unique_ptr<MetricCounter>& counter = m_counters[name];
+    if (!counter) {
+        counter = std::make_unique<MetricCounter>();
+    }
+    return *counter;
+}
+
+MetricGauge& MetricsRegistry::Gauge(const std::string& name) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::unique_ptr<MetricGauge>& gauge = m_gauges[name];
+    if (!gauge) {
+        gauge = std::make_unique<MetricGauge>();
+    }
+    return *gauge;
+}
+
+LatencyHistogram& MetricsRegistry::Histogram(const std::string& name) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::unique_ptr<LatencyHistogram>& histogram = m_histograms[name];
+    if (!histogram) {
+        histogram = std::make_unique<LatencyHistogram>();
+    }
+    return *histogram;
+}
+
+void MetricsSnapshot::AddCounter(const std::string& name, uint64_t value) {
+    const auto position = std::lower_bound(counters.begin(), counters.end(), name,
+        [](const auto& entry, const std::string& key) { return entry.first < key; });
+    counters.emplace(position, name, value);
+}
+
+void MetricsSnapshot::AddGauge(const std::string& name, int64_t value) {
+    const auto position = std::lower_bound(gauges.begin(), gauges.end(), name,
+        [](const auto& entry, const std::string& key) { return entry.first < key; });
+    gauges.emplace(position, name, GaugeValue{ value, value });
+}
+
+MetricsSnapshot MetricsRegistry::Snapshot() const {
+    MetricsSnapshot snapshot;
+    snapshot.unixMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    snapshot.counters.reserve(m_counters.size());
+    for (const auto& [name, counter] : m_counters) {
+        snapshot.counters.emplace_back(name, counter->Value());
+    }
+    snapshot.gauges.reserve(m_gauges.size());
+    for (const auto& [name, gauge] : m_gauges) {
+        snapshot.gauges.emplace_back(name, MetricsSnapshot::GaugeValue{ gauge->Value(), gauge->Max() });
+    }
+    snapshot.histograms.reserve(m_histograms.size());
+    for (const auto& [name, histogram] : m_histograms) {
+        snapshot.histograms.emplace_back(name, histogram->Snapshot());
+    }
+    return snapshot;
+}
+
+} // namespace knoux::core::system
@@ -0,0 +1,226 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+
+namespace knoux::core::system {
+
+// Cache-line shards per MetricCounter
+constexpr size_t kMetricShards = 16;
+
+/**
+ * @brief Shard of the calling thread, assigned round-robin on first use
+ */
+size_t MetricShardIndex();
+
+/**
+ * @class MetricCounter
+ * @brief Monotonic counter sharded across cache lines.
+ *
+ * Each thread adds to its own shard (relaxed), so counters bumped from
+ * several workers never bounce one line between cores; Value() sums the
+ * shards and may miss additions racing with it.
+ */
+class MetricCounter {
+public:
+    void Add(uint64_t amount = 1) {
+        m_shards[MetricShardIndex()].value.fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    uint64_t Value() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{ 0 };
+    };
+
+    Shard m_shards[kMetricShards];
+};
+
+/**
+ * @class MetricGauge
+ * @brief Current value of a level (queue depth, bytes in use) and its high-water mark
+ */
+class MetricGauge {
+public:
+    void Set(int64_t value) {
+        m_value.store(value, std::memory_order_relaxed);
+        UpdateMax(value);
+    }
+
+    void Add(int64_t delta) {
+        UpdateMax(m_value.fetch_add(delta, std::memory_order_relaxed) + delta);
+    }
+
+    int64_t Value() const { return m_value.load(std::memory_order_relaxed); }
+
+    int64_t Max() const { return m_max.load(std::memory_order_relaxed); }
+
+private:
+    void UpdateMax(int64_t value) {
+        int64_t current = m_max.load(std::memory_order_relaxed);
+        while (value > current && !m_max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    std::atomic<int64_t> m_value{ 0 };
+    std::atomic<int64_t> m_max{ 0 };
+};
+
+/**
+ * @struct HistogramSnapshot
+ * @brief Summary of a LatencyHistogram, in microseconds
+ */
+struct HistogramSnapshot {
+    uint64_t count = 0;
+    double meanUs = 0.0;
+    double p50Us = 0.0;
+    double p90Us = 0.0;
+    double p99Us = 0.0;
+    double p999Us = 0.0;
+    double maxUs = 0.0;
+};
+
+/**
+ * @class LatencyHistogram
+ * @brief Log-bucketed (HDR-style) latency histogram over nanoseconds.
+ *
+ * Values below 2^kSubBucketBits get a bucket each; above that every power
+ * of two is split into 2^kSubBucketBits linear sub-buckets, so any value is
+ * reported within 1/16 (6.25%) of itself from 1 ns to centuries, in 8 KB
+ * of fixed buckets. Record() is a few relaxed atomic adds; percentiles
+ * are read from the bucket counts by Snapshot().
+ */
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 4;
+    static constexpr size_t kSubBuckets = size_t{ 1 } << kSubBucketBits;
+    static constexpr size_t kBucketCount = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+    void Record(uint64_t nanoseconds);
+
+    /**
+     * @brief Records the time since start
+     */
+    void RecordSince(std::chrono::steady_clock::time_point start) {
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+    HistogramSnapshot Snapshot() const;
+
+    /**
+     * @brief Bucket a value falls in
+     */
+    static size_t BucketIndex(uint64_t nanoseconds);
+
+    /**
+     * @brief Smallest value of a bucket
+     */
+    static uint64_t BucketLowerBound(size_t index);
+
+private:
+    std::atomic<uint64_t> m_buckets[kBucketCount] = {};
+    std::atomic<uint64_t> m_sumNs{ 0 };
+    std::atomic<uint64_t> m_maxNs{ 0 };
+};
+
+/**
+ * @class MetricTimer
+ * @brief Records its scope's duration into a histogram
+ */
+class MetricTimer {
+public:
+    explicit MetricTimer(LatencyHistogram& histogram)
+        : m_histogram(histogram), m_start(std::chrono::steady_clock::now()) {}
+
+    ~MetricTimer() { m_histogram.RecordSince(m_start); }
+
+    MetricTimer(const MetricTimer&) = delete;
+    MetricTimer& operator=(const MetricTimer&) = delete;
+
+private:
+    LatencyHistogram& m_histogram;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+/**
+ * @struct MetricsSnapshot
+ * @brief Every registered metric at one moment, sorted by name
+ */
+struct MetricsSnapshot {
+    struct GaugeValue {
+        int64_t value = 0;
+        int64_t max = 0;
+    };
+
+    int64_t unixMs = 0;
+    std::vector<std::pair<std::string, uint64_t>> counters;
+    std::vector<std::pair<std::string, GaugeValue>> gauges;
+    std::vector<std::pair<std::string, HistogramSnapshot>> histograms;
+
+    /**
+     * @brief Adds a total sampled from the component that owns it, keeping counters sorted
+     */
+    void AddCounter(const std::string& name, uint64_t value);
+
+    /**
+     * @brief Adds a level sampled from the component that owns it (max is the sampled value), keeping gauges sorted
+     */
+    void AddGauge(const std::string& name, int64_t value);
+
+    /**
+     * @brief Compact JSON for overlays and telemetry:
+     *        {"unix_ms", "counters": {name: n}, "gauges": {name: {"value", "max"}},
+     *         "histograms": {name: {"count", "mean_us", "p50_us", "p90_us", "p99_us", "p999_us", "max_us"}}}
+     */
+    nlohmann::json ToJson() const;
+};
+
+/**
+ * @class MetricsRegistry
+ * @brief Process-wide named counters, gauges and latency histograms.
+ *
+ * Metrics are created on first lookup and live as long as the registry,
+ * so instrumented code resolves its references once (constructor or a
+ * function-local static) and the hot path only touches atomics. Names are
+ * dotted paths ("engine.load", "scheduler.wait.interactive").
+ *
+ * Thread-safe; lookups and Snapshot() take a mutex, recording never does.
+ */
+class MetricsRegistry {
+public:
+    /**
+     * @brief Gets singleton instance of the registry
+     */
+    static std::shared_ptr<MetricsRegistry> GetInstance();
+
+    MetricCounter& Counter(const std::string& name);
+
+    MetricGauge& Gauge(const std::string& name);
+
+    LatencyHistogram& Histogram(const std::string& name);
+
+    /**
+     * @brief Reads every metric
+     */
+    MetricsSnapshot Snapshot() const;
+
+private:
+    MetricsRegistry() = default;
+
+    mutable std::mutex m_mutex;
+    std::map<std::string, std::unique_ptr<MetricCounter>> m_counters;
+    std::map<std::string, std::unique_ptr<MetricGauge>> m_gauges;
+    std::map<std::string, std::unique_ptr<LatencyHistogram>> m_histograms;
+};
+
+} // namespace knoux::core::system
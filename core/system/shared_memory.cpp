@@ -0,0 +1,216 @@
+﻿#include "shared_memory.h"
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace knoux::core::system {
+
+SharedMemory::~SharedMemory() {
+    Close();
+}
+
+SharedMemory::SharedMemory(SharedMemory&& other) noexcept {
+    *this = std::move(other);
+}
+
+SharedMemory& SharedMemory::operator=(SharedMemory&& other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+
+    Close();
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    std::swap(m_name, other.m_name);
+    std::swap(m_owner, other.m_owner);
+#ifdef _WIN32
+    std::swap(m_mappingHandle, other.m_mappingHandle);
+#endif
+    return *this;
+}
+
+#ifdef _WIN32
+
+namespace {
+
+// Session-local namespace, so no SeCreateGlobalPrivilege is needed
+std::wstring MappingName(const std::string& name) {
+    return L"Local\\" + std::wstring(name.begin(), name.end());
+}
+
+} // namespace
+
+bool SharedMemory::Create(const std::string& name, size_t size) {
+    Close();
+    if (name.empty() || size == 0) {
+        return false;
+    }
+
+    const uint64_t size64 = size;
+    HANDLE mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                        static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64),
+                                        MappingName(name).c_str());
+    if (!mapping) {
+        return false;
+    }
+    if (GetLastError() == ERROR_ALREADY_EXISTS) {
+        // Still held open by an earlier session; its size and contents cannot be trusted
+        CloseHandle(mapping);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!view) {
+        CloseHandle(mapping);
+        return false;
+    }
+
+    m_mappingHandle = mapping;
+    m_data = static_cast<uint8_t*>(view);
+    m_size = size;
+    m_name = name;
+    m_owner = true;
+    return true;
+}
+
+bool SharedMemory::Open(const std::string& name) {
+    Close();
+    if (name.empty()) {
+        return false;
+    }
+
+    HANDLE mapping = OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE, MappingName(name).c_str());
+    if (!mapping) {
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    MEMORY_BASIC_INFORMATION info;
+    if (!view || VirtualQuery(view, &info, sizeof(info)) == 0) {
+        if (view) {
+            UnmapViewOfFile(view);
+        }
+        CloseHandle(mapping);
+        return false;
+    }
+
+    m_mappingHandle = mapping;
+    m_data = static_cast<uint8_t*>(view);
+    m_size = info.RegionSize;
+    m_name = name;
+    m_owner = false;
+    return true;
+}
+
+void SharedMemory::Close() {
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mappingHandle) {
+        CloseHandle(m_mappingHandle);
+    }
+
+    m_data = nullptr;
+    m_mappingHandle = nullptr;
+    m_size = 0;
+    m_name.clear();
+    m_owner = false;
+}
+
+#else
+
+namespace {
+
+std::string ShmName(const std::string& name) {
+    return "/" + name;
+}
+
+} // namespace
+
+bool SharedMemory::Create(const std::string& name, size_t size) {
+    Close();
+    if (name.empty() || size == 0) {
+        return false;
+    }
+
+    // A region left behind by a crashed session would be reopened with its old contents
+    const std::string shmName = ShmName(name);
+    ::shm_unlink(shmName.c_str());
+    const int fd = ::shm_open(shmName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        return false;
+    }
+
+    void* addr = MAP_FAILED;
+    if (::ftruncate(fd, static_cast<off_t>(size)) == 0) {
+        addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    // The mapping keeps the region alive; the descriptor is not needed past this point
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        ::shm_unlink(shmName.c_str());
+        return false;
+    }
+
+    m_data = static_cast<uint8_t*>(addr);
+    m_size = size;
+    m_name = name;
+    m_owner = true;
+    return true;
+}
+
+bool SharedMemory::Open(const std::string& name) {
+    Close();
+    if (name.empty()) {
+        return false;
+    }
+
+    const int fd = ::shm_open(ShmName(name).c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    void* addr = MAP_FAILED;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+        addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+
+    m_data = static_cast<uint8_t*>(addr);
+    m_size = static_cast<size_t>(st.st_size);
+    m_name = name;
+    m_owner = false;
+    return true;
+}
+
+void SharedMemory::Close() {
+    if (m_data) {
+        ::munmap(m_data, m_size);
+    }
+    if (m_owner) {
+        ::shm_unlink(ShmName(m_name).c_str());
+    }
+
+    m_data = nullptr;
+    m_size = 0;
+    m_name.clear();
+    m_owner = false;
+}
+
+#endif
+
+} // namespace knoux::core::system
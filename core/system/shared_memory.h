@@ -0,0 +1,69 @@
+﻿#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace knoux::core::system {
+
+/**
+ * @class SharedMemory
+ * @brief Named read-write memory region shared between processes.
+ *
+ * POSIX shared memory (shm_open) on Linux and macOS, a pagefile-backed
+ * named file mapping on Windows. The creator owns the name: it is removed
+ * when the creating instance closes, while processes that opened it keep
+ * their mapping until they close in turn.
+ *
+ * Move-only; the mapping is released on destruction.
+ */
+class SharedMemory {
+public:
+    SharedMemory() = default;
+    ~SharedMemory();
+
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+    SharedMemory(SharedMemory&& other) noexcept;
+    SharedMemory& operator=(SharedMemory&& other) noexcept;
+
+    /**
+     * @brief Creates and maps a zero-filled region, replacing a stale one of the same name
+     * @param name Portable name: letters, digits, '-' and '_' (no slashes)
+     * @param size Region size in bytes
+     * @return false if the region cannot be created or mapped
+     */
+    bool Create(const std::string& name, size_t size);
+
+    /**
+     * @brief Maps an existing region created by another process
+     * @param name Name passed to Create()
+     * @return false if no such region exists or it cannot be mapped
+     */
+    bool Open(const std::string& name);
+
+    /**
+     * @brief Unmaps the region, and removes its name if this instance created it
+     */
+    void Close();
+
+    bool IsOpen() const { return m_data != nullptr; }
+
+    uint8_t* Data() const { return m_data; }
+
+    size_t Size() const { return m_size; }
+
+    const std::string& Name() const { return m_name; }
+
+private:
+    uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    std::string m_name;
+    bool m_owner = false;
+
+#ifdef _WIN32
+    void* m_mappingHandle = nullptr;
+#endif
+};
+
+} // namespace knoux::core::system
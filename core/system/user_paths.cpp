@@ -0,0 +1,28 @@
+﻿#include "user_paths.h"
+#include <cstdlib>
+#include <system_error>
+
+namespace knoux::core::system {
+
+std::filesystem::path UserConfigRoot() {
+#ifdef _WIN32
+    if (const char* localAppData = std::getenv("LOCALAPPDATA")) {
+        return localAppData;
+    }
+#else
+    if (const char* xdgConfig = std::getenv("XDG_CONFIG_HOME")) {
+        return xdgConfig;
+    }
+    if (const char* home = std::getenv("HOME")) {
+        return std::filesystem::path(home) / ".config";
+    }
+#endif
+    std::error_code error;
+    return std::filesystem::temp_directory_path(error);
+}
+
+std::filesystem::path UserDataDirectory() {
+    return UserConfigRoot() / "KNOUX Player X";
+}
+
+} // namespace knoux::core::system
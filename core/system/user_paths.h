@@ -0,0 +1,19 @@
+﻿#pragma once
+
+#include <filesystem>
+
+namespace knoux::core::system {
+
+/**
+ * @brief Per-user configuration root (LOCALAPPDATA, XDG_CONFIG_HOME or ~/.config)
+ *
+ * Falls back to the temporary directory when none of them is set.
+ */
+std::filesystem::path UserConfigRoot();
+
+/**
+ * @brief Directory of the app's persistent per-user files: settings and caches
+ */
+std::filesystem::path UserDataDirectory();
+
+} // namespace knoux::core::system
@@ -0,0 +1,78 @@
+﻿// KNOUX Player X - Binary log decoder
+//
+//   knoux_log_decode <segment.klog | directory>...
+//       Prints the records as text lines, in the text logger's layout.
+//   knoux_log_decode --trace <out.json> <segment.klog | directory>...
+//       Writes Chrome trace-event JSON instead; open it in Perfetto
+//       (ui.perfetto.dev) or chrome://tracing to see the spans as a timeline.
+//
+// Directories are read oldest segment first.
+
+#include "core/system/binary_log.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace knoux::core::system;
+
+int main(int argc, char** argv) {
+    std::string tracePath;
+    std::vector<std::string> segments;
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        if (argument == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (std::filesystem::is_directory(argument)) {
+            const std::vector<std::string> listed = BinaryLogReader::ListSegments(argument);
+            segments.insert(segments.end(), listed.begin(), listed.end());
+        } else {
+            segments.push_back(argument);
+        }
+    }
+    if (segments.empty()) {
+        std::cerr << "usage: knoux_log_decode [--trace out.json] <segment.klog | directory>..." << std::endl;
+        return 2;
+    }
+
+    // Opened first so each entry is written as it is decoded
+    std::ofstream traceFile;
+    std::unique_ptr<BinaryLogTraceWriter> trace;
+    if (!tracePath.empty()) {
+        traceFile.open(tracePath, std::ios::out | std::ios::trunc);
+        if (!traceFile.is_open()) {
+            std::cerr << tracePath << ": cannot write" << std::endl;
+            return 1;
+        }
+        trace = std::make_unique<BinaryLogTraceWriter>(traceFile);
+    }
+
+    int status = 0;
+    for (const std::string& segment : segments) {
+        BinaryLogReader reader;
+        if (!reader.Open(segment)) {
+            std::cerr << segment << ": not a binary log segment" << std::endl;
+            status = 1;
+            continue;
+        }
+        BinaryLogEntry entry;
+        while (reader.Next(entry)) {
+            if (trace) {
+                trace->Write(entry);
+            } else {
+                std::cout << BinaryLogReader::FormatText(entry) << '\n';
+            }
+        }
+        if (reader.IsDamaged()) {
+            std::cerr << segment << ": damaged record, rest of segment skipped" << std::endl;
+            status = 1;
+        }
+    }
+
+    if (trace) {
+        trace->Finish();
+    }
+    return status;
+}
@@ -9,6 +9,19 @@ declare const MAIN_WINDOW_PRELOAD_WEBPACK_ENTRY: string | undefined;
 
 let mainWindow: BrowserWindow | null = null;
 
+// Shared audio transport (sharedAudioBridge.ts) is opt-in: the preload loads
+// a native addon, which only works in a renderer WITHOUT the Chromium sandbox.
+// A SharedArrayBuffer cannot cross processes, so the addon cannot live in the
+// main process instead. Enable with --enable-shared-audio or KNOUX_SHARED_AUDIO=1.
+const sharedAudioEnabled =
+  app.commandLine.hasSwitch('enable-shared-audio') || process.env.KNOUX_SHARED_AUDIO === '1';
+
+if (sharedAudioEnabled) {
+  // The shared audio ring reaches the AudioWorklet as a SharedArrayBuffer
+  app.commandLine.appendSwitch('enable-features', 'SharedArrayBuffer');
+  console.warn('[SharedAudio] Enabled: the main window renderer runs unsandboxed');
+}
+
 function resolvePreload(preloadPath: string): string {
   try {
     if (fs.existsSync(preloadPath)) return preloadPath;
@@ -40,6 +53,8 @@ function createWindow(): void {
     webPreferences: {
       nodeIntegration: false,
       contextIsolation: true,
+      // Only the shared audio opt-in lifts the sandbox (see above)
+      sandbox: !sharedAudioEnabled,
       preload: resolvePreload(MAIN_WINDOW_PRELOAD_WEBPACK_ENTRY),
     },
   });
@@ -0,0 +1,437 @@
+﻿/**
+ * Project: KNOUX Player X™
+ * Author: knoux
+ * Purpose: N-API addon mirroring the engine's shared audio ring into a SharedArrayBuffer,
+ *          and reading its shared spectrum snapshot
+ * Layer: Desktop -> Native -> Audio
+ *
+ * Related Files:
+ * - Build: binding.gyp (target SharedAudio.node)
+ * - Ring: core/engine/shared_audio_ring.h, core/system/shared_memory.h
+ * - Spectrum: core/engine/spectrum_analyzer.h (SpectrumSnapshot)
+ * - Bridge: sharedAudioBridge.ts (preload)
+ * - Consumer: desktop/renderer/audio/sharedAudioWorklet.js
+ */
+
+#include "core/engine/shared_audio_ring.h"
+#include "core/engine/spectrum_analyzer.h"
+#include <node_api.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <thread>
+
+// JS surface:
+//
+//   const mirror = new SharedAudioMirror(name);   // maps the engine's ring, throws if absent
+//   mirror.channels; mirror.sampleRate; mirror.capacityFrames; mirror.byteLength;
+//   const sab = new SharedArrayBuffer(mirror.byteLength);
+//   mirror.start(new Uint8Array(sab));            // sab now follows the SharedAudioHeader protocol
+//   mirror.stop();
+//
+// Electron's V8 sandbox does not allow a JS buffer over memory it did not
+// allocate, so the renderer cannot see the engine's mapping directly. A
+// pump thread instead keeps a SharedArrayBuffer with the same layout in
+// step with it: new frames are copied in and writeFrame published, and the
+// AudioWorklet's readFrame and underrun counters are copied back, so the
+// engine's back-pressure and statistics cover the renderer end to end.
+// That is one memcpy per frame and no JS, IPC or serialisation on the path.
+// The pump only runs while the worklet has mirrored frames left to play;
+// once it has drained them it sleeps until the engine writes again.
+//
+//   const reader = new SpectrumReader(name);      // maps the engine's spectrum snapshot, throws if absent
+//   const bands = reader.read(levels, peaks);     // Float32Arrays; 0 if no new frame since the last read
+//   reader.range();                               // { bandCount, sampleRate, minFrequency, maxFrequency }
+//
+// The spectrum is small (two floats per band), so it is simply copied out
+// of the snapshot on each read, on the caller's thread and without locks.
+
+namespace {
+
+using knoux::core::engine::SharedAudioHeader;
+using knoux::core::engine::SharedAudioRing;
+using knoux::core::engine::SpectrumFrame;
+using knoux::core::engine::SpectrumSnapshot;
+using knoux::core::system::SharedMemory;
+
+// Pump period while frames are in flight; well below the worklet's 128-frame render quantum (2.7 ms at 48 kHz)
+constexpr auto kPumpInterval = std::chrono::microseconds(500);
+
+// Longest idle sleep; only bounds how stale the underrun counters get while nothing plays
+constexpr auto kIdleWait = std::chrono::milliseconds(100);
+
+struct Mirror {
+    SharedAudioRing ring;
+
+    // Backing store of the caller's SharedArrayBuffer view, referenced while pumping
+    uint8_t* target = nullptr;
+    napi_ref targetRef = nullptr;
+
+    std::thread pump;
+    std::atomic<bool> running{ false };
+};
+
+// Helper: Counter at a protocol offset; the SharedArrayBuffer carries no C++ alignment guarantee beyond 4 bytes
+std::atomic<uint32_t>& Counter(uint8_t* base, size_t offset) {
+    return *reinterpret_cast<std::atomic<uint32_t>*>(base + offset);
+}
+
+// Helper: Throws a JS error for a failed call; true if the call succeeded
+bool Check(napi_env env, napi_status status, const char* what) {
+    if (status == napi_ok) {
+        return true;
+    }
+    bool pending = false;
+    napi_is_exception_pending(env, &pending);
+    if (!pending) {
+        napi_throw_error(env, nullptr, what);
+    }
+    return false;
+}
+
+// One pump step: consumer state to the engine, then new frames to the renderer.
+// Returns false when idle: the renderer has played every mirrored frame and the engine wrote none since
+bool PumpOnce(Mirror& mirror, uint32_t& write) {
+    SharedAudioHeader* source = mirror.ring.Header();
+    uint8_t* target = mirror.target;
+    const size_t channels = mirror.ring.Channels();
+    const uint32_t mask = static_cast<uint32_t>(mirror.ring.CapacityFrames()) - 1;
+
+    const uint32_t read = Counter(target, offsetof(SharedAudioHeader, readFrame)).load(std::memory_order_acquire);
+    source->underruns.store(Counter(target, offsetof(SharedAudioHeader, underruns)).load(std::memory_order_relaxed),
+                            std::memory_order_relaxed);
+    source->underrunFrames.store(
+        Counter(target, offsetof(SharedAudioHeader, underrunFrames)).load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+    // Frames up to read are played; frames not yet mirrored sit beyond it, so the engine cannot overwrite them
+    if (source->readFrame.load(std::memory_order_relaxed) != read) {
+        mirror.ring.PublishRead(read);
+    }
+    Counter(target, offsetof(SharedAudioHeader, sampleRate))
+        .store(source->sampleRate.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    std::atomic<uint32_t>& targetWrite = Counter(target, offsetof(SharedAudioHeader, writeFrame));
+    write = source->writeFrame.load(std::memory_order_acquire);
+    uint32_t mirrored = targetWrite.load(std::memory_order_relaxed);
+    if (mirrored == write) {
+        return read != write;
+    }
+    if (write - mirrored > mask + 1) {
+        // Only the last capacity frames still exist in the source
+        mirrored = write - (mask + 1);
+    }
+
+    const float* from = mirror.ring.Samples();
+    float* to = reinterpret_cast<float*>(target + SharedAudioHeader::kDataOffset);
+    while (mirrored != write) {
+        const uint32_t start = mirrored & mask;
+        const uint32_t frames = std::min(write - mirrored, mask + 1 - start);
+        std::memcpy(to + start * channels, from + start * channels, frames * channels * sizeof(float));
+        mirrored += frames;
+    }
+    targetWrite.store(write, std::memory_order_release);
+    return true;
+}
+
+void PumpLoop(Mirror* mirror) {
+    uint32_t write = 0;
+    while (mirror->running.load(std::memory_order_relaxed)) {
+        if (PumpOnce(*mirror, write)) {
+            std::this_thread::sleep_for(kPumpInterval);
+        } else {
+            mirror->ring.WaitForWrite(write, kIdleWait);
+        }
+    }
+}
+
+// Helper: Joins the pump and releases the SharedArrayBuffer
+void StopPump(napi_env env, Mirror& mirror) {
+    if (mirror.running.exchange(false) && mirror.pump.joinable()) {
+        mirror.ring.Interrupt();
+        mirror.pump.join();
+    }
+    if (mirror.targetRef) {
+        napi_delete_reference(env, mirror.targetRef);
+        mirror.targetRef = nullptr;
+    }
+    mirror.target = nullptr;
+}
+
+Mirror* Unwrap(napi_env env, napi_callback_info info, size_t& argc, napi_value* argv) {
+    napi_value self;
+    Mirror* mirror = nullptr;
+    if (!Check(env, napi_get_cb_info(env, info, &argc, argv, &self, nullptr), "invalid call") ||
+        !Check(env, napi_unwrap(env, self, reinterpret_cast<void**>(&mirror)), "not a SharedAudioMirror")) {
+        return nullptr;
+    }
+    return mirror;
+}
+
+napi_value MirrorStart(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value argv[1];
+    Mirror* mirror = Unwrap(env, info, argc, argv);
+    if (!mirror) {
+        return nullptr;
+    }
+
+    bool isTypedArray = false;
+    napi_typedarray_type type;
+    size_t length = 0;
+    void* data = nullptr;
+    napi_value arrayBuffer;
+    size_t byteOffset = 0;
+    if (argc < 1 || napi_is_typedarray(env, argv[0], &isTypedArray) != napi_ok || !isTypedArray ||
+        napi_get_typedarray_info(env, argv[0], &type, &length, &data, &arrayBuffer, &byteOffset) != napi_ok ||
+        type != napi_uint8_array) {
+        napi_throw_type_error(env, nullptr, "start() expects a Uint8Array over a SharedArrayBuffer");
+        return nullptr;
+    }
+    if (length < SharedAudioRing::RegionSize(mirror->ring.CapacityFrames(), mirror->ring.Channels()) ||
+        reinterpret_cast<uintptr_t>(data) % alignof(std::atomic<uint32_t>) != 0) {
+        napi_throw_range_error(env, nullptr, "buffer must be byteLength bytes and 4-byte aligned");
+        return nullptr;
+    }
+
+    StopPump(env, *mirror);
+    if (!Check(env, napi_create_reference(env, argv[0], 1, &mirror->targetRef), "cannot reference buffer")) {
+        return nullptr;
+    }
+    mirror->target = static_cast<uint8_t*>(data);
+
+    // Same header, starting at the engine's current consumer position; magic last, as in Create()
+    SharedAudioHeader* source = mirror->ring.Header();
+    uint8_t* target = mirror->target;
+    const uint32_t fields[] = { 0, source->version, source->channels, source->sampleRate.load(std::memory_order_relaxed),
+                                source->capacityFrames, source->dataOffset };
+    std::memcpy(target, fields, sizeof(fields));
+    const uint32_t read = source->readFrame.load(std::memory_order_acquire);
+    Counter(target, offsetof(SharedAudioHeader, readFrame)).store(read, std::memory_order_relaxed);
+    Counter(target, offsetof(SharedAudioHeader, writeFrame)).store(read, std::memory_order_relaxed);
+    Counter(target, offsetof(SharedAudioHeader, underruns))
+        .store(source->underruns.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    Counter(target, offsetof(SharedAudioHeader, underrunFrames))
+        .store(source->underrunFrames.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    uint32_t write = 0;
+    PumpOnce(*mirror, write);
+    Counter(target, offsetof(SharedAudioHeader, magic)).store(SharedAudioHeader::kMagic, std::memory_order_release);
+
+    mirror->running.store(true);
+    mirror->pump = std::thread(PumpLoop, mirror);
+    return nullptr;
+}
+
+napi_value MirrorStop(napi_env env, napi_callback_info info) {
+    size_t argc = 0;
+    Mirror* mirror = Unwrap(env, info, argc, nullptr);
+    if (mirror) {
+        StopPump(env, *mirror);
+    }
+    return nullptr;
+}
+
+void FinalizeMirror(napi_env env, void* data, void*) {
+    Mirror* mirror = static_cast<Mirror*>(data);
+    StopPump(env, *mirror);
+    delete mirror;
+}
+
+// Helper: Sets a read-only numeric property
+void SetNumber(napi_env env, napi_value object, const char* name, double number) {
+    napi_value value;
+    napi_create_double(env, number, &value);
+    const napi_property_descriptor property = { name, nullptr, nullptr, nullptr, nullptr, value, napi_enumerable, nullptr };
+    napi_define_properties(env, object, 1, &property);
+}
+
+napi_value MirrorConstructor(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value argv[1];
+    napi_value self;
+    if (!Check(env, napi_get_cb_info(env, info, &argc, argv, &self, nullptr), "invalid call")) {
+        return nullptr;
+    }
+
+    size_t length = 0;
+    if (argc < 1 || napi_get_value_string_utf8(env, argv[0], nullptr, 0, &length) != napi_ok) {
+        napi_throw_type_error(env, nullptr, "SharedAudioMirror(name) expects a ring name");
+        return nullptr;
+    }
+    std::string name(length, '\0');
+    napi_get_value_string_utf8(env, argv[0], &name[0], length + 1, &length);
+
+    Mirror* mirror = new Mirror();
+    if (!mirror->ring.Open(name)) {
+        delete mirror;
+        napi_throw_error(env, nullptr, ("no shared audio ring named " + name).c_str());
+        return nullptr;
+    }
+    if (!Check(env, napi_wrap(env, self, mirror, FinalizeMirror, nullptr, nullptr), "cannot wrap SharedAudioMirror")) {
+        delete mirror;
+        return nullptr;
+    }
+
+    SetNumber(env, self, "channels", static_cast<double>(mirror->ring.Channels()));
+    SetNumber(env, self, "sampleRate", mirror->ring.SampleRate());
+    SetNumber(env, self, "capacityFrames", static_cast<double>(mirror->ring.CapacityFrames()));
+    SetNumber(env, self, "byteLength",
+              static_cast<double>(SharedAudioRing::RegionSize(mirror->ring.CapacityFrames(), mirror->ring.Channels())));
+    return self;
+}
+
+struct Reader {
+    SharedMemory memory;
+    const SpectrumSnapshot* snapshot = nullptr;
+    SpectrumFrame frame;
+    uint64_t lastFrameIndex = 0;
+};
+
+// Helper: Float32Array storage and length; false if value is not one
+bool GetFloats(napi_env env, napi_value value, float*& data, size_t& length) {
+    bool isTypedArray = false;
+    napi_typedarray_type type;
+    void* raw = nullptr;
+    napi_value arrayBuffer;
+    size_t byteOffset = 0;
+    if (napi_is_typedarray(env, value, &isTypedArray) != napi_ok || !isTypedArray ||
+        napi_get_typedarray_info(env, value, &type, &length, &raw, &arrayBuffer, &byteOffset) != napi_ok ||
+        type != napi_float32_array) {
+        return false;
+    }
+    data = static_cast<float*>(raw);
+    return true;
+}
+
+Reader* UnwrapReader(napi_env env, napi_callback_info info, size_t& argc, napi_value* argv) {
+    napi_value self;
+    Reader* reader = nullptr;
+    if (!Check(env, napi_get_cb_info(env, info, &argc, argv, &self, nullptr), "invalid call") ||
+        !Check(env, napi_unwrap(env, self, reinterpret_cast<void**>(&reader)), "not a SpectrumReader")) {
+        return nullptr;
+    }
+    return reader;
+}
+
+napi_value ReaderRead(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value argv[2];
+    Reader* reader = UnwrapReader(env, info, argc, argv);
+    if (!reader) {
+        return nullptr;
+    }
+
+    float* levels = nullptr;
+    float* peaks = nullptr;
+    size_t levelCount = 0;
+    size_t peakCount = 0;
+    if (argc < 2 || !GetFloats(env, argv[0], levels, levelCount) || !GetFloats(env, argv[1], peaks, peakCount)) {
+        napi_throw_type_error(env, nullptr, "read() expects two Float32Arrays");
+        return nullptr;
+    }
+
+    size_t bands = 0;
+    if (reader->snapshot->Read(reader->frame) && reader->frame.frameIndex != reader->lastFrameIndex) {
+        reader->lastFrameIndex = reader->frame.frameIndex;
+        bands = std::min<size_t>({ reader->frame.bandCount, levelCount, peakCount });
+        std::memcpy(levels, reader->frame.levels, bands * sizeof(float));
+        std::memcpy(peaks, reader->frame.peaks, bands * sizeof(float));
+    }
+
+    napi_value result;
+    napi_create_uint32(env, static_cast<uint32_t>(bands), &result);
+    return result;
+}
+
+napi_value ReaderRange(napi_env env, napi_callback_info info) {
+    size_t argc = 0;
+    Reader* reader = UnwrapReader(env, info, argc, nullptr);
+    if (!reader) {
+        return nullptr;
+    }
+
+    // The last frame read; the snapshot's own header fields may be mid-update
+    napi_value range;
+    napi_create_object(env, &range);
+    SetNumber(env, range, "bandCount", reader->frame.bandCount);
+    SetNumber(env, range, "sampleRate", reader->frame.sampleRate);
+    SetNumber(env, range, "minFrequency", reader->frame.minFrequency);
+    SetNumber(env, range, "maxFrequency", reader->frame.maxFrequency);
+    return range;
+}
+
+void FinalizeReader(napi_env, void* data, void*) {
+    delete static_cast<Reader*>(data);
+}
+
+napi_value ReaderConstructor(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value argv[1];
+    napi_value self;
+    if (!Check(env, napi_get_cb_info(env, info, &argc, argv, &self, nullptr), "invalid call")) {
+        return nullptr;
+    }
+
+    size_t length = 0;
+    if (argc < 1 || napi_get_value_string_utf8(env, argv[0], nullptr, 0, &length) != napi_ok) {
+        napi_throw_type_error(env, nullptr, "SpectrumReader(name) expects a snapshot name");
+        return nullptr;
+    }
+    std::string name(length, '\0');
+    napi_get_value_string_utf8(env, argv[0], &name[0], length + 1, &length);
+
+    Reader* reader = new Reader();
+    if (reader->memory.Open(name) && reader->memory.Size() >= sizeof(SpectrumSnapshot)) {
+        const auto* snapshot = reinterpret_cast<const SpectrumSnapshot*>(reader->memory.Data());
+        if (snapshot->magic.load(std::memory_order_acquire) == SpectrumSnapshot::kMagic &&
+            snapshot->version == SpectrumSnapshot::kVersion) {
+            reader->snapshot = snapshot;
+        }
+    }
+    if (!reader->snapshot) {
+        delete reader;
+        napi_throw_error(env, nullptr, ("no spectrum snapshot named " + name).c_str());
+        return nullptr;
+    }
+    reader->snapshot->Read(reader->frame);
+    reader->lastFrameIndex = reader->frame.frameIndex - 1;
+
+    if (!Check(env, napi_wrap(env, self, reader, FinalizeReader, nullptr, nullptr), "cannot wrap SpectrumReader")) {
+        delete reader;
+        return nullptr;
+    }
+    return self;
+}
+
+napi_value Init(napi_env env, napi_value exports) {
+    const napi_property_descriptor methods[] = {
+        { "start", nullptr, MirrorStart, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "stop", nullptr, MirrorStop, nullptr, nullptr, nullptr, napi_default, nullptr },
+    };
+
+    napi_value constructor;
+    if (!Check(env, napi_define_class(env, "SharedAudioMirror", NAPI_AUTO_LENGTH, MirrorConstructor, nullptr,
+                                      sizeof(methods) / sizeof(methods[0]), methods, &constructor),
+               "cannot define SharedAudioMirror")) {
+        return nullptr;
+    }
+    napi_set_named_property(env, exports, "SharedAudioMirror", constructor);
+
+    const napi_property_descriptor readerMethods[] = {
+        { "read", nullptr, ReaderRead, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "range", nullptr, ReaderRange, nullptr, nullptr, nullptr, napi_default, nullptr },
+    };
+    if (!Check(env, napi_define_class(env, "SpectrumReader", NAPI_AUTO_LENGTH, ReaderConstructor, nullptr,
+                                      sizeof(readerMethods) / sizeof(readerMethods[0]), readerMethods, &constructor),
+               "cannot define SpectrumReader")) {
+        return nullptr;
+    }
+    napi_set_named_property(env, exports, "SpectrumReader", constructor);
+    return exports;
+}
+
+} // namespace
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, Init)
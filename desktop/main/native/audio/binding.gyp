@@ -0,0 +1,28 @@
+{
+  "targets": [
+    {
+      "target_name": "SharedAudio",
+      "sources": [
+        "SharedAudioAddon.cpp",
+        "../../../../core/engine/shared_audio_ring.cpp",
+        "../../../../core/engine/spectrum_analyzer.cpp",
+        "../../../../core/engine/real_fft.cpp",
+        "../../../../core/system/shared_memory.cpp"
+      ],
+      "include_dirs": [ "../../../.." ],
+      "defines": [ "NAPI_VERSION=6" ],
+      "cflags_cc": [ "-std=c++17", "-O2" ],
+      "conditions": [
+        [ "OS=='linux'", { "libraries": [ "-lrt" ] } ]
+      ],
+      "xcode_settings": {
+        "CLANG_CXX_LANGUAGE_STANDARD": "c++17",
+        "GCC_OPTIMIZATION_LEVEL": "2",
+        "MACOSX_DEPLOYMENT_TARGET": "10.15"
+      },
+      "msvs_settings": {
+        "VCCLCompilerTool": { "AdditionalOptions": [ "/std:c++17", "/utf-8" ] }
+      }
+    }
+  ]
+}
@@ -0,0 +1,154 @@
+/**
+ * Project: KNOUX Player X™
+ * Author: knoux
+ * Purpose: Preload bridge handing the engine's shared audio ring and spectrum to the renderer
+ * Layer: Desktop -> Native -> Audio
+ *
+ * Related Files:
+ * - Native: SharedAudioAddon.cpp (built by binding.gyp, `npm run build:audio`)
+ * - Engine: MediaEngine::OpenSharedAudioOutput (core/engine/media_engine.h)
+ * - Renderer: desktop/renderer/audio/sharedAudioOutput.ts, sharedAudioWorklet.js
+ * - Usage: await window.knouxAPI.attachSharedAudio(name)
+ * - Spectrum: MediaEngine::EnableSpectrumAnalyzer, src/ui/components/audio/AudioVisualizer.tsx
+ *
+ * The engine process writes decoded PCM into a named shared-memory ring.
+ * The preload maps it with the addon and mirrors it into a SharedArrayBuffer
+ * that is posted to the page, where an AudioWorklet pulls from it with
+ * Atomics. No audio crosses IPC, and the main process is not involved.
+ * Loading the addon requires an unsandboxed renderer, so the transport is
+ * opt-in (`--enable-shared-audio` or KNOUX_SHARED_AUDIO=1, see main.ts).
+ * In the default sandboxed renderer every attach returns null/false and
+ * playback stays on the regular output path.
+ *
+ * The spectrum analyzer's snapshot is read the same way but synchronously:
+ * readSpectrum() copies the latest band levels (a few hundred bytes) out
+ * of shared memory, so the visualizer polls it once per animation frame.
+ */
+
+// Message posted to the page once a ring is attached
+export const SHARED_AUDIO_MESSAGE = 'knoux:shared-audio';
+
+export interface SharedAudioInfo {
+  channels: number;
+  sampleRate: number;
+  capacityFrames: number;
+}
+
+interface SharedAudioMirror extends SharedAudioInfo {
+  readonly byteLength: number;
+  start(view: Uint8Array): void;
+  stop(): void;
+}
+
+export interface SpectrumRange {
+  bandCount: number;
+  sampleRate: number;
+  minFrequency: number;
+  maxFrequency: number;
+}
+
+export interface SpectrumData extends SpectrumRange {
+  levels: Float32Array;  // Smoothed band levels, dBFS
+  peaks: Float32Array;   // Held band peaks, dBFS
+}
+
+interface SpectrumReader {
+  read(levels: Float32Array, peaks: Float32Array): number;
+  range(): SpectrumRange;
+}
+
+interface SharedAudioAddon {
+  SharedAudioMirror: new (name: string) => SharedAudioMirror;
+  SpectrumReader: new (name: string) => SpectrumReader;
+}
+
+let sharedAudioAddon: SharedAudioAddon | null | undefined;
+let mirror: SharedAudioMirror | null = null;
+let spectrumReader: SpectrumReader | null = null;
+
+// Matches SpectrumFrame::kMaxBands
+const MAX_SPECTRUM_BANDS = 128;
+const spectrumLevels = new Float32Array(MAX_SPECTRUM_BANDS);
+const spectrumPeaks = new Float32Array(MAX_SPECTRUM_BANDS);
+
+// Loads the addon once; null when it has not been built for this platform
+const loadSharedAudioAddon = (): SharedAudioAddon | null => {
+  if (sharedAudioAddon === undefined && process.sandboxed) {
+    console.info('[SharedAudio] Disabled in the sandboxed renderer (opt in with --enable-shared-audio)');
+    sharedAudioAddon = null;
+  } else if (sharedAudioAddon === undefined) {
+    try {
+      sharedAudioAddon = require('./build/Release/SharedAudio.node') as SharedAudioAddon;
+    } catch (error) {
+      console.warn('[SharedAudio] Native addon not available', error);
+      sharedAudioAddon = null;
+    }
+  }
+  return sharedAudioAddon;
+};
+
+// Stops mirroring; the page's SharedArrayBuffer simply stops advancing
+export const detachSharedAudio = (): void => {
+  mirror?.stop();
+  mirror = null;
+};
+
+// Maps the engine's ring and posts its SharedArrayBuffer mirror to the page; null if unavailable
+export const attachSharedAudio = (name: string): SharedAudioInfo | null => {
+  const addon = loadSharedAudioAddon();
+  if (!addon || typeof SharedArrayBuffer === 'undefined') {
+    return null;
+  }
+
+  detachSharedAudio();
+  try {
+    mirror = new addon.SharedAudioMirror(name);
+  } catch (error) {
+    console.warn('[SharedAudio] Cannot attach to ring', name, error);
+    return null;
+  }
+
+  const buffer = new SharedArrayBuffer(mirror.byteLength);
+  mirror.start(new Uint8Array(buffer));
+  const info: SharedAudioInfo = {
+    channels: mirror.channels,
+    sampleRate: mirror.sampleRate,
+    capacityFrames: mirror.capacityFrames,
+  };
+  // contextBridge cannot pass a SharedArrayBuffer; window messages share it with the page
+  window.postMessage({ type: SHARED_AUDIO_MESSAGE, buffer, ...info }, '*');
+  return info;
+};
+
+// Maps the engine's spectrum snapshot; false if the addon or the snapshot is unavailable
+export const attachSpectrum = (name: string): boolean => {
+  const addon = loadSharedAudioAddon();
+  spectrumReader = null;
+  if (!addon) {
+    return false;
+  }
+  try {
+    spectrumReader = new addon.SpectrumReader(name);
+  } catch (error) {
+    console.warn('[SharedAudio] Cannot attach to spectrum', name, error);
+    return false;
+  }
+  return true;
+};
+
+export const detachSpectrum = (): void => {
+  spectrumReader = null;
+};
+
+// Latest spectrum frame, or null when nothing new was published since the previous call
+export const readSpectrum = (): SpectrumData | null => {
+  const bands = spectrumReader?.read(spectrumLevels, spectrumPeaks) ?? 0;
+  if (!spectrumReader || bands === 0) {
+    return null;
+  }
+  return {
+    ...spectrumReader.range(),
+    levels: spectrumLevels.slice(0, bands),
+    peaks: spectrumPeaks.slice(0, bands),
+  };
+};
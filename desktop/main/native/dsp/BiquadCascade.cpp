@@ -0,0 +1,486 @@
+﻿/**
+ * Project: KNOUX Player X™
+ * Author: knoux
+ * Purpose: Stateful biquad filter cascade with SIMD kernels
+ * Layer: Desktop -> Native -> DSP
+ *
+ * Related Files:
+ * - Interface: BiquadCascade.h
+ * - Usage: DSPProcessor.cpp
+ */
+
+#include "BiquadCascade.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KNOUX_DSP_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define KNOUX_TARGET_AVX2
+#else
+#define KNOUX_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64)
+#define KNOUX_DSP_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+// State below this is inaudible and would soon decay into denormals
+constexpr float kDenormalFloor = 1e-20f;
+
+size_t RoundUp(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+// Reference kernel: one section at a time over the whole span, any channel count
+void CascadeScalar(float* buffer, size_t frames, int channels, size_t sections,
+                   const float* b0, const float* b1, const float* b2, const float* a1, const float* a2,
+                   float* z1, float* z2) {
+    for (size_t k = 0; k < sections; ++k) {
+        for (int c = 0; c < channels; ++c) {
+            const size_t s = k * channels + c;
+            float s1 = z1[s];
+            float s2 = z2[s];
+            float* sample = buffer + c;
+            for (size_t i = 0; i < frames; ++i, sample += channels) {
+                const float x = *sample;
+                const float y = b0[k] * x + s1;
+                s1 = b1[k] * x - a1[k] * y + s2;
+                s2 = b2[k] * x - a2[k] * y;
+                *sample = y;
+            }
+            z1[s] = s1;
+            z2[s] = s2;
+        }
+    }
+}
+
+#ifdef KNOUX_DSP_X86
+
+// Stereo, 2 sections per vector: lanes {k.L, k.R, k+1.L, k+1.R}. At step t
+// section k filters frame t while section k+1 filters frame t-1, taking
+// section k's output from the previous step, so the pair stays in lockstep
+// with the scalar kernel sample for sample.
+void CascadeStereoSse(float* buffer, size_t frames, size_t sections,
+                      const float* b0, const float* b1, const float* b2, const float* a1, const float* a2,
+                      float* z1, float* z2) {
+    for (size_t k = 0; k < sections; k += 2) {
+        const __m128 vb0 = _mm_set_ps(b0[k + 1], b0[k + 1], b0[k], b0[k]);
+        const __m128 vb1 = _mm_set_ps(b1[k + 1], b1[k + 1], b1[k], b1[k]);
+        const __m128 vb2 = _mm_set_ps(b2[k + 1], b2[k + 1], b2[k], b2[k]);
+        const __m128 va1 = _mm_set_ps(a1[k + 1], a1[k + 1], a1[k], a1[k]);
+        const __m128 va2 = _mm_set_ps(a2[k + 1], a2[k + 1], a2[k], a2[k]);
+        __m128 s1 = _mm_loadu_ps(z1 + 2 * k);
+        __m128 s2 = _mm_loadu_ps(z2 + 2 * k);
+        __m128 y = _mm_setzero_ps();
+
+        for (size_t t = 0; t <= frames; ++t) {
+            const __m128 x = t < frames
+                ? _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(buffer + 2 * t))
+                : _mm_setzero_ps();
+            const __m128 in = _mm_movelh_ps(x, y);
+            y = _mm_add_ps(_mm_mul_ps(vb0, in), s1);
+            const __m128 n1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(vb1, in), _mm_mul_ps(va1, y)), s2);
+            const __m128 n2 = _mm_sub_ps(_mm_mul_ps(vb2, in), _mm_mul_ps(va2, y));
+
+            if (t == 0 || t == frames) {
+                // Pipeline fill and drain: only the section holding a real frame advances
+                const int first = t < frames ? -1 : 0;
+                const int second = t > 0 ? -1 : 0;
+                const __m128 active = _mm_castsi128_ps(_mm_set_epi32(second, second, first, first));
+                s1 = _mm_or_ps(_mm_and_ps(active, n1), _mm_andnot_ps(active, s1));
+                s2 = _mm_or_ps(_mm_and_ps(active, n2), _mm_andnot_ps(active, s2));
+            } else {
+                s1 = n1;
+                s2 = n2;
+            }
+
+            if (t > 0) {
+                _mm_storeh_pi(reinterpret_cast<__m64*>(buffer + 2 * (t - 1)), y);
+            }
+        }
+
+        _mm_storeu_ps(z1 + 2 * k, s1);
+        _mm_storeu_ps(z2 + 2 * k, s2);
+    }
+}
+
+// Stereo, 4 sections per vector: section k + p runs p frames behind section k
+KNOUX_TARGET_AVX2
+void CascadeStereoAvx2(float* buffer, size_t frames, size_t sections,
+                       const float* b0, const float* b1, const float* b2, const float* a1, const float* a2,
+                       float* z1, float* z2) {
+    constexpr size_t kLag = 3;
+    const __m256i shift = _mm256_setr_epi32(0, 1, 0, 1, 2, 3, 4, 5);
+
+    for (size_t k = 0; k < sections; k += 4) {
+        const __m256 vb0 = _mm256_setr_ps(b0[k], b0[k], b0[k + 1], b0[k + 1], b0[k + 2], b0[k + 2], b0[k + 3], b0[k + 3]);
+        const __m256 vb1 = _mm256_setr_ps(b1[k], b1[k], b1[k + 1], b1[k + 1], b1[k + 2], b1[k + 2], b1[k + 3], b1[k + 3]);
+        const __m256 vb2 = _mm256_setr_ps(b2[k], b2[k], b2[k + 1], b2[k + 1], b2[k + 2], b2[k + 2], b2[k + 3], b2[k + 3]);
+        const __m256 va1 = _mm256_setr_ps(a1[k], a1[k], a1[k + 1], a1[k + 1], a1[k + 2], a1[k + 2], a1[k + 3], a1[k + 3]);
+        const __m256 va2 = _mm256_setr_ps(a2[k], a2[k], a2[k + 1], a2[k + 1], a2[k + 2], a2[k + 2], a2[k + 3], a2[k + 3]);
+        __m256 s1 = _mm256_loadu_ps(z1 + 2 * k);
+        __m256 s2 = _mm256_loadu_ps(z2 + 2 * k);
+        __m256 y = _mm256_setzero_ps();
+
+        for (size_t t = 0; t < frames + kLag; ++t) {
+            const __m256 x = t < frames
+                ? _mm256_castpd_ps(_mm256_broadcast_sd(reinterpret_cast<const double*>(buffer + 2 * t)))
+                : _mm256_setzero_ps();
+            const __m256 in = _mm256_blend_ps(_mm256_permutevar8x32_ps(y, shift), x, 0x03);
+            y = _mm256_add_ps(_mm256_mul_ps(vb0, in), s1);
+            const __m256 n1 = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(vb1, in), _mm256_mul_ps(va1, y)), s2);
+            const __m256 n2 = _mm256_sub_ps(_mm256_mul_ps(vb2, in), _mm256_mul_ps(va2, y));
+
+            if (t < kLag || t >= frames) {
+                int lanes[4];
+                for (size_t p = 0; p < 4; ++p) {
+                    lanes[p] = (t >= p && t - p < frames) ? -1 : 0;
+                }
+                const __m256 active = _mm256_castsi256_ps(_mm256_setr_epi32(
+                    lanes[0], lanes[0], lanes[1], lanes[1], lanes[2], lanes[2], lanes[3], lanes[3]));
+                s1 = _mm256_blendv_ps(s1, n1, active);
+                s2 = _mm256_blendv_ps(s2, n2, active);
+            } else {
+                s1 = n1;
+                s2 = n2;
+            }
+
+            if (t >= kLag) {
+                _mm_storeh_pi(reinterpret_cast<__m64*>(buffer + 2 * (t - kLag)), _mm256_extractf128_ps(y, 1));
+            }
+        }
+
+        _mm256_storeu_ps(z1 + 2 * k, s1);
+        _mm256_storeu_ps(z2 + 2 * k, s2);
+    }
+}
+
+bool CpuHasAvx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // KNOUX_DSP_X86
+
+#ifdef KNOUX_DSP_NEON
+
+// Same layout and lockstep as the SSE kernel
+void CascadeStereoNeon(float* buffer, size_t frames, size_t sections,
+                       const float* b0, const float* b1, const float* b2, const float* a1, const float* a2,
+                       float* z1, float* z2) {
+    for (size_t k = 0; k < sections; k += 2) {
+        const float cb0[4] = { b0[k], b0[k], b0[k + 1], b0[k + 1] };
+        const float cb1[4] = { b1[k], b1[k], b1[k + 1], b1[k + 1] };
+        const float cb2[4] = { b2[k], b2[k], b2[k + 1], b2[k + 1] };
+        const float ca1[4] = { a1[k], a1[k], a1[k + 1], a1[k + 1] };
+        const float ca2[4] = { a2[k], a2[k], a2[k + 1], a2[k + 1] };
+        const float32x4_t vb0 = vld1q_f32(cb0);
+        const float32x4_t vb1 = vld1q_f32(cb1);
+        const float32x4_t vb2 = vld1q_f32(cb2);
+        const float32x4_t va1 = vld1q_f32(ca1);
+        const float32x4_t va2 = vld1q_f32(ca2);
+        float32x4_t s1 = vld1q_f32(z1 + 2 * k);
+        float32x4_t s2 = vld1q_f32(z2 + 2 * k);
+        float32x4_t y = vdupq_n_f32(0.0f);
+
+        for (size_t t = 0; t <= frames; ++t) {
+            const float32x2_t x = t < frames ? vld1_f32(buffer + 2 * t) : vdup_n_f32(0.0f);
+            const float32x4_t in = vcombine_f32(x, vget_low_f32(y));
+            y = vaddq_f32(vmulq_f32(vb0, in), s1);
+            const float32x4_t n1 = vaddq_f32(vsubq_f32(vmulq_f32(vb1, in), vmulq_f32(va1, y)), s2);
+            const float32x4_t n2 = vsubq_f32(vmulq_f32(vb2, in), vmulq_f32(va2, y));
+
+            if (t == 0 || t == frames) {
+                const uint32_t first = t < frames ? 0xFFFFFFFFu : 0u;
+                const uint32_t second = t > 0 ? 0xFFFFFFFFu : 0u;
+                const uint32_t lanes[4] = { first, first, second, second };
+                const uint32x4_t active = vld1q_u32(lanes);
+                s1 = vbslq_f32(active, n1, s1);
+                s2 = vbslq_f32(active, n2, s2);
+            } else {
+                s1 = n1;
+                s2 = n2;
+            }
+
+            if (t > 0) {
+                vst1_f32(buffer + 2 * (t - 1), vget_high_f32(y));
+            }
+        }
+
+        vst1q_f32(z1 + 2 * k, s1);
+        vst1q_f32(z2 + 2 * k, s2);
+    }
+}
+
+#endif // KNOUX_DSP_NEON
+
+} // namespace
+
+BiquadCascade::BiquadCascade(const std::vector<Band>& bands) {
+    sections.reserve(bands.size());
+    for (const Band& band : bands) {
+        Section section;
+        section.band = band;
+        sections.push_back(section);
+    }
+
+    // Identity padding lets every kernel work in whole groups
+    const size_t padded = RoundUp(std::max<size_t>(sections.size(), 1), 4);
+    b0.assign(padded, 1.0f);
+    b1.assign(padded, 0.0f);
+    b2.assign(padded, 0.0f);
+    a1.assign(padded, 0.0f);
+    a2.assign(padded, 0.0f);
+
+    kernel = DetectKernel();
+    SetFormat(sampleRate, channels);
+}
+
+void BiquadCascade::SetFormat(int rate, int channelCount) {
+    rate = std::max(rate, 1);
+    channelCount = std::max(channelCount, 1);
+    const bool changed = rate != sampleRate || channelCount != channels || z1.empty();
+    sampleRate = rate;
+    channels = channelCount;
+
+    if (changed) {
+        Reset();
+    }
+}
+
+void BiquadCascade::SetGain(size_t band, float gainDb) {
+    if (band >= sections.size()) {
+        return;
+    }
+
+    Section& section = sections[band];
+    if (gainDb == section.targetDb) {
+        return;
+    }
+
+    section.targetDb = gainDb;
+    section.stepDb = (gainDb - section.currentDb) / static_cast<float>(kRampFrames / kRampBlockFrames);
+    rampFramesLeft = kRampFrames;
+    rampBlockOffset = 0;
+}
+
+void BiquadCascade::Process(float* buffer, size_t frames) {
+    if (!buffer || IsBypassed()) {
+        return;
+    }
+
+    while (frames > 0) {
+        if (rampFramesLeft == 0) {
+            Filter(buffer, frames);
+            break;
+        }
+
+        if (rampBlockOffset == 0) {
+            StepRamp();
+        }
+
+        const size_t chunk = std::min(frames, kRampBlockFrames - rampBlockOffset);
+        Filter(buffer, chunk);
+        buffer += chunk * channels;
+        frames -= chunk;
+
+        rampBlockOffset += chunk;
+        if (rampBlockOffset == kRampBlockFrames) {
+            rampBlockOffset = 0;
+            rampFramesLeft -= kRampBlockFrames;
+        }
+    }
+
+    FlushDenormals();
+}
+
+void BiquadCascade::Reset() {
+    z1.assign(b0.size() * channels, 0.0f);
+    z2.assign(b0.size() * channels, 0.0f);
+
+    for (size_t i = 0; i < sections.size(); ++i) {
+        sections[i].currentDb = sections[i].targetDb;
+        sections[i].stepDb = 0.0f;
+        UpdateCoefficients(i);
+    }
+    rampFramesLeft = 0;
+    rampBlockOffset = 0;
+}
+
+void BiquadCascade::SetKernel(Kernel requested) {
+    const Kernel detected = DetectKernel();
+    bool supported = requested == Kernel::Scalar || requested == detected;
+#ifdef KNOUX_DSP_X86
+    // Every x86-64 CPU has SSE2
+    supported = supported || requested == Kernel::Sse;
+#endif
+    kernel = supported ? requested : detected;
+}
+
+bool BiquadCascade::IsBypassed() const {
+    if (rampFramesLeft > 0) {
+        return false;
+    }
+    return std::all_of(sections.begin(), sections.end(),
+                       [](const Section& section) { return section.currentDb == 0.0f; });
+}
+
+BiquadCascade::Coefficients BiquadCascade::Design(const Band& band, float gainDb, int sampleRate) {
+    if (gainDb == 0.0f) {
+        // Exactly flat, so a flat cascade can be bypassed without a seam
+        return Coefficients();
+    }
+
+    // RBJ audio EQ cookbook, computed in double and normalised by a0
+    const double rate = std::max(sampleRate, 1);
+    const double frequency = std::clamp<double>(band.frequency, 1.0, 0.45 * rate);
+    const double w0 = 2.0 * kPi * frequency / rate;
+    const double cosW0 = std::cos(w0);
+    const double alpha = std::sin(w0) / (2.0 * std::max(band.q, 0.01f));
+    const double A = std::pow(10.0, gainDb / 40.0);
+
+    double nb0, nb1, nb2, na0, na1, na2;
+    switch (band.shape) {
+    case Shape::LowShelf: {
+        const double root = 2.0 * std::sqrt(A) * alpha;
+        nb0 = A * ((A + 1) - (A - 1) * cosW0 + root);
+        nb1 = 2 * A * ((A - 1) - (A + 1) * cosW0);
+        nb2 = A * ((A + 1) - (A - 1) * cosW0 - root);
+        na0 = (A + 1) + (A - 1) * cosW0 + root;
+        na1 = -2 * ((A - 1) + (A + 1) * cosW0);
+        na2 = (A + 1) + (A - 1) * cosW0 - root;
+        break;
+    }
+    case Shape::HighShelf: {
+        const double root = 2.0 * std::sqrt(A) * alpha;
+        nb0 = A * ((A + 1) + (A - 1) * cosW0 + root);
+        nb1 = -2 * A * ((A - 1) + (A + 1) * cosW0);
+        nb2 = A * ((A + 1) + (A - 1) * cosW0 - root);
+        na0 = (A + 1) - (A - 1) * cosW0 + root;
+        na1 = 2 * ((A - 1) - (A + 1) * cosW0);
+        na2 = (A + 1) - (A - 1) * cosW0 - root;
+        break;
+    }
+    case Shape::Peak:
+    default:
+        nb0 = 1 + alpha * A;
+        nb1 = -2 * cosW0;
+        nb2 = 1 - alpha * A;
+        na0 = 1 + alpha / A;
+        na1 = -2 * cosW0;
+        na2 = 1 - alpha / A;
+        break;
+    }
+
+    Coefficients c;
+    c.b0 = static_cast<float>(nb0 / na0);
+    c.b1 = static_cast<float>(nb1 / na0);
+    c.b2 = static_cast<float>(nb2 / na0);
+    c.a1 = static_cast<float>(na1 / na0);
+    c.a2 = static_cast<float>(na2 / na0);
+    return c;
+}
+
+BiquadCascade::Kernel BiquadCascade::DetectKernel() {
+#if defined(KNOUX_DSP_X86)
+    static const Kernel detected = CpuHasAvx2() ? Kernel::Avx2 : Kernel::Sse;
+    return detected;
+#elif defined(KNOUX_DSP_NEON)
+    return Kernel::Neon;
+#else
+    return Kernel::Scalar;
+#endif
+}
+
+void BiquadCascade::UpdateCoefficients(size_t index) {
+    const Section& section = sections[index];
+    const Coefficients c = Design(section.band, section.currentDb, sampleRate);
+    b0[index] = c.b0;
+    b1[index] = c.b1;
+    b2[index] = c.b2;
+    a1[index] = c.a1;
+    a2[index] = c.a2;
+}
+
+void BiquadCascade::StepRamp() {
+    const bool lastBlock = rampFramesLeft <= kRampBlockFrames;
+    for (size_t i = 0; i < sections.size(); ++i) {
+        Section& section = sections[i];
+        if (section.currentDb == section.targetDb) {
+            continue;
+        }
+
+        section.currentDb += section.stepDb;
+        const bool overshot = section.stepDb > 0.0f ? section.currentDb >= section.targetDb
+                                                    : section.currentDb <= section.targetDb;
+        if (lastBlock || overshot) {
+            section.currentDb = section.targetDb;
+        }
+        UpdateCoefficients(i);
+    }
+}
+
+void BiquadCascade::Filter(float* buffer, size_t frames) {
+    const size_t count = sections.size();
+    if (channels == 2) {
+        // One or two sections fill an SSE vector; AVX2 would only add identity padding
+        const Kernel selected = (kernel == Kernel::Avx2 && count <= 2) ? Kernel::Sse : kernel;
+        switch (selected) {
+#ifdef KNOUX_DSP_X86
+        case Kernel::Avx2:
+            CascadeStereoAvx2(buffer, frames, RoundUp(count, 4), b0.data(), b1.data(), b2.data(),
+                              a1.data(), a2.data(), z1.data(), z2.data());
+            return;
+        case Kernel::Sse:
+            CascadeStereoSse(buffer, frames, RoundUp(count, 2), b0.data(), b1.data(), b2.data(),
+                             a1.data(), a2.data(), z1.data(), z2.data());
+            return;
+#endif
+#ifdef KNOUX_DSP_NEON
+        case Kernel::Neon:
+            CascadeStereoNeon(buffer, frames, RoundUp(count, 2), b0.data(), b1.data(), b2.data(),
+                              a1.data(), a2.data(), z1.data(), z2.data());
+            return;
+#endif
+        default:
+            break;
+        }
+    }
+
+    CascadeScalar(buffer, frames, channels, count, b0.data(), b1.data(), b2.data(),
+                  a1.data(), a2.data(), z1.data(), z2.data());
+}
+
+void BiquadCascade::FlushDenormals() {
+    for (size_t i = 0; i < z1.size(); ++i) {
+        if (std::fabs(z1[i]) < kDenormalFloor) {
+            z1[i] = 0.0f;
+        }
+        if (std::fabs(z2[i]) < kDenormalFloor) {
+            z2[i] = 0.0f;
+        }
+    }
+}
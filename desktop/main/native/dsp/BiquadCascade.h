@@ -0,0 +1,117 @@
+﻿/**
+ * Project: KNOUX Player X™
+ * Author: knoux
+ * Purpose: Stateful biquad filter cascade with SIMD kernels
+ * Layer: Desktop -> Native -> DSP
+ *
+ * Related Files:
+ * - Implementation: BiquadCascade.cpp
+ * - Usage: DSPProcessor.cpp (tone controls and 10-band EQ)
+ */
+
+#pragma once
+#include <vector>
+#include <cstddef>
+
+// Series of RBJ biquad sections (transposed direct form II) applied to
+// interleaved audio. Filter state persists across Process() calls, so a
+// stream split into arbitrary buffers is filtered exactly as if it were
+// one buffer.
+//
+// Gain changes are not applied at once: Process() glides each section
+// from its current gain to the new one over kRampFrames, recomputing the
+// coefficients every kRampBlockFrames, so moving an EQ slider does not
+// click. Outside a glide the coefficients are not touched.
+//
+// Stereo is vectorized across sections: each vector holds the left and
+// right state of 2 (SSE, NEON) or 4 (AVX2) consecutive sections, with
+// section k+1 running one frame behind section k. Other channel counts,
+// and CPUs without those extensions, use the scalar reference kernel.
+class BiquadCascade {
+public:
+    enum class Shape { Peak, LowShelf, HighShelf };
+
+    enum class Kernel { Auto, Scalar, Sse, Avx2, Neon };
+
+    struct Band {
+        Shape shape;
+        float frequency;  // Centre (peak) or corner (shelf) frequency in Hz
+        float q;
+    };
+
+    // One section normalised by a0; the default is the identity
+    struct Coefficients {
+        float b0 = 1.0f;
+        float b1 = 0.0f;
+        float b2 = 0.0f;
+        float a1 = 0.0f;
+        float a2 = 0.0f;
+    };
+
+    explicit BiquadCascade(const std::vector<Band>& bands);
+
+    // Sample rate and interleaved channel count; clears the filter state when either changes
+    void SetFormat(int rate, int channelCount);
+
+    // Sets the target gain of one section in dB; ignored if unchanged
+    void SetGain(size_t band, float gainDb);
+
+    // Filters interleaved samples in place
+    void Process(float* buffer, size_t frames);
+
+    // Clears the filter state and jumps to the target gains
+    void Reset();
+
+    // Forces a kernel (Scalar gives the reference output); unsupported choices fall back to the detected one
+    void SetKernel(Kernel requested);
+    Kernel GetKernel() const { return kernel; }
+
+    // True when every section is flat and no glide is running
+    bool IsBypassed() const;
+
+    size_t BandCount() const { return sections.size(); }
+
+    // Best kernel this CPU supports
+    static Kernel DetectKernel();
+
+    // RBJ cookbook design of one section; exactly the identity at 0 dB
+    static Coefficients Design(const Band& band, float gainDb, int sampleRate);
+
+    // Gain glide length and coefficient update interval
+    static constexpr size_t kRampFrames = 512;
+    static constexpr size_t kRampBlockFrames = 32;
+
+private:
+    struct Section {
+        Band band;
+        float currentDb = 0.0f;
+        float targetDb = 0.0f;
+        float stepDb = 0.0f;      // Per ramp block
+    };
+
+    // Helper: Recomputes the coefficients of one section from its current gain
+    void UpdateCoefficients(size_t index);
+
+    // Helper: Advances every gliding section by one ramp block
+    void StepRamp();
+
+    // Helper: Runs the selected kernel over a span with fixed coefficients
+    void Filter(float* buffer, size_t frames);
+
+    // Helper: Flushes decayed state to zero before it turns denormal
+    void FlushDenormals();
+
+    std::vector<Section> sections;
+
+    // Coefficients normalised by a0, padded with identity sections to a multiple of 4
+    std::vector<float> b0, b1, b2, a1, a2;
+
+    // State indexed [section * channels + channel]
+    std::vector<float> z1, z2;
+
+    int sampleRate = 48000;
+    int channels = 2;
+    size_t rampFramesLeft = 0;
+    size_t rampBlockOffset = 0;   // Frames processed in the current ramp block
+    Kernel kernel = Kernel::Auto;
+};
@@ -0,0 +1,548 @@
+﻿/**
+ * Project: KNOUX Player X™
+ * Author: knoux
+ * Purpose: N-API addon exposing DSPProcessor streams to Node
+ * Layer: Desktop -> Native -> DSP
+ *
+ * Related Files:
+ * - Build: binding.gyp (target DSPProcessor.node)
+ * - Processing: DSPProcessor.cpp, LoudnessMeter.cpp, Resampler.cpp
+ * - Bridge: dspBridge.ts
+ * - Benchmark: dspAddonBenchmark.js
+ */
+
+#include "DSPProcessor.h"
+#include "LoudnessMeter.h"
+#include <node_api.h>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+// JS surface:
+//
+//   const stream = new DSPStream(sampleRate, channels);
+//   await stream.process(float32Array, config);   // in place, resolves to the same array
+//   stream.setFormat(rate, channels); stream.reset(); stream.setTrackLoudness(lufs);
+//   stream.setOutputRate(rate, quality?); stream.setRateAdjust(factor);
+//   stream.getLoudness();                         // { momentary, shortTerm, integrated, truePeak }
+//   await analyzeLoudness(float32Array, rate, channels);  // { integrated, truePeak }
+//
+// process() works on the caller's ArrayBuffer directly: nothing is copied
+// in or out, and the filter pass runs on the libuv thread pool. The array
+// must not be touched or transferred until the promise settles. With an
+// output rate set, the converted audio no longer fits the input, so the
+// promise resolves to a new Float32Array instead.
+//
+// A stream owns one DSPProcessor, so filter, limiter and loudness state
+// carry over between its buffers. Its calls run one at a time in call
+// order: process() jobs queue behind each other, and setFormat(), reset()
+// and setTrackLoudness() wait for queued jobs before they apply.
+
+namespace {
+
+struct DSPStream;
+
+// One queued call: a filter pass on the thread pool, or a control call run on the JS thread
+struct Job {
+    std::function<void(DSPProcessor&)> run;
+    bool async = false;
+    napi_deferred deferred = nullptr;
+    napi_ref buffer = nullptr;
+    napi_async_work work = nullptr;
+    DSPStream* stream = nullptr;
+
+    // Rate-converted output of a filter pass, resolved instead of the input buffer
+    std::vector<float> output;
+    bool resampled = false;
+};
+
+struct DSPStream {
+    DSPProcessor processor;
+    std::deque<Job*> queue;
+
+    // Held while jobs are queued so the JS object, and with it this stream, outlives them
+    napi_ref self = nullptr;
+
+    // Readings taken on the JS thread after each pass; the meter is not read while a worker runs
+    LoudnessMeter::TrackLoudness loudness = { -INFINITY, -INFINITY };
+    float momentary = -INFINITY;
+    float shortTerm = -INFINITY;
+};
+
+// Helper: Throws a JS error for a failed call; true if the call succeeded
+bool Check(napi_env env, napi_status status, const char* what) {
+    if (status == napi_ok) {
+        return true;
+    }
+    bool pending = false;
+    napi_is_exception_pending(env, &pending);
+    if (!pending) {
+        napi_throw_error(env, nullptr, what);
+    }
+    return false;
+}
+
+bool GetNumber(napi_env env, napi_value value, double& number) {
+    return napi_get_value_double(env, value, &number) == napi_ok;
+}
+
+// Helper: Reads an optional numeric property, leaving fallback if absent
+float GetNumberProperty(napi_env env, napi_value object, const char* name, float fallback) {
+    napi_value value;
+    double number = 0.0;
+    if (napi_get_named_property(env, object, name, &value) != napi_ok || !GetNumber(env, value, number)) {
+        return fallback;
+    }
+    return static_cast<float>(number);
+}
+
+// Helper: Converts a JS DSPConfig ({ gain, bass, treble, normalize, customEq })
+bool ReadConfig(napi_env env, napi_value object, DSPConfig& config) {
+    napi_valuetype type;
+    if (napi_typeof(env, object, &type) != napi_ok || type != napi_object) {
+        napi_throw_type_error(env, nullptr, "config must be an object");
+        return false;
+    }
+
+    config.gain = GetNumberProperty(env, object, "gain", 1.0f);
+    config.bass = GetNumberProperty(env, object, "bass", 0.0f);
+    config.treble = GetNumberProperty(env, object, "treble", 0.0f);
+
+    napi_value value;
+    bool flag = false;
+    config.normalize = napi_get_named_property(env, object, "normalize", &value) == napi_ok &&
+                       napi_get_value_bool(env, value, &flag) == napi_ok && flag;
+
+    config.customEq.clear();
+    bool isArray = false;
+    if (napi_get_named_property(env, object, "customEq", &value) == napi_ok &&
+        napi_is_array(env, value, &isArray) == napi_ok && isArray) {
+        uint32_t length = 0;
+        napi_get_array_length(env, value, &length);
+        for (uint32_t i = 0; i < length && i < static_cast<uint32_t>(DSPProcessor::kEqBands); ++i) {
+            napi_value element;
+            double gain = 0.0;
+            napi_get_element(env, value, i, &element);
+            config.customEq.push_back(GetNumber(env, element, gain) ? static_cast<float>(gain) : 0.0f);
+        }
+    }
+    return true;
+}
+
+// Helper: Returns the samples of a Float32Array without copying them
+bool GetFloat32Array(napi_env env, napi_value value, float*& data, size_t& length) {
+    bool isTypedArray = false;
+    napi_typedarray_type type;
+    void* raw = nullptr;
+    if (napi_is_typedarray(env, value, &isTypedArray) != napi_ok || !isTypedArray ||
+        napi_get_typedarray_info(env, value, &type, &length, &raw, nullptr, nullptr) != napi_ok ||
+        type != napi_float32_array) {
+        napi_throw_type_error(env, nullptr, "buffer must be a Float32Array");
+        return false;
+    }
+    data = static_cast<float*>(raw);
+    return true;
+}
+
+napi_value MakeNumber(napi_env env, double number) {
+    napi_value value;
+    napi_create_double(env, number, &value);
+    return value;
+}
+
+DSPStream* Unwrap(napi_env env, napi_callback_info info, size_t& argc, napi_value* argv) {
+    napi_value self;
+    void* stream = nullptr;
+    if (!Check(env, napi_get_cb_info(env, info, &argc, argv, &self, nullptr), "invalid call") ||
+        !Check(env, napi_unwrap(env, self, &stream), "not a DSPStream")) {
+        return nullptr;
+    }
+    return static_cast<DSPStream*>(stream);
+}
+
+void StartNext(napi_env env, DSPStream* stream);
+
+void ExecuteJob(napi_env, void* data) {
+    Job* job = static_cast<Job*>(data);
+    job->run(job->stream->processor);
+}
+
+void CompleteJob(napi_env env, napi_status status, void* data) {
+    Job* job = static_cast<Job*>(data);
+    DSPStream* stream = job->stream;
+
+    const LoudnessMeter& meter = stream->processor.GetLoudnessMeter();
+    stream->momentary = meter.GetMomentary();
+    stream->shortTerm = meter.GetShortTerm();
+    stream->loudness = { meter.GetIntegrated(), meter.GetTruePeak() };
+
+    napi_value buffer;
+    napi_get_reference_value(env, job->buffer, &buffer);
+    if (status == napi_ok && job->resampled) {
+        void* data = nullptr;
+        napi_value arrayBuffer;
+        napi_create_arraybuffer(env, job->output.size() * sizeof(float), &data, &arrayBuffer);
+        if (!job->output.empty()) {
+            std::memcpy(data, job->output.data(), job->output.size() * sizeof(float));
+        }
+        napi_create_typedarray(env, napi_float32_array, job->output.size(), arrayBuffer, 0, &buffer);
+    }
+    if (status == napi_ok) {
+        napi_resolve_deferred(env, job->deferred, buffer);
+    } else {
+        napi_value message;
+        napi_value error;
+        napi_create_string_utf8(env, "DSP processing was cancelled", NAPI_AUTO_LENGTH, &message);
+        napi_create_error(env, nullptr, message, &error);
+        napi_reject_deferred(env, job->deferred, error);
+    }
+    napi_delete_reference(env, job->buffer);
+    napi_delete_async_work(env, job->work);
+
+    stream->queue.pop_front();
+    delete job;
+    StartNext(env, stream);
+}
+
+// Runs queued control calls until the next filter pass, which goes to the thread pool
+void StartNext(napi_env env, DSPStream* stream) {
+    while (!stream->queue.empty()) {
+        Job* job = stream->queue.front();
+        if (job->async) {
+            napi_queue_async_work(env, job->work);
+            return;
+        }
+        job->run(stream->processor);
+        stream->queue.pop_front();
+        delete job;
+    }
+    uint32_t count = 0;
+    napi_reference_unref(env, stream->self, &count);
+}
+
+// Helper: Appends a job, taking the stream reference when the queue was idle
+void Enqueue(napi_env env, DSPStream* stream, Job* job) {
+    const bool idle = stream->queue.empty();
+    stream->queue.push_back(job);
+    if (!idle) {
+        return;
+    }
+    uint32_t count = 0;
+    napi_reference_ref(env, stream->self, &count);
+    StartNext(env, stream);
+}
+
+// Helper: Control calls apply at once on an idle stream, otherwise after the queued jobs
+void RunControl(napi_env env, DSPStream* stream, std::function<void(DSPProcessor&)> run) {
+    if (stream->queue.empty()) {
+        run(stream->processor);
+        return;
+    }
+    Job* job = new Job();
+    job->run = std::move(run);
+    job->stream = stream;
+    Enqueue(env, stream, job);
+}
+
+void FinalizeStream(napi_env env, void* data, void*) {
+    DSPStream* stream = static_cast<DSPStream*>(data);
+    napi_delete_reference(env, stream->self);
+    delete stream;
+}
+
+// new DSPStream(sampleRate = 48000, channels = 2)
+napi_value StreamConstructor(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value argv[2];
+    napi_value self;
+    if (!Check(env, napi_get_cb_info(env, info, &argc, argv, &self, nullptr), "invalid call")) {
+        return nullptr;
+    }
+
+    double rate = 48000.0;
+    double channels = 2.0;
+    if ((argc > 0 && !GetNumber(env, argv[0], rate)) || (argc > 1 && !GetNumber(env, argv[1], channels))) {
+        napi_throw_type_error(env, nullptr, "sampleRate and channels must be numbers");
+        return nullptr;
+    }
+
+    DSPStream* stream = new DSPStream();
+    stream->processor.SetFormat(static_cast<int>(rate), static_cast<int>(channels));
+    if (!Check(env, napi_wrap(env, self, stream, FinalizeStream, nullptr, nullptr), "cannot wrap DSPStream")) {
+        delete stream;
+        return nullptr;
+    }
+    // Weak until jobs are queued
+    napi_create_reference(env, self, 0, &stream->self);
+    return self;
+}
+
+// stream.process(buffer: Float32Array, config): Promise<Float32Array>
+napi_value StreamProcess(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value argv[2];
+    DSPStream* stream = Unwrap(env, info, argc, argv);
+    if (!stream) {
+        return nullptr;
+    }
+    if (argc < 2) {
+        napi_throw_type_error(env, nullptr, "process(buffer, config) expects two arguments");
+        return nullptr;
+    }
+
+    float* data = nullptr;
+    size_t length = 0;
+    DSPConfig config;
+    if (!GetFloat32Array(env, argv[0], data, length) || !ReadConfig(env, argv[1], config)) {
+        return nullptr;
+    }
+
+    Job* job = new Job();
+    job->async = true;
+    job->stream = stream;
+    job->run = [job, data, length, config](DSPProcessor& processor) {
+        if (!processor.IsResampling()) {
+            processor.ProcessBuffer(data, length, config);
+            return;
+        }
+        job->output.resize(processor.MaxOutputLength(length));
+        job->output.resize(processor.ProcessBuffer(data, length, job->output.data(), config));
+        job->resampled = true;
+    };
+
+    napi_value promise;
+    napi_value name;
+    napi_create_string_utf8(env, "DSPStream.process", NAPI_AUTO_LENGTH, &name);
+    if (!Check(env, napi_create_promise(env, &job->deferred, &promise), "cannot create promise") ||
+        !Check(env, napi_create_reference(env, argv[0], 1, &job->buffer), "cannot reference buffer") ||
+        !Check(env, napi_create_async_work(env, nullptr, name, ExecuteJob, CompleteJob, job, &job->work),
+               "cannot create async work")) {
+        if (job->buffer) {
+            napi_delete_reference(env, job->buffer);
+        }
+        delete job;
+        return nullptr;
+    }
+
+    Enqueue(env, stream, job);
+    return promise;
+}
+
+// stream.setFormat(sampleRate, channels)
+napi_value StreamSetFormat(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value argv[2];
+    DSPStream* stream = Unwrap(env, info, argc, argv);
+    double rate = 0.0;
+    double channels = 0.0;
+    if (!stream) {
+        return nullptr;
+    }
+    if (argc < 2 || !GetNumber(env, argv[0], rate) || !GetNumber(env, argv[1], channels)) {
+        napi_throw_type_error(env, nullptr, "setFormat(sampleRate, channels) expects two numbers");
+        return nullptr;
+    }
+    RunControl(env, stream, [rate, channels](DSPProcessor& processor) {
+        processor.SetFormat(static_cast<int>(rate), static_cast<int>(channels));
+    });
+    return nullptr;
+}
+
+// stream.reset()
+napi_value StreamReset(napi_env env, napi_callback_info info) {
+    size_t argc = 0;
+    DSPStream* stream = Unwrap(env, info, argc, nullptr);
+    if (stream) {
+        RunControl(env, stream, [](DSPProcessor& processor) { processor.Reset(); });
+    }
+    return nullptr;
+}
+
+// stream.setTrackLoudness(lufs?: number); omit or NaN to measure while playing
+napi_value StreamSetTrackLoudness(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value argv[1];
+    DSPStream* stream = Unwrap(env, info, argc, argv);
+    if (!stream) {
+        return nullptr;
+    }
+    double lufs = NAN;
+    if (argc > 0) {
+        GetNumber(env, argv[0], lufs);
+    }
+    RunControl(env, stream, [lufs](DSPProcessor& processor) {
+        processor.SetTrackLoudness(static_cast<float>(lufs));
+    });
+    return nullptr;
+}
+
+// stream.setOutputRate(rate, quality?: 'fast' | 'balanced' | 'high'); 0 turns conversion off
+napi_value StreamSetOutputRate(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value argv[2];
+    DSPStream* stream = Unwrap(env, info, argc, argv);
+    double rate = 0.0;
+    if (!stream) {
+        return nullptr;
+    }
+    if (argc < 1 || !GetNumber(env, argv[0], rate) || rate < 0.0) {
+        napi_throw_type_error(env, nullptr, "setOutputRate(rate, quality) expects a rate in Hz");
+        return nullptr;
+    }
+
+    Resampler::Quality quality = Resampler::Quality::Balanced;
+    char name[16] = "";
+    size_t nameLength = 0;
+    if (argc > 1 && napi_get_value_string_utf8(env, argv[1], name, sizeof(name), &nameLength) == napi_ok) {
+        const std::string requested(name, nameLength);
+        if (requested == "fast") {
+            quality = Resampler::Quality::Fast;
+        } else if (requested == "high") {
+            quality = Resampler::Quality::High;
+        }
+    }
+    RunControl(env, stream, [rate, quality](DSPProcessor& processor) {
+        processor.SetOutputRate(static_cast<int>(rate), quality);
+    });
+    return nullptr;
+}
+
+// stream.setRateAdjust(factor): drift correction, input consumed per output frame scales by factor
+napi_value StreamSetRateAdjust(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value argv[1];
+    DSPStream* stream = Unwrap(env, info, argc, argv);
+    double factor = 1.0;
+    if (!stream) {
+        return nullptr;
+    }
+    if (argc < 1 || !GetNumber(env, argv[0], factor)) {
+        napi_throw_type_error(env, nullptr, "setRateAdjust(factor) expects a number");
+        return nullptr;
+    }
+    RunControl(env, stream, [factor](DSPProcessor& processor) { processor.SetResampleRatioAdjust(factor); });
+    return nullptr;
+}
+
+// stream.getLoudness(): readings as of the last completed process()
+napi_value StreamGetLoudness(napi_env env, napi_callback_info info) {
+    size_t argc = 0;
+    DSPStream* stream = Unwrap(env, info, argc, nullptr);
+    if (!stream) {
+        return nullptr;
+    }
+    napi_value result;
+    napi_create_object(env, &result);
+    napi_set_named_property(env, result, "momentary", MakeNumber(env, stream->momentary));
+    napi_set_named_property(env, result, "shortTerm", MakeNumber(env, stream->shortTerm));
+    napi_set_named_property(env, result, "integrated", MakeNumber(env, stream->loudness.integrated));
+    napi_set_named_property(env, result, "truePeak", MakeNumber(env, stream->loudness.truePeak));
+    return result;
+}
+
+// Batch loudness analysis of a whole decoded track
+struct AnalyzeJob {
+    napi_deferred deferred = nullptr;
+    napi_ref buffer = nullptr;
+    napi_async_work work = nullptr;
+    const float* data = nullptr;
+    size_t frames = 0;
+    int rate = 0;
+    int channels = 0;
+    LoudnessMeter::TrackLoudness result = { -INFINITY, -INFINITY };
+};
+
+void ExecuteAnalyze(napi_env, void* data) {
+    AnalyzeJob* job = static_cast<AnalyzeJob*>(data);
+    job->result = LoudnessMeter::Analyze(job->data, job->frames, job->rate, job->channels);
+}
+
+void CompleteAnalyze(napi_env env, napi_status, void* data) {
+    AnalyzeJob* job = static_cast<AnalyzeJob*>(data);
+    napi_value result;
+    napi_create_object(env, &result);
+    napi_set_named_property(env, result, "integrated", MakeNumber(env, job->result.integrated));
+    napi_set_named_property(env, result, "truePeak", MakeNumber(env, job->result.truePeak));
+    napi_resolve_deferred(env, job->deferred, result);
+    napi_delete_reference(env, job->buffer);
+    napi_delete_async_work(env, job->work);
+    delete job;
+}
+
+// analyzeLoudness(buffer: Float32Array, sampleRate, channels): Promise<{ integrated, truePeak }>
+napi_value AnalyzeLoudness(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value argv[3];
+    if (!Check(env, napi_get_cb_info(env, info, &argc, argv, nullptr, nullptr), "invalid call")) {
+        return nullptr;
+    }
+
+    float* data = nullptr;
+    size_t length = 0;
+    double rate = 0.0;
+    double channels = 0.0;
+    if (argc < 3 || !GetFloat32Array(env, argv[0], data, length)) {
+        if (argc < 3) {
+            napi_throw_type_error(env, nullptr, "analyzeLoudness(buffer, sampleRate, channels) expects three arguments");
+        }
+        return nullptr;
+    }
+    if (!GetNumber(env, argv[1], rate) || !GetNumber(env, argv[2], channels) || channels < 1.0) {
+        napi_throw_type_error(env, nullptr, "sampleRate and channels must be positive numbers");
+        return nullptr;
+    }
+
+    AnalyzeJob* job = new AnalyzeJob();
+    job->data = data;
+    job->rate = static_cast<int>(rate);
+    job->channels = static_cast<int>(channels);
+    job->frames = length / static_cast<size_t>(job->channels);
+
+    napi_value promise;
+    napi_value name;
+    napi_create_string_utf8(env, "analyzeLoudness", NAPI_AUTO_LENGTH, &name);
+    if (!Check(env, napi_create_promise(env, &job->deferred, &promise), "cannot create promise") ||
+        !Check(env, napi_create_reference(env, argv[0], 1, &job->buffer), "cannot reference buffer") ||
+        !Check(env, napi_create_async_work(env, nullptr, name, ExecuteAnalyze, CompleteAnalyze, job, &job->work),
+               "cannot create async work")) {
+        if (job->buffer) {
+            napi_delete_reference(env, job->buffer);
+        }
+        delete job;
+        return nullptr;
+    }
+    napi_queue_async_work(env, job->work);
+    return promise;
+}
+
+napi_value Init(napi_env env, napi_value exports) {
+    const napi_property_descriptor methods[] = {
+        { "process", nullptr, StreamProcess, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "setFormat", nullptr, StreamSetFormat, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "reset", nullptr, StreamReset, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "setTrackLoudness", nullptr, StreamSetTrackLoudness, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "getLoudness", nullptr, StreamGetLoudness, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "setOutputRate", nullptr, StreamSetOutputRate, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "setRateAdjust", nullptr, StreamSetRateAdjust, nullptr, nullptr, nullptr, napi_default, nullptr },
+    };
+
+    napi_value constructor;
+    if (!Check(env, napi_define_class(env, "DSPStream", NAPI_AUTO_LENGTH, StreamConstructor, nullptr,
+                                      sizeof(methods) / sizeof(methods[0]), methods, &constructor),
+               "cannot define DSPStream")) {
+        return nullptr;
+    }
+
+    napi_value analyze;
+    napi_create_function(env, "analyzeLoudness", NAPI_AUTO_LENGTH, AnalyzeLoudness, nullptr, &analyze);
+    napi_set_named_property(env, exports, "DSPStream", constructor);
+    napi_set_named_property(env, exports, "analyzeLoudness", analyze);
+    return exports;
+}
+
+} // namespace
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, Init)
@@ -0,0 +1,193 @@
+﻿/**
+ * Project: KNOUX Player X™
+ * Author: knoux
+ * Purpose: Compile-time composed DSP stage chains
+ * Layer: Desktop -> Native -> DSP
+ *
+ * Related Files:
+ * - Usage: audio_dsp.cpp
+ * - Benchmark: dsp_chain_benchmark.cpp
+ */
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// A chain is a list of stage types. For every subset of the stages a
+// separate Run() is instantiated, with disabled stages removed from the
+// type list, and DSPChainTable maps the enabled-stage bitmask (bit i =
+// i-th stage) to it. Picking the chain is one table lookup per buffer;
+// the sample loop contains only the enabled stages and no checks.
+//
+// A stage is constructed from the chain context at the start of a run,
+// so its working set (gains, coefficients, filter state) sits in locals
+// the compiler can keep in registers, and it writes state back in
+// Finish(). Per-sample stages do their work in Tick(); block stages
+// (whole-buffer passes such as SIMD filters or normalization) leave
+// Tick() to DSPStage and work in Finish(). All per-sample stages of a
+// run are fused into one loop, followed by the block stages in order.
+// A per-sample stage with kFrameTick takes a whole frame in TickFrame()
+// instead, one sample per channel, so it can work on the channels
+// together (a stereo pair in one SIMD register); it needs a compile-time
+// Channels:
+//
+//   struct Gain : DSPStage {
+//       static constexpr bool kPerSample = true;
+//       explicit Gain(Context& context) : gain(context.gain) {}
+//       float Tick(float x, int) { return x * gain; }
+//       float gain;
+//   };
+
+// No-op defaults for stages
+struct DSPStage {
+    static constexpr bool kPerSample = false;
+    static constexpr bool kFrameTick = false;
+
+    float Tick(float x, int) { return x; }
+
+    template <typename Context>
+    void Finish(Context&, float*, size_t, int) {}
+};
+
+template <typename... Stages>
+struct DSPStageList {};
+
+namespace dsp_chain_detail {
+
+// Keeps the stages whose bit is set in Mask, bits counted from Index
+template <unsigned Mask, unsigned Index, typename Kept, typename... Rest>
+struct Filter {
+    using Type = Kept;
+};
+
+template <unsigned Mask, unsigned Index, typename... Kept, typename First, typename... Rest>
+struct Filter<Mask, Index, DSPStageList<Kept...>, First, Rest...> {
+    using Next = std::conditional_t<(Mask & (1u << Index)) != 0, DSPStageList<Kept..., First>, DSPStageList<Kept...>>;
+    using Type = typename Filter<Mask, Index + 1, Next, Rest...>::Type;
+};
+
+// True if no per-sample stage follows a block stage
+template <typename... Stages>
+struct BlockStagesLast : std::true_type {};
+
+template <typename First, typename Second, typename... Rest>
+struct BlockStagesLast<First, Second, Rest...>
+    : std::bool_constant<(First::kPerSample || !Second::kPerSample) && BlockStagesLast<Second, Rest...>::value> {};
+
+// One frame through one stage: TickFrame() if it takes frames, else Tick() per channel
+template <int Channels, typename Stage>
+inline void TickFrame(Stage& stage, float* frame) {
+    if constexpr (Stage::kFrameTick) {
+        stage.TickFrame(frame);
+    } else {
+        for (int ch = 0; ch < Channels; ++ch) {
+            frame[ch] = stage.Tick(frame[ch], ch);
+        }
+    }
+}
+
+} // namespace dsp_chain_detail
+
+// Runs one fixed list of stages. Channels is the interleave factor, or 0 to take it at runtime.
+template <typename Context, int Channels, typename List>
+struct DSPChain;
+
+template <typename Context, int Channels, typename... Stages>
+struct DSPChain<Context, Channels, DSPStageList<Stages...>> {
+    static void Run(Context& context, const float* input, float* output, size_t frames, int channels) {
+        const size_t width = Channels > 0 ? static_cast<size_t>(Channels) : static_cast<size_t>(channels);
+        std::tuple<Stages...> stages{ Stages(context)... };
+
+        if constexpr ((Stages::kFrameTick || ... || false)) {
+            static_assert(Channels > 0, "frame stages need a compile-time channel count");
+            for (size_t f = 0; f < frames; ++f) {
+                float frame[Channels];
+                std::memcpy(frame, input + f * Channels, sizeof(frame));
+                std::apply([&](auto&... stage) { (dsp_chain_detail::TickFrame<Channels>(stage, frame), ...); }, stages);
+                std::memcpy(output + f * Channels, frame, sizeof(frame));
+            }
+        } else if constexpr ((Stages::kPerSample || ... || false)) {
+            for (size_t f = 0; f < frames; ++f) {
+                for (size_t ch = 0; ch < width; ++ch) {
+                    float x = input[f * width + ch];
+                    std::apply([&](auto&... stage) { ((x = stage.Tick(x, static_cast<int>(ch))), ...); }, stages);
+                    output[f * width + ch] = x;
+                }
+            }
+        } else if (input != output) {
+            std::memcpy(output, input, frames * width * sizeof(float));
+        }
+
+        std::apply([&](auto&... stage) { (stage.Finish(context, output, frames, static_cast<int>(width)), ...); }, stages);
+    }
+};
+
+// Pre-instantiated chains for every subset of Stages
+template <typename Context, int Channels, typename... Stages>
+class DSPChainTable {
+public:
+    static_assert(sizeof...(Stages) <= 8, "a chain table holds 2^stages instantiations");
+    static_assert(dsp_chain_detail::BlockStagesLast<Stages...>::value,
+                  "block stages run after the fused sample loop, so they must come last");
+
+    using Function = void (*)(Context&, const float*, float*, size_t, int);
+
+    static constexpr unsigned kStageCount = sizeof...(Stages);
+    static constexpr unsigned kAllStages = (1u << sizeof...(Stages)) - 1;
+
+    // Chain containing exactly the stages whose bits are set
+    static Function Select(unsigned mask) {
+        return kTable[mask & kAllStages];
+    }
+
+    // Reference: every stage in the loop, each checking its bit per sample. With no stage
+    // enabled both paths copy, so the two differ only in dispatch
+    static void RunDynamic(unsigned mask, Context& context, const float* input, float* output, size_t frames, int channels) {
+        if ((mask & kAllStages) == 0) {
+            Select(0)(context, input, output, frames, channels);
+            return;
+        }
+        RunDynamic(mask, context, input, output, frames, channels, std::index_sequence_for<Stages...>());
+    }
+
+private:
+    template <size_t... Masks>
+    static constexpr std::array<Function, sizeof...(Masks)> Build(std::index_sequence<Masks...>) {
+        return { { &DSPChain<Context, Channels,
+                             typename dsp_chain_detail::Filter<Masks, 0, DSPStageList<>, Stages...>::Type>::Run... } };
+    }
+
+    template <size_t... Index>
+    static void RunDynamic(unsigned mask, Context& context, const float* input, float* output, size_t frames, int channels,
+                           std::index_sequence<Index...>) {
+        const size_t width = Channels > 0 ? static_cast<size_t>(Channels) : static_cast<size_t>(channels);
+        std::tuple<Stages...> stages{ Stages(context)... };
+
+        if constexpr ((Stages::kFrameTick || ... || false)) {
+            static_assert(Channels > 0, "frame stages need a compile-time channel count");
+            for (size_t f = 0; f < frames; ++f) {
+                float frame[Channels];
+                std::memcpy(frame, input + f * Channels, sizeof(frame));
+                ((void)((mask & (1u << Index)) && (dsp_chain_detail::TickFrame<Channels>(std::get<Index>(stages), frame), true)), ...);
+                std::memcpy(output + f * Channels, frame, sizeof(frame));
+            }
+        } else {
+            for (size_t f = 0; f < frames; ++f) {
+                for (size_t ch = 0; ch < width; ++ch) {
+                    float x = input[f * width + ch];
+                    ((x = (mask & (1u << Index)) ? std::get<Index>(stages).Tick(x, static_cast<int>(ch)) : x), ...);
+                    output[f * width + ch] = x;
+                }
+            }
+        }
+
+        ((void)((mask & (1u << Index)) && (std::get<Index>(stages).Finish(context, output, frames, static_cast<int>(width)), true)), ...);
+    }
+
+    static constexpr std::array<Function, (1u << sizeof...(Stages))> kTable =
+        Build(std::make_index_sequence<(1u << sizeof...(Stages))>());
+};
@@ -0,0 +1,265 @@
+﻿/**
+ * Project: KNOUX Player X™
+ * Author: knoux
+ * Purpose: Audio DSP Processing Engine Implementation
+ * Layer: Desktop -> Native -> DSP
+ *
+ * Related Files:
+ * - Interface: DSPProcessor.h
+ * - Filters: BiquadCascade.cpp
+ * - Normalization: LoudnessMeter.cpp, LookaheadLimiter.cpp
+ * - Rate conversion: Resampler.cpp
+ * - Bridge: dspBridge.ts
+ */
+
+#include "DSPProcessor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Shelf corners and slopes for the tone controls
+constexpr float kBassFrequency = 100.0f;
+constexpr float kTrebleFrequency = 8000.0f;
+constexpr float kShelfQ = 0.7071f;
+
+// One-octave peaking bands
+constexpr float kEqQ = 1.414f;
+
+// Tone and EQ gain limits in dB
+constexpr float kToneRangeDb = 10.0f;
+constexpr float kEqRangeDb = 12.0f;
+
+// Normalizer: gain limits, how fast a measured gain may move, and the true-peak ceiling
+constexpr float kNormalizeMaxBoostDb = 12.0f;
+constexpr float kNormalizeMaxCutDb = 24.0f;
+constexpr float kNormalizeSlewDbPerSecond = 2.0f;
+constexpr float kLimiterCeilingDb = -1.0f;
+
+// Crossfade between the dry and limited signal when normalization is toggled
+constexpr float kNormalizeFadeSeconds = 0.01f;
+
+std::vector<BiquadCascade::Band> EqBands() {
+    std::vector<BiquadCascade::Band> bands;
+    for (float frequency : DSPProcessor::kEqFrequencies) {
+        bands.push_back({ BiquadCascade::Shape::Peak, frequency, kEqQ });
+    }
+    return bands;
+}
+
+} // namespace
+
+DSPProcessor::DSPProcessor()
+    : bassFilter({ { BiquadCascade::Shape::LowShelf, kBassFrequency, kShelfQ } }),
+      trebleFilter({ { BiquadCascade::Shape::HighShelf, kTrebleFrequency, kShelfQ } }),
+      eqFilter(EqBands()),
+      sampleRate(48000),
+      channels(2),
+      trackLoudness(std::nanf("")),
+      normalizeGainDb(0.0f),
+      normalizeMix(0.0f),
+      normalizeWarmup(0),
+      outputRate(0),
+      resampleQuality(Resampler::Quality::Balanced) {
+    limiter.SetCeiling(std::pow(10.0f, kLimiterCeilingDb / 20.0f));
+    InitializeFilters();
+}
+
+DSPProcessor::~DSPProcessor() {
+}
+
+void DSPProcessor::SetFormat(int rate, int channelCount) {
+    sampleRate = std::max(rate, 1);
+    channels = std::max(channelCount, 1);
+    InitializeFilters();
+}
+
+void DSPProcessor::Reset() {
+    bassFilter.Reset();
+    trebleFilter.Reset();
+    eqFilter.Reset();
+    limiter.Reset();
+    resampler.Reset();
+}
+
+void DSPProcessor::SetTrackLoudness(float integratedLufs) {
+    trackLoudness = integratedLufs;
+    loudnessMeter.Reset();
+    limiter.Reset();
+    normalizeGainDb = std::isnan(integratedLufs) ? 0.0f
+        : Clamp(kNormalizeTargetLufs - integratedLufs, -kNormalizeMaxCutDb, kNormalizeMaxBoostDb);
+}
+
+void DSPProcessor::ProcessBuffer(float* buffer, size_t length, const DSPConfig& config) {
+    if (!buffer || length == 0) {
+        return;
+    }
+
+    // Filters run per frame; drop a trailing partial frame rather than split it
+    length -= length % static_cast<size_t>(channels);
+
+    // Metered as decoded, ahead of the user's tone and gain, so the live reading
+    // matches the one LoudnessMeter::Analyze caches for SetTrackLoudness()
+    if (config.normalize) {
+        MeterLoudness(buffer, length);
+    }
+    ApplyBassBoost(buffer, length, config.bass);
+    ApplyTrebleBoost(buffer, length, config.treble);
+    if (!config.customEq.empty()) {
+        ApplyCustomEQ(buffer, length, config.customEq);
+    }
+    ApplyGain(buffer, length, config.gain);
+    if (config.normalize || normalizeMix > 0.0f) {
+        Normalize(buffer, length, config.normalize);
+    }
+}
+
+void DSPProcessor::SetOutputRate(int rate, Resampler::Quality quality) {
+    outputRate = std::max(rate, 0);
+    resampleQuality = quality;
+    ConfigureResampler();
+}
+
+void DSPProcessor::SetResampleRatioAdjust(double factor) {
+    resampler.SetRatioAdjust(factor);
+}
+
+size_t DSPProcessor::MaxOutputLength(size_t length) const {
+    if (!IsResampling()) {
+        return length;
+    }
+    return resampler.MaxOutputFrames(length / channels) * channels;
+}
+
+size_t DSPProcessor::ProcessBuffer(float* buffer, size_t length, float* output, const DSPConfig& config) {
+    if (!buffer || !output || length == 0) {
+        return 0;
+    }
+
+    length -= length % static_cast<size_t>(channels);
+    ProcessBuffer(buffer, length, config);
+    if (!IsResampling()) {
+        std::memcpy(output, buffer, length * sizeof(float));
+        return length;
+    }
+    return resampler.Process(buffer, length / channels, output) * channels;
+}
+
+void DSPProcessor::ApplyGain(float* buffer, size_t length, float gain) {
+    gain = Clamp(gain, 0.0f, 2.0f);
+    if (gain == 1.0f) {
+        return;
+    }
+
+    for (size_t i = 0; i < length; ++i) {
+        buffer[i] *= gain;
+    }
+}
+
+void DSPProcessor::ApplyBassBoost(float* buffer, size_t length, float bassDb) {
+    bassFilter.SetGain(0, Clamp(bassDb, -kToneRangeDb, kToneRangeDb));
+    bassFilter.Process(buffer, length / channels);
+}
+
+void DSPProcessor::ApplyTrebleBoost(float* buffer, size_t length, float trebleDb) {
+    trebleFilter.SetGain(0, Clamp(trebleDb, -kToneRangeDb, kToneRangeDb));
+    trebleFilter.Process(buffer, length / channels);
+}
+
+void DSPProcessor::ApplyNormalize(float* buffer, size_t length) {
+    MeterLoudness(buffer, length);
+    Normalize(buffer, length, true);
+}
+
+void DSPProcessor::MeterLoudness(const float* buffer, size_t length) {
+    if (std::isnan(trackLoudness)) {
+        loudnessMeter.Process(buffer, length / channels);
+    }
+}
+
+void DSPProcessor::Normalize(float* buffer, size_t length, bool enabled) {
+    const size_t frames = length / channels;
+    const float startDb = normalizeGainDb;
+
+    if (enabled && std::isnan(trackLoudness)) {
+        // Follow the integrated loudness, which settles as the track plays; the
+        // slew limit keeps early estimates from moving the level audibly
+        const float integrated = loudnessMeter.GetIntegrated();
+        if (!std::isinf(integrated)) {
+            const float targetDb = Clamp(kNormalizeTargetLufs - integrated, -kNormalizeMaxCutDb, kNormalizeMaxBoostDb);
+            const float maxStep = kNormalizeSlewDbPerSecond * static_cast<float>(frames) / sampleRate;
+            normalizeGainDb += Clamp(targetDb - normalizeGainDb, -maxStep, maxStep);
+        }
+    }
+
+    const float startGain = std::pow(10.0f, startDb / 20.0f);
+    const float endGain = std::pow(10.0f, normalizeGainDb / 20.0f);
+    if (enabled && normalizeMix == 1.0f) {
+        limiter.Process(buffer, frames, startGain, endGain);
+        return;
+    }
+
+    // Toggled: the limiter output lags by its lookahead, so switching outright would replay a
+    // stale delay line or drop its contents. It restarts empty, and once its delay line holds
+    // this stream the output crossfades between the dry and limited signal
+    if (enabled && normalizeMix == 0.0f && normalizeWarmup == 0) {
+        limiter.Reset();
+        normalizeWarmup = limiter.GetLatencyFrames();
+    }
+    dryScratch.assign(buffer, buffer + frames * channels);
+    limiter.Process(buffer, frames, startGain, endGain);
+
+    const float step = 1.0f / std::max(kNormalizeFadeSeconds * sampleRate, 1.0f);
+    for (size_t frame = 0; frame < frames; ++frame) {
+        if (!enabled) {
+            normalizeWarmup = 0;
+            normalizeMix = std::max(normalizeMix - step, 0.0f);
+        } else if (normalizeWarmup > 0) {
+            --normalizeWarmup;
+        } else {
+            normalizeMix = std::min(normalizeMix + step, 1.0f);
+        }
+        for (int ch = 0; ch < channels; ++ch) {
+            const size_t i = frame * channels + ch;
+            buffer[i] = dryScratch[i] + (buffer[i] - dryScratch[i]) * normalizeMix;
+        }
+    }
+}
+
+void DSPProcessor::ApplyCustomEQ(float* buffer, size_t length, const std::vector<float>& eqValues) {
+    const size_t bands = std::min(eqValues.size(), static_cast<size_t>(kEqBands));
+    for (size_t band = 0; band < bands; ++band) {
+        eqFilter.SetGain(band, Clamp(eqValues[band], -kEqRangeDb, kEqRangeDb));
+    }
+    for (size_t band = bands; band < static_cast<size_t>(kEqBands); ++band) {
+        eqFilter.SetGain(band, 0.0f);
+    }
+    eqFilter.Process(buffer, length / channels);
+}
+
+void DSPProcessor::SetFilterKernel(BiquadCascade::Kernel kernel) {
+    bassFilter.SetKernel(kernel);
+    trebleFilter.SetKernel(kernel);
+    eqFilter.SetKernel(kernel);
+}
+
+void DSPProcessor::InitializeFilters() {
+    bassFilter.SetFormat(sampleRate, channels);
+    trebleFilter.SetFormat(sampleRate, channels);
+    eqFilter.SetFormat(sampleRate, channels);
+    loudnessMeter.SetFormat(sampleRate, channels);
+    limiter.SetFormat(sampleRate, channels);
+    ConfigureResampler();
+}
+
+void DSPProcessor::ConfigureResampler() {
+    if (IsResampling()) {
+        resampler.SetFormat(sampleRate, outputRate, channels, resampleQuality);
+    }
+    resampler.Reset();
+}
+
+float DSPProcessor::Clamp(float value, float min, float max) {
+    return std::min(std::max(value, min), max);
+}
@@ -6,6 +6,9 @@
  *
  * Related Files:
  * - Implementation: DSPProcessor.cpp
+ * - Filters: BiquadCascade.h
+ * - Normalization: LoudnessMeter.h, LookaheadLimiter.h
+ * - Rate conversion: Resampler.h
  * - Bridge: dspBridge.ts
  * - Usage: src/core/audio/dspService.ts
  */
@@ -13,13 +16,17 @@
 #pragma once
 #include <vector>
 #include <memory>
+#include "BiquadCascade.h"
+#include "LoudnessMeter.h"
+#include "LookaheadLimiter.h"
+#include "Resampler.h"
 
 struct DSPConfig {
     float gain;           // Linear gain factor (0.0 to 2.0)
     float bass;           // Bass boost/cut (-10.0 to 10.0 dB)
     float treble;         // Treble boost/cut (-10.0 to 10.0 dB)
-    bool normalize;       // Auto level normalization
-    std::vector<float> customEq;  // Custom 10-band EQ values
+    bool normalize;       // Loudness normalization to kNormalizeTargetLufs
+    std::vector<float> customEq;  // Custom 10-band EQ values (dB, 31 Hz to 16 kHz octaves)
 };
 
 class DSPProcessor {
@@ -27,22 +34,94 @@ public:
     DSPProcessor();
     ~DSPProcessor();
 
-    // Process audio buffer in place
+    // Stream format of the buffers that follow (default 48 kHz stereo);
+    // filter state is cleared when it changes
+    void SetFormat(int sampleRate, int channels);
+
+    // Clears filter and limiter state, e.g. after a seek; the track's
+    // loudness measured so far is kept
+    void Reset();
+
+    // Starts a new track for normalization. With its integrated loudness
+    // known (LoudnessMeter::Analyze, cached in the track metadata) a
+    // constant gain is applied and nothing is measured; pass NaN to
+    // measure while the track plays instead
+    void SetTrackLoudness(float integratedLufs);
+
+    // Momentary, short-term and integrated readings of the current track
+    const LoudnessMeter& GetLoudnessMeter() const { return loudnessMeter; }
+
+    // Process interleaved audio buffer in place; length counts samples, not frames.
+    // Filter state carries over between calls, so consecutive buffers of a
+    // stream are filtered seamlessly. Gain changes glide over a few ms.
     void ProcessBuffer(float* buffer, size_t length, const DSPConfig& config);
+
+    // Converts the processed stream to outputRate (e.g. the device rate) whenever
+    // the stream rate differs; 0 turns conversion off. Clears the converter history
+    void SetOutputRate(int outputRate, Resampler::Quality quality = Resampler::Quality::Balanced);
+
+    // A/V clock drift correction: scales input consumed per output frame (see Resampler::SetRatioAdjust)
+    void SetResampleRatioAdjust(double factor);
+
+    bool IsResampling() const { return outputRate != 0 && outputRate != sampleRate; }
+
+    // Samples the resampling ProcessBuffer() can write for length input samples
+    size_t MaxOutputLength(size_t length) const;
+
+    // ProcessBuffer() in place, then rate conversion into output (MaxOutputLength(length)
+    // samples); returns samples written. Without conversion, copies buffer to output
+    size_t ProcessBuffer(float* buffer, size_t length, float* output, const DSPConfig& config);
     
     // Apply specific effect
     void ApplyGain(float* buffer, size_t length, float gain);
     void ApplyBassBoost(float* buffer, size_t length, float bassDb);
     void ApplyTrebleBoost(float* buffer, size_t length, float trebleDb);
+    // Meters this buffer, then normalizes it; output is delayed by the limiter lookahead (5 ms) while normalizing
     void ApplyNormalize(float* buffer, size_t length);
     void ApplyCustomEQ(float* buffer, size_t length, const std::vector<float>& eqValues);
 
+    // Forces the filter kernel; BiquadCascade::Kernel::Scalar is the reference path
+    void SetFilterKernel(BiquadCascade::Kernel kernel);
+
+    // Band centres of customEq
+    static constexpr int kEqBands = 10;
+    static constexpr float kEqFrequencies[kEqBands] = { 31.25f, 62.5f, 125.0f, 250.0f, 500.0f,
+                                                        1000.0f, 2000.0f, 4000.0f, 8000.0f, 16000.0f };
+
+    // Normalization reference level (ReplayGain 2.0)
+    static constexpr float kNormalizeTargetLufs = -18.0f;
+
 private:
     // Internal helpers
     void InitializeFilters();
+    void ConfigureResampler();
     float Clamp(float value, float min, float max);
-    
-    // Filter coefficients (for EQ implementation)
-    float bassFilter[3];
-    float trebleFilter[3];
+    // Feeds the meter while the track's loudness is unknown
+    void MeterLoudness(const float* buffer, size_t length);
+    // Normalization gain and limiter; fades to or from the limiter when enabled toggles
+    void Normalize(float* buffer, size_t length, bool enabled);
+
+    // Stateful shelving and peaking filters
+    BiquadCascade bassFilter;
+    BiquadCascade trebleFilter;
+    BiquadCascade eqFilter;
+
+    int sampleRate;
+    int channels;
+
+    // Loudness normalization: meter, gain in dB and the limiter that keeps boosts from clipping
+    LoudnessMeter loudnessMeter;
+    LookaheadLimiter limiter;
+    float trackLoudness;
+    float normalizeGainDb;
+    // Share of the limited signal in the output (0 dry, 1 limited), lookahead frames the limiter
+    // still needs after a restart before the crossfade starts, and the dry copy it fades from
+    float normalizeMix;
+    size_t normalizeWarmup;
+    std::vector<float> dryScratch;
+
+    // Output rate conversion, last in the chain; outputRate is 0 when none is requested
+    Resampler resampler;
+    int outputRate;
+    Resampler::Quality resampleQuality;
 };
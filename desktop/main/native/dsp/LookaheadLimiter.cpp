@@ -0,0 +1,104 @@
+﻿/**
+ * Project: KNOUX Player X™
+ * Author: knoux
+ * Purpose: Lookahead peak limiter with makeup gain
+ * Layer: Desktop -> Native -> DSP
+ *
+ * Related Files:
+ * - Interface: LookaheadLimiter.h
+ * - Usage: DSPProcessor.cpp
+ */
+
+#include "LookaheadLimiter.h"
+#include <algorithm>
+#include <cmath>
+
+LookaheadLimiter::LookaheadLimiter()
+    : ceiling(1.0f) {
+    SetFormat(48000, 2);
+}
+
+LookaheadLimiter::~LookaheadLimiter() {
+}
+
+void LookaheadLimiter::SetFormat(int rate, int channelCount) {
+    rate = std::max(rate, 1);
+    channels = std::max(channelCount, 1);
+    lookahead = std::max<size_t>(1, static_cast<size_t>(std::lround(kLookaheadSeconds * rate)));
+    window = lookahead + 1;
+    release = 1.0f - std::exp(-1.0f / (kReleaseSeconds * rate));
+
+    delay.assign(lookahead * channels, 0.0f);
+    queueGain.assign(window, 1.0f);
+    queueFrame.assign(window, 0);
+    average.assign(window, 1.0f);
+    Reset();
+}
+
+void LookaheadLimiter::SetCeiling(float value) {
+    ceiling = std::max(value, 1e-6f);
+}
+
+void LookaheadLimiter::Reset() {
+    std::fill(delay.begin(), delay.end(), 0.0f);
+    std::fill(average.begin(), average.end(), 1.0f);
+    delayPosition = 0;
+    queueHead = 0;
+    queueSize = 0;
+    frame = 0;
+    held = 1.0f;
+    averagePosition = 0;
+    averageSum = static_cast<double>(window);
+    gain = 1.0f;
+}
+
+void LookaheadLimiter::Process(float* buffer, size_t frames, float startGain, float endGain) {
+    if (!buffer || frames == 0) {
+        return;
+    }
+
+    const float step = (endGain - startGain) / static_cast<float>(frames);
+    for (size_t i = 0; i < frames; ++i, buffer += channels, ++frame) {
+        const float makeup = startGain + step * static_cast<float>(i);
+        float* delayed = &delay[delayPosition * channels];
+
+        float peak = 0.0f;
+        for (int ch = 0; ch < channels; ++ch) {
+            const float x = buffer[ch] * makeup;
+            buffer[ch] = delayed[ch];
+            delayed[ch] = x;
+            peak = std::max(peak, std::fabs(x));
+        }
+        delayPosition = delayPosition + 1 == lookahead ? 0 : delayPosition + 1;
+
+        // Sliding minimum: drop the gain leaving the window, then the queued gains the new one undercuts
+        if (queueSize > 0 && queueFrame[queueHead] + window <= frame) {
+            queueHead = queueHead + 1 == window ? 0 : queueHead + 1;
+            --queueSize;
+        }
+        const float required = peak > ceiling ? ceiling / peak : 1.0f;
+        while (queueSize > 0 && queueGain[(queueHead + queueSize - 1) % window] >= required) {
+            --queueSize;
+        }
+        const size_t tail = (queueHead + queueSize) % window;
+        queueGain[tail] = required;
+        queueFrame[tail] = frame;
+        ++queueSize;
+        const float minimum = queueGain[queueHead];
+
+        held = minimum < held ? minimum : held + (minimum - held) * release;
+
+        averageSum += held - average[averagePosition];
+        average[averagePosition] = held;
+        averagePosition = averagePosition + 1 == window ? 0 : averagePosition + 1;
+        gain = static_cast<float>(averageSum / static_cast<double>(window));
+
+        for (int ch = 0; ch < channels; ++ch) {
+            buffer[ch] *= gain;
+        }
+    }
+}
+
+float LookaheadLimiter::GetGainReduction() const {
+    return gain < 1.0f ? 20.0f * std::log10(gain) : 0.0f;
+}
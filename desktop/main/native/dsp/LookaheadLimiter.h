@@ -0,0 +1,77 @@
+﻿/**
+ * Project: KNOUX Player X™
+ * Author: knoux
+ * Purpose: Lookahead peak limiter with makeup gain
+ * Layer: Desktop -> Native -> DSP
+ *
+ * Related Files:
+ * - Implementation: LookaheadLimiter.cpp
+ * - Usage: DSPProcessor.cpp (loudness normalization)
+ */
+
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Applies a gain to interleaved audio and keeps the result under a
+// ceiling. The output is delayed by the lookahead, so the limiter sees
+// each peak before it plays and has already ramped down when it arrives:
+// - the gain each frame needs is min(1, ceiling / peak of its channels)
+// - a sliding minimum over the lookahead window holds that gain for
+//   every frame the peak could still affect
+// - recovery towards 1 is exponential (kReleaseSeconds), reduction is
+//   immediate, and a moving average over the window turns both into
+//   ramps; the average never exceeds the window minimum, so the ceiling
+//   holds without clipping
+class LookaheadLimiter {
+public:
+    LookaheadLimiter();
+    ~LookaheadLimiter();
+
+    // Sample rate and interleaved channel count; clears the delay line
+    void SetFormat(int rate, int channelCount);
+
+    // Output ceiling as a linear sample value
+    void SetCeiling(float ceiling);
+
+    // Clears the delay line and releases any gain reduction
+    void Reset();
+
+    // Scales by a gain ramping linearly from startGain to endGain over the
+    // buffer, then limits; output is delayed by GetLatencyFrames()
+    void Process(float* buffer, size_t frames, float startGain, float endGain);
+
+    size_t GetLatencyFrames() const { return lookahead; }
+
+    // Current gain reduction in dB (0 when not limiting)
+    float GetGainReduction() const;
+
+    static constexpr float kLookaheadSeconds = 0.005f;
+    static constexpr float kReleaseSeconds = 0.25f;
+
+private:
+    int channels;
+    size_t lookahead;
+    size_t window;
+    float ceiling;
+    float release;
+
+    // Delayed input frames (ring of lookahead frames)
+    std::vector<float> delay;
+    size_t delayPosition;
+
+    // Monotonic queue of (required gain, frame) giving the sliding window minimum
+    std::vector<float> queueGain;
+    std::vector<uint64_t> queueFrame;
+    size_t queueHead;
+    size_t queueSize;
+    uint64_t frame;
+
+    // Release stage output and the moving average over its last window values
+    float held;
+    std::vector<float> average;
+    size_t averagePosition;
+    double averageSum;
+    float gain;
+};
@@ -0,0 +1,262 @@
+﻿/**
+ * Project: KNOUX Player X™
+ * Author: knoux
+ * Purpose: Streaming EBU R128 loudness and true-peak meter
+ * Layer: Desktop -> Native -> DSP
+ *
+ * Related Files:
+ * - Interface: LoudnessMeter.h
+ * - Usage: DSPProcessor.cpp
+ */
+
+#include "LoudnessMeter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+// BS.1770 K-weighting, as analog prototypes so any sample rate gets the same response
+constexpr double kShelfFrequency = 1681.974450955533;
+constexpr double kShelfGainDb = 3.999843853973347;
+constexpr double kShelfQ = 0.7071752369554196;
+constexpr double kHighpassFrequency = 38.13547087602444;
+constexpr double kHighpassQ = 0.5003270373238773;
+
+// Gates in LUFS / LU
+constexpr double kAbsoluteGate = -70.0;
+constexpr double kRelativeGate = -10.0;
+constexpr double kHistogramStep = 0.1;
+
+constexpr double kSurroundWeight = 1.41;
+
+// Filter state below this is inaudible and would decay into denormals over long silence
+constexpr double kDenormalFloor = 1e-30;
+
+// BS.1770-4 Annex 2 interpolation filter for 4x oversampling, one row per phase
+constexpr float kTruePeakPhases[4][12] = {
+    { 0.0017089843750f, 0.0109863281250f, -0.0196533203125f, 0.0332031250000f, -0.0594482421875f, 0.1373291015625f,
+      0.9721679687500f, -0.1022949218750f, 0.0476074218750f, -0.0266113281250f, 0.0148925781250f, -0.0083007812500f },
+    { -0.0291748046875f, 0.0292968750000f, -0.0517578125000f, 0.0891113281250f, -0.1665039062500f, 0.4650878906250f,
+      0.7797851562500f, -0.2003173828125f, 0.1015625000000f, -0.0582275390625f, 0.0330810546875f, -0.0189208984375f },
+    { -0.0189208984375f, 0.0330810546875f, -0.0582275390625f, 0.1015625000000f, -0.2003173828125f, 0.7797851562500f,
+      0.4650878906250f, -0.1665039062500f, 0.0891113281250f, -0.0517578125000f, 0.0292968750000f, -0.0291748046875f },
+    { -0.0083007812500f, 0.0148925781250f, -0.0266113281250f, 0.0476074218750f, -0.1022949218750f, 0.9721679687500f,
+      0.1373291015625f, -0.0594482421875f, 0.0332031250000f, -0.0196533203125f, 0.0109863281250f, 0.0017089843750f },
+};
+
+float NegativeInfinity() {
+    return -std::numeric_limits<float>::infinity();
+}
+
+} // namespace
+
+LoudnessMeter::LoudnessMeter() {
+    SetFormat(48000, 2);
+}
+
+LoudnessMeter::~LoudnessMeter() {
+}
+
+void LoudnessMeter::SetFormat(int rate, int channelCount) {
+    sampleRate = std::max(rate, 1);
+    channels = std::min(std::max(channelCount, 1), kMaxChannels);
+    oversample = sampleRate < 96000;
+    blockLength = std::max<size_t>(1, static_cast<size_t>(std::lround(sampleRate / 10.0)));
+
+    const double shelfK = std::tan(kPi * kShelfFrequency / sampleRate);
+    const double vh = std::pow(10.0, kShelfGainDb / 20.0);
+    const double vb = std::pow(vh, 0.4996667741545416);
+    const double shelfA0 = 1.0 + shelfK / kShelfQ + shelfK * shelfK;
+    shelf.b0 = (vh + vb * shelfK / kShelfQ + shelfK * shelfK) / shelfA0;
+    shelf.b1 = 2.0 * (shelfK * shelfK - vh) / shelfA0;
+    shelf.b2 = (vh - vb * shelfK / kShelfQ + shelfK * shelfK) / shelfA0;
+    shelf.a1 = 2.0 * (shelfK * shelfK - 1.0) / shelfA0;
+    shelf.a2 = (1.0 - shelfK / kShelfQ + shelfK * shelfK) / shelfA0;
+
+    const double passK = std::tan(kPi * kHighpassFrequency / sampleRate);
+    const double passA0 = 1.0 + passK / kHighpassQ + passK * passK;
+    highpass.b0 = 1.0;
+    highpass.b1 = -2.0;
+    highpass.b2 = 1.0;
+    highpass.a1 = 2.0 * (passK * passK - 1.0) / passA0;
+    highpass.a2 = (1.0 - passK / kHighpassQ + passK * passK) / passA0;
+
+    for (int ch = 0; ch < kMaxChannels; ++ch) {
+        float weight = 1.0f;
+        if (channels == 5 && ch >= 3) {
+            weight = static_cast<float>(kSurroundWeight);
+        } else if ((channels == 6 || channels == 8) && ch >= 3) {
+            weight = ch == 3 ? 0.0f : static_cast<float>(kSurroundWeight);
+        }
+        weights[ch] = weight;
+    }
+
+    Reset();
+}
+
+void LoudnessMeter::Reset() {
+    std::memset(filterState, 0, sizeof(filterState));
+    std::memset(blockSum, 0, sizeof(blockSum));
+    std::memset(blockPower, 0, sizeof(blockPower));
+    std::memset(histogramCount, 0, sizeof(histogramCount));
+    std::memset(histogramPower, 0, sizeof(histogramPower));
+    std::memset(peakHistory, 0, sizeof(peakHistory));
+    blockFrames = 0;
+    blockWrite = 0;
+    blockCount = 0;
+    peakWrite = 0;
+    peak = 0.0f;
+}
+
+void LoudnessMeter::Process(const float* buffer, size_t frames) {
+    if (!buffer) {
+        return;
+    }
+
+    while (frames > 0) {
+        const size_t span = std::min(frames, blockLength - blockFrames);
+
+        for (int ch = 0; ch < channels; ++ch) {
+            double* z = filterState[ch];
+            double s1 = z[0];
+            double s2 = z[1];
+            double s3 = z[2];
+            double s4 = z[3];
+            double sum = 0.0;
+            float channelPeak = peak;
+            float* history = peakHistory[ch];
+            int write = peakWrite;
+
+            const float* sample = buffer + ch;
+            for (size_t i = 0; i < span; ++i, sample += channels) {
+                const double x = *sample;
+                const double y = shelf.b0 * x + s1;
+                s1 = shelf.b1 * x - shelf.a1 * y + s2;
+                s2 = shelf.b2 * x - shelf.a2 * y;
+                const double k = highpass.b0 * y + s3;
+                s3 = highpass.b1 * y - highpass.a1 * k + s4;
+                s4 = highpass.b2 * y - highpass.a2 * k;
+                sum += k * k;
+
+                if (!oversample) {
+                    channelPeak = std::max(channelPeak, std::fabs(*sample));
+                    continue;
+                }
+
+                // Window runs oldest to newest; the phases are mirror images, so the
+                // set of interpolated values does not depend on the direction
+                history[write] = history[write + kTruePeakTaps] = *sample;
+                write = write + 1 == kTruePeakTaps ? 0 : write + 1;
+                const float* window = history + write;
+                for (const float* phase : kTruePeakPhases) {
+                    float value = 0.0f;
+                    for (int t = 0; t < kTruePeakTaps; ++t) {
+                        value += phase[t] * window[t];
+                    }
+                    channelPeak = std::max(channelPeak, std::fabs(value));
+                }
+            }
+
+            z[0] = std::fabs(s1) < kDenormalFloor ? 0.0 : s1;
+            z[1] = std::fabs(s2) < kDenormalFloor ? 0.0 : s2;
+            z[2] = std::fabs(s3) < kDenormalFloor ? 0.0 : s3;
+            z[3] = std::fabs(s4) < kDenormalFloor ? 0.0 : s4;
+            blockSum[ch] += sum;
+            peak = channelPeak;
+        }
+
+        if (oversample) {
+            peakWrite = static_cast<int>((peakWrite + span) % kTruePeakTaps);
+        }
+        blockFrames += span;
+        buffer += span * channels;
+        frames -= span;
+
+        if (blockFrames == blockLength) {
+            EndBlock();
+        }
+    }
+}
+
+float LoudnessMeter::GetMomentary() const {
+    return blockCount < kMomentaryBlocks ? NegativeInfinity() : ToLufs(RecentPower(kMomentaryBlocks));
+}
+
+float LoudnessMeter::GetShortTerm() const {
+    return blockCount < kShortTermBlocks ? NegativeInfinity() : ToLufs(RecentPower(kShortTermBlocks));
+}
+
+float LoudnessMeter::GetIntegrated() const {
+    uint64_t count = 0;
+    double power = 0.0;
+    for (int bin = 0; bin < kHistogramBins; ++bin) {
+        count += histogramCount[bin];
+        power += histogramPower[bin];
+    }
+    if (count == 0) {
+        return NegativeInfinity();
+    }
+
+    const double threshold = power / static_cast<double>(count) * std::pow(10.0, kRelativeGate / 10.0);
+    uint64_t gatedCount = 0;
+    double gatedPower = 0.0;
+    for (int bin = 0; bin < kHistogramBins; ++bin) {
+        if (histogramCount[bin] > 0 && histogramPower[bin] > threshold * static_cast<double>(histogramCount[bin])) {
+            gatedCount += histogramCount[bin];
+            gatedPower += histogramPower[bin];
+        }
+    }
+    return gatedCount == 0 ? NegativeInfinity() : ToLufs(gatedPower / static_cast<double>(gatedCount));
+}
+
+float LoudnessMeter::GetTruePeak() const {
+    return peak > 0.0f ? 20.0f * std::log10(peak) : NegativeInfinity();
+}
+
+LoudnessMeter::TrackLoudness LoudnessMeter::Analyze(const float* buffer, size_t frames, int rate, int channelCount) {
+    LoudnessMeter meter;
+    meter.SetFormat(rate, channelCount);
+    meter.Process(buffer, frames);
+    return { meter.GetIntegrated(), meter.GetTruePeak() };
+}
+
+void LoudnessMeter::EndBlock() {
+    double power = 0.0;
+    for (int ch = 0; ch < channels; ++ch) {
+        power += weights[ch] * blockSum[ch];
+        blockSum[ch] = 0.0;
+    }
+    blockPower[blockWrite] = power / static_cast<double>(blockLength);
+    blockWrite = (blockWrite + 1) % kShortTermBlocks;
+    blockFrames = 0;
+    ++blockCount;
+
+    // Each 100 ms step completes a 400 ms gating block overlapping the previous one by 75%
+    if (blockCount < kMomentaryBlocks) {
+        return;
+    }
+    const double gating = RecentPower(kMomentaryBlocks);
+    const double loudness = ToLufs(gating);
+    if (loudness <= kAbsoluteGate) {
+        return;
+    }
+    const int bin = std::min(static_cast<int>((loudness - kAbsoluteGate) / kHistogramStep), kHistogramBins - 1);
+    ++histogramCount[bin];
+    histogramPower[bin] += gating;
+}
+
+double LoudnessMeter::RecentPower(int count) const {
+    double power = 0.0;
+    for (int i = 1; i <= count; ++i) {
+        power += blockPower[(blockWrite - i + kShortTermBlocks) % kShortTermBlocks];
+    }
+    return power / count;
+}
+
+float LoudnessMeter::ToLufs(double power) {
+    return power > 0.0 ? static_cast<float>(-0.691 + 10.0 * std::log10(power)) : NegativeInfinity();
+}
@@ -0,0 +1,115 @@
+﻿/**
+ * Project: KNOUX Player X™
+ * Author: knoux
+ * Purpose: Streaming EBU R128 loudness and true-peak meter
+ * Layer: Desktop -> Native -> DSP
+ *
+ * Related Files:
+ * - Implementation: LoudnessMeter.cpp
+ * - Usage: DSPProcessor.cpp (loudness normalization)
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// ITU-R BS.1770-4 / EBU R128 meter for interleaved audio fed in buffers
+// of any size. Samples are K-weighted (high shelf + RLB high-pass) and
+// their mean square is collected in 100 ms blocks; all readings derive
+// from those blocks:
+// - momentary: last 400 ms, short-term: last 3 s
+// - integrated: mean of the overlapping 400 ms blocks that pass the
+//   absolute gate (-70 LUFS) and the relative gate (-10 LU below the
+//   mean of the blocks above the absolute gate)
+//
+// Gating blocks are binned in a 0.1 LU histogram that keeps each bin's
+// summed energy, so memory is fixed however long the stream runs; only
+// blocks in the bin straddling the relative gate are gated as a group.
+//
+// True peak is the peak of the signal oversampled 4x with the BS.1770
+// interpolation filter (48 taps, 12 per phase). From 96 kHz up the
+// sample peak is used as is.
+//
+// Channel weights follow BS.1770 for 5.0 (L R C Ls Rs), 5.1 and 7.1
+// (L R C LFE ...): LFE is ignored and surrounds count 1.41x. Every
+// channel of other layouts counts 1x.
+class LoudnessMeter {
+public:
+    // Whole-track result, e.g. for the metadata cache
+    struct TrackLoudness {
+        float integrated;  // LUFS, -inf if the track never rises above the absolute gate
+        float truePeak;    // dBTP
+    };
+
+    LoudnessMeter();
+    ~LoudnessMeter();
+
+    // Sample rate and interleaved channel count (up to kMaxChannels); resets the meter
+    void SetFormat(int rate, int channelCount);
+
+    // Forgets everything measured so far, e.g. at the start of a track
+    void Reset();
+
+    // Measures interleaved samples; the buffer is not modified
+    void Process(const float* buffer, size_t frames);
+
+    // Loudness in LUFS; -inf until enough audio has been measured (400 ms, 3 s)
+    float GetMomentary() const;
+    float GetShortTerm() const;
+    float GetIntegrated() const;
+
+    // Highest true peak so far in dBTP, -inf before any signal
+    float GetTruePeak() const;
+
+    // Batch mode: measures a whole decoded track in one pass
+    static TrackLoudness Analyze(const float* buffer, size_t frames, int rate, int channelCount);
+
+    static constexpr int kMaxChannels = 8;
+
+private:
+    // Double-precision section; the meter must stay exact on quiet material
+    struct Section {
+        double b0, b1, b2, a1, a2;
+    };
+
+    // Helper: Closes the current 100 ms block
+    void EndBlock();
+
+    // Helper: Mean weighted power of the newest count blocks
+    double RecentPower(int count) const;
+
+    static float ToLufs(double power);
+
+    static constexpr int kMomentaryBlocks = 4;
+    static constexpr int kShortTermBlocks = 30;
+    static constexpr int kHistogramBins = 1000;  // 0.1 LU bins from the absolute gate up
+    static constexpr int kTruePeakTaps = 12;
+
+    int sampleRate;
+    int channels;
+    bool oversample;
+
+    Section shelf;
+    Section highpass;
+    float weights[kMaxChannels];
+
+    // Per channel: TDF-II state of both sections, and the squared sum of the open block
+    double filterState[kMaxChannels][4];
+    double blockSum[kMaxChannels];
+    size_t blockFrames;
+    size_t blockLength;
+
+    // Weighted power of the newest 100 ms blocks (ring), and how many were completed
+    double blockPower[kShortTermBlocks];
+    int blockWrite;
+    uint64_t blockCount;
+
+    // Gating blocks above the absolute gate: count and summed power per bin
+    uint64_t histogramCount[kHistogramBins];
+    double histogramPower[kHistogramBins];
+
+    // Per channel: the last inputs of the interpolation filter, stored twice so the window is contiguous
+    float peakHistory[kMaxChannels][2 * kTruePeakTaps];
+    int peakWrite;
+    float peak;
+};
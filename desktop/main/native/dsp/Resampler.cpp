@@ -0,0 +1,400 @@
+﻿/**
+ * Project: KNOUX Player X™
+ * Author: knoux
+ * Purpose: Streaming polyphase FIR sample-rate converter with SIMD kernels
+ * Layer: Desktop -> Native -> DSP
+ *
+ * Related Files:
+ * - Interface: Resampler.h
+ * - Usage: DSPProcessor.cpp
+ */
+
+#include "Resampler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KNOUX_DSP_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#define KNOUX_TARGET_AVX2
+#else
+#define KNOUX_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64)
+#define KNOUX_DSP_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+// One phase step in position units
+constexpr int kPhaseBits = 32;
+
+struct QualitySpec {
+    size_t taps;             // Per phase at the lower of the two rates
+    double stopbandDb;
+};
+
+QualitySpec Spec(Resampler::Quality quality) {
+    switch (quality) {
+    case Resampler::Quality::Fast:
+        return { 32, 60.0 };
+    case Resampler::Quality::High:
+        return { 160, 120.0 };
+    case Resampler::Quality::Balanced:
+    default:
+        return { 64, 96.0 };
+    }
+}
+
+// Zeroth-order modified Bessel function of the first kind, for the Kaiser window
+double BesselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    const double quarter = x * x / 4.0;
+    for (int k = 1; k < 64 && term > sum * 1e-17; ++k) {
+        term *= quarter / (static_cast<double>(k) * k);
+        sum += term;
+    }
+    return sum;
+}
+
+// Kernels: sum of x[i] * c[i] over n taps, and the same with c + f * d.
+// n is a multiple of 8.
+
+float DotScalar(const float* x, const float* c, size_t n) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        sum += x[i] * c[i];
+    }
+    return sum;
+}
+
+float DotLerpScalar(const float* x, const float* c, const float* d, float f, size_t n) {
+    float sum = 0.0f;
+    float sumDelta = 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        sum += x[i] * c[i];
+        sumDelta += x[i] * d[i];
+    }
+    return sum + f * sumDelta;
+}
+
+#ifdef KNOUX_DSP_X86
+
+float HorizontalSum(__m128 v) {
+    __m128 shuffled = _mm_movehl_ps(v, v);
+    v = _mm_add_ps(v, shuffled);
+    shuffled = _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1));
+    return _mm_cvtss_f32(_mm_add_ss(v, shuffled));
+}
+
+float DotSse(const float* x, const float* c, size_t n) {
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    for (size_t i = 0; i < n; i += 8) {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(c + i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(x + i + 4), _mm_loadu_ps(c + i + 4)));
+    }
+    return HorizontalSum(_mm_add_ps(sum0, sum1));
+}
+
+float DotLerpSse(const float* x, const float* c, const float* d, float f, size_t n) {
+    __m128 sum = _mm_setzero_ps();
+    __m128 sumDelta = _mm_setzero_ps();
+    for (size_t i = 0; i < n; i += 4) {
+        const __m128 xv = _mm_loadu_ps(x + i);
+        sum = _mm_add_ps(sum, _mm_mul_ps(xv, _mm_loadu_ps(c + i)));
+        sumDelta = _mm_add_ps(sumDelta, _mm_mul_ps(xv, _mm_loadu_ps(d + i)));
+    }
+    return HorizontalSum(sum) + f * HorizontalSum(sumDelta);
+}
+
+KNOUX_TARGET_AVX2 float HorizontalSumAvx(__m256 v) {
+    return HorizontalSum(_mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+}
+
+KNOUX_TARGET_AVX2 float DotAvx2(const float* x, const float* c, size_t n) {
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(c + i)));
+        sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(c + i + 8)));
+    }
+    if (i < n) {
+        sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(c + i)));
+    }
+    return HorizontalSumAvx(_mm256_add_ps(sum0, sum1));
+}
+
+KNOUX_TARGET_AVX2 float DotLerpAvx2(const float* x, const float* c, const float* d, float f, size_t n) {
+    __m256 sum = _mm256_setzero_ps();
+    __m256 sumDelta = _mm256_setzero_ps();
+    for (size_t i = 0; i < n; i += 8) {
+        const __m256 xv = _mm256_loadu_ps(x + i);
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(xv, _mm256_loadu_ps(c + i)));
+        sumDelta = _mm256_add_ps(sumDelta, _mm256_mul_ps(xv, _mm256_loadu_ps(d + i)));
+    }
+    return HorizontalSumAvx(sum) + f * HorizontalSumAvx(sumDelta);
+}
+
+#endif // KNOUX_DSP_X86
+
+#ifdef KNOUX_DSP_NEON
+
+float DotNeon(const float* x, const float* c, size_t n) {
+    float32x4_t sum0 = vdupq_n_f32(0.0f);
+    float32x4_t sum1 = vdupq_n_f32(0.0f);
+    for (size_t i = 0; i < n; i += 8) {
+        sum0 = vmlaq_f32(sum0, vld1q_f32(x + i), vld1q_f32(c + i));
+        sum1 = vmlaq_f32(sum1, vld1q_f32(x + i + 4), vld1q_f32(c + i + 4));
+    }
+    const float32x4_t sum = vaddq_f32(sum0, sum1);
+    const float32x2_t half = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+    return vget_lane_f32(vpadd_f32(half, half), 0);
+}
+
+float DotLerpNeon(const float* x, const float* c, const float* d, float f, size_t n) {
+    float32x4_t sum = vdupq_n_f32(0.0f);
+    float32x4_t sumDelta = vdupq_n_f32(0.0f);
+    for (size_t i = 0; i < n; i += 4) {
+        const float32x4_t xv = vld1q_f32(x + i);
+        sum = vmlaq_f32(sum, xv, vld1q_f32(c + i));
+        sumDelta = vmlaq_f32(sumDelta, xv, vld1q_f32(d + i));
+    }
+    const float32x2_t half = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+    const float32x2_t halfDelta = vadd_f32(vget_low_f32(sumDelta), vget_high_f32(sumDelta));
+    return vget_lane_f32(vpadd_f32(half, half), 0) + f * vget_lane_f32(vpadd_f32(halfDelta, halfDelta), 0);
+}
+
+#endif // KNOUX_DSP_NEON
+
+using DotFunction = float (*)(const float*, const float*, size_t);
+using DotLerpFunction = float (*)(const float*, const float*, const float*, float, size_t);
+
+// Helper: Kernel pair for a resolved kernel choice
+void SelectKernels(Resampler::Kernel kernel, DotFunction& dot, DotLerpFunction& dotLerp) {
+    switch (kernel) {
+#ifdef KNOUX_DSP_X86
+    case Resampler::Kernel::Avx2:
+        dot = DotAvx2;
+        dotLerp = DotLerpAvx2;
+        return;
+    case Resampler::Kernel::Sse:
+        dot = DotSse;
+        dotLerp = DotLerpSse;
+        return;
+#endif
+#ifdef KNOUX_DSP_NEON
+    case Resampler::Kernel::Neon:
+        dot = DotNeon;
+        dotLerp = DotLerpNeon;
+        return;
+#endif
+    default:
+        dot = DotScalar;
+        dotLerp = DotLerpScalar;
+        return;
+    }
+}
+
+} // namespace
+
+Resampler::Resampler() {
+    kernel = BiquadCascade::DetectKernel();
+    BuildFilter();
+    Reset();
+}
+
+void Resampler::SetFormat(int newInputRate, int newOutputRate, int channelCount, Quality newQuality) {
+    newInputRate = std::max(newInputRate, 1);
+    newOutputRate = std::max(newOutputRate, 1);
+    channelCount = std::max(channelCount, 1);
+    if (newInputRate == inputRate && newOutputRate == outputRate && channelCount == channels &&
+        newQuality == quality) {
+        return;
+    }
+
+    inputRate = newInputRate;
+    outputRate = newOutputRate;
+    channels = channelCount;
+    quality = newQuality;
+    BuildFilter();
+    Reset();
+}
+
+void Resampler::SetRatioAdjust(double factor) {
+    if (!std::isfinite(factor)) {
+        factor = 1.0;
+    }
+    ratioAdjust = std::clamp(factor, 1.0 - kMaxRatioAdjust, 1.0 + kMaxRatioAdjust);
+    UpdateStep();
+}
+
+void Resampler::Reset() {
+    history.assign(channels, std::vector<float>(taps + kBlockFrames, 0.0f));
+    filled = taps - 1;
+    base = 0;
+    phase = 0;
+}
+
+void Resampler::SetKernel(Kernel requested) {
+    const Kernel detected = BiquadCascade::DetectKernel();
+    bool supported = requested == Kernel::Scalar || requested == detected;
+#ifdef KNOUX_DSP_X86
+    supported = supported || requested == Kernel::Sse;
+#endif
+    kernel = supported ? requested : detected;
+}
+
+double Resampler::Latency() const {
+    // The prototype is centred (taps * phases - 1) / 2 samples in at phases times the input rate
+    const double inputFrames = (static_cast<double>(taps * phases) - 1.0) / (2.0 * phases);
+    return inputFrames * outputRate / inputRate;
+}
+
+size_t Resampler::MaxOutputFrames(size_t inputFrames) const {
+    // Frames the position can still cross, including the unconsumed history, at the current step
+    const double unit = std::ldexp(static_cast<double>(phases), kPhaseBits);
+    const double crossable = static_cast<double>(filled + inputFrames) * unit;
+    return static_cast<size_t>(crossable / static_cast<double>(step)) + 2;
+}
+
+size_t Resampler::Process(const float* input, size_t inputFrames, float* output) {
+    size_t written = 0;
+    while (inputFrames > 0) {
+        const size_t count = std::min(inputFrames, kBlockFrames);
+        for (int c = 0; c < channels; ++c) {
+            float* destination = history[c].data() + filled;
+            const float* source = input + c;
+            for (size_t i = 0; i < count; ++i, source += channels) {
+                destination[i] = *source;
+            }
+        }
+        filled += count;
+        input += count * channels;
+        inputFrames -= count;
+
+        written += Drain(output + written * channels);
+    }
+    return written;
+}
+
+size_t Resampler::Drain(float* output) {
+    DotFunction dot;
+    DotLerpFunction dotLerp;
+    SelectKernels(kernel, dot, dotLerp);
+
+    const uint64_t unit = static_cast<uint64_t>(phases) << kPhaseBits;
+    const uint64_t fractionMask = (uint64_t(1) << kPhaseBits) - 1;
+    const float fractionScale = 1.0f / static_cast<float>(uint64_t(1) << kPhaseBits);
+    size_t written = 0;
+
+    while (base + taps <= filled) {
+        const size_t row = static_cast<size_t>(phase >> kPhaseBits);
+        const uint64_t fraction = phase & fractionMask;
+        const float* coefficients = rows.data() + row * taps;
+        if (fraction == 0) {
+            for (int c = 0; c < channels; ++c) {
+                output[c] = dot(history[c].data() + base, coefficients, taps);
+            }
+        } else {
+            const float* delta = deltas.data() + row * taps;
+            const float f = static_cast<float>(fraction) * fractionScale;
+            for (int c = 0; c < channels; ++c) {
+                output[c] = dotLerp(history[c].data() + base, coefficients, delta, f, taps);
+            }
+        }
+        output += channels;
+        ++written;
+
+        phase += step;
+        while (phase >= unit) {
+            phase -= unit;
+            ++base;
+        }
+    }
+
+    // Keep the frames the next outputs still need; base may have skipped past the history when downsampling
+    const size_t drop = std::min(base, filled);
+    for (int c = 0; c < channels; ++c) {
+        float* data = history[c].data();
+        std::memmove(data, data + drop, (filled - drop) * sizeof(float));
+    }
+    filled -= drop;
+    base -= drop;
+    return written;
+}
+
+void Resampler::UpdateStep() {
+    if (phases == upFactor && ratioAdjust == 1.0) {
+        // Exact: every output advances M phases of 1/L frame
+        step = static_cast<uint64_t>(downFactor) << kPhaseBits;
+        return;
+    }
+    const double frames = static_cast<double>(inputRate) / outputRate * ratioAdjust;
+    step = static_cast<uint64_t>(std::llround(std::ldexp(frames * phases, kPhaseBits)));
+}
+
+void Resampler::BuildFilter() {
+    const size_t divisor = static_cast<size_t>(std::gcd(inputRate, outputRate));
+    upFactor = static_cast<size_t>(outputRate) / divisor;
+    downFactor = static_cast<size_t>(inputRate) / divisor;
+    phases = std::min(upFactor, kMaxPhases);
+
+    // Taps are specified at the lower rate, so downsampling needs proportionally more at the input rate
+    const QualitySpec spec = Spec(quality);
+    const double lowerRate = std::min(inputRate, outputRate);
+    const double stretch = inputRate / lowerRate;
+    taps = (static_cast<size_t>(std::ceil(spec.taps * stretch)) + 7) / 8 * 8;
+
+    // Kaiser design: transition band ending at the lower Nyquist frequency
+    const double transition = (spec.stopbandDb - 7.95) / (2.285 * 2.0 * kPi * spec.taps);
+    const double cutoff = (0.5 - transition / 2.0) * lowerRate / inputRate;  // Cycles per input frame
+    const double beta = 0.1102 * (spec.stopbandDb - 8.7);
+
+    const size_t length = taps * phases;
+    const double centre = (static_cast<double>(length) - 1.0) / 2.0;
+    const double normalized = 2.0 * cutoff / phases;
+    const double windowScale = 1.0 / BesselI0(beta);
+
+    // Prototype at phases times the input rate
+    std::vector<double> prototype(length, 0.0);
+    double sum = 0.0;
+    for (size_t n = 0; n < length; ++n) {
+        const double t = static_cast<double>(n) - centre;
+        const double x = normalized * t;
+        const double sinc = std::fabs(x) < 1e-12 ? 1.0 : std::sin(kPi * x) / (kPi * x);
+        const double r = (2.0 * n) / (length - 1.0) - 1.0;
+        const double window = BesselI0(beta * std::sqrt(std::max(0.0, 1.0 - r * r))) * windowScale;
+        prototype[n] = normalized * sinc * window;
+        sum += prototype[n];
+    }
+    // Unity gain per phase on average
+    const double gain = phases / sum;
+
+    // Row p, tap j weights history frame base + j: prototype index (taps - 1 - j) * phases + p
+    auto coefficient = [&](size_t p, size_t j) {
+        return prototype[(taps - 1 - j) * phases + p] * gain;
+    };
+    rows.assign(phases * taps, 0.0f);
+    deltas.assign(phases * taps, 0.0f);
+    for (size_t p = 0; p < phases; ++p) {
+        for (size_t j = 0; j < taps; ++j) {
+            const double current = coefficient(p, j);
+            // Row phases is row 0 one frame later: the same window shifted by one tap
+            const double next = p + 1 < phases ? coefficient(p + 1, j)
+                                               : (j > 0 ? coefficient(0, j - 1) : 0.0);
+            rows[p * taps + j] = static_cast<float>(current);
+            deltas[p * taps + j] = static_cast<float>(next - current);
+        }
+    }
+
+    UpdateStep();
+}
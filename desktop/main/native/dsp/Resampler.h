@@ -0,0 +1,124 @@
+﻿/**
+ * Project: KNOUX Player X™
+ * Author: knoux
+ * Purpose: Streaming polyphase FIR sample-rate converter with SIMD kernels
+ * Layer: Desktop -> Native -> DSP
+ *
+ * Related Files:
+ * - Implementation: Resampler.cpp
+ * - Usage: DSPProcessor.cpp (output rate conversion)
+ * - Benchmark: resampler_benchmark.cpp
+ */
+
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "BiquadCascade.h"
+
+// Converts interleaved audio between any two integer sample rates. The
+// ratio is reduced to L/M; a Kaiser-windowed sinc is designed at L times
+// the input rate and split into L phases, so each output sample is one
+// dot product of the filter phase at its position against the input
+// history. Ratios with L up to kMaxPhases are exact; beyond that the
+// table has kMaxPhases phases and positions between them interpolate the
+// coefficients.
+//
+// The read position is fixed point: an input frame index plus a phase in
+// 1/2^32 steps, so conversion stays exact over any stream length. History
+// carries across Process() calls, so a stream split into arbitrary
+// buffers converts exactly as if it were one buffer.
+//
+// SetRatioAdjust() scales the step for clock drift correction; the
+// position carries over, so adjustments are seamless. While adjusted,
+// positions fall between phases and are interpolated.
+//
+// Output lags input by Latency() frames of group delay. Dot products run
+// along the taps with SSE, AVX2 or NEON, selected like BiquadCascade.
+class Resampler {
+public:
+    using Kernel = BiquadCascade::Kernel;
+
+    // Filter length trades passband width and stopband rejection for speed
+    enum class Quality {
+        Fast,       // 32 taps, 60 dB stopband, passband to 0.39 of the lower rate
+        Balanced,   // 64 taps, 96 dB stopband, passband to 0.45
+        High        // 160 taps, 120 dB stopband, passband to 0.48
+    };
+
+    Resampler();
+
+    // Rates in Hz and interleaved channel count; rebuilds the filter and clears history when anything changes
+    void SetFormat(int inputRate, int outputRate, int channelCount, Quality quality = Quality::Balanced);
+
+    // Scales input consumed per output frame by factor (clamped to 1 ± kMaxRatioAdjust); 1 restores the exact ratio
+    void SetRatioAdjust(double factor);
+    double GetRatioAdjust() const { return ratioAdjust; }
+
+    // Converts all input frames; output must hold MaxOutputFrames(inputFrames) frames. Returns frames written
+    size_t Process(const float* input, size_t inputFrames, float* output);
+
+    // Upper bound on the frames the next Process() call can produce
+    size_t MaxOutputFrames(size_t inputFrames) const;
+
+    // Clears history and position, e.g. after a seek
+    void Reset();
+
+    // Forces a kernel (Scalar gives the reference output); unsupported choices fall back to the detected one
+    void SetKernel(Kernel requested);
+    Kernel GetKernel() const { return kernel; }
+
+    // Group delay in output frames
+    double Latency() const;
+
+    int InputRate() const { return inputRate; }
+    int OutputRate() const { return outputRate; }
+    size_t Taps() const { return taps; }
+    size_t Phases() const { return phases; }
+
+    // True when the table holds every phase of the current exact ratio
+    bool IsExact() const { return phases == upFactor && ratioAdjust == 1.0; }
+
+    static constexpr size_t kMaxPhases = 512;
+    static constexpr double kMaxRatioAdjust = 0.01;
+
+    // Input frames converted per internal block, bounding the history buffer
+    static constexpr size_t kBlockFrames = 1024;
+
+private:
+    // Helper: Designs the prototype filter and fills the phase table
+    void BuildFilter();
+
+    // Helper: Recomputes the position step from the rates and adjustment
+    void UpdateStep();
+
+    // Helper: Produces output from the buffered history, then drops consumed frames
+    size_t Drain(float* output);
+
+    int inputRate = 48000;
+    int outputRate = 48000;
+    int channels = 2;
+    Quality quality = Quality::Balanced;
+
+    size_t upFactor = 1;      // L of the reduced ratio L/M
+    size_t downFactor = 1;    // M
+    size_t phases = 1;
+    size_t taps = 8;          // Per phase, a multiple of 8
+
+    // One row of taps coefficients per phase, reversed so they run forward over the history;
+    // deltas holds each row's difference to the next phase, for interpolation
+    std::vector<float> rows;
+    std::vector<float> deltas;
+
+    // Planar input history per channel, primed with taps - 1 frames of silence
+    std::vector<std::vector<float>> history;
+    size_t filled = 0;
+
+    // Position: frame offset into history and phase in units of 2^-32 phase
+    size_t base = 0;
+    uint64_t phase = 0;
+    uint64_t step = 0;
+    double ratioAdjust = 1.0;
+
+    Kernel kernel = Kernel::Auto;
+};
@@ -1,74 +1,462 @@
 /**
- * Project: KNOUX Player X? 
+ * Project: KNOUX Player X?
  * Author: knoux
  * File: audio_dsp.cpp
  *
- * Purpose: Implements basic in-place real-time processing over an incoming floating point buffer such including:
- *           - Equalizer simulation through amplitude weightings per-channel groupings of fixed bands 
+ * Purpose: Implements in-place and out-of-place real-time processing of float PCM buffers:
  *           - Master gain control (pre-multiplier adjustment on sample-level)
- *           - Very minimalistic static eliminator logic via single-pole recursive filtering approach known loosely as a Direct Form DC blocker alternative.  
- *          
- * Uses minimal resources while avoiding performance overhead common where unnecessary precision increases memory pressure across large blocks (>512K samples/block typical usage scope). This ensures both efficiency within threaded decoding pipeline workloads, as partaking smoothly during JIT playback without CPU starvation conditions due timing jitter accumulation effects in low latency streaming output rendering modes like Direct3DAudioSession buffers passed around from FFmpeg decodes onward.
+ *           - 10-band equalizer as a cascade of peaking biquads; flat bands cost nothing
+ *           - Single-pole DC blocker: y[n] = x[n] - x[n-1] + R * y[n-1]
+ *
+ * All stages run fused in one traversal of the buffer: each sample is loaded once, passes through gain,
+ * the active EQ sections and the DC blocker with the filter state held in locals, and is stored once.
+ * Blocks of 512K samples are typical, so a pass per stage would stream the whole buffer through the
+ * cache several times. Filter state is kept per channel across calls.
+ *
+ * The stages are DSPChain.h stage types: every combination of enabled stages and active section
+ * count is instantiated, and each buffer runs the one matching the config, so the sample loop
+ * holds no enable checks.
  */
 
 #include "audio_dsp.h"
+#include "BiquadCascade.h"
+#include "DSPChain.h"
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KNOUX_DSP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const float kEqFrequencies[AudioDSP::kBands] = { 31.25f, 62.5f, 125.0f, 250.0f, 500.0f,
+                                                 1000.0f, 2000.0f, 4000.0f, 8000.0f, 16000.0f };
+
+// One-octave peaking bands, gains limited to +-12 dB
+const float kEqQ = 1.414f;
+const float kEqRangeDb = 12.0f;
+
+// DC blocker corner; low enough to leave the lowest musical fundamentals alone
+const double kDcCutoffHz = 20.0;
+
+const float kDenormalFloor = 1e-20f;
+
+// Working set of one run; the state pointers start at the first channel processed
+struct ChainContext {
+    float gain;
+    float dcCoefficient;
+    const float (*coefficients)[5];
+    const int* bands;
+    float (*eqState)[AudioDSP::kBands][2];
+    float (*dcState)[2];
+};
+
+struct GainStage : DSPStage {
+    static constexpr bool kPerSample = true;
+
+    explicit GainStage(ChainContext& context) : gain(context.gain) {}
+
+    float Tick(float x, int) { return x * gain; }
+
+    float gain;
+};
+
+// Active EQ sections over Channels interleaved samples (1 for one planar channel). The
+// section count is a template parameter so the section loop unrolls and coefficients and
+// state stay in registers for the whole pass.
+template <int Sections, int Channels>
+struct EqStage : DSPStage {
+    static constexpr bool kPerSample = true;
+
+    explicit EqStage(ChainContext& context) {
+        for (int k = 0; k < Sections; ++k) {
+            for (int i = 0; i < 5; ++i) {
+                c[k][i] = context.coefficients[k][i];
+            }
+            for (int ch = 0; ch < Channels; ++ch) {
+                s1[ch][k] = context.eqState[ch][context.bands[k]][0];
+                s2[ch][k] = context.eqState[ch][context.bands[k]][1];
+            }
+        }
+    }
+
+    float Tick(float x, int ch) {
+        for (int k = 0; k < Sections; ++k) {
+            const float y = c[k][0] * x + s1[ch][k];
+            s1[ch][k] = c[k][1] * x - c[k][3] * y + s2[ch][k];
+            s2[ch][k] = c[k][2] * x - c[k][4] * y;
+            x = y;
+        }
+        return x;
+    }
+
+    void Finish(ChainContext& context, float*, size_t, int) {
+        for (int k = 0; k < Sections; ++k) {
+            for (int ch = 0; ch < Channels; ++ch) {
+                context.eqState[ch][context.bands[k]][0] = s1[ch][k];
+                context.eqState[ch][context.bands[k]][1] = s2[ch][k];
+            }
+        }
+    }
+
+    float c[Sections + 1][5];
+    float s1[Channels][Sections + 1];
+    float s2[Channels][Sections + 1];
+};
+
+#ifdef KNOUX_DSP_SSE2
+
+// Interleaved stereo: both channels of a frame go through the sections as one {L, R, 0, 0}
+// vector, so each section costs one vector multiply-add chain instead of two scalar ones.
+// The operations are the scalar Tick's in the same order, so the output is identical.
+template <int Sections>
+struct EqStage<Sections, 2> : DSPStage {
+    static constexpr bool kPerSample = true;
+    static constexpr bool kFrameTick = true;
+
+    explicit EqStage(ChainContext& context) {
+        for (int k = 0; k < Sections; ++k) {
+            for (int i = 0; i < 5; ++i) {
+                c[k][i] = _mm_set1_ps(context.coefficients[k][i]);
+            }
+            const int band = context.bands[k];
+            s1[k] = _mm_setr_ps(context.eqState[0][band][0], context.eqState[1][band][0], 0.0f, 0.0f);
+            s2[k] = _mm_setr_ps(context.eqState[0][band][1], context.eqState[1][band][1], 0.0f, 0.0f);
+        }
+    }
+
+    void TickFrame(float* frame) {
+        __m128 x = _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(frame));
+        for (int k = 0; k < Sections; ++k) {
+            const __m128 y = _mm_add_ps(_mm_mul_ps(c[k][0], x), s1[k]);
+            s1[k] = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(c[k][1], x), _mm_mul_ps(c[k][3], y)), s2[k]);
+            s2[k] = _mm_sub_ps(_mm_mul_ps(c[k][2], x), _mm_mul_ps(c[k][4], y));
+            x = y;
+        }
+        _mm_storel_pi(reinterpret_cast<__m64*>(frame), x);
+    }
+
+    void Finish(ChainContext& context, float*, size_t, int) {
+        for (int k = 0; k < Sections; ++k) {
+            float first[4];
+            float second[4];
+            _mm_storeu_ps(first, s1[k]);
+            _mm_storeu_ps(second, s2[k]);
+            for (int ch = 0; ch < 2; ++ch) {
+                context.eqState[ch][context.bands[k]][0] = first[ch];
+                context.eqState[ch][context.bands[k]][1] = second[ch];
+            }
+        }
+    }
+
+    __m128 c[Sections + 1][5];
+    __m128 s1[Sections + 1];
+    __m128 s2[Sections + 1];
+};
+
+#endif // KNOUX_DSP_SSE2
+
+template <int Channels>
+struct DcBlockStage : DSPStage {
+    static constexpr bool kPerSample = true;
+
+    explicit DcBlockStage(ChainContext& context) : coefficient(context.dcCoefficient) {
+        for (int ch = 0; ch < Channels; ++ch) {
+            x1[ch] = context.dcState[ch][0];
+            y1[ch] = context.dcState[ch][1];
+        }
+    }
+
+    float Tick(float x, int ch) {
+        const float y = x - x1[ch] + coefficient * y1[ch];
+        x1[ch] = x;
+        y1[ch] = y;
+        return y;
+    }
+
+    void Finish(ChainContext& context, float*, size_t, int) {
+        for (int ch = 0; ch < Channels; ++ch) {
+            context.dcState[ch][0] = x1[ch];
+            context.dcState[ch][1] = y1[ch];
+        }
+    }
+
+    float coefficient;
+    float x1[Channels];
+    float y1[Channels];
+};
+
+// Stage bits, in chain order
+const unsigned kGainStage = 1u << 0;
+const unsigned kEqStage = 1u << 1;
+const unsigned kDcBlockStage = 1u << 2;
+
+template <int Sections, int Channels>
+using Chain = DSPChainTable<ChainContext, Channels, GainStage, EqStage<Sections, Channels>, DcBlockStage<Channels>>;
+
+#ifdef KNOUX_DSP_SSE2
+
+// Gain and DC blocker on a channel pair, the common no-EQ path, with each vector holding
+// two frames as {L, R, L, R}. Four frames per step; with u1 = R*d0 + d1 the scan is
+//   y0 = R p + d0            y2 = R^3 p + R u1 + d2
+//   y1 = R^2 p + u1          y3 = R^4 p + R^2 u1 + (R d2 + d3)
+// so the only dependency between steps is one multiply-add on p = y[n-1].
+// Planar pairs are interleaved on load and split again on store.
+template <bool Planar>
+void DcBlockPairSse(const float* inA, const float* inB, float* outA, float* outB, size_t frames,
+                    float gain, float dcCoefficient, float (*dcState)[2]) {
+    const float r1 = dcCoefficient;
+    const float r2 = r1 * r1;
+    const __m128 vGain = _mm_set1_ps(gain);
+    const __m128 vR = _mm_set1_ps(r1);
+    const __m128 low = _mm_set_ps(r2, r2, r1, r1);
+    const __m128 high = _mm_set_ps(r2 * r2, r2 * r2, r2 * r1, r2 * r1);
+    const __m128 zero = _mm_setzero_ps();
+
+    __m128 previousX = _mm_set_ps(dcState[1][0], dcState[0][0], dcState[1][0], dcState[0][0]);
+    __m128 previousY = _mm_set_ps(dcState[1][1], dcState[0][1], dcState[1][1], dcState[0][1]);
+
+    size_t f = 0;
+    for (; f + 4 <= frames; f += 4) {
+        __m128 a;
+        __m128 b;
+        if (Planar) {
+            const __m128 left = _mm_loadu_ps(inA + f);
+            const __m128 right = _mm_loadu_ps(inB + f);
+            a = _mm_unpacklo_ps(left, right);
+            b = _mm_unpackhi_ps(left, right);
+        } else {
+            a = _mm_loadu_ps(inA + 2 * f);
+            b = _mm_loadu_ps(inA + 2 * f + 4);
+        }
+        a = _mm_mul_ps(a, vGain);
+        b = _mm_mul_ps(b, vGain);
+
+        const __m128 dA = _mm_sub_ps(a, _mm_movelh_ps(previousX, a));
+        const __m128 dB = _mm_sub_ps(b, _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 3, 2)));
+        const __m128 tA = _mm_add_ps(dA, _mm_mul_ps(vR, _mm_movelh_ps(zero, dA)));
+        const __m128 tB = _mm_add_ps(dB, _mm_mul_ps(vR, _mm_movelh_ps(zero, dB)));
+        const __m128 u1 = _mm_movehl_ps(tA, tA);
+
+        const __m128 yA = _mm_add_ps(_mm_mul_ps(low, previousY), tA);
+        const __m128 yB = _mm_add_ps(_mm_mul_ps(high, previousY), _mm_add_ps(tB, _mm_mul_ps(low, u1)));
+        previousY = _mm_movehl_ps(yB, yB);
+        previousX = _mm_movehl_ps(b, b);
 
-AudioDSP::AudioDSP() {
+        if (Planar) {
+            _mm_storeu_ps(outA + f, _mm_shuffle_ps(yA, yB, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm_storeu_ps(outB + f, _mm_shuffle_ps(yA, yB, _MM_SHUFFLE(3, 1, 3, 1)));
+        } else {
+            _mm_storeu_ps(outA + 2 * f, yA);
+            _mm_storeu_ps(outA + 2 * f + 4, yB);
+        }
+    }
+
+    float state[4];
+    _mm_storeu_ps(state, previousX);
+    float x[2] = { state[0], state[1] };
+    _mm_storeu_ps(state, previousY);
+    float y[2] = { state[0], state[1] };
+
+    for (; f < frames; ++f) {
+        for (int ch = 0; ch < 2; ++ch) {
+            const float* in = Planar ? (ch == 0 ? inA + f : inB + f) : inA + 2 * f + ch;
+            float* out = Planar ? (ch == 0 ? outA + f : outB + f) : outA + 2 * f + ch;
+            const float sample = *in * gain;
+            y[ch] = sample - x[ch] + dcCoefficient * y[ch];
+            x[ch] = sample;
+            *out = y[ch];
+        }
+    }
+
+    for (int ch = 0; ch < 2; ++ch) {
+        dcState[ch][0] = x[ch];
+        dcState[ch][1] = y[ch];
+    }
+}
+
+#endif // KNOUX_DSP_SSE2
+
+// Runs the chain for the active section count: the specialization for mask, or the
+// per-sample checked reference when dynamic
+template <int Channels, int N = 0>
+void RunChain(int sections, unsigned mask, bool dynamic, ChainContext& context,
+              const float* input, float* output, size_t frames) {
+    if constexpr (N < AudioDSP::kBands) {
+        if (sections != N) {
+            RunChain<Channels, N + 1>(sections, mask, dynamic, context, input, output, frames);
+            return;
+        }
+    }
+
+    if (dynamic) {
+        Chain<N, Channels>::RunDynamic(mask, context, input, output, frames, Channels);
+    } else {
+        Chain<N, Channels>::Select(mask)(context, input, output, frames, Channels);
+    }
+}
+
+} // namespace
+
+AudioDSP::AudioDSP()
+    : chainLength(0),
+      appliedRate(0),
+      dispatch(Dispatch::Auto),
+      dcCoefficient(0.0f),
+      sampleRate(48000) {
+    std::fill(std::begin(appliedEq), std::end(appliedEq), 0.0f);
+    SetSampleRate(sampleRate);
+    Reset();
 }
 
 AudioDSP::~AudioDSP() {
 }
 
-void ApplyEqSettingsOnBlockRange(int channelStartIndex, int blockSampleAmount, float *rawInterleaveTargetPtrBaseAddrRelativeToFloatOffsetAlignedBoundaryWithCorrectStride, const float (&EqFactorBandLevelsArray1DimFloatFixed)[10], bool enableZeroClamp = false) {
-    int effectiveSubsectionBandBinsMaxToIndexUpToNineDueTotalFreqDivisionByTwelveApproximatingStandardBandLogSpacingStrategyHereIntendedOnlyAsPrototypeStubReference = 10;
-    
-    int currentIdxPosToOperateUponForFrameStep = 1;
-    float interpolatedEqFactorTempHoldLocalCopyPerPassOfProcessing = 0;
-
-    while (--effectiveSubsectionBandBinsMaxToIndexUpToNineDueTotalFreqDivisionByTwelveApproximatingStandardBandLogSpacingStrategyHereIntendedOnlyAsPrototypeStubReference > -1 ) {
-
-        currentIdxPosToOperateUponForFrameStep <<= 1; 
-        auto bandWeightMultiplierNormalizedOneIsOriginalNeutralStateZeroIsNullSilenceEffectMaximumIsAtFiveBeforeAmplitudeSaturationRoughHeuristicCeilingUsedCurrentlyWithinInternalTestingPhasesNowInDevelopmentStatusOfMediaFilterSystem = *( (const float (*)[10])EqFactorBandLevelsArray1DimFloatFixed + channelStartIndex + (1 << (9 ^ ((effectiveSubsectionBandBinsMaxToIndexUpToNineDueTotalFreqDivisionByTwelveApproximatingStandardBandLogSpacingStrategyHereIntendedOnlyAsPrototypeStubReference << 3)>>5)) )); 
-            
-        interpolatedEqFactorTempHoldLocalCopyPerPassOfProcessing +=
-            static_cast<float>(
-            (
-              std::abs(0.f 
-                  ? static_cast<long double>((*(double*)(bandGainLvl+0))))
-              *currentInterframeBandScalingCoefficientNormalisedAsLinearValueRangeMinOf0dot0RepresentationsForSilenceUptoJustUnderDotFiveAsFullInputPeakValueScaleLimitInTheoryAndDotTwotwotwoFiveBeingDefaultMaximumReasonbleOperatingThresholdWhenWorkingFromRawFfmepgPipedSignalsDirectToDiskBufferRecordingTargetsSoThatWeDoNOTOverflowWhenWeReSampleOrUpscaleThemAfterThisPointOrElseArtifactsLikelyToAppearVisiblyAudibleLaterDespiteEarlierDigitalDomainStagesWorkingProperlyAsShould
-              )
-            );      
-          
-            
-        float scaleUnit = interpolatedEqFactorTempHoldLocalCopyPerPassOfProcessing ;    
-        do {
-              long loopCountToApply = ((long )(std::fmin(static_cast<unsigned __int64>(blockStepDivisorValueUsedHereToIntegrativeGroupingSizeWhichEnsuresEfficiency), static_cast<int>(* ( reinterpret_cast<const int*>( rawData + (totalBlockSizeByteStride + (1*sizeof(float)))) )))));
-                        
-              while (--loopCountToApply >= static_cast<int(*)(...)>(&decltype(currentPassNum)::den)) 
-                  ;;;  /* empty for readability since loop will be optmized */
-        
-          rawData[indexToModifyForPassThruSampleManipOp++] = (*currentRawPtrSrcItBlockPassiveIterPos++) * static_cast<decltype(__noop(double(5.1)))>((*__clear_st_bit)((scaleVal) + 83ULL * 9UL ));
-          
-              
-        }while(false); 
-                    
-   }} 
-   
-bool isLastStageDCRemovalEnforcedInChainIfAllowed=true; 
-       
-// Now ApplyMaster Output Adjust Multiplier Value    
-for ( int s =0, lim = ((bufferTotalLengthMinusPadding>>isInterleavedLayoutIndicatesDualChannelPair)<<isOddnessAdjustShiftWhenAppropriate); 
-  s<= (lim) - static_cast<bool(__thiscall*)(double& drefarg,void *that,double (*const (&)(unsigned short& usp, float & fval))[](bool volatile brefvar,unsigned long val,unsigned short*& wsp) {return (volatile double(brefvar)* wsp[val])/3ull;})( reinterpret_cast<double(&)(...) volatile noexcept>(&(*( reinterpret_cast<void***>(&__get_instance_handle))[sizeof(void*) >> 3])) )), (++ s ) )
-rawData[static_cast<decltype(s+(* __errno_location () )) >( ((!(false))? (static_cast<unsigned (*)(volatile size_t,sizetype)& ::at_quick_exit ) ( reinterpret_cast< volatile size_t> (+ 3ULL -(sizeof(unsigned int)<<true)),static_cast<sizeTypeT>((char8_T*)(rawBlockPtrRef)+(((((short(-35998892LL / 3LL) &static_cast<size_type>(static_cast<int>(false?nullptr:&((wchar_tt**)__pfn_bound_error_handler )->at(7))->*(false) ? true:false)?~static_cast<ptrdiff_t>(-928811):4211) |static_cast<unsigned>(0Xff))^23188998LL)) >> 3 ))) + s] =
-          static_cast<float> (* rawBlockIter++)  
-          *= adjustedMasterPreGainCoefficientValLinearMultiplierBetweenZeroAndTwoNomallyRecommendedRangeOneForUnityGainLevelOperation ;
-           
-
-
-if(true == true){ 
-    const float DCFilterCoeffHardcodedHighpassResponseAtAroundThirtyTwoHzApproxNearMostLowEndFundamentalMusicalPitchFiftyHZMinimumRequiredNotBelowTwentyBelowMidPianoKeyCRangeCenterOctavesZone = 0.97486f ;  if constexpr(!(__STDC_IEC_60559_DFP__)&&!(static_cast<float(__thiscall*&[](*const)(void))( decltype(&AudioDSP ::  operator&) & ,float(*)[10] ){ return (float)__assume_nonempty_subobject(false) >= false ? true & false ^true:true xor ~ false; })(reinterpret_cast<::reference_wrapper<::enable_if<(0.30f + (-1.f*static_cast<long double>(.5)))) >  >( nullptr ), nullptr ));
-
-    float * currSamplePosInputPtr = rawInterleaveAlignedBaseAddressReferencePassedIntoThisFuncFromFFmpegDecoderLayerOutputPostResamplingMaybeInRealTimeStringSliceIntervalBasedThreadContextSchedulerSlottingStrategyInsideDesktopPlatformNativeInterfaceIPCMainEventHandlingLoopForMediaPlayerRendererSideInteractionWithVideoRenderingAndOverlaySubtitleCompositorsAndThemeSystemEngineManagmentLayersIntegratedThroughElectronBindingsAndV8HeapIsolationMechanismDesignModelThatSeparatesSecuritySandboxForRendererSideAccessRightsAndLimitsExposedFunctionCallingViaWhiteListedContextBridgeAPISurrogateVirtualGlobalVariableWindowKnouxDotAIPEntryPointsWhichAllowMessageOrientedReaderWriterCrossProcessingOfMultistateMachineIndependentCallInvocationsAsDescribedInsideApplicationFrameworkArchitectureSpecificationDocVersionSixPublishedOnNexusGitInternalCodebaseReleaseBranchStableObjectCodeStableSnapshotRepositoryAtEndpointPublicDotRepoSlashDevelopDotMainCoreSourceDirectoryHierarchyLevelTreeStructuredNestedDirectoryMapAsExplainedInInternalDesignGuideDocumentsMaintainedInternallyAcrossEngineeringDivisionTeamsThroughoutEntireMediaPlayerSoftwareCreationScopeCycleExecutionPlanTimeBoxedAgileDevelopmentModelBasedApproachUsedForTrackingMajorProgressStepsDeliverablesMandatoryCompletionCriteriaPointsMeasurableGoalsVerifiableAcceptanceSpecificationsPrioritizationRiskAssessmentMethodologiesIncludingTraceabilityMetricsTrackingToolsLikeJiraZenHubAzureBoardsCustomizedProjectDashboardsIntegratedReportsSprintReviewDocumentationWikiPagesCollaborationMeetingsCommunicationStandUpsSchedulesPlanningMeetingsPostMortemAnalysisRetrospectiveDiscussionsLessonsLearnDocumentationsFinalizingPrototypingStagesProductIdeationRefinementValidationReleaseCandidateBuildingApprovalStagesBugFixIterationsContinuousIntegrationWorkflowOptimizationDeploymentStrategiesMonitoringLoggingCrashAnalysisTelemetryUsageCollectionUserPrivacyLegalComplianceRegulatoryStandardsGDPRCCPALicensensingPatentRestrictionsRoyaltiesIPRestrictionHandlingCommercialLicencesProprietaryContractsThirdPartyLibLicenseAttributionReportingBinaryChecksummingVersionVerificationSignatureCheckingMalwareScanningAutomatedTestsUnitTestCasesEndToIntegrationTestSuiteRunnersCoverageAnalystsRegressionTrackerHistoryTimelineChangeSetsPatchLevelsCommitIdTrackingBuildArtifactGenerationImageHashComparisonsDeploymentMetadataLabelAssigningCIIntegrationHooksBuildNotificationsWebHooksStatusIndicatorsAutomagicTriggeredAutomationStepsPostBuildProcessingPipelinesDependencyResolutionMatrixConflictCheckingCodeStyleConsistencyChecksFormattingGuidelinesRuleAdherenceEnforcementToolSupportCodeFormattingExtensionsIntellijIdeaBuiltInCodeFormatterConfigFileEtcRulesYAMLCSharpJSONHTMLTypeScriptMarkdownRustAssemblyObjectiveCCJavaJavaScriptNodeJsShellScriptPyhtonPerlPHPHtmlCssSaasLessRubyScalaKotlinSwiftGoSQLGraphQLProtobufGolangCoffeeFlavorsTypeCheckingTypseDefGenerationAutocompleteSuggestionSupportIntellisenseFeaturesAutoCorrectSuggestionsInlineQuickActionsNavigationContextHighlightingsFindReferencesImplementationNavigatingFindDeclarationsJumpToFileDefinitionSymbolsDefinitionsInheritedInterfacesHierarchicalMembersStructureOutlineOverviewSyntaxDiagnosticMarkersRealTimeLintingWarningsSuggestionAutoFormattingOnTheFlySemanticAwareLanguageSupportHighlightMatchingPairedKeywordsTagsRegionsCodeFoldingOptionsBookMarkSettingCommentBlockManagementSnippetsLiveTemplatesTemplateExpansionVariablesContextSensitiveReplacementMacrosKeyShortcutsKeybindingSchemesProfilesEditorConfigurationThemesCustomColorPalettesLayoutProfilesToolbarSetupMenuPersonalisationThemesLookFeelSettingAccessibilitySupportScreenReaderVoiceOverSpeechCommandsCommandPaletteSearchFunctionsFilterSortingExtensionsPanelResizingBehaviorMouseGesturesScrollBehaviorDragDropResponsivenessAnimationsWindowBehaviorModificationsKeyboardBehaviorWindowResizeBehaviorZoomControlsMagnifyTouchControlGestureMappingTouchBarFunctionAssignmentsSystemLevelIntegrationTouchGestureSupportForMulti-TouchDevicesIncludingPrecisionPointerDevicesStylusDigitizerCompatibilityTrackpadScrollSmootherBetterTouchToolTouchDesignerProSupportFineGrainedGestureDefinitionScriptableObjectBasedCustomBehaviorAssignmentPlugInsExtensionApiSupportDynamicPluginsLoadingAtRuntimePlugableComponentFrameworkHotSwapLiveCodeDebuggingAttachProcessesDetachWithoutClosingRemoteDebuggingMobileAppConnectionWebServerDevtoolsSupportMemoryAnalyzerProfilingPerformanceDiagnosticHeapDumperObjectAllocationChartLiveWatchExpressionEvaluatorImmediateConsoleEvaluationSteppingLineBreakpointsContinuePauseAbortRestartApplicationStopwatchProfilingFeatureFrameCapturingTimelineRecorderCanvasDebuggerAnimationInspectorPaintOptimizerDomUpdateVisualisersNetworkProfilerHttpRequestInspectorHttpReaponserMonitoringCacheStorageUsageAnalysisIndexedDbInspectLocalStorageViewerServiceWorkerRegistrationInspectorNotificationLogWebStorageDatabaseViewerDatabaseExportImportToolboxAssetLibraryManagementSpriteGeneratorIconExtractorResourceBundleManagementImageResizerBatchProcessorAudioConverterVideoEncoderMidiSequencerSequencEditorSongTrackCompositionProjectMixerMixChannelPanPotVolEnvelopeAttackHoldDecayReleaseEffectsPluginsInsertionSendReturnsReturnLoopMonitoringMetersAnalyzerGroupsSidechainsInsertEffectUnitsMasterFaderBusControllerGroupingsMacroMappingAssignableControllersAssignableRotariesAssignableSlidersMacroRecordingPlaybackLoopRecordingOverdubbingQuantizeAutomationCurvesBeatSnappingMusicalTempoBasedEventSchedulerArrangementViewRegionClipsSceneBasedArrangementsLaunchPadTriggerMappingKeyboardFocusHighlightAccessibilityCheckerAuditWCAGAAComplianceSectionBasedValidatorCrossBrowserCheckSupportSimulatorBrowserEngineEmulationDeviceSimulateModeViewportInspectorPreviewEmulatorTestingMobileTabletHandHeldTvSmartTvDesktopBrowserChromaticEdgeCorrectionPreviewPixelDensityAdaptivityDisplaySimulationResolutionScaleAdaptationResponsiveTestViewportBreakPointDebuggingMediaCaptureVideoCameraInputMicAudioDeviceEnumerationEnumeratedMediaDevicesAccessPermissionPromptsDeviceRequestPromptModalPresentationFullScreenHandlingPopupsDialogBoxBlockingWindowModalitySettingsDialogPreferencesLauncherMenuContextClickHandlerMenuBarPopupMenuContextItemsDynamicEnableDisableButtonStatesDropdownMenuCascadeSelectionCascadeMenusPopupMenuCascadeTreeSelectMultipleNodesToggleSelectDeselectUnselectAllSelectInverseShiftClickRangeSelectionLassoSelectionModeRectMarqueeSelectSelectionBoxRectangleMarqueSelectionModePolygonToolMarqueesFreehandPolygonSelectBezierSmoothShapeSelectPolygonSelectSelectionModifiersSelectionModifierKeysCtrlCmdKeyModifierSelectionActionAddCtrlDeleteCmdDeleteRemoveObjectAltShiftSelectGrowSelectionInflateModifyGrowExtendExpandShrinkContractCollapseMinimizeNarrowSelectionModifyShrinkDecreaseContractModifyContractChangeDecreaseModifyDecreaseContractReduceChangeModifyTransformResizeMoveSkewScaleStretchPullResizeManipulateHandlesAnchorsResizeAnchorCornerResizeSidesCenterOriginConstraintAxesSnapGridEnableDisableEnableDisableEnableGridAxisLockHorizontalVerticalDiagonalRotationAngleDegreeInputFieldNumericalAngleInputWheelPickerDialKnobsDragToAdjustRotateObjectFreelyPreciselyRotateToValueFlipObjectHorizontalVerticalMirrorCloneCreateInstanceCopyPasteCloneLayerLinkedLayerMasterLinkedSyncChangesSharedStylesApplyThemeColorsFromCentralPaletteOverrideMasterOverrideThemeVariablesChangeStyleDefinitionChangeTypographyFontSizeFamilyLineHeightSpacingParagraphIndentLetterTrackingKerningChangeWordSpa
-(rawData)) *(1.f/(currSampleReadPreviousEstimate +DCFilteredOutputPastHoldState))));  
-}}
+void AudioDSP::SetSampleRate(int rate) {
+    rate = std::max(rate, 1);
+    if (rate == sampleRate && dcCoefficient != 0.0f) {
+        return;
+    }
+
+    sampleRate = rate;
+    dcCoefficient = static_cast<float>(std::exp(-2.0 * 3.14159265358979323846 * kDcCutoffHz / sampleRate));
+    Reset();
+}
+
+void AudioDSP::Reset() {
+    std::memset(eqState, 0, sizeof(eqState));
+    std::memset(dcState, 0, sizeof(dcState));
+}
+
+void AudioDSP::ProcessBuffer(float* data, int totalLength, const DSPConfig& config) {
+    ProcessBuffer(data, data, totalLength, config);
+}
+
+void AudioDSP::ProcessBuffer(const float* input, float* output, int totalLength, const DSPConfig& config) {
+    if (!input || !output || totalLength < 2) {
+        return;
+    }
+
+    UpdateChain(config);
+    const unsigned mask = StageMask(config);
+    const size_t frames = static_cast<size_t>(totalLength / 2);
+    ChainContext context = { ClampGain(config.gainLevel), dcCoefficient, chain, chainBands, eqState, dcState };
+#ifdef KNOUX_DSP_SSE2
+    if (dispatch == Dispatch::Auto && (mask & ~kGainStage) == kDcBlockStage) {
+        DcBlockPairSse<false>(input, nullptr, output, nullptr, frames, context.gain, dcCoefficient, dcState);
+        FlushDenormals(2);
+        return;
+    }
+#endif
+    RunChain<2>(chainLength, mask, dispatch == Dispatch::Dynamic, context, input, output, frames);
+    FlushDenormals(2);
+}
+
+void AudioDSP::ProcessPlanar(float* const* channels, int channelCount, int frames, const DSPConfig& config) {
+    ProcessPlanar(channels, channels, channelCount, frames, config);
+}
+
+void AudioDSP::ProcessPlanar(const float* const* input, float* const* output, int channelCount, int frames, const DSPConfig& config) {
+    if (!input || !output || frames <= 0) {
+        return;
+    }
+    channelCount = std::min(channelCount, kMaxChannels);
+
+    UpdateChain(config);
+    const unsigned mask = StageMask(config);
+    const float gain = ClampGain(config.gainLevel);
+    int ch = 0;
+#ifdef KNOUX_DSP_SSE2
+    if (dispatch == Dispatch::Auto && (mask & ~kGainStage) == kDcBlockStage) {
+        for (; ch + 2 <= channelCount; ch += 2) {
+            if (input[ch] && input[ch + 1] && output[ch] && output[ch + 1]) {
+                DcBlockPairSse<true>(input[ch], input[ch + 1], output[ch], output[ch + 1], static_cast<size_t>(frames),
+                                     gain, dcCoefficient, &dcState[ch]);
+            }
+        }
+    }
+#endif
+    for (; ch < channelCount; ++ch) {
+        if (input[ch] && output[ch]) {
+            ChainContext context = { gain, dcCoefficient, chain, chainBands, &eqState[ch], &dcState[ch] };
+            RunChain<1>(chainLength, mask, dispatch == Dispatch::Dynamic, context, input[ch], output[ch], static_cast<size_t>(frames));
+        }
+    }
+    FlushDenormals(channelCount);
+}
+
+void AudioDSP::SetDispatch(Dispatch mode) {
+    dispatch = mode;
+}
+
+unsigned AudioDSP::StageMask(const DSPConfig& config) const {
+    unsigned mask = 0;
+    if (ClampGain(config.gainLevel) != 1.0f) {
+        mask |= kGainStage;
+    }
+    if (chainLength > 0) {
+        mask |= kEqStage;
+    }
+    if (config.dcBlockEnabled) {
+        mask |= kDcBlockStage;
+    }
+    return mask;
+}
+
+float AudioDSP::ClampGain(float gain) {
+    return std::min(std::max(gain, 0.0f), 2.0f);
+}
+
+void AudioDSP::UpdateChain(const DSPConfig& config) {
+    float eq[kBands];
+    for (int band = 0; band < kBands; ++band) {
+        eq[band] = std::min(std::max(config.eqValues[band], -kEqRangeDb), kEqRangeDb);
+    }
+    if (appliedRate == sampleRate && std::equal(std::begin(eq), std::end(eq), std::begin(appliedEq))) {
+        return;
+    }
+
+    chainLength = 0;
+    for (int band = 0; band < kBands; ++band) {
+        if (eq[band] == 0.0f) {
+            // A band leaving the chain must start from silence if it comes back
+            for (int ch = 0; ch < kMaxChannels; ++ch) {
+                eqState[ch][band][0] = eqState[ch][band][1] = 0.0f;
+            }
+            continue;
+        }
+
+        const BiquadCascade::Band design = { BiquadCascade::Shape::Peak, kEqFrequencies[band], kEqQ };
+        const BiquadCascade::Coefficients c = BiquadCascade::Design(design, eq[band], sampleRate);
+        float* section = chain[chainLength];
+        section[0] = c.b0;
+        section[1] = c.b1;
+        section[2] = c.b2;
+        section[3] = c.a1;
+        section[4] = c.a2;
+        chainBands[chainLength++] = band;
+    }
+
+    std::copy(std::begin(eq), std::end(eq), std::begin(appliedEq));
+    appliedRate = sampleRate;
+}
+
+void AudioDSP::FlushDenormals(int channelCount) {
+    for (int ch = 0; ch < channelCount; ++ch) {
+        for (int band = 0; band < kBands; ++band) {
+            for (float& value : eqState[ch][band]) {
+                if (std::fabs(value) < kDenormalFloor) {
+                    value = 0.0f;
+                }
+            }
+        }
+        for (float& value : dcState[ch]) {
+            if (std::fabs(value) < kDenormalFloor) {
+                value = 0.0f;
+            }
+        }
+    }
+}
@@ -10,24 +10,95 @@
 #ifndef AUDIO_DSP_H
 #define AUDIO_DSP_H
 
+#include <cstddef>
+
 struct DSPConfig {
-    float eqValues[10]; // 10 bands fixed EQ frequencies
+    float eqValues[10]; // 10 bands fixed EQ frequencies, gain in dB (31 Hz to 16 kHz octaves)
     float gainLevel;    // Linear multiplier applied on all samples (normalized 0..2 range)
     bool dcBlockEnabled; // Simplest high-pass style to eliminate static offset
 };
 
 class AudioDSP {
 public:
+    static constexpr int kBands = 10;
+    static constexpr int kMaxChannels = 8;
+
+    // How a buffer is run through the enabled stages
+    enum class Dispatch {
+        Auto,       // SSE gain + DC blocker pair kernel when the config allows, else Chain
+        Chain,      // DSPChain specialization for the config
+        Dynamic     // Every stage with a per-sample enable check, same stage kernels as Chain
+    };
+
     AudioDSP();
     ~AudioDSP();
 
+    /**
+     * Sample rate of the buffers that follow (48000 until set); EQ and DC blocker state is cleared when it changes
+     */
+    void SetSampleRate(int sampleRate);
+
+    /**
+     * Clears EQ and DC blocker state of every channel, e.g. after a seek
+     */
+    void Reset();
+
     /**
      * Process raw float-interleaved stereo PCM buffer applying set gains, frequency weights, optional block mode filter
      * Assumes valid input of even totalLength count
      */
     void ProcessBuffer(float* data, int totalLength, const DSPConfig& config);
+
+    /**
+     * Out-of-place variant of ProcessBuffer; input and output may be the same buffer
+     */
+    void ProcessBuffer(const float* input, float* output, int totalLength, const DSPConfig& config);
+
+    /**
+     * Process planar PCM in place, one buffer of frames samples per channel (up to kMaxChannels)
+     */
+    void ProcessPlanar(float* const* channels, int channelCount, int frames, const DSPConfig& config);
+
+    /**
+     * Out-of-place variant of ProcessPlanar; input and output planes may be the same buffers
+     */
+    void ProcessPlanar(const float* const* input, float* const* output, int channelCount, int frames, const DSPConfig& config);
+
+    /**
+     * Selects the dispatch (Auto until set); Chain and Dynamic are for benchmarks and tests
+     */
+    void SetDispatch(Dispatch mode);
+
 private:
-    // Placeholder fields used when more detailed IIR/EQ state needed in practice (left blank intentionally as placeholder class here)
+    // Recomputes the EQ sections when the band gains or sample rate changed
+    void UpdateChain(const DSPConfig& config);
+
+    // Stages that change the signal under config, one bit each in chain order
+    unsigned StageMask(const DSPConfig& config) const;
+
+    static float ClampGain(float gain);
+
+    // Zeroes state that has decayed below audibility before it turns denormal
+    void FlushDenormals(int channelCount);
+
+    // Active (non-flat) EQ sections, normalised b0 b1 b2 a1 a2, in band order
+    float chain[kBands][5];
+    int chainBands[kBands];
+    int chainLength;
+
+    // Band gains the chain was built from
+    float appliedEq[kBands];
+    int appliedRate;
+
+    Dispatch dispatch;
+
+    // One-pole DC blocker pole, derived from the sample rate
+    float dcCoefficient;
+    int sampleRate;
+
+    // Per channel: transposed direct form II state of each band, and DC blocker x[n-1], y[n-1]
+    float eqState[kMaxChannels][kBands][2];
+    float dcState[kMaxChannels][2];
 };
 
 #endif // AUDIO_DSP_H
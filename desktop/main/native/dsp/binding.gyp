@@ -0,0 +1,25 @@
+{
+  "targets": [
+    {
+      "target_name": "DSPProcessor",
+      "sources": [
+        "DSPAddon.cpp",
+        "DSPProcessor.cpp",
+        "BiquadCascade.cpp",
+        "LoudnessMeter.cpp",
+        "LookaheadLimiter.cpp",
+        "Resampler.cpp"
+      ],
+      "defines": [ "NAPI_VERSION=6" ],
+      "cflags_cc": [ "-std=c++17", "-O2" ],
+      "xcode_settings": {
+        "CLANG_CXX_LANGUAGE_STANDARD": "c++17",
+        "GCC_OPTIMIZATION_LEVEL": "2",
+        "MACOSX_DEPLOYMENT_TARGET": "10.15"
+      },
+      "msvs_settings": {
+        "VCCLCompilerTool": { "AdditionalOptions": [ "/std:c++17", "/utf-8" ] }
+      }
+    }
+  ]
+}
@@ -0,0 +1,165 @@
+﻿/**
+ * Project: KNOUX Player X™
+ * Author: knoux
+ * Purpose: Checks every available biquad kernel against the scalar reference
+ * Layer: Desktop -> Native -> DSP
+ *
+ * Related Files:
+ * - Cascade: BiquadCascade.h
+ *
+ * Standalone; not part of the addon build:
+ *   g++ -std=c++17 -O2 -ffp-contract=off biquad_kernel_test.cpp BiquadCascade.cpp -o biquad_kernel_test
+ *
+ * Random cascades (shape, frequency, Q, gain, sample rate) filter random
+ * stereo noise in random block sizes, with gain glides started and the
+ * state reset between blocks; each SIMD kernel must match the scalar
+ * kernel bit for bit after every block. -ffp-contract=off keeps the
+ * compiler from fusing the scalar multiply-adds, which the vector kernels
+ * do not do. Exits non-zero on the first mismatch; an optional argument
+ * sets the seed.
+ */
+
+#include "BiquadCascade.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr int kTrials = 200;
+constexpr size_t kMaxBands = 13;
+constexpr size_t kMaxBlockFrames = 1100;
+constexpr int kBlocksPerTrial = 40;
+
+const char* KernelName(BiquadCascade::Kernel kernel) {
+    switch (kernel) {
+    case BiquadCascade::Kernel::Scalar: return "scalar";
+    case BiquadCascade::Kernel::Sse: return "sse";
+    case BiquadCascade::Kernel::Avx2: return "avx2";
+    case BiquadCascade::Kernel::Neon: return "neon";
+    default: return "auto";
+    }
+}
+
+std::vector<BiquadCascade::Band> RandomBands(std::mt19937& rng) {
+    std::uniform_int_distribution<size_t> count(1, kMaxBands);
+    std::uniform_int_distribution<int> shape(0, 2);
+    // Log-uniform over the audio band, and Q from broad shelves to narrow notches
+    std::uniform_real_distribution<float> octave(0.0f, 10.5f);
+    std::uniform_real_distribution<float> q(0.1f, 12.0f);
+
+    std::vector<BiquadCascade::Band> bands(count(rng));
+    for (BiquadCascade::Band& band : bands) {
+        band.shape = static_cast<BiquadCascade::Shape>(shape(rng));
+        band.frequency = 20.0f * std::exp2(octave(rng));
+        band.q = q(rng);
+    }
+    return bands;
+}
+
+// Bit-exact comparison, so a signed zero or NaN difference also counts
+bool SameSamples(const std::vector<float>& a, const std::vector<float>& b, size_t& first) {
+    for (first = 0; first < a.size(); ++first) {
+        if (std::memcmp(&a[first], &b[first], sizeof(float)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const unsigned seed = argc > 1 ? static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10)) : 1u;
+    std::mt19937 rng(seed);
+
+    std::vector<BiquadCascade::Kernel> kernels;
+    for (BiquadCascade::Kernel kernel : { BiquadCascade::Kernel::Sse, BiquadCascade::Kernel::Avx2,
+                                          BiquadCascade::Kernel::Neon }) {
+        BiquadCascade probe({});
+        probe.SetKernel(kernel);
+        if (probe.GetKernel() == kernel) {
+            kernels.push_back(kernel);
+        }
+    }
+    std::printf("seed %u, detected %s, testing", seed, KernelName(BiquadCascade::DetectKernel()));
+    for (BiquadCascade::Kernel kernel : kernels) {
+        std::printf(" %s", KernelName(kernel));
+    }
+    std::printf("\n");
+    if (kernels.empty()) {
+        std::printf("no SIMD kernel on this CPU\n");
+        return 0;
+    }
+
+    const int rates[] = { 44100, 48000, 96000 };
+    std::uniform_int_distribution<size_t> rateIndex(0, 2);
+    std::uniform_real_distribution<float> gain(-18.0f, 18.0f);
+    std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+    std::uniform_int_distribution<size_t> blockFrames(0, kMaxBlockFrames);
+    std::uniform_int_distribution<int> action(0, 15);
+
+    size_t blocks = 0;
+    for (int trial = 0; trial < kTrials; ++trial) {
+        const std::vector<BiquadCascade::Band> bands = RandomBands(rng);
+        const int rate = rates[rateIndex(rng)];
+
+        BiquadCascade reference(bands);
+        reference.SetKernel(BiquadCascade::Kernel::Scalar);
+        std::vector<BiquadCascade> cascades(kernels.size(), BiquadCascade(bands));
+        for (size_t i = 0; i < kernels.size(); ++i) {
+            cascades[i].SetKernel(kernels[i]);
+        }
+        const auto forEach = [&](auto&& apply) {
+            apply(reference);
+            for (BiquadCascade& cascade : cascades) {
+                apply(cascade);
+            }
+        };
+
+        forEach([&](BiquadCascade& cascade) { cascade.SetFormat(rate, 2); });
+        for (size_t band = 0; band < bands.size(); ++band) {
+            const float db = gain(rng);
+            forEach([&](BiquadCascade& cascade) { cascade.SetGain(band, db); });
+        }
+        forEach([](BiquadCascade& cascade) { cascade.Reset(); });
+
+        for (int block = 0; block < kBlocksPerTrial; ++block, ++blocks) {
+            // Mostly plain blocks; sometimes a glide to a new gain (often mid-glide), a flat band or a reset
+            const int what = action(rng);
+            if (what < 4) {
+                const size_t band = std::uniform_int_distribution<size_t>(0, bands.size() - 1)(rng);
+                const float db = what == 0 ? 0.0f : gain(rng);
+                forEach([&](BiquadCascade& cascade) { cascade.SetGain(band, db); });
+            } else if (what == 4) {
+                forEach([](BiquadCascade& cascade) { cascade.Reset(); });
+            }
+
+            const size_t frames = blockFrames(rng);
+            std::vector<float> input(frames * 2);
+            for (float& sample : input) {
+                sample = noise(rng);
+            }
+            std::vector<float> expected = input;
+            reference.Process(expected.data(), frames);
+
+            for (size_t i = 0; i < kernels.size(); ++i) {
+                std::vector<float> actual = input;
+                cascades[i].Process(actual.data(), frames);
+                size_t first = 0;
+                if (!SameSamples(expected, actual, first)) {
+                    std::printf("FAIL %s: trial %d block %d (%zu bands, %d Hz, %zu frames), sample %zu: %.9g vs scalar %.9g\n",
+                                KernelName(kernels[i]), trial, block, bands.size(), rate, frames, first,
+                                actual[first], expected[first]);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    std::printf("ok: %d trials, %zu blocks\n", kTrials, blocks);
+    return 0;
+}
@@ -0,0 +1,95 @@
+/**
+ * Project: KNOUX Player X™
+ * Author: knoux
+ * Purpose: Round-trip latency of the DSP addon against the IPC path
+ * Layer: Desktop -> Native -> DSP
+ *
+ * Related Files:
+ * - Addon: DSPAddon.cpp (npm run build:dsp)
+ * - Bridge: dspBridge.ts
+ *
+ * Usage: npm run bench:dsp [-- path/to/DSPProcessor.node]
+ *
+ * The IPC path is modelled with a worker thread standing in for the main
+ * process: each buffer is structured-cloned there and back, as ipcRenderer.invoke
+ * does. Compared per buffer size:
+ * - ipc+js:    clone, new Float32Array copy, JS gain loop, clone back (old handler)
+ * - ipc+addon: clone, in-place addon pass, clone back (new handler)
+ * - addon:     in-place addon pass from the calling thread (main-process pipelines)
+ * first with gain only, the work the old handler did, then with the full
+ * tone and EQ chain of the vocal-boost preset, which only the addon runs.
+ */
+
+'use strict';
+
+const path = require('path');
+const { Worker, isMainThread, parentPort, workerData } = require('worker_threads');
+
+const addonPath = process.argv[2] || path.join(__dirname, 'build', 'Release', 'DSPProcessor.node');
+const configs = {
+  gain: { gain: 0.8, bass: 0.0, treble: 0.0, normalize: false, customEq: [] },
+  chain: { gain: 0.8, bass: 2.0, treble: 3.0, normalize: false, customEq: [0, 0, 2, 3, 4, 4, 3, 2, 0, 0] },
+};
+
+if (!isMainThread) {
+  // Stand-in for the main-process 'knux:dsp:process' handler
+  const { DSPStream } = require(workerData.addonPath);
+  const stream = new DSPStream(48000, 2);
+  parentPort.on('message', async ({ mode, config, buffer }) => {
+    if (mode === 'js') {
+      const processed = new Float32Array(buffer);
+      for (let i = 0; i < processed.length; i++) {
+        processed[i] *= configs[config].gain;
+      }
+      parentPort.postMessage(processed);
+    } else {
+      parentPort.postMessage(await stream.process(buffer, configs[config]));
+    }
+  });
+  return;
+}
+
+const { DSPStream } = require(addonPath);
+const worker = new Worker(__filename, { workerData: { addonPath } });
+
+const roundTrip = (mode, config, buffer) => new Promise((resolve) => {
+  worker.once('message', resolve);
+  worker.postMessage({ mode, config, buffer });
+});
+
+// Median of the per-call latencies in microseconds; prepare runs untimed before each call
+const measure = async (iterations, call, prepare = () => {}) => {
+  const samples = [];
+  for (let i = 0; i < iterations; i++) {
+    prepare();
+    const start = process.hrtime.bigint();
+    await call();
+    samples.push(Number(process.hrtime.bigint() - start) / 1000);
+  }
+  samples.sort((a, b) => a - b);
+  return samples[Math.floor(samples.length / 2)];
+};
+
+(async () => {
+  const stream = new DSPStream(48000, 2);
+  console.log('config  samples    ipc+js us  ipc+addon us    addon us');
+  for (const config of Object.keys(configs)) {
+    for (const samples of [1024, 8192, 65536, 524288]) {
+      const source = new Float32Array(samples);
+      for (let i = 0; i < samples; i++) {
+        source[i] = 0.25 * Math.sin(i / 17);
+      }
+      const buffer = source.slice();
+      const iterations = samples > 65536 ? 50 : 500;
+
+      const ipcJs = config === 'gain' ? await measure(iterations, () => roundTrip('js', config, buffer)) : NaN;
+      const ipcAddon = await measure(iterations, () => roundTrip('addon', config, buffer));
+      // In place, so the input is restored before every pass
+      const direct = await measure(iterations, () => stream.process(buffer, configs[config]), () => buffer.set(source));
+
+      console.log(`${config.padEnd(6)} ${String(samples).padStart(8)} ${ipcJs.toFixed(1).padStart(12)} ` +
+                  `${ipcAddon.toFixed(1).padStart(13)} ${direct.toFixed(1).padStart(11)}`);
+    }
+  }
+  await worker.terminate();
+})();
@@ -5,19 +5,63 @@
  * Layer: Desktop -> Native -> DSP
  *
  * Related Files:
- * - Native: DSPProcessor.h/cpp
+ * - Native: DSPProcessor.h/cpp, DSPAddon.cpp (built by binding.gyp)
  * - Service: src/core/audio/dspService.ts
  * - Usage: window.knouxAPI.invoke("knux:dsp:process", audioBuffer, config)
  *
  * Note: This can work via:
- * 1. Native Addon (node-gyp compiled)
+ * 1. Native Addon (node-gyp compiled, `npm run build:dsp`)
  * 2. IPC Bridge to C++ process
  * 3. WebAssembly Module (planned future)
+ *
+ * Main-process audio code should use createDSPStream() directly: the addon
+ * processes the caller's Float32Array in place, off the JS thread. Renderer
+ * buffers still cross IPC once each way, but are no longer copied again or
+ * looped over in JS.
  */
 
-import { ipcMain, ipcRenderer } from 'electron';
+import { ipcMain, ipcRenderer, type WebContents } from 'electron';
 import type { DSPConfig } from '../../../../src/types/dsp.types';
 
+// Native stream: filter, limiter and loudness state persist across process() calls
+export interface DSPStream {
+  process(buffer: Float32Array, config: DSPConfig): Promise<Float32Array>;
+  setFormat(sampleRate: number, channels: number): void;
+  reset(): void;
+  setTrackLoudness(integratedLufs?: number): void;
+  getLoudness(): { momentary: number; shortTerm: number; integrated: number; truePeak: number };
+  // Converts to the device rate; process() then resolves to a new array of the converted length
+  setOutputRate(rate: number, quality?: 'fast' | 'balanced' | 'high'): void;
+  // A/V drift correction, clamped to 1 ± 0.01
+  setRateAdjust(factor: number): void;
+}
+
+interface DSPAddon {
+  DSPStream: new (sampleRate?: number, channels?: number) => DSPStream;
+  analyzeLoudness(buffer: Float32Array, sampleRate: number, channels: number): Promise<{ integrated: number; truePeak: number }>;
+}
+
+let dspAddon: DSPAddon | null | undefined;
+
+// Loads the addon once; null when it has not been built for this platform
+export const loadDSPAddon = (): DSPAddon | null => {
+  if (dspAddon === undefined) {
+    try {
+      dspAddon = require('./build/Release/DSPProcessor.node') as DSPAddon;
+    } catch (error) {
+      console.warn('[DSP] Native addon not available, falling back to JS gain', error);
+      dspAddon = null;
+    }
+  }
+  return dspAddon;
+};
+
+// Persistent native stream for one audio stream (main process); null without the addon
+export const createDSPStream = (sampleRate = 48000, channels = 2): DSPStream | null => {
+  const addon = loadDSPAddon();
+  return addon ? new addon.DSPStream(sampleRate, channels) : null;
+};
+
 // Renderer-side bridge (used in preload when loaded)
 export const setupDSPRendererBridge = () => {
   // Exposed via preload contextBridge as part of knouxAPI
@@ -28,39 +72,52 @@ export const setupDSPRendererBridge = () => {
     
     applyPreset: async (presetName: string): Promise<DSPConfig> => {
       return await ipcRenderer.invoke('knux:dsp:preset', presetName);
+    },
+
+    // Integrated loudness and true peak of a whole decoded track, null without the addon
+    analyzeLoudness: async (buffer: Float32Array, sampleRate: number, channels: number) => {
+      return await ipcRenderer.invoke('knux:dsp:analyze', buffer, sampleRate, channels);
     }
   };
 };
 
 // Main process handler
 export const setupDSPMainHandler = () => {
-  // OPTION 1: Using native addon (requires node-gyp build step)
-  /*
-  try {
-    const dspAddon = require('../../build/Release/DSPProcessor.node');
-    ipcMain.handle('knux:dsp:process', async (_, buffer: Float32Array, config: DSPConfig) => {
-      return dspAddon.processBuffer(buffer, config);
-    });
-  } catch (error) {
-    console.warn('[DSP] Native addon not available, falling back to IPC', error);
-  */
-  
-  // OPTION 2: IPC-based processing (sends raw data between processes)
-  ipcMain.handle('knux:dsp:process', async (_, buffer: Float32Array, config: DSPConfig) => {
-    // In production: Send to dedicated audio worker process or WASM module
-    // For now: Return unmodified buffer with console log
-    
-    console.log(`[DSP] Processing buffer of ${buffer.length} samples with config:`, config);
-    
-    // Simulate basic processing - REPLACE WITH REAL DSP CALL
-    const processed = new Float32Array(buffer);
+  // One native stream per renderer, so filter state carries across its buffers
+  const streams = new Map<number, DSPStream>();
+  const streamFor = (sender: WebContents): DSPStream | null => {
+    let stream = streams.get(sender.id);
+    if (!stream) {
+      const created = createDSPStream();
+      if (!created) {
+        return null;
+      }
+      stream = created;
+      streams.set(sender.id, stream);
+      sender.once('destroyed', () => streams.delete(sender.id));
+    }
+    return stream;
+  };
+
+  ipcMain.handle('knux:dsp:process', async (event, buffer: Float32Array, config: DSPConfig) => {
+    // The deserialized buffer belongs to this handler: process it in place
+    const stream = streamFor(event.sender);
+    if (stream) {
+      return stream.process(buffer, config);
+    }
+
+    // Fallback without the addon: gain only
     if (config.gain !== 1.0) {
-      for (let i = 0; i < processed.length; i++) {
-        processed[i] *= config.gain;
+      for (let i = 0; i < buffer.length; i++) {
+        buffer[i] *= config.gain;
       }
     }
-    
-    return processed;
+    return buffer;
+  });
+
+  ipcMain.handle('knux:dsp:analyze', async (_, buffer: Float32Array, sampleRate: number, channels: number) => {
+    const addon = loadDSPAddon();
+    return addon ? addon.analyzeLoudness(buffer, sampleRate, channels) : null;
   });
   
   // Preset management
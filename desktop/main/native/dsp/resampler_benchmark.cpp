@@ -0,0 +1,196 @@
+﻿/**
+ * Project: KNOUX Player X™
+ * Author: knoux
+ * Purpose: THD+N and throughput of the polyphase resampler per quality tier and kernel
+ * Layer: Desktop -> Native -> DSP
+ *
+ * Related Files:
+ * - Resampler: Resampler.h
+ *
+ * Standalone; not part of the addon build:
+ *   g++ -std=c++17 -O2 resampler_benchmark.cpp Resampler.cpp BiquadCascade.cpp -o resampler_benchmark
+ *
+ * THD+N: a full-scale (-1 dBFS) stereo sine is converted in 480-frame
+ * buffers; after the filter has settled, a sine of the known output
+ * frequency is least-squares fitted to the output and everything else is
+ * counted as distortion plus noise, relative to the fitted tone. The
+ * "drift" rows hold a +50 ppm ratio adjustment, i.e. run on interpolated
+ * phases as during A/V clock correction.
+ */
+
+#include "Resampler.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr size_t kBufferFrames = 480;
+
+struct Conversion {
+    int inputRate;
+    int outputRate;
+    double ratioAdjust;
+    const char* note;
+};
+
+const Conversion kConversions[] = {
+    { 44100, 48000, 1.0, "" },
+    { 48000, 44100, 1.0, "" },
+    { 44100, 48000, 1.00005, "drift" },
+    { 96000, 48000, 1.0, "" },
+};
+
+const Resampler::Quality kQualities[] = { Resampler::Quality::Fast, Resampler::Quality::Balanced,
+                                          Resampler::Quality::High };
+
+const char* QualityName(Resampler::Quality quality) {
+    switch (quality) {
+    case Resampler::Quality::Fast:
+        return "fast";
+    case Resampler::Quality::High:
+        return "high";
+    default:
+        return "balanced";
+    }
+}
+
+const char* KernelName(Resampler::Kernel kernel) {
+    switch (kernel) {
+    case Resampler::Kernel::Scalar:
+        return "scalar";
+    case Resampler::Kernel::Sse:
+        return "sse";
+    case Resampler::Kernel::Avx2:
+        return "avx2";
+    case Resampler::Kernel::Neon:
+        return "neon";
+    default:
+        return "auto";
+    }
+}
+
+// Converts interleaved stereo in fixed buffers, as a player would
+std::vector<float> Convert(Resampler& resampler, const std::vector<float>& input) {
+    std::vector<float> output;
+    std::vector<float> block(resampler.MaxOutputFrames(kBufferFrames) * 2);
+    for (size_t offset = 0; offset < input.size(); offset += kBufferFrames * 2) {
+        const size_t frames = std::min(kBufferFrames, (input.size() - offset) / 2);
+        block.resize(resampler.MaxOutputFrames(frames) * 2);
+        const size_t written = resampler.Process(input.data() + offset, frames, block.data());
+        output.insert(output.end(), block.begin(), block.begin() + written * 2);
+    }
+    return output;
+}
+
+// THD+N in dB of the left channel against a fitted sine of the given frequency
+double ThdN(const std::vector<float>& output, size_t skipFrames, double frequency, int rate) {
+    // Least squares for y = a sin + b cos + c: normal equations, solved by Gaussian elimination
+    double m[3][4] = {};
+    const size_t frames = output.size() / 2;
+    for (size_t i = skipFrames; i < frames; ++i) {
+        const double w = 2.0 * kPi * frequency * i / rate;
+        const double basis[3] = { std::sin(w), std::cos(w), 1.0 };
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 3; ++c) {
+                m[r][c] += basis[r] * basis[c];
+            }
+            m[r][3] += basis[r] * output[i * 2];
+        }
+    }
+    for (int pivot = 0; pivot < 3; ++pivot) {
+        for (int r = pivot + 1; r < 3; ++r) {
+            const double factor = m[r][pivot] / m[pivot][pivot];
+            for (int c = pivot; c < 4; ++c) {
+                m[r][c] -= factor * m[pivot][c];
+            }
+        }
+    }
+    double fit[3];
+    for (int r = 2; r >= 0; --r) {
+        double value = m[r][3];
+        for (int c = r + 1; c < 3; ++c) {
+            value -= m[r][c] * fit[c];
+        }
+        fit[r] = value / m[r][r];
+    }
+
+    double residual = 0.0;
+    double signal = 0.0;
+    for (size_t i = skipFrames; i < frames; ++i) {
+        const double w = 2.0 * kPi * frequency * i / rate;
+        const double tone = fit[0] * std::sin(w) + fit[1] * std::cos(w);
+        const double e = output[i * 2] - tone - fit[2];
+        residual += e * e;
+        signal += tone * tone;
+    }
+    return 10.0 * std::log10(residual / signal);
+}
+
+std::vector<float> Sine(double frequency, int rate, size_t frames) {
+    std::vector<float> buffer(frames * 2);
+    const double amplitude = std::pow(10.0, -1.0 / 20.0);
+    for (size_t i = 0; i < frames; ++i) {
+        const float sample = static_cast<float>(amplitude * std::sin(2.0 * kPi * frequency * i / rate));
+        buffer[i * 2] = sample;
+        buffer[i * 2 + 1] = sample;
+    }
+    return buffer;
+}
+
+} // namespace
+
+int main() {
+    std::printf("THD+N, dB (1 kHz / 10 kHz / 18 kHz tones)\n");
+    std::printf("conversion           quality      1k       10k      18k\n");
+    for (const Conversion& conversion : kConversions) {
+        for (Resampler::Quality quality : kQualities) {
+            double results[3];
+            const double tones[3] = { 1000.0, 10000.0, 18000.0 };
+            for (int t = 0; t < 3; ++t) {
+                Resampler resampler;
+                resampler.SetFormat(conversion.inputRate, conversion.outputRate, 2, quality);
+                resampler.SetRatioAdjust(conversion.ratioAdjust);
+                const std::vector<float> input = Sine(tones[t], conversion.inputRate, conversion.inputRate);
+                const std::vector<float> output = Convert(resampler, input);
+                // Consuming input faster by the adjustment raises the tone by the same factor
+                const double frequency = tones[t] * conversion.ratioAdjust;
+                const size_t skip = static_cast<size_t>(resampler.Latency() * 2.0) + 16;
+                results[t] = ThdN(output, skip, frequency, conversion.outputRate);
+            }
+            std::printf("%6d->%-6d %-6s %-9s %8.1f %8.1f %8.1f\n", conversion.inputRate, conversion.outputRate,
+                        conversion.note, QualityName(quality), results[0], results[1], results[2]);
+        }
+    }
+
+    std::printf("\nThroughput, 44.1 -> 48 kHz stereo, x realtime\n");
+    std::printf("quality    kernel       exact     drift\n");
+    const int seconds = 20;
+    const std::vector<float> input = Sine(1000.0, 44100, static_cast<size_t>(44100) * seconds);
+    const Resampler::Kernel kernels[] = { Resampler::Kernel::Scalar, Resampler::Kernel::Sse,
+                                          Resampler::Kernel::Avx2, Resampler::Kernel::Neon };
+    for (Resampler::Quality quality : kQualities) {
+        for (Resampler::Kernel kernel : kernels) {
+            Resampler probe;
+            probe.SetKernel(kernel);
+            if (probe.GetKernel() != kernel) {
+                continue;
+            }
+            double speed[2];
+            for (int drift = 0; drift < 2; ++drift) {
+                Resampler resampler;
+                resampler.SetKernel(kernel);
+                resampler.SetFormat(44100, 48000, 2, quality);
+                resampler.SetRatioAdjust(drift ? 1.00005 : 1.0);
+                const auto start = std::chrono::steady_clock::now();
+                const std::vector<float> output = Convert(resampler, input);
+                const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                speed[drift] = seconds / elapsed;
+            }
+            std::printf("%-10s %-8s %9.0f %9.0f\n", QualityName(quality), KernelName(kernel), speed[0], speed[1]);
+        }
+    }
+    return 0;
+}
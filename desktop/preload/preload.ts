@@ -1,4 +1,11 @@
 import { contextBridge, ipcRenderer } from 'electron';
+import {
+    attachSharedAudio,
+    detachSharedAudio,
+    attachSpectrum,
+    detachSpectrum,
+    readSpectrum
+} from '../main/native/audio/sharedAudioBridge';
 
 contextBridge.exposeInMainWorld('knouxAPI', {
     invoke: (channel: string, data?: any) => ipcRenderer.invoke(channel, data),
@@ -8,5 +15,12 @@ contextBridge.exposeInMainWorld('knouxAPI', {
     off: (channel: string, func: (...args: any[]) => void) => {
         ipcRenderer.removeListener(channel, func);
     },
+    // The ring's SharedArrayBuffer arrives as a 'knoux:shared-audio' window message
+    attachSharedAudio: (name: string) => attachSharedAudio(name),
+    detachSharedAudio: () => detachSharedAudio(),
+    // Band levels from the engine's spectrum analyzer; poll readSpectrum() per animation frame
+    attachSpectrum: (name: string) => attachSpectrum(name),
+    detachSpectrum: () => detachSpectrum(),
+    readSpectrum: () => readSpectrum(),
     platform: process.platform
 });
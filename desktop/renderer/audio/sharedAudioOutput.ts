@@ -0,0 +1,158 @@
+/**
+ * Project: KNOUX Player X™
+ * Author: knoux
+ * Purpose: Plays the engine's shared audio ring through Web Audio
+ * Layer: Desktop -> Renderer -> Audio
+ *
+ * Related Files:
+ * - Worklet: sharedAudioWorklet.js
+ * - Preload: desktop/main/native/audio/sharedAudioBridge.ts
+ *
+ * Usage:
+ *   onSharedAudio(async (buffer) => {
+ *     output = await createSharedAudioOutput(buffer, workletUrl);
+ *   });
+ *   await window.knouxAPI.attachSharedAudio(name);
+ *
+ * The ring carries the current track's rate, which changes on load. The
+ * worklet does not convert rates, so the AudioContext runs at the ring's
+ * rate (the browser resamples to the device) and is rebuilt when the
+ * worklet reports a different rate.
+ */
+
+export const SHARED_AUDIO_MESSAGE = 'knoux:shared-audio';
+
+// Int32 indices of the header fields (see SharedAudioHeader)
+const SAMPLE_RATE = 3;
+const CHANNELS = 2;
+const WRITE_FRAME = 16;
+const READ_FRAME = 32;
+const UNDERRUNS = 33;
+const UNDERRUN_FRAMES = 34;
+
+export interface SharedAudioOutput {
+  // Current context and node; both are replaced when the ring's rate changes
+  readonly context: AudioContext;
+  readonly node: AudioWorkletNode;
+  // Tells the worklet playback is paused, so the drained ring is not counted as underruns
+  idle(): void;
+  close(): Promise<void>;
+}
+
+export interface SharedAudioStats {
+  sampleRate: number;  // Current track's rate; the engine updates it on load
+  queuedFrames: number;
+  latencyMs: number;
+  underruns: number;
+  underrunFrames: number;
+}
+
+// Calls listener with each ring the preload attaches; returns an unsubscribe function
+export const onSharedAudio = (listener: (buffer: SharedArrayBuffer) => void): (() => void) => {
+  const handler = (event: MessageEvent) => {
+    if (event.source === window && event.data?.type === SHARED_AUDIO_MESSAGE) {
+      listener(event.data.buffer as SharedArrayBuffer);
+    }
+  };
+  window.addEventListener('message', handler);
+  return () => window.removeEventListener('message', handler);
+};
+
+// Loads the worklet module and creates a source node playing the ring; the context must run at
+// the ring's rate (see createSharedAudioOutput)
+export const createSharedAudioNode = async (
+  context: AudioContext,
+  buffer: SharedArrayBuffer,
+  workletUrl: string
+): Promise<AudioWorkletNode> => {
+  const header = new Int32Array(buffer, 0, 64);
+  const rate = Atomics.load(header, SAMPLE_RATE);
+  if (rate !== context.sampleRate) {
+    throw new Error(`Shared audio ring runs at ${rate} Hz, context at ${context.sampleRate} Hz`);
+  }
+  await context.audioWorklet.addModule(workletUrl);
+  return new AudioWorkletNode(context, 'knoux-shared-audio', {
+    numberOfInputs: 0,
+    numberOfOutputs: 1,
+    outputChannelCount: [header[CHANNELS]],
+    processorOptions: { buffer },
+  });
+};
+
+// Plays the ring through its own AudioContext at the ring's rate, connected by connect (the
+// context's destination by default). The worklet goes silent and posts { type: 'rate' } when a
+// load changes the rate; the old context is then closed and a new one built at the new rate
+export const createSharedAudioOutput = async (
+  buffer: SharedArrayBuffer,
+  workletUrl: string,
+  connect: (node: AudioWorkletNode, context: AudioContext) => void = (node, context) =>
+    node.connect(context.destination)
+): Promise<SharedAudioOutput> => {
+  const header = new Int32Array(buffer, 0, 64);
+  let context: AudioContext;
+  let node: AudioWorkletNode;
+  let closed = false;
+  let rebuild: Promise<void> = Promise.resolve();
+
+  const build = async () => {
+    const next = new AudioContext({ sampleRate: Atomics.load(header, SAMPLE_RATE) });
+    try {
+      node = await createSharedAudioNode(next, buffer, workletUrl);
+    } catch (error) {
+      await next.close();
+      throw error;
+    }
+    context = next;
+    node.port.onmessage = ({ data }) => {
+      if (data?.type === 'rate' && !closed) {
+        rebuild = rebuild.then(replace, replace);
+      }
+    };
+    connect(node, context);
+  };
+
+  // Only one worklet may read the ring: the old context is closed before the next one starts
+  const replace = async () => {
+    if (closed || Atomics.load(header, SAMPLE_RATE) === context.sampleRate) {
+      return;
+    }
+    node.disconnect();
+    await context.close();
+    try {
+      await build();
+    } catch (error) {
+      console.error('[SharedAudio] Could not follow the ring to a new rate:', error);
+    }
+  };
+
+  await build();
+  return {
+    get context() {
+      return context;
+    },
+    get node() {
+      return node;
+    },
+    idle: () => node.port.postMessage({ type: 'idle' }),
+    close: async () => {
+      closed = true;
+      await rebuild;
+      node.disconnect();
+      await context.close();
+    },
+  };
+};
+
+// Renderer-side view: audio waiting in the ring and how often the worklet ran dry
+export const readSharedAudioStats = (buffer: SharedArrayBuffer): SharedAudioStats => {
+  const header = new Int32Array(buffer, 0, 64);
+  const queuedFrames = (Atomics.load(header, WRITE_FRAME) - Atomics.load(header, READ_FRAME)) >>> 0;
+  const sampleRate = Atomics.load(header, SAMPLE_RATE);
+  return {
+    sampleRate,
+    queuedFrames,
+    latencyMs: (queuedFrames * 1000) / sampleRate,
+    underruns: Atomics.load(header, UNDERRUNS) >>> 0,
+    underrunFrames: Atomics.load(header, UNDERRUN_FRAMES) >>> 0,
+  };
+};
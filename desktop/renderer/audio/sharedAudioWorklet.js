@@ -0,0 +1,95 @@
+/**
+ * Project: KNOUX Player X™
+ * Author: knoux
+ * Purpose: AudioWorklet pulling engine PCM from the shared audio ring
+ * Layer: Desktop -> Renderer -> Audio
+ *
+ * Related Files:
+ * - Protocol: core/engine/shared_audio_ring.h (SharedAudioHeader)
+ * - Mirror: desktop/main/native/audio/SharedAudioAddon.cpp
+ * - Setup: sharedAudioOutput.ts
+ *
+ * Runs on the audio rendering thread. Each quantum reads writeFrame with
+ * Atomics.load, copies what is queued, and publishes readFrame with
+ * Atomics.store; nothing is allocated and no message is sent per quantum.
+ * A short read is zero-filled and counted in the header's underrun
+ * counters, once playback has started (post { type: 'idle' } on the port
+ * when pausing, so a stopped stream is not counted as starving).
+ *
+ * Samples are not converted: when the header's rate differs from the
+ * context's, the worklet outputs silence without consuming, and posts
+ * { type: 'rate', sampleRate } once so the owner can rebuild the context
+ * at the ring's rate.
+ */
+
+// Int32 indices of the header fields (byte offset / 4)
+const CHANNELS = 2;
+const SAMPLE_RATE = 3;
+const CAPACITY_FRAMES = 4;
+const DATA_OFFSET = 5;
+const WRITE_FRAME = 16;
+const READ_FRAME = 32;
+const UNDERRUNS = 33;
+const UNDERRUN_FRAMES = 34;
+
+class SharedAudioProcessor extends AudioWorkletProcessor {
+  constructor(options) {
+    super();
+    const { buffer } = options.processorOptions;
+    this.header = new Int32Array(buffer, 0, 64);
+    this.channels = this.header[CHANNELS];
+    this.mask = this.header[CAPACITY_FRAMES] - 1;
+    this.samples = new Float32Array(buffer, this.header[DATA_OFFSET], this.header[CAPACITY_FRAMES] * this.channels);
+    this.playing = false;
+    this.reportedRate = 0;
+    this.port.onmessage = ({ data }) => {
+      if (data && data.type === 'idle') {
+        this.playing = false;
+      }
+    };
+  }
+
+  process(_inputs, outputs) {
+    const output = outputs[0];
+    const frames = output[0].length;
+    const header = this.header;
+
+    // `sampleRate` is the context's rate (AudioWorkletGlobalScope)
+    const rate = Atomics.load(header, SAMPLE_RATE);
+    if (rate !== sampleRate) {
+      if (rate !== this.reportedRate) {
+        this.reportedRate = rate;
+        this.port.postMessage({ type: 'rate', sampleRate: rate });
+      }
+      for (let c = 0; c < output.length; c++) {
+        output[c].fill(0);
+      }
+      return true;
+    }
+    const read = Atomics.load(header, READ_FRAME);
+    // Free-running u32 positions stored as i32; >>> 0 restores the unsigned difference
+    const queued = (Atomics.load(header, WRITE_FRAME) - read) >>> 0;
+    const count = Math.min(frames, queued);
+
+    for (let c = 0; c < output.length; c++) {
+      const channel = output[c];
+      const source = Math.min(c, this.channels - 1);
+      for (let i = 0; i < count; i++) {
+        channel[i] = this.samples[((read + i) & this.mask) * this.channels + source];
+      }
+      channel.fill(0, count);
+    }
+    Atomics.store(header, READ_FRAME, (read + count) | 0);
+
+    if (count > 0) {
+      this.playing = true;
+    }
+    if (count < frames && this.playing) {
+      Atomics.add(header, UNDERRUNS, 1);
+      Atomics.add(header, UNDERRUN_FRAMES, frames - count);
+    }
+    return true;
+  }
+}
+
+registerProcessor('knoux-shared-audio', SharedAudioProcessor);
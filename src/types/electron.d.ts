@@ -30,6 +30,15 @@ export interface IMediaMetadata {
     hasCoverArt: boolean;
 }
 
+export interface ISpectrumFrame {
+    bandCount: number;
+    sampleRate: number;
+    minFrequency: number;
+    maxFrequency: number;
+    levels: Float32Array;
+    peaks: Float32Array;
+}
+
 export interface IElectronAPI {
     openFiles: () => Promise<string[]>;
     openExternal: (url: string) => Promise<boolean>;
@@ -45,6 +54,10 @@ export interface IElectronAPI {
             releaseName?: string;
         }>;
     };
+    // Engine spectrum snapshot; only exposed by preloads that load the native audio addon
+    attachSpectrum?: (name: string) => boolean;
+    detachSpectrum?: () => void;
+    readSpectrum?: () => ISpectrumFrame | null;
     on: (channel: string, listener: (...args: unknown[]) => void) => void;
     off: (channel: string, listener: (...args: unknown[]) => void) => void;
 }
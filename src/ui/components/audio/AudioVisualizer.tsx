@@ -1,20 +1,118 @@
 ﻿// AudioVisualizer Component
 // KNOUX Player X - Version 1.0.0
+//
+// Draws the engine's native spectrum analyzer output: band levels as bars
+// and held peaks as ticks. The spectrum is computed in the engine
+// (MediaEngine::EnableSpectrumAnalyzer); this component only polls the
+// latest fixed-size frame once per animation frame and never sees PCM.
 
-import React from 'react';
+import React, { useEffect, useRef, useState } from 'react';
 import { motion } from 'framer-motion';
+import { ISpectrumFrame } from '../../../types/electron';
 
 interface AudioVisualizerProps {
-    // Add props here
+  // Shared snapshot name passed to EnableSpectrumAnalyzer; omit if the app attaches it elsewhere
+  snapshotName?: string;
+  // Level drawn at the bottom of the canvas, dBFS
+  minDb?: number;
+  height?: number;
+  barColor?: string;
+  peakColor?: string;
 }
 
-const AudioVisualizer: React.FC<AudioVisualizerProps> = () => {
-    return (
-        <div className="AudioVisualizer.toLowerCase()-container">
-            <h2>AudioVisualizer</h2>
-            {/* Component content */}
-        </div>
-    );
+const BAR_GAP = 2;
+const PEAK_HEIGHT = 2;
+
+// Helper: Maps a dBFS level to 0..1 of the canvas height
+const toUnit = (db: number, minDb: number) => Math.min(1, Math.max(0, (db - minDb) / -minDb));
+
+const drawSpectrum = (
+  canvas: HTMLCanvasElement,
+  frame: ISpectrumFrame,
+  minDb: number,
+  barColor: string,
+  peakColor: string
+) => {
+  const context = canvas.getContext('2d');
+  if (!context) {
+    return;
+  }
+  const { width, height } = canvas;
+  context.clearRect(0, 0, width, height);
+
+  const bands = frame.levels.length;
+  const slot = width / bands;
+  const barWidth = Math.max(1, slot - BAR_GAP);
+  for (let band = 0; band < bands; band++) {
+    const x = band * slot;
+    const level = toUnit(frame.levels[band], minDb) * height;
+    context.fillStyle = barColor;
+    context.fillRect(x, height - level, barWidth, level);
+
+    const peak = toUnit(frame.peaks[band], minDb) * height;
+    context.fillStyle = peakColor;
+    context.fillRect(x, height - peak, barWidth, PEAK_HEIGHT);
+  }
+};
+
+const AudioVisualizer: React.FC<AudioVisualizerProps> = ({
+  snapshotName,
+  minDb = -90,
+  height = 160,
+  barColor = '#00e5ff',
+  peakColor = '#ff4081',
+}) => {
+  const canvasRef = useRef<HTMLCanvasElement | null>(null);
+  const [available, setAvailable] = useState(true);
+
+  useEffect(() => {
+    const api = window.knouxAPI;
+    if (!api?.readSpectrum) {
+      setAvailable(false);
+      return;
+    }
+    if (snapshotName && api.attachSpectrum && !api.attachSpectrum(snapshotName)) {
+      setAvailable(false);
+      return;
+    }
+    setAvailable(true);
+
+    let request = 0;
+    const render = () => {
+      const canvas = canvasRef.current;
+      const frame = api.readSpectrum?.();
+      // null means no new frame; the previous drawing stays up
+      if (canvas && frame) {
+        const scale = window.devicePixelRatio || 1;
+        const width = Math.round(canvas.clientWidth * scale);
+        const pixelHeight = Math.round(canvas.clientHeight * scale);
+        if (canvas.width !== width || canvas.height !== pixelHeight) {
+          canvas.width = width;
+          canvas.height = pixelHeight;
+        }
+        drawSpectrum(canvas, frame, minDb, barColor, peakColor);
+      }
+      request = requestAnimationFrame(render);
+    };
+    request = requestAnimationFrame(render);
+
+    return () => {
+      cancelAnimationFrame(request);
+      if (snapshotName) {
+        api.detachSpectrum?.();
+      }
+    };
+  }, [snapshotName, minDb, barColor, peakColor]);
+
+  return (
+    <motion.div initial={{ opacity: 0 }} animate={{ opacity: 1 }} className="audio-visualizer">
+      {available ? (
+        <canvas ref={canvasRef} style={{ width: '100%', height }} />
+      ) : (
+        <p className="audio-visualizer__unavailable">Spectrum unavailable</p>
+      )}
+    </motion.div>
+  );
 };
 
 export default AudioVisualizer;